@@ -0,0 +1,715 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "AsyncWaiter.hpp"
+
+#include "AtomicWait.hpp"
+#include "detail/WatchThread.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+    #include <sys/eventfd.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+
+    #include <linux/futex.h>
+    #include <linux/time_types.h>
+#endif
+
+namespace wjh {
+
+struct AsyncWaiter::Impl
+{
+    virtual ~Impl() { close_signal(); }
+    virtual Backend backend() const noexcept = 0;
+    virtual std::size_t pending() const noexcept = 0;
+    virtual void async_wait(
+        Atomic<std::uint32_t> const & word,
+        std::uint32_t expected,
+        std::uint64_t user_data) = 0;
+    virtual void async_lock(
+        WaitableProcessIdLock & lock,
+        std::uint64_t user_data) = 0;
+    virtual std::size_t poll(std::span<Completion> out) = 0;
+
+    int fd() const noexcept { return signal_fd_; }
+
+protected:
+    Impl();
+    void signal() noexcept;
+    void drain_signal() noexcept;
+    void close_signal() noexcept;
+
+    int signal_fd_ = -1;
+    int signal_write_fd_ = -1;
+};
+
+namespace {
+using Completion = AsyncWaiter::Completion;
+
+[[noreturn]] void
+throw_errno(char const * what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// The state of an outstanding wait, tagged with its user_data.
+using Op = watch_detail::Watch;
+
+#if defined(__linux__)
+// IORING_OP_FUTEX_WAIT and FUTEX2_SIZE_U32 are newer than the kernel headers
+// we may be compiled against.
+constexpr std::uint8_t op_futex_wait = 51;
+constexpr std::uint32_t futex2_size_u32 = 0x02;
+
+// A minimal io_uring, with just enough to submit requests and reap
+// completions.
+class Ring
+{
+public:
+    // With @p cq_entries, the completion queue has that many entries (or
+    // as many as the kernel allows), rather than twice @p entries.
+    explicit Ring(unsigned entries, unsigned cq_entries = 0)
+    {
+        try {
+            setup(entries, cq_entries);
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~Ring() { release(); }
+
+    void operator = (Ring &&) = delete;
+
+    int fd() const noexcept { return fd_; }
+
+    unsigned cq_entries() const noexcept { return cq_entries_; }
+
+    int register_op(unsigned opcode, void * arg, unsigned nr_args)
+    {
+        return static_cast<int>(
+            ::syscall(__NR_io_uring_register, fd_, opcode, arg, nr_args));
+    }
+
+    ::io_uring_sqe & next_sqe()
+    {
+        auto const tail = *sq_tail_;
+        if (tail - load(sq_head_) == sq_entries_) {
+            submit();
+        }
+        auto const index = tail & sq_mask_;
+        auto & sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sq_array_[index] = index;
+        store(sq_tail_, tail + 1);
+        ++to_submit_;
+        return sqe;
+    }
+
+    void submit()
+    {
+        while (to_submit_ > 0) {
+            auto const n = enter(to_submit_, 0u);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                throw_errno("io_uring_enter");
+            }
+            to_submit_ -= static_cast<unsigned>(n);
+        }
+    }
+
+    template <typename FnT>
+    void reap(FnT && fn)
+    {
+        for (;;) {
+            auto head = *cq_head_;
+            for (auto const tail = load(cq_tail_); head != tail; ++head) {
+                fn(cqes_[head & cq_mask_]);
+            }
+            store(cq_head_, head);
+
+            // Completions that did not fit in the queue wait in the kernel
+            // until they are asked for, now that there is room.
+            if ((load(sq_flags_) & IORING_SQ_CQ_OVERFLOW) == 0) {
+                return;
+            }
+            enter(0u, IORING_ENTER_GETEVENTS);
+        }
+    }
+
+private:
+    long enter(unsigned to_submit, unsigned flags) noexcept
+    {
+        return ::syscall(
+            __NR_io_uring_enter,
+            fd_,
+            to_submit,
+            0u,
+            flags,
+            nullptr,
+            0u);
+    }
+
+    void setup(unsigned entries, unsigned cq_entries)
+    {
+        ::io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        if (cq_entries != 0) {
+            params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+            params.cq_entries = cq_entries;
+        }
+        fd_ = static_cast<int>(
+            ::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ == -1) {
+            throw_errno("io_uring_setup");
+        }
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes +
+            params.cq_entries * sizeof(::io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+        sq_ring_ = map(sq_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = (params.features & IORING_FEAT_SINGLE_MMAP)
+            ? sq_ring_
+            : map(cq_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(::io_uring_sqe);
+        sqes_ = static_cast<::io_uring_sqe *>(
+            map(sqes_size_, IORING_OFF_SQES));
+
+        auto sq = static_cast<char *>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        sq_flags_ = reinterpret_cast<unsigned *>(sq + params.sq_off.flags);
+
+        auto cq = static_cast<char *>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<::io_uring_cqe *>(cq + params.cq_off.cqes);
+        cq_entries_ = params.cq_entries;
+    }
+
+    void release() noexcept
+    {
+        if (sqes_) {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ && cq_ring_ != sq_ring_) {
+            ::munmap(cq_ring_, cq_size_);
+        }
+        if (sq_ring_) {
+            ::munmap(sq_ring_, sq_size_);
+        }
+        if (fd_ != -1) {
+            ::close(fd_);
+        }
+    }
+
+    void * map(std::size_t size, off_t offset)
+    {
+        auto addr = ::mmap(
+            nullptr,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            fd_,
+            offset);
+        if (addr == MAP_FAILED) {
+            throw_errno("mmap io_uring");
+        }
+        return addr;
+    }
+
+    static unsigned load(unsigned * p)
+    {
+        return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire);
+    }
+
+    static void store(unsigned * p, unsigned value)
+    {
+        std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+    }
+
+    int fd_ = -1;
+    void * sq_ring_ = nullptr;
+    void * cq_ring_ = nullptr;
+    ::io_uring_sqe * sqes_ = nullptr;
+    std::size_t sq_size_ = 0;
+    std::size_t cq_size_ = 0;
+    std::size_t sqes_size_ = 0;
+    unsigned * sq_head_ = nullptr;
+    unsigned * sq_tail_ = nullptr;
+    unsigned * sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned * sq_flags_ = nullptr;
+    unsigned * cq_head_ = nullptr;
+    unsigned * cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    unsigned cq_entries_ = 0;
+    ::io_uring_cqe * cqes_ = nullptr;
+    unsigned to_submit_ = 0;
+};
+
+bool
+probe_io_uring_futex()
+{
+    try {
+        auto ring = Ring(2);
+        constexpr unsigned nops = 256;
+        auto const size = sizeof(::io_uring_probe) +
+            nops * sizeof(::io_uring_probe_op);
+        auto storage = std::vector<unsigned char>(size);
+        auto probe = reinterpret_cast<::io_uring_probe *>(storage.data());
+        if (ring.register_op(IORING_REGISTER_PROBE, probe, nops) != 0) {
+            return false;
+        }
+        return probe->last_op >= op_futex_wait &&
+            (probe->ops[op_futex_wait].flags & IO_URING_OP_SUPPORTED);
+    } catch (std::system_error const &) {
+        return false;
+    }
+}
+
+class UringImpl final
+: public AsyncWaiter::Impl
+{
+    // Completions for link timeouts are tagged, so they can be ignored.
+    static constexpr std::uint64_t timeout_tag = std::uint64_t(1) << 63;
+
+    // Waits stay in the kernel until they complete, so the completion
+    // queue is much larger than the submission queue.
+    static constexpr unsigned submission_entries = 64;
+    static constexpr unsigned completion_entries = 4096;
+
+public:
+    UringImpl()
+    : ring_(submission_entries, completion_entries)
+    {
+        if (ring_.register_op(IORING_REGISTER_EVENTFD, &signal_fd_, 1) != 0) {
+            throw_errno("IORING_REGISTER_EVENTFD");
+        }
+    }
+
+    ~UringImpl() override
+    {
+        // Closing the ring cancels the outstanding requests.
+        for (auto & op : ops_) {
+            op.finish();
+        }
+    }
+
+    void operator = (UringImpl &&) = delete;
+
+    AsyncWaiter::Backend backend() const noexcept override
+    {
+        return AsyncWaiter::Backend::io_uring;
+    }
+
+    std::size_t pending() const noexcept override
+    {
+        return ops_.size() - free_.size() + ready_.size();
+    }
+
+    void async_wait(
+        Atomic<std::uint32_t> const & word,
+        std::uint32_t expected,
+        std::uint64_t user_data) override
+    {
+        start(watch_detail::watch_word(word, expected, user_data));
+    }
+
+    void async_lock(WaitableProcessIdLock & lock, std::uint64_t user_data)
+        override
+    {
+        auto op = watch_detail::watch_lock(lock, user_data);
+        if (op.try_lock()) {
+            op.finish();
+            complete(user_data);
+        } else {
+            submit(allocate(op));
+        }
+    }
+
+    std::size_t poll(std::span<Completion> out) override
+    {
+        drain_signal();
+        ring_.reap([this](::io_uring_cqe const & cqe) {
+            --in_flight_;
+            if (cqe.user_data & timeout_tag) {
+                return;
+            }
+            resume(static_cast<std::uint32_t>(cqe.user_data));
+        });
+
+        // Deferred waits go in as room frees up, and any whose word has
+        // changed meanwhile complete without going in at all.
+        for (auto n = deferred_.size(); n > 0; --n) {
+            auto const index = deferred_.front();
+            deferred_.pop_front();
+            resume(index);
+        }
+        ring_.submit();
+
+        std::size_t n = 0;
+        for (; n < out.size() && not ready_.empty(); ++n) {
+            out[n] = ready_.front();
+            ready_.pop_front();
+        }
+        if (not ready_.empty()) {
+            signal();
+        }
+        return n;
+    }
+
+private:
+    void start(Op const & op)
+    {
+        if (op.word->load() != op.expected) {
+            complete(op.tag);
+        } else {
+            submit(allocate(op));
+        }
+    }
+
+    void complete(std::uint64_t user_data)
+    {
+        ready_.push_back(Completion{user_data});
+        signal();
+    }
+
+    // Complete the op at @p index if it is done, or wait for it again.
+    void resume(std::uint32_t index)
+    {
+        auto & op = ops_[index];
+        if (op.done()) {
+            op.finish();
+            ready_.push_back(Completion{op.tag});
+            op = Op{};
+            free_.push_back(index);
+        } else {
+            submit(index);
+        }
+    }
+
+    std::uint32_t allocate(Op const & op)
+    {
+        if (free_.empty()) {
+            ops_.push_back(op);
+            return static_cast<std::uint32_t>(ops_.size() - 1);
+        }
+        auto const index = free_.back();
+        free_.pop_back();
+        ops_[index] = op;
+        return index;
+    }
+
+    // Submit the wait of the op at @p index, unless its completions might
+    // not fit in the completion queue; then defer it until poll() has
+    // reaped some.
+    void submit(std::uint32_t index)
+    {
+        auto & op = ops_[index];
+        auto const completions = op.lock ? 2u : 1u;
+        if (in_flight_ + completions > ring_.cq_entries()) {
+            deferred_.push_back(index);
+            return;
+        }
+        in_flight_ += completions;
+        auto & sqe = ring_.next_sqe();
+        prep_futex_wait(sqe, *op.word, op.expected, index);
+        if (op.lock) {
+            // The owner might die holding the lock, and then nobody would
+            // notify us, so bound the wait with a linked timeout.
+            sqe.flags |= IOSQE_IO_LINK;
+            auto & timeout = ring_.next_sqe();
+            timeout.opcode = IORING_OP_LINK_TIMEOUT;
+            timeout.addr = reinterpret_cast<std::uintptr_t>(&link_timeout_);
+            timeout.len = 1;
+            timeout.user_data = timeout_tag | index;
+        }
+        ring_.submit();
+    }
+
+    static constexpr ::__kernel_timespec link_timeout_ = {
+        .tv_sec = 0,
+        .tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       WaitableProcessIdLock::owner_check_interval)
+                       .count()};
+
+    Ring ring_;
+    std::vector<Op> ops_;
+    std::vector<std::uint32_t> free_;
+    std::deque<Completion> ready_;
+    // The completions the kernel may yet post.
+    unsigned in_flight_ = 0;
+    std::deque<std::uint32_t> deferred_;
+};
+#endif
+
+// The fallback: a helper thread waits on all of the words at once.
+class ThreadImpl final
+: public AsyncWaiter::Impl
+{
+public:
+    ThreadImpl()
+    : watcher_([this] { signal(); }, nullptr)
+    { }
+
+    void operator = (ThreadImpl &&) = delete;
+
+    AsyncWaiter::Backend backend() const noexcept override
+    {
+        return AsyncWaiter::Backend::thread;
+    }
+
+    std::size_t pending() const noexcept override
+    {
+        return watcher_.pending();
+    }
+
+    void async_wait(
+        Atomic<std::uint32_t> const & word,
+        std::uint32_t expected,
+        std::uint64_t user_data) override
+    {
+        if (watcher_.add(watch_detail::watch_word(word, expected, user_data)))
+        {
+            signal();
+        }
+    }
+
+    void async_lock(WaitableProcessIdLock & lock, std::uint64_t user_data)
+        override
+    {
+        if (watcher_.add(watch_detail::watch_lock(lock, user_data))) {
+            signal();
+        }
+    }
+
+    std::size_t poll(std::span<Completion> out) override
+    {
+        drain_signal();
+        std::uint64_t tags[64];
+        std::size_t n = 0;
+        while (n < out.size()) {
+            auto const want = std::min(std::size(tags), out.size() - n);
+            auto const taken = watcher_.take(std::span(tags).first(want));
+            if (taken == 0) {
+                break;
+            }
+            for (std::size_t i = 0; i < taken; ++i) {
+                out[n++] = Completion{tags[i]};
+            }
+        }
+        if (watcher_.ready() != 0) {
+            signal();
+        }
+        return n;
+    }
+
+private:
+    watch_detail::WatchThread watcher_;
+};
+
+} // anonymous namespace
+
+AsyncWaiter::Impl::
+Impl()
+{
+#if defined(__linux__)
+    signal_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (signal_fd_ == -1) {
+        throw_errno("eventfd");
+    }
+    signal_write_fd_ = signal_fd_;
+#else
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        throw_errno("pipe");
+    }
+    for (auto fd : fds) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    signal_fd_ = fds[0];
+    signal_write_fd_ = fds[1];
+#endif
+}
+
+void
+AsyncWaiter::Impl::
+signal() noexcept
+{
+    std::uint64_t const one = 1;
+    [[maybe_unused]] auto n = ::write(signal_write_fd_, &one, sizeof(one));
+}
+
+void
+AsyncWaiter::Impl::
+drain_signal() noexcept
+{
+    std::uint64_t buffer[8];
+    while (::read(signal_fd_, buffer, sizeof(buffer)) > 0) { }
+}
+
+void
+AsyncWaiter::Impl::
+close_signal() noexcept
+{
+    if (signal_write_fd_ != signal_fd_) {
+        ::close(signal_write_fd_);
+    }
+    ::close(signal_fd_);
+}
+
+#if defined(__linux__)
+void
+prep_futex_wait(
+    ::io_uring_sqe & sqe,
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t expected,
+    std::uint64_t user_data) noexcept
+{
+    // Mirrors io_uring_prep_futex_wait() from liburing: the futex2 flags go
+    // in fd, the value in off, and the wake mask in addr3.  No
+    // FUTEX2_PRIVATE, because the word is shared between processes.
+    sqe.opcode = op_futex_wait;
+    sqe.fd = static_cast<std::int32_t>(futex2_size_u32);
+    sqe.addr = reinterpret_cast<std::uintptr_t>(std::addressof(word));
+    sqe.off = expected;
+    sqe.addr3 = FUTEX_BITSET_MATCH_ANY;
+    sqe.user_data = user_data;
+}
+#endif
+
+bool
+io_uring_futex_supported() noexcept
+{
+#if defined(__linux__)
+    static bool const supported = probe_io_uring_futex();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+AsyncWaiter::
+AsyncWaiter(std::optional<Backend> backend)
+{
+    if (not backend) {
+        backend = io_uring_futex_supported() ? Backend::io_uring
+                                             : Backend::thread;
+    }
+    if (*backend == Backend::thread) {
+        impl_ = std::make_unique<ThreadImpl>();
+        return;
+    }
+#if defined(__linux__)
+    if (io_uring_futex_supported()) {
+        impl_ = std::make_unique<UringImpl>();
+        return;
+    }
+#endif
+    throw std::invalid_argument("io_uring futex waits are not supported");
+}
+
+AsyncWaiter::
+~AsyncWaiter() = default;
+
+AsyncWaiter::Backend
+AsyncWaiter::
+backend() const noexcept
+{
+    return impl_->backend();
+}
+
+int
+AsyncWaiter::
+fd() const noexcept
+{
+    return impl_->fd();
+}
+
+std::size_t
+AsyncWaiter::
+pending() const noexcept
+{
+    return impl_->pending();
+}
+
+void
+AsyncWaiter::
+async_wait(
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t expected,
+    std::uint64_t user_data)
+{
+    impl_->async_wait(word, expected, user_data);
+}
+
+void
+AsyncWaiter::
+async_lock(WaitableProcessIdLock & lock, std::uint64_t user_data)
+{
+    impl_->async_lock(lock, user_data);
+}
+
+std::size_t
+AsyncWaiter::
+poll(std::span<Completion> out)
+{
+    return impl_->poll(out);
+}
+
+std::size_t
+AsyncWaiter::
+wait(std::span<Completion> out, std::optional<std::chrono::nanoseconds> timeout)
+{
+    using Clock = std::chrono::steady_clock;
+    auto const deadline = timeout ? Clock::now() + *timeout
+                                  : Clock::time_point{};
+    for (;;) {
+        if (auto n = poll(out); n > 0 || out.empty()) {
+            return n;
+        }
+        int ms = -1;
+        if (timeout) {
+            auto const remaining =
+                std::chrono::ceil<std::chrono::milliseconds>(
+                    deadline - Clock::now());
+            if (remaining.count() <= 0) {
+                return 0;
+            }
+            ms = static_cast<int>(remaining.count());
+        }
+        ::pollfd pfd{.fd = fd(), .events = POLLIN, .revents = 0};
+        ::poll(&pfd, 1, ms);
+    }
+}
+
+} // namespace wjh
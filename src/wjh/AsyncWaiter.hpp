@@ -0,0 +1,165 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_1a7f3c9e5b2d4806a4e1f7c3b9d2e5a8
+#define WJH_1a7f3c9e5b2d4806a4e1f7c3b9d2e5a8
+
+#include "Atomic.hpp"
+#include "WaitableProcessIdLock.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+
+#if defined(__linux__)
+    #include <linux/io_uring.h>
+#endif
+
+namespace wjh {
+
+#if defined(__linux__)
+/**
+ * Prepare @p sqe as an IORING_OP_FUTEX_WAIT (Linux 6.7+) on @p word.
+ *
+ * This is for applications that drive their own io_uring.  The request
+ * completes with res == -EAGAIN if @p word does not hold @p expected when the
+ * kernel looks at it, and with res == 0 when the word is notified (e.g., by
+ * atomic_notify_all).  As with any futex wait, a completion with res == 0 may
+ * be spurious, so re-check the word.
+ *
+ * The wait uses a shared futex, so it works for words in shared memory that
+ * are notified from other processes.
+ *
+ * @pre  @p sqe has been zeroed, as io_uring_get_sqe() from liburing does.
+ */
+void prep_futex_wait(
+    ::io_uring_sqe & sqe,
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t expected,
+    std::uint64_t user_data) noexcept;
+#endif
+
+/**
+ * Return true if the running kernel supports IORING_OP_FUTEX_WAIT.
+ */
+bool io_uring_futex_supported() noexcept;
+
+/**
+ * Waits on shared-memory words and locks without dedicating a blocked thread
+ * to each one.
+ *
+ * Each wait is submitted with a caller-supplied user_data, and completes once
+ * the awaited condition holds.  Completed waits are reaped with poll() or
+ * wait().  fd() becomes readable whenever there are completions to reap, so
+ * it can be added to an application's epoll set or io_uring (as a poll
+ * request).
+ *
+ * When the kernel supports IORING_OP_FUTEX_WAIT, each wait is a futex wait
+ * request on a private io_uring, whose completions are signaled through a
+ * registered eventfd.  Its completion queue has room for a few thousand
+ * waits; waits beyond that are deferred until earlier ones complete, and
+ * until then are only checked when poll() is called.  Otherwise, a single
+ * helper thread waits on all of the words at once with wait_any(), and
+ * signals the eventfd itself.
+ *
+ * An AsyncWaiter is a process-local object, and is not thread safe.
+ */
+class AsyncWaiter
+{
+public:
+    enum class Backend
+    {
+        io_uring,
+        thread
+    };
+
+    struct Completion
+    {
+        std::uint64_t user_data;
+    };
+
+    /**
+     * Create a waiter, using the best available backend, unless @p backend
+     * is specified.
+     *
+     * @throw  std::system_error if the resources can't be created, or
+     * std::invalid_argument if the io_uring backend was requested but is not
+     * supported.
+     */
+    explicit AsyncWaiter(std::optional<Backend> backend = std::nullopt);
+
+    /**
+     * Abandon all outstanding waits.
+     */
+    ~AsyncWaiter();
+
+    void operator = (AsyncWaiter &&) = delete;
+
+    /**
+     * The backend in use.
+     */
+    Backend backend() const noexcept;
+
+    /**
+     * A file descriptor that is readable while there are completions.
+     */
+    int fd() const noexcept;
+
+    /**
+     * The number of waits that have not yet been reaped.
+     */
+    std::size_t pending() const noexcept;
+
+    /**
+     * Wait, asynchronously, for @p word to hold a value other than
+     * @p expected.
+     *
+     * @pre  @p word remains valid until the wait completes, or this waiter is
+     * destroyed.
+     */
+    void async_wait(
+        Atomic<std::uint32_t> const & word,
+        std::uint32_t expected,
+        std::uint64_t user_data);
+
+    /**
+     * Acquire @p lock, asynchronously.  When the wait completes, the calling
+     * process holds the lock.
+     *
+     * @pre  @p lock remains valid until the wait completes, or this waiter is
+     * destroyed.
+     */
+    void async_lock(WaitableProcessIdLock & lock, std::uint64_t user_data);
+
+    /**
+     * Reap completed waits, without blocking.
+     *
+     * @return  The number of completions written to @p out.
+     */
+    std::size_t poll(std::span<Completion> out);
+
+    /**
+     * Reap completed waits, blocking until there is at least one, or the
+     * timeout elapses.
+     *
+     * @return  The number of completions written to @p out.
+     */
+    std::size_t wait(
+        std::span<Completion> out,
+        std::optional<std::chrono::nanoseconds> timeout = std::nullopt);
+
+    struct Impl;
+
+private:
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace wjh
+
+#endif // WJH_1a7f3c9e5b2d4806a4e1f7c3b9d2e5a8
@@ -144,8 +144,7 @@ public:
                 std::addressof(desired),
                 atomic_detail::native_order<
                     __ATOMIC_RELAXED,
-                    __ATOMIC_ACQUIRE,
-                    __ATOMIC_CONSUME,
+                    __ATOMIC_RELEASE,
                     __ATOMIC_SEQ_CST>(order));
         }
     }
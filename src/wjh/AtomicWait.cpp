@@ -0,0 +1,387 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "AtomicWait.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <time.h>
+
+#if defined(__linux__)
+    #include <sys/syscall.h>
+
+    #include <linux/futex.h>
+    #include <unistd.h>
+
+    #if not defined(__NR_futex_waitv)
+        // Same number on every architecture that uses the generic table.
+        #define __NR_futex_waitv 449
+    #endif
+#endif
+
+namespace wjh {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using Deadline = std::optional<Clock::time_point>;
+
+static_assert(std::is_standard_layout_v<Atomic<std::uint32_t>>);
+static_assert(sizeof(Atomic<std::uint32_t>) == sizeof(std::uint32_t));
+
+std::uint32_t const *
+address_of(Atomic<std::uint32_t> const & word)
+{
+    // Atomic is standard layout, and its only member is the value.
+    return reinterpret_cast<std::uint32_t const *>(std::addressof(word));
+}
+
+Deadline
+deadline_from(std::optional<std::chrono::nanoseconds> timeout)
+{
+    if (timeout) {
+        return Clock::now() + *timeout;
+    }
+    return std::nullopt;
+}
+
+bool
+expired(Deadline const & deadline)
+{
+    return deadline && Clock::now() >= *deadline;
+}
+
+// Sleep for a bit, backing off exponentially, without overshooting deadline.
+void
+backoff(std::chrono::microseconds & delay, Deadline const & deadline)
+{
+    auto until = Clock::now() + delay;
+    if (deadline) {
+        until = std::min(until, *deadline);
+    }
+    std::this_thread::sleep_until(until);
+    delay = std::min(delay * 2, std::chrono::microseconds(1000));
+}
+
+#if defined(__linux__)
+// steady_clock is CLOCK_MONOTONIC, which is also what the futex calls use for
+// absolute timeouts, so a deadline can be handed straight to the kernel.
+::timespec
+to_timespec(Clock::time_point tp)
+{
+    auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        tp.time_since_epoch())
+                        .count();
+    return ::timespec{
+        .tv_sec = static_cast<::time_t>(ns / 1'000'000'000),
+        .tv_nsec = static_cast<long>(ns % 1'000'000'000)};
+}
+
+long
+futex(std::uint32_t const * addr, int op, std::uint32_t val, ::timespec * ts)
+{
+    // Not FUTEX_PRIVATE_FLAG: these words are shared between processes.
+    return ::syscall(
+        SYS_futex,
+        addr,
+        op,
+        val,
+        ts,
+        nullptr,
+        FUTEX_BITSET_MATCH_ANY);
+}
+
+bool
+wait_until(
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t expected,
+    Deadline const & deadline)
+{
+    if (deadline) {
+        auto ts = to_timespec(*deadline);
+        return futex(address_of(word), FUTEX_WAIT_BITSET, expected, &ts) !=
+            -1 ||
+            errno != ETIMEDOUT;
+    }
+    futex(address_of(word), FUTEX_WAIT, expected, nullptr);
+    return true;
+}
+
+void
+wake(Atomic<std::uint32_t> & word, int count)
+{
+    futex(address_of(word), FUTEX_WAKE, static_cast<std::uint32_t>(count), {});
+}
+
+bool
+probe_futex_waitv()
+{
+    // An empty vector is invalid, but only a kernel that knows the system
+    // call will say so.
+    return ::syscall(__NR_futex_waitv, nullptr, 0u, 0u, nullptr, 0) == -1 &&
+        errno != ENOSYS;
+}
+#else
+bool
+wait_until(
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t expected,
+    Deadline const & deadline)
+{
+    // No portable cross-process wait; poll.
+    auto delay = std::chrono::microseconds(1);
+    while (word.load(std::memory_order_acquire) == expected) {
+        if (expired(deadline)) {
+            return false;
+        }
+        backoff(delay, deadline);
+    }
+    return true;
+}
+
+void
+wake(Atomic<std::uint32_t> &, int)
+{ }
+
+bool
+probe_futex_waitv()
+{
+    return false;
+}
+#endif
+
+std::optional<std::size_t>
+find_ready(std::span<AtomicWaitTarget const> targets)
+{
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        auto const & t = targets[i];
+        if (t.atomic->load(std::memory_order_acquire) != t.expected) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+#if defined(__linux__)
+std::optional<std::size_t>
+wait_any_waitv(
+    std::span<AtomicWaitTarget const> targets,
+    Deadline const & deadline)
+{
+    std::array<::futex_waitv, futex_waitv_max> waiters;
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        waiters[i] = ::futex_waitv{
+            .val = targets[i].expected,
+            .uaddr = reinterpret_cast<std::uintptr_t>(
+                address_of(*targets[i].atomic)),
+            .flags = FUTEX_32,
+            .__reserved = 0};
+    }
+
+    auto ts = deadline ? to_timespec(*deadline) : ::timespec{};
+    for (;;) {
+        // Returns immediately (EAGAIN) if any word no longer matches.
+        auto const r = ::syscall(
+            __NR_futex_waitv,
+            waiters.data(),
+            static_cast<unsigned>(targets.size()),
+            0u,
+            deadline ? &ts : nullptr,
+            CLOCK_MONOTONIC);
+        if (auto ready = find_ready(targets)) {
+            return ready;
+        }
+        if (r == -1) {
+            auto const error = errno;
+            if (error == ETIMEDOUT) {
+                return std::nullopt;
+            }
+            if (error != EAGAIN && error != EINTR) {
+                throw std::system_error(
+                    error,
+                    std::generic_category(),
+                    "futex_waitv");
+            }
+        }
+    }
+}
+#endif
+
+std::optional<std::size_t>
+wait_any_doorbell(
+    std::span<AtomicWaitTarget const> targets,
+    Deadline const & deadline,
+    IpcDoorbell & doorbell)
+{
+    for (;;) {
+        auto const key = doorbell.prepare_wait();
+        if (auto ready = find_ready(targets)) {
+            doorbell.cancel_wait();
+            return ready;
+        }
+        std::optional<std::chrono::nanoseconds> remaining;
+        if (deadline) {
+            remaining = std::max(
+                std::chrono::nanoseconds(0),
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    *deadline - Clock::now()));
+        }
+        if (not doorbell.wait(key, remaining)) {
+            return find_ready(targets);
+        }
+    }
+}
+
+std::optional<std::size_t>
+wait_any_poll(
+    std::span<AtomicWaitTarget const> targets,
+    Deadline const & deadline)
+{
+    auto delay = std::chrono::microseconds(1);
+    for (;;) {
+        if (auto ready = find_ready(targets)) {
+            return ready;
+        }
+        if (expired(deadline)) {
+            return std::nullopt;
+        }
+        backoff(delay, deadline);
+    }
+}
+
+std::optional<std::size_t>
+wait_any_until(
+    std::span<AtomicWaitTarget const> targets,
+    Deadline const & deadline,
+    IpcDoorbell * doorbell)
+{
+    if (targets.empty()) {
+        throw std::invalid_argument("wait_any needs at least one target");
+    }
+    if (auto ready = find_ready(targets)) {
+        return ready;
+    }
+#if defined(__linux__)
+    if (targets.size() <= futex_waitv_max && futex_waitv_supported()) {
+        return wait_any_waitv(targets, deadline);
+    }
+    if (targets.size() == 1u && not doorbell) {
+        auto const & t = targets.front();
+        while (wait_until(*t.atomic, t.expected, deadline)) {
+            if (auto ready = find_ready(targets)) {
+                return ready;
+            }
+        }
+        return find_ready(targets);
+    }
+#endif
+    if (doorbell) {
+        return wait_any_doorbell(targets, deadline, *doorbell);
+    }
+    return wait_any_poll(targets, deadline);
+}
+
+} // anonymous namespace
+
+bool
+atomic_wait(
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t expected,
+    std::optional<std::chrono::nanoseconds> timeout)
+{
+    return wait_until(word, expected, deadline_from(timeout));
+}
+
+void
+atomic_notify_one(Atomic<std::uint32_t> & word)
+{
+    wake(word, 1);
+}
+
+void
+atomic_notify_all(Atomic<std::uint32_t> & word)
+{
+    wake(word, INT_MAX);
+}
+
+std::uint32_t
+IpcDoorbell::
+prepare_wait() noexcept
+{
+    // The increment must precede reading the key, so that a ringer that
+    // sees no waiters has necessarily bumped the key we are about to read.
+    waiters_.fetch_add(1u);
+    return seq_.load();
+}
+
+void
+IpcDoorbell::
+cancel_wait() noexcept
+{
+    waiters_.fetch_sub(1u);
+}
+
+bool
+IpcDoorbell::
+wait(std::uint32_t key, std::optional<std::chrono::nanoseconds> timeout)
+{
+    auto const deadline = deadline_from(timeout);
+    while (seq_.load(std::memory_order_acquire) == key) {
+        if (not wait_until(seq_, key, deadline)) {
+            break;
+        }
+    }
+    waiters_.fetch_sub(1u);
+    return seq_.load(std::memory_order_acquire) != key;
+}
+
+void
+IpcDoorbell::
+ring() noexcept
+{
+    seq_.fetch_add(1u);
+    if (waiters_.load() != 0u) {
+        atomic_notify_all(seq_);
+    }
+}
+
+bool
+futex_waitv_supported() noexcept
+{
+    static bool const supported = probe_futex_waitv();
+    return supported;
+}
+
+std::optional<std::size_t>
+wait_any(
+    std::span<AtomicWaitTarget const> targets,
+    std::chrono::nanoseconds timeout,
+    IpcDoorbell * doorbell)
+{
+    return wait_any_until(targets, Clock::now() + timeout, doorbell);
+}
+
+std::size_t
+wait_any(std::span<AtomicWaitTarget const> targets, IpcDoorbell * doorbell)
+{
+    return *wait_any_until(targets, std::nullopt, doorbell);
+}
+
+void
+notify(Atomic<std::uint32_t> & word, IpcDoorbell * doorbell)
+{
+    atomic_notify_all(word);
+    if (doorbell) {
+        doorbell->ring();
+    }
+}
+
+} // namespace wjh
@@ -0,0 +1,160 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_5e0b8d3f71c24a6f9d1a2c7b4e9f0d36
+#define WJH_5e0b8d3f71c24a6f9d1a2c7b4e9f0d36
+
+#include "Atomic.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+namespace wjh {
+
+/**
+ * Block while @p word holds @p expected, until woken or @p timeout elapses.
+ *
+ * Unlike std::atomic::wait, this works across processes: the underlying
+ * futex is a shared futex, so @p word may live in shared memory or an mmap
+ * file, and be notified from any process that maps it.
+ *
+ * @return  false if the timeout elapsed; true otherwise.  As with all futex
+ * based waits, a true return may be spurious, so callers must re-check.
+ */
+bool atomic_wait(
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t expected,
+    std::optional<std::chrono::nanoseconds> timeout = std::nullopt);
+
+/**
+ * Wake one thread, in any process, blocked on @p word.
+ */
+void atomic_notify_one(Atomic<std::uint32_t> & word);
+
+/**
+ * Wake all threads, in any process, blocked on @p word.
+ */
+void atomic_notify_all(Atomic<std::uint32_t> & word);
+
+/**
+ * An inter-process event count.
+ *
+ * A waiter takes a key with prepare_wait(), checks its condition, and then
+ * waits on the key.  A notifier changes the condition and then rings the
+ * doorbell.  A ring that happens after prepare_wait() causes the wait to
+ * return immediately, so wakeups are never lost.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized doorbell is ready for use.
+ */
+class IpcDoorbell
+{
+public:
+    /**
+     * Register interest in the doorbell, and return the key to wait on.
+     *
+     * @note  Every call must be balanced with a call to either wait() or
+     * cancel_wait().
+     */
+    std::uint32_t prepare_wait() noexcept;
+
+    /**
+     * Withdraw the interest registered by prepare_wait().
+     */
+    void cancel_wait() noexcept;
+
+    /**
+     * Block until the doorbell has been rung since @p key was obtained, or
+     * @p timeout elapses.
+     *
+     * @return  false if the timeout elapsed; true otherwise.
+     */
+    bool wait(
+        std::uint32_t key,
+        std::optional<std::chrono::nanoseconds> timeout = std::nullopt);
+
+    /**
+     * Wake all threads waiting on the doorbell.
+     *
+     * @note  This only makes a system call if there are waiters.
+     */
+    void ring() noexcept;
+
+private:
+    Atomic<std::uint32_t> seq_;
+    Atomic<std::uint32_t> waiters_;
+};
+
+static_assert(std::is_trivially_constructible_v<IpcDoorbell>);
+
+/**
+ * One of the words a call to wait_any() watches.  The target is "ready" when
+ * the value of @p atomic is no longer @p expected.
+ */
+struct AtomicWaitTarget
+{
+    Atomic<std::uint32_t> const * atomic;
+    std::uint32_t expected;
+};
+
+/**
+ * The maximum number of targets that can be handed to a single futex_waitv
+ * system call.  Larger sets are handled with the doorbell.
+ */
+inline constexpr std::size_t futex_waitv_max = 128;
+
+/**
+ * Return true if the running kernel supports futex_waitv (Linux 5.16+).
+ */
+bool futex_waitv_supported() noexcept;
+
+/**
+ * Block until any of @p targets is ready, or @p timeout elapses.
+ *
+ * When the kernel supports it, and there are no more than futex_waitv_max
+ * targets, this is a single futex_waitv system call over all of the words.
+ * Otherwise, this waits on @p doorbell, which notifiers must ring after
+ * changing a word; see notify().  Without a doorbell, the fallback is to poll
+ * with an exponential backoff.
+ *
+ * @return  The index of a ready target, or std::nullopt if the timeout
+ * elapsed first.  If several targets are ready, the lowest index is returned.
+ *
+ * @throw  std::invalid_argument if @p targets is empty.
+ * @throw  std::system_error if the wait fails other than by timing out.
+ */
+std::optional<std::size_t> wait_any(
+    std::span<AtomicWaitTarget const> targets,
+    std::chrono::nanoseconds timeout,
+    IpcDoorbell * doorbell = nullptr);
+
+/**
+ * Block until any of @p targets is ready.
+ *
+ * @return  The index of a ready target.
+ *
+ * @throw  std::invalid_argument if @p targets is empty.
+ * @throw  std::system_error if the wait fails.
+ */
+std::size_t wait_any(
+    std::span<AtomicWaitTarget const> targets,
+    IpcDoorbell * doorbell = nullptr);
+
+/**
+ * Wake everything waiting on @p word, whether through atomic_wait() or
+ * wait_any(), and ring @p doorbell, if one is given.
+ *
+ * @pre  The new value has already been stored into @p word.
+ */
+void notify(Atomic<std::uint32_t> & word, IpcDoorbell * doorbell = nullptr);
+
+} // namespace wjh
+
+#endif // WJH_5e0b8d3f71c24a6f9d1a2c7b4e9f0d36
@@ -0,0 +1,288 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "BiasedProcessIdLock.hpp"
+
+#include <atomic>
+#include <thread>
+
+#if defined(__linux__)
+    #include <sys/syscall.h>
+
+    #include <linux/membarrier.h>
+    #include <unistd.h>
+#elif defined(__APPLE__) && defined(__MACH__)
+    #include <pthread.h>
+#endif
+
+namespace wjh {
+
+namespace {
+using PID = ProcessId;
+
+std::uint64_t
+mix(std::uint64_t x)
+{
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58'476d'1ce4'e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d0'49bb'1331'11ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+std::uint64_t
+native_thread_id()
+{
+#if defined(__linux__)
+    return static_cast<std::uint64_t>(::syscall(SYS_gettid));
+#elif defined(__APPLE__) && defined(__MACH__)
+    std::uint64_t result = 0;
+    ::pthread_threadid_np(nullptr, &result);
+    return result;
+#endif
+}
+
+// A 64-bit value that identifies the calling thread across all processes.
+// The low bit is always clear, so it can be combined with the enabled bit.
+std::uint64_t
+thread_token()
+{
+    struct Cache
+    {
+        PID pid;
+        std::uint64_t token;
+    };
+    thread_local Cache cache{};
+
+    // The thread id of the forking thread changes in the child, but its
+    // thread-local storage does not, so the cache is keyed on the ProcessId.
+    if (auto const me = PID::current(); cache.pid != me) {
+        auto const tv = me.start_time();
+        auto token = mix(static_cast<std::uint64_t>(me.pid()));
+        token = mix(token ^ static_cast<std::uint64_t>(tv.tv_sec));
+        token = mix(token ^ static_cast<std::uint64_t>(tv.tv_usec));
+        token = mix(token ^ native_thread_id());
+        cache.pid = me;
+        cache.token = (token & ~std::uint64_t(1)) | 2u;
+    }
+    return cache.token;
+}
+
+#if defined(__linux__)
+int
+membarrier(int cmd)
+{
+    return static_cast<int>(::syscall(__NR_membarrier, cmd, 0u, 0));
+}
+
+bool
+query_asymmetric()
+{
+    constexpr int needed = MEMBARRIER_CMD_GLOBAL_EXPEDITED |
+        MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED;
+    auto const cmds = membarrier(MEMBARRIER_CMD_QUERY);
+    return cmds != -1 && (cmds & needed) == needed;
+}
+
+    #if defined(__clang__)
+        #pragma clang diagnostic push
+        #pragma clang diagnostic ignored "-Wglobal-constructors"
+    #endif
+static bool const asymmetric = query_asymmetric();
+    #if defined(__clang__)
+        #pragma clang diagnostic pop
+    #endif
+
+bool
+register_home()
+{
+    // Registration is idempotent, and is only done on the (rare) path that
+    // establishes a bias, so we don't bother remembering that it was done.
+    return not asymmetric ||
+        membarrier(MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED) == 0;
+}
+
+void
+light_barrier() noexcept
+{
+    if (asymmetric) {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    } else {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void
+heavy_barrier()
+{
+    if (not asymmetric) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    } else if (membarrier(MEMBARRIER_CMD_GLOBAL_EXPEDITED) != 0) {
+        // Should not happen, but the non-expedited command is always correct,
+        // just slow.
+        membarrier(MEMBARRIER_CMD_GLOBAL);
+    }
+}
+#else
+bool
+register_home()
+{
+    return true;
+}
+
+void
+light_barrier() noexcept
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void
+heavy_barrier()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+#endif
+
+} // anonymous namespace
+
+bool
+BiasedProcessIdLock::
+try_lock()
+{
+    auto const token = thread_token();
+    if (try_fast_lock(token)) {
+        return true;
+    }
+    if (not lock_.try_lock()) {
+        return false;
+    }
+    if (not revoke(false)) {
+        lock_.unlock();
+        return false;
+    }
+    note_slow_acquire(token);
+    return true;
+}
+
+void
+BiasedProcessIdLock::
+lock()
+{
+    auto const token = thread_token();
+    if (try_fast_lock(token)) {
+        return;
+    }
+    lock_.lock();
+    revoke(true);
+    note_slow_acquire(token);
+}
+
+void
+BiasedProcessIdLock::
+unlock()
+{
+    // Only the home thread ever sets in_cs_, and the home thread can't be
+    // replaced while in_cs_ is set, so this can't see a false positive.
+    auto const token = thread_token();
+    if ((bias_.load(std::memory_order_relaxed) & ~enabled) == token &&
+        in_cs_.load(std::memory_order_relaxed) != 0u)
+    {
+        in_cs_.store(0u, std::memory_order_release);
+    } else {
+        lock_.unlock();
+    }
+}
+
+bool
+BiasedProcessIdLock::
+biased() const noexcept
+{
+    return (bias_.load(std::memory_order_relaxed) & enabled) != 0u;
+}
+
+bool
+BiasedProcessIdLock::
+try_fast_lock(std::uint64_t token) noexcept
+{
+    auto const mine = token | enabled;
+    if (bias_.load(std::memory_order_relaxed) != mine) {
+        return false;
+    }
+
+    // Announce ourselves, then make sure the bias was not revoked in the
+    // meantime.  The revoker does the opposite (clears the bias, then looks
+    // for us), and its heavy barrier orders our store before our load.
+    in_cs_.store(1u, std::memory_order_relaxed);
+    light_barrier();
+    if (bias_.load(std::memory_order_relaxed) == mine) {
+        std::atomic_signal_fence(std::memory_order_acquire);
+        return true;
+    }
+    in_cs_.store(0u, std::memory_order_release);
+    return false;
+}
+
+bool
+BiasedProcessIdLock::
+revoke(bool wait)
+{
+    // Only the holder of lock_ modifies bias_, and we hold lock_.
+    if (auto const b = bias_.load(std::memory_order_relaxed); b & enabled) {
+        bias_.store(b & ~enabled);
+        heavy_barrier();
+    }
+
+    // Wait for the home thread to leave a critical section it entered
+    // through the fast path.  If the home process died in there, we peel the
+    // lock from its cold dead hands, just as ProcessIdLock does.
+    for (unsigned spins = 0; in_cs_.load(std::memory_order_acquire) != 0u;
+         ++spins)
+    {
+        if ((not wait || spins % 64u == 63u) && not home_.load().alive()) {
+            in_cs_.store(0u, std::memory_order_relaxed);
+            break;
+        }
+        if (not wait) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+void
+BiasedProcessIdLock::
+note_slow_acquire(std::uint64_t token)
+{
+    // Everything in here is done while holding lock_.
+    auto streak = std::uint32_t(1);
+    if (last_.load(std::memory_order_relaxed) == token) {
+        streak += streak_.load(std::memory_order_relaxed);
+    } else {
+        last_.store(token, std::memory_order_relaxed);
+    }
+    if (streak < rebias_threshold) {
+        streak_.store(streak, std::memory_order_relaxed);
+        return;
+    }
+    streak_.store(0u, std::memory_order_relaxed);
+
+    // A thread that was once the home thread may still be in the middle of
+    // the fast path, about to announce itself in in_cs_.  Thus, the home may
+    // only move to another thread if the previous home's process is gone.
+    auto const home = bias_.load(std::memory_order_relaxed) & ~enabled;
+    if (home != 0u && home != token && home_.load().alive()) {
+        return;
+    }
+    if (register_home()) {
+        home_.store(PID::current());
+        bias_.store(token | enabled);
+    }
+}
+
+} // namespace wjh
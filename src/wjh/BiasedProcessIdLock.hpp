@@ -0,0 +1,112 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_3c1e9a52d7f04b6e8a4f0b21c6d8e573
+#define WJH_3c1e9a52d7f04b6e8a4f0b21c6d8e573
+
+#include "Atomic.hpp"
+#include "ProcessId.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace wjh {
+
+/**
+ * An inter-process lock that is biased toward a single "home" thread.
+ *
+ * Many locks are taken almost exclusively by one thread of one process.  For
+ * such locks, the read-modify-write operation of a ProcessIdLock is pure
+ * overhead.  When this lock is biased, the home thread acquires and releases
+ * it with plain loads and stores, separated only by a compiler barrier.
+ *
+ * Any other thread, in this or another process, that wants the lock first
+ * acquires the underlying ProcessIdLock and then revokes the bias.  Revocation
+ * uses membarrier(MEMBARRIER_CMD_GLOBAL_EXPEDITED) to force a full memory
+ * barrier on every running thread of the home process, which pairs with the
+ * compiler barrier in the home thread's fast path (an asymmetric Dekker
+ * handshake).  The revoker then waits for the home thread to leave any
+ * critical section it entered through the fast path.  After revocation the
+ * lock behaves exactly like a ProcessIdLock.
+ *
+ * The bias is re-established adaptively: once a single thread has acquired
+ * the lock through the slow path rebias_threshold times in a row, the lock is
+ * biased toward that thread again.  The home may only move to a different
+ * thread if the lock has never been biased, or if the process of the previous
+ * home thread has exited, because a live former home thread could still be in
+ * the middle of its fast path.
+ *
+ * On systems without membarrier, the home thread uses a full fence in place
+ * of the compiler barrier.  That still avoids the read-modify-write operation
+ * and keeps the lock's cache line local to the home thread.
+ *
+ * Like ProcessIdLock, this is an implicit lifetime type, and can be placed in
+ * shared memory and mmap files.  A zero-initialized lock is unlocked and
+ * unbiased.  If the home process dies while inside its critical section, the
+ * next revoker recovers the lock.
+ *
+ * @note  A lock acquired by the home thread through the fast path must be
+ * released by that same thread.
+ */
+struct BiasedProcessIdLock
+{
+    /**
+     * The number of consecutive slow-path acquisitions by a single thread
+     * after which the lock becomes biased toward that thread.
+     */
+    static constexpr std::uint32_t rebias_threshold = 64;
+
+    /**
+     * Try to obtain the lock.
+     *
+     * @return  true if the calling thread obtained the lock; false otherwise.
+     *
+     * @pre  Calling thread does not already hold the lock.
+     */
+    bool try_lock();
+
+    /**
+     * Obtain the lock, blocking (busy-wait) until the lock has been obtained.
+     *
+     * @pre  Calling thread does not already hold the lock.
+     */
+    void lock();
+
+    /**
+     * Unlocks the lock.
+     *
+     * @pre  Calling thread holds the lock.
+     */
+    void unlock();
+
+    /**
+     * Return true if the lock is currently biased toward some thread.
+     */
+    bool biased() const noexcept;
+
+private:
+    bool try_fast_lock(std::uint64_t token) noexcept;
+    bool revoke(bool wait);
+    void note_slow_acquire(std::uint64_t token);
+
+    // The low bit of bias_ says whether the bias is enabled; the remaining
+    // bits identify the home thread, even after the bias has been revoked.
+    static constexpr std::uint64_t enabled = 1;
+
+    Atomic<std::uint64_t> bias_;
+    Atomic<std::uint32_t> in_cs_;
+    Atomic<std::uint32_t> streak_;
+    Atomic<std::uint64_t> last_;
+    Atomic<ProcessId> home_;
+    ProcessIdLock lock_;
+};
+
+static_assert(std::is_trivially_constructible_v<BiasedProcessIdLock>);
+
+} // namespace wjh
+
+#endif // WJH_3c1e9a52d7f04b6e8a4f0b21c6d8e573
@@ -0,0 +1,103 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "CoroutineWaker.hpp"
+
+#include "detail/WatchThread.hpp"
+
+#include <cstdint>
+#include <utility>
+
+namespace wjh {
+
+namespace {
+
+std::uint64_t
+tag_of(std::coroutine_handle<> handle) noexcept
+{
+    return reinterpret_cast<std::uintptr_t>(handle.address());
+}
+
+std::coroutine_handle<>
+handle_of(std::uint64_t tag) noexcept
+{
+    return std::coroutine_handle<>::from_address(
+        reinterpret_cast<void *>(static_cast<std::uintptr_t>(tag)));
+}
+
+} // anonymous namespace
+
+struct CoroutineWaker::Impl
+{
+    Impl(ResumeHook resume, IpcDoorbell * doorbell)
+    : resume_(std::move(resume))
+    , watcher_([this] { resume_ready(); }, doorbell)
+    { }
+
+    void operator = (Impl &&) = delete;
+
+    // Called on the helper thread, which resumes coroutines itself unless
+    // there is a hook.
+    void resume_ready()
+    {
+        std::uint64_t tags[64];
+        while (auto const n = watcher_.take(tags)) {
+            for (std::size_t i = 0; i < n; ++i) {
+                if (resume_) {
+                    resume_(handle_of(tags[i]));
+                } else {
+                    handle_of(tags[i]).resume();
+                }
+            }
+        }
+    }
+
+    ResumeHook resume_;
+    watch_detail::WatchThread watcher_;
+};
+
+CoroutineWaker::
+CoroutineWaker(ResumeHook resume, IpcDoorbell * doorbell)
+: impl_(std::make_unique<Impl>(std::move(resume), doorbell))
+{ }
+
+CoroutineWaker::
+~CoroutineWaker() = default;
+
+CoroutineWaker &
+CoroutineWaker::
+instance()
+{
+    static CoroutineWaker waker;
+    return waker;
+}
+
+void
+CoroutineWaker::
+watch(
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t expected,
+    std::coroutine_handle<> handle)
+{
+    impl_->watcher_.add(
+        watch_detail::watch_word(word, expected, tag_of(handle)));
+}
+
+void
+CoroutineWaker::
+watch(WaitableProcessIdLock & lock, std::coroutine_handle<> handle)
+{
+    impl_->watcher_.add(watch_detail::watch_lock(lock, tag_of(handle)));
+}
+
+std::size_t
+CoroutineWaker::
+pending() const noexcept
+{
+    return impl_->watcher_.pending();
+}
+
+} // namespace wjh
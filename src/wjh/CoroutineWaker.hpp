@@ -0,0 +1,180 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_5d0b8e3f2a7c4916b8d4e6a1c3f9b7e2
+#define WJH_5d0b8e3f2a7c4916b8d4e6a1c3f9b7e2
+
+#include "Atomic.hpp"
+#include "AtomicWait.hpp"
+#include "WaitableProcessIdLock.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace wjh {
+
+/**
+ * Resumes coroutines that are suspended on shared-memory words and locks.
+ *
+ * A single helper thread waits on every registered word at once with
+ * wait_any(), so any number of suspended coroutines cost one OS thread.  When
+ * a wait is satisfied, the coroutine is handed to the resume hook, which
+ * decides where it runs (e.g., by posting it to an executor).  Without a
+ * hook, coroutines are resumed on the helper thread itself.
+ *
+ * futex_waitv can only wait on futex_waitv_max words at once.  If more
+ * coroutines than that are suspended, the waker sleeps on @p doorbell
+ * instead, so notifiers must ring it, e.g., with notify(word, doorbell).
+ * Without a doorbell, the waker falls back to polling.
+ *
+ * A CoroutineWaker is a process-local object, and its methods are thread
+ * safe.  Destroying it abandons (and never resumes) any suspended coroutines.
+ */
+class CoroutineWaker
+{
+public:
+    using ResumeHook = std::function<void(std::coroutine_handle<>)>;
+
+    /**
+     * Create a waker, and start its helper thread.
+     *
+     * @pre  If provided, @p doorbell outlives the waker.
+     */
+    explicit CoroutineWaker(
+        ResumeHook resume = {},
+        IpcDoorbell * doorbell = nullptr);
+
+    ~CoroutineWaker();
+
+    void operator = (CoroutineWaker &&) = delete;
+
+    /**
+     * The process-wide waker used when none is given.  It resumes
+     * coroutines on its helper thread, and has no doorbell.
+     *
+     * @note  The helper thread does not survive fork(), so a child process
+     * must not use the default waker of its parent.
+     */
+    static CoroutineWaker & instance();
+
+    /**
+     * Resume @p handle once @p word holds a value other than @p expected.
+     */
+    void watch(
+        Atomic<std::uint32_t> const & word,
+        std::uint32_t expected,
+        std::coroutine_handle<> handle);
+
+    /**
+     * Resume @p handle once the calling process holds @p lock.
+     */
+    void watch(WaitableProcessIdLock & lock, std::coroutine_handle<> handle);
+
+    /**
+     * The number of coroutines that are suspended, waiting to be resumed.
+     */
+    std::size_t pending() const noexcept;
+
+    struct Impl;
+
+private:
+    std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * Awaitable returned by wait_async().
+ */
+class AtomicWaitAwaitable
+{
+public:
+    AtomicWaitAwaitable(
+        Atomic<std::uint32_t> const & word,
+        std::uint32_t old,
+        CoroutineWaker & waker) noexcept
+    : word_(word)
+    , old_(old)
+    , waker_(waker)
+    { }
+
+    bool await_ready() const noexcept { return word_.load() != old_; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        waker_.watch(word_, old_, handle);
+    }
+
+    /**
+     * @return  The value of the word when the coroutine runs.
+     */
+    std::uint32_t await_resume() const noexcept { return word_.load(); }
+
+private:
+    Atomic<std::uint32_t> const & word_;
+    std::uint32_t old_;
+    CoroutineWaker & waker_;
+};
+
+/**
+ * Awaitable returned by lock_async().
+ */
+class LockAwaitable
+{
+public:
+    LockAwaitable(WaitableProcessIdLock & lock, CoroutineWaker & waker) noexcept
+    : lock_(lock)
+    , waker_(waker)
+    { }
+
+    bool await_ready() { return lock_.try_lock(); }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        waker_.watch(lock_, handle);
+    }
+
+    void await_resume() const noexcept { }
+
+private:
+    WaitableProcessIdLock & lock_;
+    CoroutineWaker & waker_;
+};
+
+/**
+ * co_await the result to suspend until @p word holds a value other than
+ * @p old.  Unlike atomic_wait(), the coroutine is only resumed once the word
+ * has been seen to differ from @p old, but the word may have changed back by
+ * the time it runs, so the value returned can still be @p old.
+ *
+ * @pre  @p word remains valid until the coroutine is resumed.
+ */
+inline AtomicWaitAwaitable
+wait_async(
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t old,
+    CoroutineWaker & waker = CoroutineWaker::instance()) noexcept
+{
+    return AtomicWaitAwaitable(word, old, waker);
+}
+
+/**
+ * co_await the result to suspend until the calling process holds @p lock.
+ *
+ * @pre  @p lock remains valid until the coroutine is resumed.
+ */
+inline LockAwaitable
+lock_async(
+    WaitableProcessIdLock & lock,
+    CoroutineWaker & waker = CoroutineWaker::instance()) noexcept
+{
+    return LockAwaitable(lock, waker);
+}
+
+} // namespace wjh
+
+#endif // WJH_5d0b8e3f2a7c4916b8d4e6a1c3f9b7e2
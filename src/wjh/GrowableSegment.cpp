@@ -0,0 +1,309 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "GrowableSegment.hpp"
+
+#include "Segment.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace wjh {
+
+using growable_detail::Header;
+
+namespace {
+
+[[noreturn]] void
+throw_errno(char const * what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+int
+open_file(std::filesystem::path const & path, int flags)
+{
+    int fd = ::open(path.c_str(), flags | O_CLOEXEC, 0666);
+    if (fd == -1) {
+        throw_errno("open");
+    }
+    return fd;
+}
+
+std::size_t
+file_size(int fd)
+{
+    struct ::stat st;
+    if (::fstat(fd, &st) != 0) {
+        throw_errno("fstat");
+    }
+    return static_cast<std::size_t>(st.st_size);
+}
+
+std::size_t
+round_up(std::size_t size)
+{
+    auto const page = Segment::page_size();
+    return (size + page - 1) / page * page;
+}
+
+// Make the file at least @p size bytes.  Unlike ftruncate, this never
+// shrinks the file, so it can't race with another process growing it, and
+// it allocates the blocks, so touching the new pages can't fail later with
+// SIGBUS on a full disk.
+void
+extend(int fd, std::size_t size)
+{
+#if defined(__linux__)
+    if (auto error = ::posix_fallocate(fd, 0, static_cast<off_t>(size))) {
+        throw std::system_error(error, std::generic_category(), "fallocate");
+    }
+#else
+    // There is no posix_fallocate, so allocate what we can, and then grow,
+    // but never shrink, the file.  Growth past the first page happens under
+    // the grow lock, so only racing first opens can see the same old size.
+    auto const current = file_size(fd);
+    if (current >= size) {
+        return;
+    }
+    #if defined(__APPLE__)
+    auto store = ::fstore_t{};
+    store.fst_flags = F_ALLOCATECONTIG;
+    store.fst_posmode = F_PEOFPOSMODE;
+    store.fst_length = static_cast<off_t>(size - current);
+    if (::fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        if (::fcntl(fd, F_PREALLOCATE, &store) == -1) {
+            throw_errno("F_PREALLOCATE");
+        }
+    }
+    #endif
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        throw_errno("ftruncate");
+    }
+#endif
+}
+
+// Read the reserve from the header of the file, first setting it to
+// @p request if nobody has yet.
+std::size_t
+file_reserve(int fd, std::size_t request)
+{
+    auto const page = Segment::page_size();
+    void * addr =
+        ::mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        throw_errno("mmap");
+    }
+    auto & header = *static_cast<Header *>(addr);
+    std::uint64_t reserve = 0;
+    if (request != 0) {
+        header.reserve.compare_exchange_strong(reserve, request);
+    }
+    reserve = header.reserve.load();
+    ::munmap(addr, page);
+    return static_cast<std::size_t>(reserve);
+}
+
+} // anonymous namespace
+
+GrowableSegment::
+GrowableSegment(
+    std::filesystem::path path,
+    std::size_t size,
+    std::size_t reserve)
+: path_(std::move(path))
+, fd_(open_file(path_, O_RDWR | O_CREAT))
+{
+    try {
+        extend(fd_, Segment::page_size());
+        auto const request = round_up(std::max<std::size_t>(reserve, 1u));
+        reserve_ = file_reserve(fd_, request);
+        open();
+        grow(size);
+    } catch (...) {
+        if (base_) {
+            ::munmap(base_, Segment::page_size() + reserve_);
+        }
+        ::close(fd_);
+        throw;
+    }
+}
+
+GrowableSegment::
+GrowableSegment(std::filesystem::path path)
+: path_(std::move(path))
+, fd_(open_file(path_, O_RDWR))
+{
+    try {
+        if (file_size(fd_) < Segment::page_size()) {
+            throw std::invalid_argument(
+                path_.string() + " is not a growable segment");
+        }
+        reserve_ = file_reserve(fd_, 0);
+        if (reserve_ == 0 || reserve_ % Segment::page_size() != 0) {
+            throw std::invalid_argument(
+                path_.string() + " is not a growable segment");
+        }
+        open();
+    } catch (...) {
+        if (base_) {
+            ::munmap(base_, Segment::page_size() + reserve_);
+        }
+        ::close(fd_);
+        throw;
+    }
+}
+
+GrowableSegment::
+~GrowableSegment()
+{
+    ::munmap(base_, Segment::page_size() + reserve_);
+    ::close(fd_);
+}
+
+void
+GrowableSegment::
+open()
+{
+    auto const page = Segment::page_size();
+
+    // Reserve the address range without committing any memory to it.
+    void * addr = ::mmap(
+        nullptr,
+        page + reserve_,
+        PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+        -1,
+        0);
+    if (addr == MAP_FAILED) {
+        throw_errno("mmap");
+    }
+    base_ = static_cast<std::byte *>(addr);
+    data_ = base_ + page;
+
+    addr = ::mmap(
+        base_,
+        page,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_FIXED,
+        fd_,
+        0);
+    if (addr == MAP_FAILED) {
+        throw_errno("mmap");
+    }
+    refresh();
+}
+
+Header &
+GrowableSegment::
+header() const noexcept
+{
+    return *reinterpret_cast<Header *>(base_);
+}
+
+std::uint64_t
+GrowableSegment::
+generation() const noexcept
+{
+    return header().generation.load(std::memory_order_acquire);
+}
+
+std::size_t
+GrowableSegment::
+grow(std::size_t size)
+{
+    if (size > reserve_) {
+        throw std::length_error("segment can't grow beyond its reserve");
+    }
+    size = round_up(size);
+    {
+        auto guard = std::lock_guard(header().grow_lock);
+        auto & header = this->header();
+        if (header.size.load(std::memory_order_acquire) < size) {
+            extend(fd_, Segment::page_size() + size);
+            header.size.store(size, std::memory_order_release);
+            header.generation.fetch_add(1u, std::memory_order_release);
+        }
+    }
+    return refresh();
+}
+
+std::size_t
+GrowableSegment::
+refresh()
+{
+    auto guard = std::lock_guard(mutex_);
+    auto const mapped = mapped_.load(std::memory_order_relaxed);
+    auto const size = std::min<std::size_t>(
+        header().size.load(std::memory_order_acquire),
+        reserve_);
+    if (size > mapped) {
+        // Only the new pages are mapped, over the front of what remains of
+        // the reservation, so the pages already in use never move.
+        void * addr = ::mmap(
+            data_ + mapped,
+            size - mapped,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_FIXED,
+            fd_,
+            static_cast<off_t>(Segment::page_size() + mapped));
+        if (addr == MAP_FAILED) {
+            throw_errno("mmap");
+        }
+        mapped_.store(size, std::memory_order_release);
+        return size;
+    }
+    return mapped;
+}
+
+void
+GrowableSegment::
+ensure(std::size_t offset, std::size_t length)
+{
+    if (offset > reserve_ || length > reserve_ - offset ||
+        offset + length > refresh())
+    {
+        throw std::out_of_range("offset is beyond the end of the segment");
+    }
+}
+
+void
+GrowableSegment::
+sync(std::size_t offset, std::size_t length) const
+{
+    auto const page = Segment::page_size();
+    auto const begin = offset / page * page;
+    auto const end = std::min(size(), offset + length);
+    if (begin >= end) {
+        return;
+    }
+    if (::msync(data_ + begin, end - begin, MS_SYNC) != 0) {
+        throw_errno("msync");
+    }
+}
+
+void
+GrowableSegment::
+sync() const
+{
+    if (::msync(base_, Segment::page_size() + size(), MS_SYNC) != 0) {
+        throw_errno("msync");
+    }
+    if (::fsync(fd_) != 0) {
+        throw_errno("fsync");
+    }
+}
+
+} // namespace wjh
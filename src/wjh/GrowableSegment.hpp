@@ -0,0 +1,189 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_c41e7a2d9b6f48e3a05d7c1b8e2f4a69
+#define WJH_c41e7a2d9b6f48e3a05d7c1b8e2f4a69
+
+#include "Atomic.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <type_traits>
+
+namespace wjh {
+
+namespace growable_detail {
+
+/**
+ * The first page of a growable segment file.
+ */
+struct Header
+{
+    // The size of the address range every process reserves, which bounds
+    // the growth of the segment.  Zero until the creator sets it.
+    Atomic<std::uint64_t> reserve;
+    // The size of the data, which is always a multiple of the page size.
+    Atomic<std::uint64_t> size;
+    // Bumped every time the segment grows.
+    Atomic<std::uint64_t> generation;
+    // Serializes growth across processes.
+    ProcessIdLock grow_lock;
+};
+static_assert(std::is_trivially_constructible_v<Header>);
+
+} // namespace growable_detail
+
+/**
+ * A file, mapped shared like a Segment, that can grow while other processes
+ * are using it.
+ *
+ * Each process reserves an address range for the largest size the segment
+ * may reach, and maps the file into the front of it.  Growing the segment
+ * extends the file, and publishes the new size in a header that lives in
+ * the file.  Other processes map the new pages into their reservation the
+ * next time they reach for them, so data() never moves, offsets never
+ * change, and nothing is copied.
+ *
+ * The header takes the first page of the file; data() is the page after it.
+ *
+ * A GrowableSegment is a process-local handle; it is neither copyable nor
+ * movable.  Its member functions are thread safe.
+ */
+class GrowableSegment
+{
+public:
+    /**
+     * Map the file at @p path, creating it if it does not exist, and growing
+     * it to at least @p size bytes of data.
+     *
+     * @param reserve  The largest size the segment can grow to.  It is
+     * rounded up to a multiple of the page size, and only the creator's
+     * value is used; every later process uses the reserve in the file.
+     *
+     * @throw  std::system_error if the file can't be opened, sized, or
+     * mapped.
+     * @throw  std::length_error if @p size is larger than the reserve.
+     */
+    GrowableSegment(
+        std::filesystem::path path,
+        std::size_t size,
+        std::size_t reserve);
+
+    /**
+     * Map the existing growable segment file at @p path.
+     *
+     * @throw  std::system_error if the file can't be opened or mapped.
+     * @throw  std::invalid_argument if the file is not a growable segment.
+     */
+    explicit GrowableSegment(std::filesystem::path path);
+
+    ~GrowableSegment();
+
+    void operator = (GrowableSegment &&) = delete;
+
+    /**
+     * The start of the data, which stays put for the life of this object.
+     */
+    std::byte * data() const noexcept { return data_; }
+
+    /**
+     * The number of bytes of data mapped into this process, which may lag
+     * behind the size published by another process until refresh().
+     */
+    std::size_t size() const noexcept
+    {
+        return mapped_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * The largest size the segment can grow to.
+     */
+    std::size_t reserve() const noexcept { return reserve_; }
+
+    /**
+     * The number of times the segment has grown, in any process.
+     */
+    std::uint64_t generation() const noexcept;
+
+    int fd() const noexcept { return fd_; }
+    std::filesystem::path const & path() const noexcept { return path_; }
+
+    /**
+     * Grow the segment to at least @p size bytes, rounded up to a multiple
+     * of the page size, and map the new pages into this process.  The new
+     * bytes read as zeros.
+     *
+     * @return  The new size of the segment in this process.
+     *
+     * @throw  std::length_error if @p size is larger than reserve().
+     * @throw  std::system_error if the file can't be extended or mapped.
+     */
+    std::size_t grow(std::size_t size);
+
+    /**
+     * Map any growth published by other processes.
+     *
+     * @return  The new size of the segment in this process.
+     *
+     * @throw  std::system_error if the new pages can't be mapped.
+     */
+    std::size_t refresh();
+
+    /**
+     * The address of @p offset, after making sure that the @p length bytes
+     * starting there are mapped into this process.
+     *
+     * Only when the bytes lie beyond size() does this look at the header, so
+     * a process pays for the growth of another only when it needs it.
+     *
+     * @throw  std::out_of_range if the bytes are beyond the published size.
+     */
+    std::byte * at(std::size_t offset, std::size_t length = 1)
+    {
+        if (offset + length > size()) [[unlikely]] {
+            ensure(offset, length);
+        }
+        return data_ + offset;
+    }
+
+    /**
+     * Write the pages covering [offset, offset + length) back to the file,
+     * and wait for the writes to complete.
+     *
+     * @throw  std::system_error on failure.
+     */
+    void sync(std::size_t offset, std::size_t length) const;
+
+    /**
+     * Write the header, all of the mapped data, and the file metadata back
+     * to the file.
+     *
+     * @throw  std::system_error on failure.
+     */
+    void sync() const;
+
+private:
+    void open();
+    void ensure(std::size_t offset, std::size_t length);
+
+    growable_detail::Header & header() const noexcept;
+
+    std::filesystem::path path_;
+    int fd_ = -1;
+    std::byte * base_ = nullptr;
+    std::byte * data_ = nullptr;
+    std::size_t reserve_ = 0;
+    std::atomic<std::size_t> mapped_{0};
+    std::mutex mutex_;
+};
+
+} // namespace wjh
+
+#endif // WJH_c41e7a2d9b6f48e3a05d7c1b8e2f4a69
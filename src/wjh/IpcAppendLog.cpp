@@ -0,0 +1,443 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcAppendLog.hpp"
+
+#include "AtomicWait.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace wjh {
+
+using namespace appendlog_detail;
+
+struct IpcAppendLog::Open
+{
+    std::unique_ptr<Segment> file;
+    SegmentHeader * header;
+    std::byte * records;
+    std::uint64_t index;
+
+    RecordHeader & record(std::uint64_t offset) const
+    {
+        return *reinterpret_cast<RecordHeader *>(records + offset);
+    }
+};
+
+namespace {
+
+constexpr std::uint64_t control_magic = 0x776a682d6c6f6701; // "wjh-log", 1
+constexpr std::uint64_t segment_magic = 0x776a682d73656701; // "wjh-seg", 1
+
+std::uint64_t
+record_size(std::uint64_t length)
+{
+    return (sizeof(RecordHeader) + length + 7u) & ~std::uint64_t(7);
+}
+
+// The records of a segment start on the page after its header.
+std::size_t
+header_size()
+{
+    return Segment::page_size();
+}
+
+std::filesystem::path
+segment_path(std::filesystem::path const & directory, std::uint64_t index)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016" PRIx64 ".seg", index);
+    return directory / name;
+}
+
+void
+sync_directory(std::filesystem::path const & directory)
+{
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd != -1) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+// Create the file at @p path, fully initialized by @p init, so that no process
+// ever sees it partially initialized.  If another process creates it first,
+// that one wins.
+template <typename FnT>
+void
+publish_file(std::filesystem::path const & path, std::size_t size, FnT init)
+{
+    auto const thread =
+        std::hash<std::thread::id>{}(std::this_thread::get_id());
+    auto temp = path;
+    temp += ".tmp." + std::to_string(::getpid()) + "." + std::to_string(thread);
+    try {
+        auto file = Segment(temp, size);
+        init(file);
+        file.sync();
+    } catch (...) {
+        ::unlink(temp.c_str());
+        throw;
+    }
+    if (::link(temp.c_str(), path.c_str()) != 0 && errno != EEXIST) {
+        auto const error = errno;
+        ::unlink(temp.c_str());
+        throw std::system_error(error, std::generic_category(), "link");
+    }
+    ::unlink(temp.c_str());
+    sync_directory(path.parent_path());
+}
+
+void
+raise(Atomic<std::uint64_t> & word, std::uint64_t value)
+{
+    auto current = word.load(std::memory_order_relaxed);
+    while (current < value &&
+           not word.compare_exchange_weak(
+               current,
+               value,
+               std::memory_order_release,
+               std::memory_order_relaxed))
+    { }
+}
+
+} // anonymous namespace
+
+IpcAppendLog::
+IpcAppendLog(std::filesystem::path directory, std::size_t segment_capacity)
+: directory_(std::move(directory))
+{
+    std::filesystem::create_directories(directory_);
+    auto const path = directory_ / "control";
+    if (not std::filesystem::exists(path)) {
+        auto const page = Segment::page_size();
+        auto const capacity = std::max(
+            (segment_capacity + page - 1) / page * page,
+            page);
+        publish_file(path, page, [&](Segment & file) {
+            auto control = ::new (file.data()) Control{};
+            control->capacity = capacity;
+            control->magic = control_magic;
+        });
+    }
+    control_file_ = std::make_unique<Segment>(path);
+    control_ = reinterpret_cast<Control *>(control_file_->data());
+    if (control_file_->size() < sizeof(Control) ||
+        control_->magic != control_magic)
+    {
+        throw std::invalid_argument(path.string() + " is not a log");
+    }
+    capacity_ = control_->capacity;
+    current_.store(
+        segment(control_->newest.load(std::memory_order_acquire)),
+        std::memory_order_release);
+}
+
+IpcAppendLog::
+~IpcAppendLog() = default;
+
+std::size_t
+IpcAppendLog::
+max_record_size() const noexcept
+{
+    return capacity_ - sizeof(RecordHeader);
+}
+
+std::shared_ptr<IpcAppendLog::Open>
+IpcAppendLog::
+segment(std::uint64_t index)
+{
+    auto guard = std::lock_guard(mutex_);
+    if (auto i = segments_.find(index); i != segments_.end()) {
+        i->second.second = ++uses_;
+        return i->second.first;
+    }
+
+    auto const path = segment_path(directory_, index);
+    if (not std::filesystem::exists(path)) {
+        publish_file(path, header_size() + capacity_, [&](Segment & file) {
+            auto header = ::new (file.data()) SegmentHeader{};
+            header->index = index;
+            header->magic = segment_magic;
+        });
+    }
+
+    auto open = std::make_shared<Open>();
+    open->file = std::make_unique<Segment>(path);
+    open->header = reinterpret_cast<SegmentHeader *>(open->file->data());
+    open->records = open->file->data() + header_size();
+    open->index = index;
+    if (open->file->size() < header_size() + capacity_ ||
+        open->header->magic != segment_magic || open->header->index != index)
+    {
+        throw std::invalid_argument(path.string() + " is not a log segment");
+    }
+
+    // Close the least recently used segment that is not the tail.  Anyone
+    // still using it holds it open until they are done.
+    if (segments_.size() >= max_open_segments) {
+        auto const current = current_.load(std::memory_order_acquire);
+        auto oldest = segments_.end();
+        for (auto i = segments_.begin(); i != segments_.end(); ++i) {
+            if (i->second.first != current &&
+                (oldest == segments_.end() ||
+                 i->second.second < oldest->second.second))
+            {
+                oldest = i;
+            }
+        }
+        if (oldest != segments_.end()) {
+            segments_.erase(oldest);
+        }
+    }
+    segments_.emplace(index, std::pair(open, ++uses_));
+    return open;
+}
+
+IpcAppendLog::Position
+IpcAppendLog::
+append(std::span<std::byte const> record)
+{
+    return append(record.size(), [&](std::span<std::byte> data) {
+        if (not record.empty()) {
+            std::memcpy(data.data(), record.data(), record.size());
+        }
+    });
+}
+
+IpcAppendLog::Reservation
+IpcAppendLog::
+reserve(std::size_t size)
+{
+    if (size > max_record_size()) {
+        throw std::length_error("record does not fit in a log segment");
+    }
+    auto const total = record_size(size);
+    for (;;) {
+        auto current = current_.load(std::memory_order_acquire);
+        auto & open = *current;
+        auto const offset =
+            open.header->tail.fetch_add(total, std::memory_order_relaxed);
+        if (offset + total <= capacity_) {
+            auto & record = open.record(offset);
+            record.length = static_cast<std::uint32_t>(size);
+            return Reservation{
+                std::move(current),
+                Position{open.index, offset},
+                std::span(open.records + offset + sizeof(RecordHeader), size),
+                &record};
+        }
+        if (offset < capacity_) {
+            // This reservation straddles the end, so it pads out the segment
+            // for readers.
+            auto & record = open.record(offset);
+            record.length = static_cast<std::uint32_t>(
+                capacity_ - offset - sizeof(RecordHeader));
+            record.state.store(padding, std::memory_order_release);
+        }
+        roll(std::move(current));
+    }
+}
+
+void
+IpcAppendLog::
+roll(std::shared_ptr<Open> full)
+{
+    auto next = segment(full->index + 1);
+    raise(control_->newest, next->index);
+    current_.compare_exchange_strong(full, std::move(next));
+}
+
+std::uint64_t
+IpcAppendLog::
+advance(Open & open)
+{
+    auto & header = *open.header;
+    auto const start = header.watermark.load(std::memory_order_acquire);
+    auto const tail = std::min<std::uint64_t>(
+        header.tail.load(std::memory_order_acquire),
+        capacity_);
+    auto watermark = start;
+    while (watermark < tail) {
+        auto & record = open.record(watermark);
+        auto const state = record.state.load(std::memory_order_acquire);
+        if (state == appendlog_detail::committed) {
+            watermark += record_size(record.length);
+        } else if (state == padding) {
+            watermark = capacity_;
+        } else {
+            break;
+        }
+    }
+    if (watermark > start) {
+        raise(header.watermark, watermark);
+    }
+    return std::max(watermark, start);
+}
+
+IpcAppendLog::Position
+IpcAppendLog::
+committed()
+{
+    auto const open = current_.load(std::memory_order_acquire);
+    return Position{open->index, advance(*open)};
+}
+
+std::optional<std::span<std::byte const>>
+IpcAppendLog::
+read(Position & cursor)
+{
+    for (;;) {
+        auto const newest = control_->newest.load(std::memory_order_acquire);
+        if (cursor.segment > newest) {
+            return std::nullopt;
+        }
+        auto const held = segment(cursor.segment);
+        auto & open = *held;
+        if (cursor.offset >= capacity_) {
+            if (cursor.segment == newest) {
+                return std::nullopt;
+            }
+            cursor = Position{cursor.segment + 1, 0u};
+            continue;
+        }
+
+        auto watermark =
+            open.header->watermark.load(std::memory_order_acquire);
+        if (cursor.offset >= watermark) {
+            watermark = advance(open);
+            if (cursor.offset >= watermark) {
+                return std::nullopt;
+            }
+        }
+
+        auto & record = open.record(cursor.offset);
+        if (record.state.load(std::memory_order_acquire) == padding) {
+            cursor.offset = capacity_;
+            continue;
+        }
+        auto const data = open.records + cursor.offset + sizeof(RecordHeader);
+        cursor.offset += record_size(record.length);
+        return std::span<std::byte const>(data, record.length);
+    }
+}
+
+std::size_t
+IpcAppendLog::
+flush_locked()
+{
+    std::size_t flushed = 0;
+    auto const newest = control_->newest.load(std::memory_order_acquire);
+    auto first = control_->durable_segment.load(std::memory_order_acquire);
+    for (auto index = first; index <= newest; ++index) {
+        auto const held = segment(index);
+        auto & open = *held;
+        auto const watermark = advance(open);
+        auto const durable =
+            open.header->durable.load(std::memory_order_acquire);
+        if (watermark > durable) {
+            open.file->sync(header_size() + durable, watermark - durable);
+            open.header->durable.store(watermark, std::memory_order_release);
+
+            // The header must reach the file too, so a recovered tail never
+            // falls behind the durable records.
+            open.file->sync(0, header_size());
+            flushed += watermark - durable;
+        }
+        if (index == first && index < newest && watermark == capacity_) {
+            control_->durable_segment.store(
+                ++first,
+                std::memory_order_release);
+        }
+    }
+    if (flushed > 0) {
+        control_->flushes.fetch_add(1u, std::memory_order_release);
+        atomic_notify_all(control_->flushes);
+    }
+    return flushed;
+}
+
+std::size_t
+IpcAppendLog::
+flush()
+{
+    if (not control_->flusher.try_lock()) {
+        return 0;
+    }
+    try {
+        auto const flushed = flush_locked();
+        control_->flusher.unlock();
+        return flushed;
+    } catch (...) {
+        control_->flusher.unlock();
+        throw;
+    }
+}
+
+void
+IpcAppendLog::
+sync(Position position)
+{
+    auto const held = segment(position.segment);
+    auto & open = *held;
+    for (;;) {
+        auto const flushes = control_->flushes.load(std::memory_order_acquire);
+        if (open.header->durable.load(std::memory_order_acquire) >
+            position.offset)
+        {
+            return;
+        }
+        if (flush() == 0) {
+            // Either nothing new was committed, or someone else holds the
+            // lease, so ask the flusher, and wait for the next flush.
+            control_->requests.fetch_add(1u);
+            atomic_notify_all(control_->requests);
+            atomic_wait(
+                control_->flushes,
+                flushes,
+                std::chrono::milliseconds(10));
+        }
+    }
+}
+
+std::jthread
+IpcAppendLog::
+start_flusher(std::chrono::milliseconds interval)
+{
+    return std::jthread([this, interval](std::stop_token stop) {
+        auto wake = std::stop_callback(stop, [this] {
+            control_->requests.fetch_add(1u);
+            atomic_notify_all(control_->requests);
+        });
+        bool held = false;
+        while (not stop.stop_requested()) {
+            auto const requests = control_->requests.load();
+            if (not held) {
+                held = control_->flusher.try_lock();
+            }
+            if (held) {
+                flush_locked();
+            }
+            atomic_wait(control_->requests, requests, interval);
+        }
+        if (held) {
+            control_->flusher.unlock();
+        }
+    });
+}
+
+} // namespace wjh
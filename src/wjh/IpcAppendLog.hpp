@@ -0,0 +1,239 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_e2a6c8f14d7b4b039c5e1a8d6f2b9c43
+#define WJH_e2a6c8f14d7b4b039c5e1a8d6f2b9c43
+
+#include "Atomic.hpp"
+#include "ProcessIdLock.hpp"
+#include "Segment.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+
+namespace wjh {
+
+namespace appendlog_detail {
+
+// Shared by every segment of a log.
+struct Control
+{
+    std::uint64_t magic;
+    std::uint64_t capacity;
+    Atomic<std::uint64_t> newest;
+    // Every segment before this one is complete and durable.
+    Atomic<std::uint64_t> durable_segment;
+    ProcessIdLock flusher;
+    // Bumped after every flush, so sync() can sleep until one happens.
+    Atomic<std::uint32_t> flushes;
+    // Bumped by sync(), to wake a flusher.
+    Atomic<std::uint32_t> requests;
+};
+
+struct SegmentHeader
+{
+    std::uint64_t magic;
+    std::uint64_t index;
+    Atomic<std::uint64_t> tail;
+    Atomic<std::uint64_t> watermark;
+    Atomic<std::uint64_t> durable;
+};
+
+struct RecordHeader
+{
+    Atomic<std::uint32_t> state;
+    std::uint32_t length;
+};
+
+inline constexpr std::uint32_t uncommitted = 0;
+inline constexpr std::uint32_t committed = 1;
+inline constexpr std::uint32_t padding = 2;
+
+// The most segment files a handle keeps mapped at once.
+inline constexpr std::size_t max_open_segments = 4;
+
+} // namespace appendlog_detail
+
+/**
+ * A persistent, append-only log of records, in a directory of memory-mapped
+ * segment files, shared by any number of appending and reading processes.
+ *
+ * An append reserves space with a single fetch_add on the segment tail,
+ * writes the record in place, and then publishes it by setting the record's
+ * commit flag.  Appenders never wait for each other.  When a reservation runs
+ * past the end of the segment, the log rolls over to a new segment file.
+ *
+ * Readers see the committed prefix of each segment.  That watermark is not
+ * maintained by appenders; it is advanced lazily, by whoever asks for it, over
+ * the records whose commit flags are set.
+ *
+ * Appended records reach the file through the page cache, so they survive a
+ * process crash, but not necessarily a system crash.  For that, sync() waits
+ * until a record is durable.  Durability is group-committed: a single flusher,
+ * which holds a ProcessIdLock lease on the log, msyncs everything committed so
+ * far, on behalf of every waiter.  Without a running flusher (see
+ * start_flusher()), sync() takes the lease and flushes itself.
+ *
+ * A handle keeps the tail segment, and the few others it used last, mapped;
+ * see appendlog_detail::max_open_segments.  Older ones are closed, and
+ * opened again if they are read.
+ *
+ * @note  An appender that dies between reserving and committing a record
+ * stalls the watermark of that segment.
+ *
+ * An IpcAppendLog is a process-local handle, and its methods are thread safe.
+ */
+class IpcAppendLog
+{
+public:
+    /**
+     * The location of a record in the log.
+     */
+    struct Position
+    {
+        std::uint64_t segment;
+        std::uint64_t offset;
+
+        friend auto operator <=> (Position, Position) = default;
+    };
+
+    /**
+     * Open the log in @p directory, creating it (and the directory) if
+     * necessary.
+     *
+     * @param segment_capacity  The record space in each segment file, which
+     * is only used when creating the log.
+     *
+     * @throw  std::system_error if the files can't be created or mapped, or
+     * std::invalid_argument if @p directory contains something that is not
+     * a log.
+     */
+    explicit IpcAppendLog(
+        std::filesystem::path directory,
+        std::size_t segment_capacity = 64u << 20);
+
+    ~IpcAppendLog();
+
+    void operator = (IpcAppendLog &&) = delete;
+
+    /**
+     * The largest record that fits in a segment.
+     */
+    std::size_t max_record_size() const noexcept;
+
+    /**
+     * Append a copy of @p record.
+     *
+     * @return  The position of the record.
+     *
+     * @throw  std::length_error if the record exceeds max_record_size().
+     */
+    Position append(std::span<std::byte const> record);
+
+    /**
+     * Append a record of @p size bytes, which @p write fills in place.
+     *
+     * @p write is called with the record's space in the segment, and the
+     * record is committed when it returns.
+     */
+    template <typename FnT>
+    Position append(std::size_t size, FnT && write)
+    {
+        auto reservation = reserve(size);
+        write(reservation.data);
+        reservation.record->state.store(
+            appendlog_detail::committed,
+            std::memory_order_release);
+        return reservation.position;
+    }
+
+    /**
+     * The position after the last record that readers can see.
+     *
+     * This advances the shared watermark over any newly committed records.
+     */
+    Position committed();
+
+    /**
+     * Read the committed record at @p cursor, and advance @p cursor past it.
+     *
+     * @return  The record, or std::nullopt if there is no committed record
+     * at @p cursor yet.  The record is in a mapped segment, which may be
+     * closed once this log has used appendlog_detail::max_open_segments
+     * others since, so copy it to keep it longer.
+     */
+    std::optional<std::span<std::byte const>> read(Position & cursor);
+
+    /**
+     * Make every committed record durable, if no other flusher holds the
+     * lease.
+     *
+     * @return  The number of bytes flushed.
+     */
+    std::size_t flush();
+
+    /**
+     * Wait until the record at @p position is durable.
+     */
+    void sync(Position position);
+
+    /**
+     * Start a thread that takes the flusher lease, and group-commits whatever
+     * has been committed whenever sync() asks, or at most @p interval after
+     * a record is committed.
+     *
+     * The thread runs until the returned jthread is stopped (or destroyed).
+     *
+     * @pre  The thread is stopped before this log is destroyed.
+     */
+    std::jthread start_flusher(
+        std::chrono::milliseconds interval = std::chrono::milliseconds(10));
+
+private:
+    struct Open;
+
+    struct Reservation
+    {
+        // Keeps the segment mapped until the record is committed.
+        std::shared_ptr<Open> open;
+        Position position;
+        std::span<std::byte> data;
+        appendlog_detail::RecordHeader * record;
+    };
+
+    Reservation reserve(std::size_t size);
+    void roll(std::shared_ptr<Open> full);
+
+    std::shared_ptr<Open> segment(std::uint64_t index);
+    std::uint64_t advance(Open & open);
+    std::size_t flush_locked();
+
+    std::filesystem::path directory_;
+    std::unique_ptr<Segment> control_file_;
+    appendlog_detail::Control * control_;
+    std::uint64_t capacity_;
+    std::mutex mutex_;
+    // The open segments, and when each was last used.
+    std::map<std::uint64_t, std::pair<std::shared_ptr<Open>, std::uint64_t>>
+        segments_;
+    std::uint64_t uses_ = 0;
+    std::atomic<std::shared_ptr<Open>> current_;
+};
+
+} // namespace wjh
+
+#endif // WJH_e2a6c8f14d7b4b039c5e1a8d6f2b9c43
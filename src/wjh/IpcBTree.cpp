@@ -0,0 +1,247 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcBTree.hpp"
+
+#include "ProcessId.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace wjh {
+namespace btree_detail {
+
+namespace {
+
+constexpr std::uint64_t magic = 0x776a682d62747201; // "wjh-bt", 1
+
+// Put page @p n, which no reader can reach, on the free list.
+void
+push(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::uint64_t n) noexcept
+{
+    page(segment, page_size, n).next.store(
+        meta.free.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    meta.free.store(n, std::memory_order_release);
+}
+
+// Free every page that the tree does not reach.  No reader can be on one,
+// as the machine has restarted since any was in the tree.
+void
+rebuild(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::size_t children_offset)
+{
+    auto const pages = meta.pages.load(std::memory_order_relaxed);
+    auto const fanout = (page_size - children_offset) / sizeof(std::uint64_t);
+    std::vector<bool> reached(pages);
+    std::vector<std::uint64_t> todo;
+    if (auto const root = meta.root.load(std::memory_order_relaxed);
+        root != 0 && root < pages)
+    {
+        todo.push_back(root);
+    }
+    while (not todo.empty()) {
+        auto const n = todo.back();
+        todo.pop_back();
+        if (reached[n]) {
+            continue;
+        }
+        reached[n] = true;
+        auto & p = page(segment, page_size, n);
+        if (p.level.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        auto const * const children = reinterpret_cast<std::uint64_t *>(
+            reinterpret_cast<std::byte *>(&p) + children_offset);
+        auto const count = std::min<std::size_t>(
+            p.count.load(std::memory_order_relaxed),
+            fanout);
+        for (std::size_t i = 0; i < count; ++i) {
+            if (children[i] != 0 && children[i] < pages) {
+                todo.push_back(children[i]);
+            }
+        }
+    }
+
+    // Pushed from the end, so that the first pages are reused first.
+    meta.free.store(0u, std::memory_order_relaxed);
+    for (auto n = pages; n-- > 1;) {
+        if (reached[n]) {
+            continue;
+        }
+        auto & version = page(segment, page_size, n).version;
+        version.store(
+            version.load(std::memory_order_relaxed) | 1u,
+            std::memory_order_relaxed);
+        push(meta, segment, page_size, n);
+    }
+}
+
+} // anonymous namespace
+
+Meta &
+open(
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::size_t key_size,
+    std::size_t value_size,
+    std::size_t children_offset)
+{
+    if (segment.size() < page_size) {
+        segment.grow(page_size);
+    }
+    auto const boot = static_cast<std::int64_t>(ProcessId::boot_time());
+    auto & meta = *reinterpret_cast<Meta *>(segment.data());
+    if (meta.magic.load(std::memory_order_acquire) != magic) {
+        auto guard = std::lock_guard(meta.writer);
+        if (meta.magic.load(std::memory_order_acquire) != magic) {
+            meta.page_size.store(page_size, std::memory_order_relaxed);
+            meta.key_size.store(key_size, std::memory_order_relaxed);
+            meta.value_size.store(value_size, std::memory_order_relaxed);
+            meta.root.store(0u, std::memory_order_relaxed);
+            meta.pages.store(1u, std::memory_order_relaxed);
+            meta.free.store(0u, std::memory_order_relaxed);
+            meta.size.store(0u, std::memory_order_relaxed);
+            meta.txn.store(0u, std::memory_order_relaxed);
+            meta.boot.store(boot, std::memory_order_relaxed);
+            meta.magic.store(magic, std::memory_order_release);
+        }
+    }
+    if (meta.page_size.load(std::memory_order_relaxed) != page_size ||
+        meta.key_size.load(std::memory_order_relaxed) != key_size ||
+        meta.value_size.load(std::memory_order_relaxed) != value_size)
+    {
+        throw std::invalid_argument(
+            segment.path().string() + " holds a different IpcBTree");
+    }
+    if (meta.boot.load(std::memory_order_acquire) != boot) {
+        auto guard = std::lock_guard(meta.writer);
+        if (meta.boot.load(std::memory_order_relaxed) != boot) {
+            rebuild(meta, segment, page_size, children_offset);
+            meta.boot.store(boot, std::memory_order_release);
+        }
+    }
+    return meta;
+}
+
+std::uint64_t
+allocate(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::uint64_t txn)
+{
+    auto n = meta.free.load(std::memory_order_relaxed);
+    if (n != 0) {
+        // Free pages are already odd.
+        meta.free.store(
+            page(segment, page_size, n).next.load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+    } else {
+        n = meta.pages.load(std::memory_order_relaxed);
+        segment.grow((n + 1) * page_size);
+        page(segment, page_size, n).version.store(
+            1u,
+            std::memory_order_relaxed);
+        meta.pages.store(n + 1, std::memory_order_release);
+    }
+    auto & p = page(segment, page_size, n);
+    p.txn.store(txn, std::memory_order_relaxed);
+    p.next.store(0u, std::memory_order_relaxed);
+    p.count.store(0u, std::memory_order_relaxed);
+    p.level.store(0u, std::memory_order_relaxed);
+    return n;
+}
+
+void
+publish(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::uint64_t root,
+    std::span<std::uint64_t const> written,
+    std::int64_t size_delta,
+    bool sync)
+{
+    // The written pages are unreachable until the root is stored, so they
+    // are made readable first, and are written back as they will be read.
+    // A commit retried after a failed sync finds them readable already.
+    for (auto n : written) {
+        auto & version = page(segment, page_size, n).version;
+        auto const v = version.load(std::memory_order_relaxed);
+        if (v & 1u) {
+            version.store(v + 1, std::memory_order_release);
+        }
+    }
+    if (sync) {
+        for (auto n : written) {
+            segment.sync(n * page_size, page_size);
+        }
+    }
+    meta.root.store(root, std::memory_order_release);
+    meta.size.store(
+        meta.size.load(std::memory_order_relaxed) +
+            static_cast<std::uint64_t>(size_delta),
+        std::memory_order_relaxed);
+    meta.txn.store(
+        meta.txn.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+}
+
+void
+retire(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::span<std::uint64_t const> obsolete,
+    std::span<std::uint64_t const> dropped,
+    bool sync)
+{
+    // Until the new root is on disk, the old one is what the file holds
+    // after the machine fails, so the pages it uses must not be reused.
+    if (sync) {
+        segment.sync(0, page_size);
+    }
+
+    // Readers may still be on the replaced pages, so they change version
+    // before they can be reused.
+    for (auto n : obsolete) {
+        page(segment, page_size, n).version.fetch_add(
+            1u,
+            std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (auto n : obsolete) {
+        push(meta, segment, page_size, n);
+    }
+    for (auto n : dropped) {
+        push(meta, segment, page_size, n);
+    }
+}
+
+void
+abandon(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::span<std::uint64_t const> written) noexcept
+{
+    for (auto n : written) {
+        push(meta, segment, page_size, n);
+    }
+}
+
+} // namespace btree_detail
+} // namespace wjh
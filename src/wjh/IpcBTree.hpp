@@ -0,0 +1,898 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_3d7a9f2c5e1b4c86a4f0b8e6d2c7a913
+#define WJH_3d7a9f2c5e1b4c86a4f0b8e6d2c7a913
+
+#include "Atomic.hpp"
+#include "GrowableSegment.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace wjh {
+
+namespace btree_detail {
+
+/**
+ * The first page of an IpcBTree file.
+ */
+struct Meta
+{
+    // Set once the rest of the page is.
+    Atomic<std::uint64_t> magic;
+    Atomic<std::uint64_t> page_size;
+    Atomic<std::uint64_t> key_size;
+    Atomic<std::uint64_t> value_size;
+    ProcessIdLock writer;
+    // The page number of the root, or zero if the tree is empty.
+    Atomic<std::uint64_t> root;
+    // The number of pages ever used, including this one.
+    Atomic<std::uint64_t> pages;
+    // The first free page, with the rest chained through Page::next.
+    Atomic<std::uint64_t> free;
+    Atomic<std::uint64_t> size;
+    // The last committed transaction.
+    Atomic<std::uint64_t> txn;
+    // The ProcessId::boot_time() of the machine when the free list was last
+    // known to be whole.  Pages are only written back when a commit syncs,
+    // so the free list the file holds after the machine fails can be
+    // anything, and is rebuilt from the tree.
+    Atomic<std::int64_t> boot;
+};
+
+/**
+ * The front of every page but the first.
+ */
+struct Page
+{
+    // Even while the page is in a committed tree; odd while it is free, or
+    // being written by a transaction that has not committed.
+    Atomic<std::uint64_t> version;
+    // The transaction that wrote the page.
+    Atomic<std::uint64_t> txn;
+    // The next free page, or zero.
+    Atomic<std::uint64_t> next;
+    // The number of entries of a leaf, or children of an inner page.
+    Atomic<std::uint32_t> count;
+    // Zero for leaves.
+    Atomic<std::uint32_t> level;
+};
+
+inline Page &
+page(GrowableSegment & segment, std::size_t page_size, std::uint64_t n)
+{
+    return *reinterpret_cast<Page *>(segment.at(n * page_size, page_size));
+}
+
+/**
+ * The meta page of the tree in @p segment, which is set up if the segment
+ * is new.  The first open since the machine started rebuilds the free list
+ * from the pages that the tree does not reach; the children of an inner
+ * page are at @p children_offset.
+ *
+ * @throw  std::invalid_argument if the tree in @p segment has a different
+ * page, key, or value size.
+ */
+Meta & open(
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::size_t key_size,
+    std::size_t value_size,
+    std::size_t children_offset);
+
+/**
+ * A page for transaction @p txn to write, taken from the free list or
+ * added to the end of the segment.  Its version is odd.
+ *
+ * @throw  std::length_error if the segment can't grow.
+ */
+std::uint64_t allocate(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::uint64_t txn);
+
+/**
+ * Commit a transaction: make its @p written pages readable, and publish
+ * @p root.
+ *
+ * @throw  std::system_error if @p sync, and the pages can't be written
+ * back, in which case nothing is published.
+ */
+void publish(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::uint64_t root,
+    std::span<std::uint64_t const> written,
+    std::int64_t size_delta,
+    bool sync);
+
+/**
+ * Finish a published transaction: free the @p obsolete pages it replaced,
+ * and the @p dropped pages it wrote, but then removed from the tree.  If
+ * @p sync, the meta page is written back first, as the tree it held before
+ * may still use the obsolete pages.
+ *
+ * @throw  std::system_error if @p sync, and the meta page can't be written
+ * back, in which case no page is freed.
+ */
+void retire(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::span<std::uint64_t const> obsolete,
+    std::span<std::uint64_t const> dropped,
+    bool sync);
+
+/**
+ * Free the pages of a transaction that will not commit.
+ */
+void abandon(
+    Meta & meta,
+    GrowableSegment & segment,
+    std::size_t page_size,
+    std::span<std::uint64_t const> written) noexcept;
+
+} // namespace btree_detail
+
+/**
+ * A B+tree that maps K to V, kept in fixed size pages of a GrowableSegment
+ * file, so that it survives the processes that use it: opening the index
+ * is mapping the file.
+ *
+ * Any number of processes read at once, without latches.  Every page has
+ * a version, like a seqlock: a reader notes the version of a page, reads
+ * what it needs, and checks the version again, restarting from the root if
+ * it changed.  A reader never writes shared memory.
+ *
+ * One writer at a time, in any process, holds the ProcessIdLock in the meta
+ * page, and changes the tree by copy on write: a transaction copies each
+ * page it changes, and the pages above it, so the committed tree is never
+ * touched, and commit() publishes the new root with a single store.  A
+ * page copied within the same transaction is changed in place.  Pages that
+ * a commit replaces go on a free list for later transactions, and their
+ * versions change as they do, so that a reader still on them restarts.
+ *
+ * A writer that dies before commit() leaves the committed tree as it was;
+ * the pages it had written are lost to the file until the machine restarts,
+ * after which the first open rebuilds the free list from the tree.
+ *
+ * Leaves are removed when they become empty, but pages are never merged.
+ *
+ * An IpcBTree is a process-local handle.  Its reads are thread safe.
+ *
+ * @note  Compare is called on keys that a reader copies from a page that
+ * may be changing; the result is discarded when the version check fails, but
+ * it must be safe to call on any bit pattern of K.
+ */
+template <
+    typename K,
+    typename V,
+    typename Compare = std::less<K>,
+    std::size_t PageSize = 4096>
+requires std::is_trivially_copyable_v<K> &&
+    std::is_trivially_copyable_v<V> &&
+    std::is_trivially_default_constructible_v<K> &&
+    std::is_trivially_default_constructible_v<V> &&
+    std::is_empty_v<Compare> && std::is_default_constructible_v<Compare>
+class IpcBTree
+{
+    using Page = btree_detail::Page;
+
+    static constexpr std::size_t align_up(std::size_t n, std::size_t a)
+    {
+        return (n + a - 1) / a * a;
+    }
+
+public:
+    static constexpr std::size_t page_size = PageSize;
+
+    // Leaves hold keys, then values; inner pages hold one key fewer than
+    // they have children.
+    static constexpr std::size_t leaf_capacity =
+        (PageSize - sizeof(Page) - alignof(V)) / (sizeof(K) + sizeof(V));
+    static constexpr std::size_t inner_capacity =
+        (PageSize - sizeof(Page) - alignof(std::uint64_t) + sizeof(K)) /
+        (sizeof(K) + sizeof(std::uint64_t));
+    static_assert(PageSize >= sizeof(btree_detail::Meta));
+    static_assert(PageSize % alignof(K) == 0 && PageSize % alignof(V) == 0);
+    static_assert(leaf_capacity >= 4 && inner_capacity >= 4);
+
+    class Writer;
+
+    /**
+     * Use the tree in @p segment, setting up a new one if the segment is
+     * new.
+     *
+     * @throw  std::invalid_argument if the tree in @p segment has different
+     * sizes of page, key, or value.
+     */
+    explicit IpcBTree(GrowableSegment & segment)
+    : segment_(segment)
+    , meta_(btree_detail::open(
+          segment,
+          PageSize,
+          sizeof(K),
+          sizeof(V),
+          inner_children_offset))
+    { }
+
+    void operator = (IpcBTree &&) = delete;
+
+    /**
+     * A copy of the value of @p key, or std::nullopt if it is not present.
+     */
+    std::optional<V> get(K const & key) const
+    {
+        for (;;) {
+            auto const leaf = descend(key);
+            if (not leaf) {
+                continue;
+            }
+            if (leaf->page == 0) {
+                return std::nullopt;
+            }
+            auto * const p = bytes(leaf->page);
+            auto const count = std::min<std::size_t>(
+                header(p).count.load(std::memory_order_relaxed),
+                leaf_capacity);
+            auto const i = lower_bound(leaf_keys(p), count, key);
+            std::optional<V> result;
+            if (i < count && not less(key, leaf_keys(p)[i])) {
+                result = leaf_values(p)[i];
+            }
+            if (valid(leaf->page, leaf->version)) {
+                return result;
+            }
+        }
+    }
+
+    bool contains(K const & key) const { return get(key).has_value(); }
+
+    /**
+     * Call @p f(key, value) for each entry with @p from <= key < @p to, in
+     * order.
+     *
+     * The entries of each leaf are copied out, and checked, before any is
+     * passed to @p f, so @p f sees each leaf as it was at one moment, but
+     * the tree may change between leaves.
+     *
+     * @return  The number of entries visited.
+     */
+    template <typename F>
+    std::size_t scan(K const & from, K const & to, F && f) const
+    {
+        struct Entry
+        {
+            K key;
+            V value;
+        };
+        Entry entries[leaf_capacity];
+        std::size_t result = 0;
+        auto lo = from;
+        while (less(lo, to)) {
+            auto const leaf = descend(lo);
+            if (not leaf) {
+                continue;
+            }
+            if (leaf->page == 0) {
+                break;
+            }
+            auto * const p = bytes(leaf->page);
+            auto const count = std::min<std::size_t>(
+                header(p).count.load(std::memory_order_relaxed),
+                leaf_capacity);
+            std::size_t n = 0;
+            for (auto i = lower_bound(leaf_keys(p), count, lo); i < count;
+                 ++i)
+            {
+                auto const key = leaf_keys(p)[i];
+                if (not less(key, to)) {
+                    break;
+                }
+                entries[n++] = Entry{key, leaf_values(p)[i]};
+            }
+            if (not valid(leaf->page, leaf->version)) {
+                continue;
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                f(std::as_const(entries[i].key),
+                  std::as_const(entries[i].value));
+            }
+            result += n;
+            if (not leaf->upper) {
+                break;
+            }
+            lo = *leaf->upper;
+        }
+        return result;
+    }
+
+    /**
+     * The number of entries.
+     */
+    std::size_t size() const noexcept
+    {
+        return meta_.size.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+    /**
+     * The number of pages in the file, whether in use or free.
+     */
+    std::size_t pages() const noexcept
+    {
+        return meta_.pages.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Start a transaction, waiting for the writer of any other process, or
+     * thread, to finish.
+     */
+    Writer write() { return Writer(*this); }
+
+    /**
+     * Start a transaction, unless another writer has one.
+     */
+    std::optional<Writer> try_write()
+    {
+        if (not meta_.writer.try_lock()) {
+            return std::nullopt;
+        }
+        return Writer(*this, std::adopt_lock);
+    }
+
+    /**
+     * A transaction, which holds the writer lock of the tree.
+     *
+     * Changes are seen by readers only after commit().  Destroying a writer
+     * that has not committed discards its changes.
+     */
+    class Writer
+    {
+    public:
+        Writer(Writer && that) noexcept
+        : tree_(std::exchange(that.tree_, nullptr))
+        , txn_(that.txn_)
+        , root_(that.root_)
+        , size_delta_(that.size_delta_)
+        , written_(std::move(that.written_))
+        , obsolete_(std::move(that.obsolete_))
+        , dropped_(std::move(that.dropped_))
+        { }
+
+        ~Writer()
+        {
+            if (tree_) {
+                btree_detail::abandon(
+                    tree_->meta_,
+                    tree_->segment_,
+                    PageSize,
+                    written_);
+                btree_detail::abandon(
+                    tree_->meta_,
+                    tree_->segment_,
+                    PageSize,
+                    dropped_);
+                tree_->meta_.writer.unlock();
+            }
+        }
+
+        void operator = (Writer &&) = delete;
+
+        /**
+         * Add @p key, with @p value.
+         *
+         * @return  false, and change nothing, if @p key is already present.
+         *
+         * @throw  std::length_error if the segment can't grow.
+         */
+        bool insert(K const & key, V const & value)
+        {
+            if (root_ == 0) {
+                root_ = allocate(0);
+                auto * const p = tree_->bytes(root_);
+                header(p).count.store(1u, std::memory_order_relaxed);
+                leaf_keys(p)[0] = key;
+                leaf_values(p)[0] = value;
+                ++size_delta_;
+                return true;
+            }
+
+            auto path = Path{};
+            auto const leaf = find(key, path);
+            auto * p = tree_->bytes(leaf);
+            auto const count = header(p).count.load(std::memory_order_relaxed);
+            auto const i = lower_bound(leaf_keys(p), count, key);
+            if (i < count && not less(key, leaf_keys(p)[i])) {
+                return false;
+            }
+
+            p = tree_->bytes(make_writable(path));
+            ++size_delta_;
+            if (count < leaf_capacity) {
+                shift(leaf_keys(p), i, count, key);
+                shift(leaf_values(p), i, count, value);
+                header(p).count.store(count + 1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // Split the full leaf, with the new entry, in two.
+            K keys[leaf_capacity + 1];
+            V values[leaf_capacity + 1];
+            std::copy_n(leaf_keys(p), count, keys);
+            std::copy_n(leaf_values(p), count, values);
+            shift(keys, i, count, key);
+            shift(values, i, count, value);
+            auto const right = allocate(0);
+            auto * const q = tree_->bytes(right);
+            constexpr std::size_t half = (leaf_capacity + 1) / 2;
+            constexpr std::size_t rest = leaf_capacity + 1 - half;
+            std::copy_n(keys, half, leaf_keys(p));
+            std::copy_n(values, half, leaf_values(p));
+            std::copy_n(keys + half, rest, leaf_keys(q));
+            std::copy_n(values + half, rest, leaf_values(q));
+            header(p).count.store(half, std::memory_order_relaxed);
+            header(q).count.store(rest, std::memory_order_relaxed);
+            insert_child(path, path.depth, keys[half], right);
+            return true;
+        }
+
+        /**
+         * Remove @p key.
+         *
+         * @return  false if @p key is not present.
+         */
+        bool erase(K const & key)
+        {
+            if (root_ == 0) {
+                return false;
+            }
+            auto path = Path{};
+            auto const leaf = find(key, path);
+            auto * p = tree_->bytes(leaf);
+            auto const count = header(p).count.load(std::memory_order_relaxed);
+            auto const i = lower_bound(leaf_keys(p), count, key);
+            if (i == count || less(key, leaf_keys(p)[i])) {
+                return false;
+            }
+
+            --size_delta_;
+            if (count == 1) {
+                // The leaf goes, so there is no need to copy it.
+                remove_child(path, path.depth, make_writable(path, false));
+                return true;
+            }
+            p = tree_->bytes(make_writable(path));
+            unshift(leaf_keys(p), i, count);
+            unshift(leaf_values(p), i, count);
+            header(p).count.store(count - 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * A copy of the value of @p key, as this transaction sees it.
+         */
+        std::optional<V> get(K const & key) const
+        {
+            if (root_ == 0) {
+                return std::nullopt;
+            }
+            auto path = Path{};
+            auto * const p = tree_->bytes(find(key, path));
+            auto const count = header(p).count.load(std::memory_order_relaxed);
+            auto const i = lower_bound(leaf_keys(p), count, key);
+            if (i < count && not less(key, leaf_keys(p)[i])) {
+                return leaf_values(p)[i];
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * Publish the changes, and release the writer lock.
+         *
+         * @param sync  Write the new pages back to the file before the new
+         * root, and the meta page after it, so that the file holds either
+         * the old tree or the new one if the machine fails.  The pages
+         * that the old tree used are not reused until the meta page is
+         * written back.
+         *
+         * @throw  std::system_error if @p sync, and the writes fail.  If the
+         * new pages could not be written, nothing is published, and the
+         * writer still holds the transaction; if the meta page could not,
+         * the changes are published, but may not be on disk, and the pages
+         * they replaced are lost to the file until the machine restarts.
+         */
+        void commit(bool sync = false)
+        {
+            btree_detail::publish(
+                tree_->meta_,
+                tree_->segment_,
+                PageSize,
+                root_,
+                written_,
+                size_delta_,
+                sync);
+            auto & tree = *std::exchange(tree_, nullptr);
+            auto guard = std::lock_guard(tree.meta_.writer, std::adopt_lock);
+            btree_detail::retire(
+                tree.meta_,
+                tree.segment_,
+                PageSize,
+                obsolete_,
+                dropped_,
+                sync);
+        }
+
+    private:
+        friend class IpcBTree;
+
+        static constexpr std::size_t max_depth = 32;
+
+        // The pages from the root down to a leaf, and the child taken from
+        // each.
+        struct Path
+        {
+            std::uint64_t pages[max_depth];
+            std::size_t children[max_depth];
+            std::size_t depth = 0;
+        };
+
+        explicit Writer(IpcBTree & tree)
+        : Writer(tree, (tree.meta_.writer.lock(), std::adopt_lock))
+        { }
+
+        Writer(IpcBTree & tree, std::adopt_lock_t)
+        : tree_(&tree)
+        , txn_(tree.meta_.txn.load(std::memory_order_relaxed) + 1)
+        , root_(tree.meta_.root.load(std::memory_order_relaxed))
+        { }
+
+        std::uint64_t allocate(std::uint32_t level)
+        {
+            auto const n = btree_detail::allocate(
+                tree_->meta_,
+                tree_->segment_,
+                PageSize,
+                txn_);
+            written_.push_back(n);
+            header(tree_->bytes(n)).level.store(
+                level,
+                std::memory_order_relaxed);
+            return n;
+        }
+
+        // Find the leaf for @p key, recording the inner pages on the way.
+        std::uint64_t find(K const & key, Path & path) const
+        {
+            path.depth = 0;
+            auto n = root_;
+            for (;;) {
+                auto * const p = tree_->bytes(n);
+                if (header(p).level.load(std::memory_order_relaxed) == 0) {
+                    return n;
+                }
+                auto const count =
+                    header(p).count.load(std::memory_order_relaxed);
+                auto const i = upper_bound(inner_keys(p), count - 1, key);
+                path.pages[path.depth] = n;
+                path.children[path.depth] = i;
+                ++path.depth;
+                n = inner_children(p)[i];
+            }
+        }
+
+        // The page @p n, or, if it is part of the committed tree, a copy of
+        // it that this transaction can change.
+        std::uint64_t writable(std::uint64_t n)
+        {
+            auto * const p = tree_->bytes(n);
+            if (header(p).txn.load(std::memory_order_relaxed) == txn_) {
+                return n;
+            }
+            auto const copy = allocate(0);
+            auto * const q = tree_->bytes(copy);
+            header(q).count.store(
+                header(p).count.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+            header(q).level.store(
+                header(p).level.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+            std::memcpy(
+                q + sizeof(Page),
+                p + sizeof(Page),
+                PageSize - sizeof(Page));
+            obsolete_.push_back(n);
+            return copy;
+        }
+
+        // Make every page of @p path writable, and the leaf at its end too
+        // if @p leaf, and return the leaf.
+        std::uint64_t make_writable(Path & path, bool leaf = true)
+        {
+            auto * slot = &root_;
+            for (std::size_t d = 0; d < path.depth; ++d) {
+                *slot = path.pages[d] = writable(*slot);
+                auto * const p = tree_->bytes(*slot);
+                slot = &inner_children(p)[path.children[d]];
+            }
+            if (leaf) {
+                *slot = writable(*slot);
+            }
+            return *slot;
+        }
+
+        // Add @p right, whose keys start at @p key, after the child taken
+        // at depth @p depth - 1 of @p path, splitting pages as needed.
+        void insert_child(
+            Path & path,
+            std::size_t depth,
+            K const & key,
+            std::uint64_t right)
+        {
+            if (depth == 0) {
+                auto const left = root_;
+                auto const level =
+                    header(tree_->bytes(left)).level.load(
+                        std::memory_order_relaxed);
+                root_ = allocate(level + 1);
+                auto * const p = tree_->bytes(root_);
+                inner_keys(p)[0] = key;
+                inner_children(p)[0] = left;
+                inner_children(p)[1] = right;
+                header(p).count.store(2u, std::memory_order_relaxed);
+                return;
+            }
+
+            auto const n = path.pages[depth - 1];
+            auto const i = path.children[depth - 1];
+            auto * const p = tree_->bytes(n);
+            auto const count = header(p).count.load(std::memory_order_relaxed);
+            if (count < inner_capacity) {
+                shift(inner_keys(p), i, count - 1, key);
+                shift(inner_children(p), i + 1, count, right);
+                header(p).count.store(count + 1, std::memory_order_relaxed);
+                return;
+            }
+
+            // Split the full page, with the new child, in two; the key
+            // between the halves moves up.
+            K keys[inner_capacity];
+            std::uint64_t children[inner_capacity + 1];
+            std::copy_n(inner_keys(p), count - 1, keys);
+            std::copy_n(inner_children(p), count, children);
+            shift(keys, i, count - 1, key);
+            shift(children, i + 1, count, right);
+            auto const level = header(p).level.load(std::memory_order_relaxed);
+            auto const sibling = allocate(level);
+            auto * const q = tree_->bytes(sibling);
+            constexpr std::size_t half = (inner_capacity + 1) / 2;
+            constexpr std::size_t rest = inner_capacity + 1 - half;
+            std::copy_n(keys, half - 1, inner_keys(p));
+            std::copy_n(children, half, inner_children(p));
+            std::copy_n(keys + half, rest - 1, inner_keys(q));
+            std::copy_n(children + half, rest, inner_children(q));
+            header(p).count.store(half, std::memory_order_relaxed);
+            header(q).count.store(rest, std::memory_order_relaxed);
+            insert_child(path, depth - 1, keys[half - 1], sibling);
+        }
+
+        // Remove @p n, whose last entry or child is going, the child taken
+        // at depth @p depth - 1 of @p path, and the pages above it that are
+        // left empty.
+        void remove_child(Path & path, std::size_t depth, std::uint64_t n)
+        {
+            drop(n);
+            if (depth == 0) {
+                root_ = 0;
+                return;
+            }
+            auto const parent = path.pages[depth - 1];
+            auto const i = path.children[depth - 1];
+            auto * const p = tree_->bytes(parent);
+            auto const count = header(p).count.load(std::memory_order_relaxed);
+            if (count == 1) {
+                remove_child(path, depth - 1, parent);
+                return;
+            }
+            unshift(inner_keys(p), i == 0 ? 0 : i - 1, count - 1);
+            unshift(inner_children(p), i, count);
+            header(p).count.store(count - 1, std::memory_order_relaxed);
+
+            // A root with one child is replaced by the child.
+            while (root_ != 0) {
+                auto * const r = tree_->bytes(root_);
+                if (header(r).level.load(std::memory_order_relaxed) == 0 ||
+                    header(r).count.load(std::memory_order_relaxed) != 1)
+                {
+                    break;
+                }
+                auto const child = inner_children(r)[0];
+                drop(root_);
+                root_ = child;
+            }
+        }
+
+        // Remove @p n from the tree.
+        void drop(std::uint64_t n)
+        {
+            auto * const p = tree_->bytes(n);
+            if (header(p).txn.load(std::memory_order_relaxed) != txn_) {
+                obsolete_.push_back(n);
+                return;
+            }
+            written_.erase(std::find(written_.begin(), written_.end(), n));
+            dropped_.push_back(n);
+        }
+
+        IpcBTree * tree_;
+        std::uint64_t txn_;
+        std::uint64_t root_;
+        std::int64_t size_delta_ = 0;
+        std::vector<std::uint64_t> written_;
+        std::vector<std::uint64_t> obsolete_;
+        std::vector<std::uint64_t> dropped_;
+    };
+
+private:
+    struct Leaf
+    {
+        std::uint64_t page;
+        std::uint64_t version;
+        // The first key of the next leaf, if there is one.
+        std::optional<K> upper;
+    };
+
+    static constexpr std::size_t leaf_values_offset =
+        align_up(sizeof(Page) + leaf_capacity * sizeof(K), alignof(V));
+    static constexpr std::size_t inner_children_offset = align_up(
+        sizeof(Page) + (inner_capacity - 1) * sizeof(K),
+        alignof(std::uint64_t));
+
+    static Page & header(std::byte * p) noexcept
+    {
+        return *reinterpret_cast<Page *>(p);
+    }
+
+    static K * leaf_keys(std::byte * p) noexcept
+    {
+        return reinterpret_cast<K *>(p + sizeof(Page));
+    }
+
+    static V * leaf_values(std::byte * p) noexcept
+    {
+        return reinterpret_cast<V *>(p + leaf_values_offset);
+    }
+
+    static K * inner_keys(std::byte * p) noexcept
+    {
+        return reinterpret_cast<K *>(p + sizeof(Page));
+    }
+
+    static std::uint64_t * inner_children(std::byte * p) noexcept
+    {
+        return reinterpret_cast<std::uint64_t *>(p + inner_children_offset);
+    }
+
+    static bool less(K const & a, K const & b) { return Compare{}(a, b); }
+
+    // The index of the first of @p n keys that is not less than @p key.
+    static std::size_t
+    lower_bound(K const * keys, std::size_t n, K const & key)
+    {
+        return static_cast<std::size_t>(
+            std::lower_bound(keys, keys + n, key, Compare{}) - keys);
+    }
+
+    // The index of the first of @p n keys that is greater than @p key.
+    static std::size_t
+    upper_bound(K const * keys, std::size_t n, K const & key)
+    {
+        return static_cast<std::size_t>(
+            std::upper_bound(keys, keys + n, key, Compare{}) - keys);
+    }
+
+    // Insert @p value at @p i of the @p n values at @p values.
+    template <typename T>
+    static void shift(T * values, std::size_t i, std::size_t n, T const & value)
+    {
+        std::copy_backward(values + i, values + n, values + n + 1);
+        values[i] = value;
+    }
+
+    // Remove the value at @p i of the @p n values at @p values.
+    template <typename T>
+    static void unshift(T * values, std::size_t i, std::size_t n)
+    {
+        std::copy(values + i + 1, values + n, values + i);
+    }
+
+    std::byte * bytes(std::uint64_t n) const
+    {
+        return reinterpret_cast<std::byte *>(
+            &btree_detail::page(segment_, PageSize, n));
+    }
+
+    std::uint64_t version(std::uint64_t n) const
+    {
+        return header(bytes(n)).version.load(std::memory_order_acquire);
+    }
+
+    bool valid(std::uint64_t n, std::uint64_t version) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return header(bytes(n)).version.load(std::memory_order_relaxed) ==
+            version;
+    }
+
+    // The leaf that holds @p key, as of the version returned with it, or a
+    // leaf of page zero if the tree is empty, or std::nullopt if a page
+    // changed on the way down, and the caller should try again.
+    //
+    // The version of each child is read before the parent is checked, so a
+    // child that was replaced, and reused, after the parent was read is
+    // caught, either by its version then, or by the parent's.
+    std::optional<Leaf> descend(K const & key) const
+    {
+        auto n = meta_.root.load(std::memory_order_acquire);
+        if (n == 0) {
+            return Leaf{0, 0, std::nullopt};
+        }
+        auto v = version(n);
+        if ((v & 1u) || meta_.root.load(std::memory_order_acquire) != n) {
+            return std::nullopt;
+        }
+
+        std::optional<K> upper;
+        auto const pages = meta_.pages.load(std::memory_order_acquire);
+        for (std::size_t depth = 0; depth < Writer::max_depth; ++depth) {
+            auto * const p = bytes(n);
+            if (header(p).level.load(std::memory_order_relaxed) == 0) {
+                return Leaf{n, v, upper};
+            }
+            auto const count = std::clamp<std::size_t>(
+                header(p).count.load(std::memory_order_relaxed),
+                1,
+                inner_capacity);
+            auto const i = upper_bound(inner_keys(p), count - 1, key);
+            if (i + 1 < count) {
+                upper = inner_keys(p)[i];
+            }
+            auto const child = inner_children(p)[i];
+            if (child == 0 || child >= pages) {
+                return std::nullopt;
+            }
+            auto const w = version(child);
+            if ((w & 1u) || not valid(n, v)) {
+                return std::nullopt;
+            }
+            n = child;
+            v = w;
+        }
+        return std::nullopt;
+    }
+
+    GrowableSegment & segment_;
+    btree_detail::Meta & meta_;
+};
+
+} // namespace wjh
+
+#endif // WJH_3d7a9f2c5e1b4c86a4f0b8e6d2c7a913
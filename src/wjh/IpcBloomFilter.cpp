@@ -0,0 +1,257 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcBloomFilter.hpp"
+
+namespace wjh {
+namespace bloom_detail {
+
+namespace {
+
+// The finalizer of MurmurHash3, which spreads every bit of the input across
+// every bit of the output.
+constexpr std::uint64_t
+mix(std::uint64_t x) noexcept
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdu;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53u;
+    x ^= x >> 33;
+    return x;
+}
+
+// Where a key goes: its block, and the first position and step of the
+// positions within it.  An odd step visits distinct positions.
+struct Probe
+{
+    std::size_t block;
+    std::uint32_t position;
+    std::uint32_t step;
+};
+
+Probe
+probe(Blocks blocks, std::uint64_t key) noexcept
+{
+    auto const h = mix(key);
+    auto const g = mix(h ^ 0x9e3779b97f4a7c15u);
+    return Probe{
+        static_cast<std::size_t>(((h >> 32) * blocks.size) >> 32),
+        static_cast<std::uint32_t>(g),
+        static_cast<std::uint32_t>(g >> 32) | 1u};
+}
+
+// The bits of each word of the block that the key sets.
+struct Masks
+{
+    std::uint64_t words[words_per_block];
+};
+
+Masks
+bit_masks(Blocks blocks, Probe p) noexcept
+{
+    Masks result{};
+    for (unsigned i = 0; i < blocks.hashes; ++i) {
+        auto const bit = (p.position + i * p.step) & 511u;
+        result.words[bit >> 6] |= std::uint64_t(1) << (bit & 63u);
+    }
+    return result;
+}
+
+// The nibbles of each word of the block that hold the key's counters.
+Masks
+counter_masks(Blocks blocks, Probe p) noexcept
+{
+    Masks result{};
+    for (unsigned i = 0; i < blocks.hashes; ++i) {
+        auto const counter = (p.position + i * p.step) & 127u;
+        result.words[counter >> 4] |= std::uint64_t(0xf)
+            << ((counter & 15u) * 4);
+    }
+    return result;
+}
+
+bool
+test(Block const & block, Masks const & masks) noexcept
+{
+    for (std::size_t w = 0; w < words_per_block; ++w) {
+        if ((block.words[w].load(std::memory_order_relaxed) &
+             masks.words[w]) != masks.words[w])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// true if every counter of @p mask in @p word is non-zero.
+bool
+counted(std::uint64_t word, std::uint64_t mask) noexcept
+{
+    while (mask) {
+        auto const shift = unsigned(__builtin_ctzll(mask)) & ~3u;
+        if (((word >> shift) & 0xf) == 0) {
+            return false;
+        }
+        mask &= ~(std::uint64_t(0xf) << shift);
+    }
+    return true;
+}
+
+// Add @p delta, which is 1 or -1, to each counter of @p mask in @p word,
+// leaving saturated counters, and those that would go below zero, alone.
+std::uint64_t
+add(std::uint64_t word, std::uint64_t mask, int delta) noexcept
+{
+    while (mask) {
+        auto const shift = unsigned(__builtin_ctzll(mask)) & ~3u;
+        auto const one = std::uint64_t(1) << shift;
+        auto const n = (word >> shift) & 0xf;
+        if (n != 0xf) {
+            if (delta > 0) {
+                word += one;
+            } else if (n != 0) {
+                word -= one;
+            }
+        }
+        mask &= ~(std::uint64_t(0xf) << shift);
+    }
+    return word;
+}
+
+// Add @p delta to the key's counters, and return true if any was zero.
+bool
+update(Block & block, Masks const & masks, int delta) noexcept
+{
+    bool zero = false;
+    for (std::size_t w = 0; w < words_per_block; ++w) {
+        if (masks.words[w] == 0) {
+            continue;
+        }
+        auto & word = block.words[w];
+        auto old = word.load(std::memory_order_relaxed);
+        while (not word.compare_exchange_weak(
+            old,
+            add(old, masks.words[w], delta),
+            std::memory_order_relaxed,
+            std::memory_order_relaxed))
+        {
+        }
+        zero = zero || not counted(old, masks.words[w]);
+    }
+    return zero;
+}
+
+} // anonymous namespace
+
+std::uint64_t
+hash(std::string_view key) noexcept
+{
+    // FNV-1a, eight bytes at a time, then mixed.
+    std::uint64_t h = 0xcbf29ce484222325u;
+    std::size_t i = 0;
+    for (; i + 8 <= key.size(); i += 8) {
+        std::uint64_t chunk = 0;
+        for (std::size_t j = 0; j < 8; ++j) {
+            chunk |= std::uint64_t(static_cast<unsigned char>(key[i + j]))
+                << (8 * j);
+        }
+        h = (h ^ chunk) * 0x100000001b3u;
+    }
+    for (; i < key.size(); ++i) {
+        h = (h ^ static_cast<unsigned char>(key[i])) * 0x100000001b3u;
+    }
+    return mix(h ^ key.size());
+}
+
+bool
+insert(Blocks blocks, std::uint64_t key) noexcept
+{
+    auto const p = probe(blocks, key);
+    auto const masks = bit_masks(blocks, p);
+    auto & block = blocks.blocks[p.block];
+    bool added = false;
+    for (std::size_t w = 0; w < words_per_block; ++w) {
+        auto const mask = masks.words[w];
+        if (mask == 0) {
+            continue;
+        }
+        // Skip the write, and its cache line invalidation, when the bits are
+        // already set.
+        auto & word = block.words[w];
+        if ((word.load(std::memory_order_relaxed) & mask) != mask &&
+            (word.fetch_or(mask, std::memory_order_relaxed) & mask) != mask)
+        {
+            added = true;
+        }
+    }
+    return added;
+}
+
+bool
+contains(Blocks blocks, std::uint64_t key) noexcept
+{
+    auto const p = probe(blocks, key);
+    return test(blocks.blocks[p.block], bit_masks(blocks, p));
+}
+
+std::uint64_t
+contains(Blocks blocks, std::span<std::uint64_t const, 64> keys) noexcept
+{
+    Probe probes[64];
+    for (std::size_t i = 0; i < 64; ++i) {
+        probes[i] = probe(blocks, keys[i]);
+    }
+    for (std::size_t i = 0; i < 64; ++i) {
+        __builtin_prefetch(&blocks.blocks[probes[i].block]);
+    }
+    std::uint64_t result = 0;
+    for (std::size_t i = 0; i < 64; ++i) {
+        if (test(blocks.blocks[probes[i].block], bit_masks(blocks, probes[i])))
+        {
+            result |= std::uint64_t(1) << i;
+        }
+    }
+    return result;
+}
+
+bool
+count_insert(Blocks blocks, std::uint64_t key) noexcept
+{
+    auto const p = probe(blocks, key);
+    return update(blocks.blocks[p.block], counter_masks(blocks, p), 1);
+}
+
+bool
+count_erase(Blocks blocks, std::uint64_t key) noexcept
+{
+    if (not count_contains(blocks, key)) {
+        return false;
+    }
+    auto const p = probe(blocks, key);
+    update(blocks.blocks[p.block], counter_masks(blocks, p), -1);
+    return true;
+}
+
+bool
+count_contains(Blocks blocks, std::uint64_t key) noexcept
+{
+    auto const p = probe(blocks, key);
+    auto const masks = counter_masks(blocks, p);
+    auto const & block = blocks.blocks[p.block];
+    for (std::size_t w = 0; w < words_per_block; ++w) {
+        if (not counted(
+                block.words[w].load(std::memory_order_relaxed),
+                masks.words[w]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace bloom_detail
+} // namespace wjh
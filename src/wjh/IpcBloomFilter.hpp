@@ -0,0 +1,243 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_5a1c9e7d3b2f48e6a0d4c8b6f1e3a952
+#define WJH_5a1c9e7d3b2f48e6a0d4c8b6f1e3a952
+
+#include "Atomic.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+namespace wjh {
+
+namespace bloom_detail {
+
+inline constexpr std::size_t words_per_block = 8;
+
+struct alignas(64) Block
+{
+    Atomic<std::uint64_t> words[words_per_block];
+};
+
+struct Blocks
+{
+    Block * blocks;
+    std::size_t size;
+    unsigned hashes;
+};
+
+/**
+ * A 64-bit hash of @p key that is the same in every process, unlike
+ * std::hash, which need not be.
+ */
+std::uint64_t hash(std::string_view key) noexcept;
+
+bool insert(Blocks blocks, std::uint64_t key) noexcept;
+
+bool contains(Blocks blocks, std::uint64_t key) noexcept;
+
+std::uint64_t
+contains(Blocks blocks, std::span<std::uint64_t const, 64> keys) noexcept;
+
+bool count_insert(Blocks blocks, std::uint64_t key) noexcept;
+
+bool count_erase(Blocks blocks, std::uint64_t key) noexcept;
+
+bool count_contains(Blocks blocks, std::uint64_t key) noexcept;
+
+} // namespace bloom_detail
+
+/**
+ * A blocked Bloom filter, shared between processes.
+ *
+ * Each key maps to one 64 byte block, and sets Hashes bits within it, so an
+ * insert or a query touches a single cache line.  Inserts fetch_or only the
+ * words of the block that need bits set, and queries are relaxed loads, so
+ * any number of processes can insert and query at once, without locks.
+ *
+ * Keys are either 64-bit integers, such as message ids, which are mixed
+ * before use, or strings, which are hashed with a hash that is the same in
+ * every process.
+ *
+ * With Hashes of 8, about 10 bits per expected key, that is Blocks of one
+ * per 50 keys, gives a false positive rate of about 1%.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized filter is empty.
+ */
+template <std::size_t Blocks, unsigned Hashes = 8>
+requires(
+    Blocks > 0 && Blocks < (std::size_t(1) << 32) && Hashes > 0 &&
+    Hashes <= 16)
+class IpcBloomFilter
+{
+public:
+    static constexpr std::size_t blocks = Blocks;
+    static constexpr std::size_t bits = Blocks * 512;
+    static constexpr unsigned hashes = Hashes;
+
+    /**
+     * Add @p key.
+     *
+     * @return  true if @p key was certainly not in the filter before, which
+     * makes this a test-and-set for deduplication.
+     */
+    bool insert(std::uint64_t key) noexcept
+    {
+        return bloom_detail::insert(detail(), key);
+    }
+
+    bool insert(std::string_view key) noexcept
+    {
+        return insert(bloom_detail::hash(key));
+    }
+
+    /**
+     * false if @p key is certainly not in the filter.
+     */
+    bool contains(std::uint64_t key) const noexcept
+    {
+        return bloom_detail::contains(detail(), key);
+    }
+
+    bool contains(std::string_view key) const noexcept
+    {
+        return contains(bloom_detail::hash(key));
+    }
+
+    /**
+     * Query 64 keys at once.
+     *
+     * The blocks of all the keys are computed, and their cache lines
+     * requested, before any is tested, so the memory accesses overlap,
+     * rather than being taken one miss at a time.
+     *
+     * @return  A mask with bit i set if keys[i] may be in the filter.
+     */
+    std::uint64_t
+    contains(std::span<std::uint64_t const, 64> keys) const noexcept
+    {
+        return bloom_detail::contains(detail(), keys);
+    }
+
+    /**
+     * Remove every key.
+     *
+     * @note  This is not atomic with respect to concurrent inserts.
+     */
+    void clear() noexcept
+    {
+        for (auto & block : blocks_) {
+            for (auto & word : block.words) {
+                word.store(0u, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    bloom_detail::Blocks detail() const noexcept
+    {
+        return bloom_detail::Blocks{
+            const_cast<bloom_detail::Block *>(blocks_),
+            Blocks,
+            Hashes};
+    }
+
+    bloom_detail::Block blocks_[Blocks];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcBloomFilter<1>>);
+
+/**
+ * A blocked counting Bloom filter, shared between processes, which also
+ * supports erase().
+ *
+ * Each key maps to one 64 byte block of 128 4-bit counters, and counts in
+ * Hashes of them.  The counters of one word are updated with a single
+ * compare and exchange, and they saturate at 15: a saturated counter is
+ * never decremented again, since its true count is no longer known.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized filter is empty.
+ *
+ * @note  Erasing a key that was never inserted can remove other keys.
+ */
+template <std::size_t Blocks, unsigned Hashes = 8>
+requires(
+    Blocks > 0 && Blocks < (std::size_t(1) << 32) && Hashes > 0 &&
+    Hashes <= 16)
+class IpcCountingBloomFilter
+{
+public:
+    static constexpr std::size_t blocks = Blocks;
+    static constexpr std::size_t counters = Blocks * 128;
+    static constexpr unsigned hashes = Hashes;
+
+    /**
+     * Add @p key.
+     *
+     * @return  true if @p key was certainly not in the filter before.
+     */
+    bool insert(std::uint64_t key) noexcept
+    {
+        return bloom_detail::count_insert(detail(), key);
+    }
+
+    bool insert(std::string_view key) noexcept
+    {
+        return insert(bloom_detail::hash(key));
+    }
+
+    /**
+     * Remove one insertion of @p key.
+     *
+     * @return  false, and change nothing, if @p key is certainly not in the
+     * filter.
+     */
+    bool erase(std::uint64_t key) noexcept
+    {
+        return bloom_detail::count_erase(detail(), key);
+    }
+
+    bool erase(std::string_view key) noexcept
+    {
+        return erase(bloom_detail::hash(key));
+    }
+
+    /**
+     * false if @p key is certainly not in the filter.
+     */
+    bool contains(std::uint64_t key) const noexcept
+    {
+        return bloom_detail::count_contains(detail(), key);
+    }
+
+    bool contains(std::string_view key) const noexcept
+    {
+        return contains(bloom_detail::hash(key));
+    }
+
+private:
+    bloom_detail::Blocks detail() const noexcept
+    {
+        return bloom_detail::Blocks{
+            const_cast<bloom_detail::Block *>(blocks_),
+            Blocks,
+            Hashes};
+    }
+
+    bloom_detail::Block blocks_[Blocks];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcCountingBloomFilter<1>>);
+
+} // namespace wjh
+
+#endif // WJH_5a1c9e7d3b2f48e6a0d4c8b6f1e3a952
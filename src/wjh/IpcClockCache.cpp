@@ -0,0 +1,459 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcClockCache.hpp"
+
+#include "IpcBloomFilter.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+
+namespace wjh {
+namespace clockcache_detail {
+
+namespace {
+
+// The hash of IpcBloomFilter, which is the same in every process.
+std::uint64_t
+hash(void const * key, std::size_t size) noexcept
+{
+    return bloom_detail::hash(
+        std::string_view(static_cast<char const *>(key), size));
+}
+
+Entry &
+entry(Cache const & cache, std::uint32_t i) noexcept
+{
+    return *reinterpret_cast<Entry *>(cache.entries + i * cache.stride);
+}
+
+std::byte *
+key_of(Cache const & cache, std::uint32_t i) noexcept
+{
+    return cache.entries + i * cache.stride + cache.key_offset;
+}
+
+std::byte *
+value_of(Cache const & cache, std::uint32_t i) noexcept
+{
+    return cache.entries + i * cache.stride + cache.value_offset;
+}
+
+std::uint32_t
+bucket_of(Cache const & cache, std::uint64_t h) noexcept
+{
+    return static_cast<std::uint32_t>(h & (cache.buckets - 1));
+}
+
+ProcessIdLock &
+stripe(Cache const & cache, std::uint32_t bucket) noexcept
+{
+    return cache.stripes[bucket % cache.nstripes];
+}
+
+void
+reference(Cache const & cache, std::uint32_t i) noexcept
+{
+    // Skip the write, and its cache line invalidation, when the bit is
+    // already set, so hits on hot entries write nothing at all.
+    auto & word = cache.referenced[i / 64];
+    auto const bit = std::uint64_t(1) << (i % 64);
+    if ((word.load(std::memory_order_relaxed) & bit) == 0) {
+        word.fetch_or(bit, std::memory_order_relaxed);
+    }
+}
+
+// Clear the reference bit of entry @p i, and return whether it was set.
+bool
+unreference(Cache const & cache, std::uint32_t i) noexcept
+{
+    auto & word = cache.referenced[i / 64];
+    auto const bit = std::uint64_t(1) << (i % 64);
+    if ((word.load(std::memory_order_relaxed) & bit) == 0) {
+        return false;
+    }
+    return (word.fetch_and(~bit, std::memory_order_relaxed) & bit) != 0;
+}
+
+struct Found
+{
+    std::uint32_t entry;
+    std::uint32_t version;
+};
+
+// Find @p key without locking.  The entry is a candidate only: the caller
+// must check that its version has not changed after reading from it.
+std::optional<Found>
+find(Cache const & cache, void const * key, std::uint64_t h) noexcept
+{
+    auto i = cache.heads[bucket_of(cache, h)].load(std::memory_order_acquire);
+
+    // A reader on an entry that is moved to another chain follows it there,
+    // and may miss, but chains never form a cycle that would keep it going
+    // for more than the entries that exist.
+    for (std::uint32_t n = 0; i != 0 && n < cache.capacity; ++n) {
+        auto const & e = entry(cache, i - 1);
+        auto const version = e.version.load(std::memory_order_acquire);
+        if ((version & 1u) == 0 &&
+            e.hash.load(std::memory_order_relaxed) == h &&
+            std::memcmp(key_of(cache, i - 1), key, cache.key_size) == 0)
+        {
+            return Found{i - 1, version};
+        }
+        i = e.next.load(std::memory_order_acquire);
+    }
+    return std::nullopt;
+}
+
+bool
+unchanged(Cache const & cache, Found found) noexcept
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return entry(cache, found.entry).version.load(std::memory_order_relaxed) ==
+        found.version;
+}
+
+// Find @p key in its bucket's chain, whose stripe the caller holds.
+std::optional<std::uint32_t>
+find_locked(Cache const & cache, void const * key, std::uint64_t h) noexcept
+{
+    auto i = cache.heads[bucket_of(cache, h)].load(std::memory_order_relaxed);
+    while (i != 0) {
+        auto const & e = entry(cache, i - 1);
+        // An odd entry in a chain was left by a process that died.
+        if ((e.version.load(std::memory_order_relaxed) & 1u) == 0 &&
+            e.hash.load(std::memory_order_relaxed) == h &&
+            std::memcmp(key_of(cache, i - 1), key, cache.key_size) == 0)
+        {
+            return i - 1;
+        }
+        i = e.next.load(std::memory_order_relaxed);
+    }
+    return std::nullopt;
+}
+
+// Remove entry @p i from the chain of @p bucket, whose stripe the caller
+// holds.  The entry keeps its next, so readers on it can go on.
+bool
+unlink(Cache const & cache, std::uint32_t bucket, std::uint32_t i) noexcept
+{
+    auto const next = entry(cache, i).next.load(std::memory_order_relaxed);
+    auto * link = &cache.heads[bucket];
+    for (;;) {
+        auto const j = link->load(std::memory_order_relaxed);
+        if (j == 0) {
+            return false;
+        }
+        if (j == i + 1) {
+            link->store(next, std::memory_order_release);
+            return true;
+        }
+        link = &entry(cache, j - 1).next;
+    }
+}
+
+// true if a live process has pinned entry @p i.
+//
+// The caller has made the entry's version odd, and a pinner records its pin
+// before checking that the version is unchanged, so either the pin is seen
+// here, or the pinner sees the change and gives up.
+bool
+pinned(Cache const & cache, std::uint32_t i)
+{
+    for (std::uint32_t r = 0; r < cache.npins; ++r) {
+        auto & record = cache.pins[r];
+        if (record.entry.load(std::memory_order_seq_cst) != i + 1) {
+            continue;
+        }
+        auto owner = record.owner.load(std::memory_order_relaxed);
+        if (owner == ProcessId::null()) {
+            continue;
+        }
+        if (owner.alive()) {
+            return true;
+        }
+        record.owner.compare_exchange_strong(
+            owner,
+            ProcessId::null(),
+            std::memory_order_release,
+            std::memory_order_relaxed);
+    }
+    return false;
+}
+
+// Take entry @p i for reuse: lock it, and, if it is in a chain, and not
+// pinned, remove it, unless @p evict is false.  On success, the entry is
+// locked, in no chain, and its version is odd.
+std::optional<Found>
+take(Cache const & cache, std::uint32_t i, bool evict)
+{
+    auto & e = entry(cache, i);
+    if (not e.lock.try_lock()) {
+        return std::nullopt;
+    }
+
+    // An odd version here means that the process that held the lock died
+    // while changing the entry.
+    auto const version = e.version.load(std::memory_order_relaxed);
+    auto const odd = version | 1u;
+    if (auto const bucket = e.bucket.load(std::memory_order_relaxed)) {
+        if (not evict) {
+            e.lock.unlock();
+            return std::nullopt;
+        }
+        auto guard = std::lock_guard(stripe(cache, bucket - 1));
+        e.version.store(odd, std::memory_order_seq_cst);
+        if (pinned(cache, i)) {
+            e.version.store(odd + 1, std::memory_order_release);
+            e.lock.unlock();
+            return std::nullopt;
+        }
+        if (unlink(cache, bucket - 1, i)) {
+            cache.control.size.fetch_sub(1u, std::memory_order_relaxed);
+        }
+        e.bucket.store(0u, std::memory_order_relaxed);
+    } else {
+        e.version.store(odd, std::memory_order_relaxed);
+    }
+    return Found{i, odd};
+}
+
+// Move the CLOCK hand on, and return the entry it was on.
+std::uint32_t
+advance(Cache const & cache) noexcept
+{
+    return cache.control.hand.fetch_add(1u, std::memory_order_relaxed) %
+        cache.capacity;
+}
+
+// Find an entry to reuse by sweeping the CLOCK hand.
+std::optional<Found>
+allocate(Cache const & cache)
+{
+    // While the cache is not full, one turn looks only for entries in no
+    // chain, and leaves the reference bits alone.
+    auto const & size = cache.control.size;
+    for (std::uint32_t n = 0; n < cache.capacity; ++n) {
+        if (size.load(std::memory_order_relaxed) >= cache.capacity) {
+            break;
+        }
+        auto const i = advance(cache);
+        if (entry(cache, i).bucket.load(std::memory_order_relaxed) == 0) {
+            if (auto const found = take(cache, i, false)) {
+                return found;
+            }
+        }
+    }
+
+    // Two turns clear every reference bit, and a third goes past any entry
+    // that was busy on the first two.
+    auto const steps = 3 * std::uint64_t(cache.capacity);
+    for (std::uint64_t n = 0; n < steps; ++n) {
+        auto const i = advance(cache);
+        if (unreference(cache, i)) {
+            continue;
+        }
+        if (auto const found = take(cache, i, true)) {
+            return found;
+        }
+    }
+    return std::nullopt;
+}
+
+// Make the taken entry @p found free again.
+void
+release(Cache const & cache, Found found) noexcept
+{
+    auto & e = entry(cache, found.entry);
+    e.version.store(found.version + 1, std::memory_order_release);
+    e.lock.unlock();
+}
+
+// Claim a free pin record.
+std::uint32_t
+claim(Cache const & cache)
+{
+    auto const me = ProcessId::current();
+    auto const start = static_cast<std::uint32_t>(me.pid()) % cache.npins;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (std::uint32_t n = 0; n < cache.npins; ++n) {
+            auto const r = (start + n) % cache.npins;
+            auto & record = cache.pins[r];
+            auto owner = record.owner.load(std::memory_order_relaxed);
+            if (owner == ProcessId::null() &&
+                record.owner.compare_exchange_strong(
+                    owner,
+                    me,
+                    std::memory_order_acquire,
+                    std::memory_order_relaxed))
+            {
+                return r;
+            }
+        }
+        if (release_dead_pins(cache) == 0) {
+            break;
+        }
+    }
+    throw std::length_error("IpcClockCache has no free pin records");
+}
+
+} // anonymous namespace
+
+bool
+get(Cache cache, void const * key, void * value)
+{
+    auto const h = hash(key, cache.key_size);
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        auto const found = find(cache, key, h);
+        if (not found) {
+            return false;
+        }
+        std::memcpy(value, value_of(cache, found->entry), cache.value_size);
+        if (unchanged(cache, *found)) {
+            reference(cache, found->entry);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<Pinned>
+pin(Cache cache, void const * key)
+{
+    auto const h = hash(key, cache.key_size);
+    auto found = find(cache, key, h);
+    if (not found) {
+        return std::nullopt;
+    }
+    auto const r = claim(cache);
+    auto & record = cache.pins[r];
+    for (int attempt = 0; found && attempt < 4; ++attempt) {
+        record.entry.store(found->entry + 1, std::memory_order_seq_cst);
+        auto const & e = entry(cache, found->entry);
+        if (e.version.load(std::memory_order_seq_cst) == found->version) {
+            reference(cache, found->entry);
+            return Pinned{r, found->entry};
+        }
+        found = find(cache, key, h);
+    }
+    unpin(cache, r);
+    return std::nullopt;
+}
+
+void
+unpin(Cache cache, std::uint32_t record) noexcept
+{
+    cache.pins[record].entry.store(0u, std::memory_order_release);
+    cache.pins[record].owner.store(
+        ProcessId::null(),
+        std::memory_order_release);
+}
+
+bool
+insert(Cache cache, void const * key, void const * value)
+{
+    auto const h = hash(key, cache.key_size);
+    if (auto const found = find(cache, key, h);
+        found && unchanged(cache, *found))
+    {
+        return false;
+    }
+    auto const found = allocate(cache);
+    if (not found) {
+        return false;
+    }
+
+    auto const bucket = bucket_of(cache, h);
+    auto & head = cache.heads[bucket];
+    auto & e = entry(cache, found->entry);
+    auto guard = std::lock_guard(stripe(cache, bucket));
+    if (find_locked(cache, key, h)) {
+        release(cache, *found);
+        return false;
+    }
+    std::memcpy(key_of(cache, found->entry), key, cache.key_size);
+    std::memcpy(value_of(cache, found->entry), value, cache.value_size);
+    e.hash.store(h, std::memory_order_relaxed);
+    e.next.store(
+        head.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    e.bucket.store(bucket + 1, std::memory_order_relaxed);
+    unreference(cache, found->entry);
+    e.version.store(found->version + 1, std::memory_order_release);
+    head.store(found->entry + 1, std::memory_order_release);
+    cache.control.size.fetch_add(1u, std::memory_order_relaxed);
+    e.lock.unlock();
+    return true;
+}
+
+bool
+erase(Cache cache, void const * key)
+{
+    auto const h = hash(key, cache.key_size);
+    auto const bucket = bucket_of(cache, h);
+    auto guard = std::lock_guard(stripe(cache, bucket));
+    auto const i = find_locked(cache, key, h);
+    if (not i) {
+        return false;
+    }
+
+    // A process that holds the lock is evicting the entry, and is waiting
+    // for the stripe.
+    auto & e = entry(cache, *i);
+    if (not e.lock.try_lock()) {
+        return false;
+    }
+    auto const version = e.version.load(std::memory_order_relaxed);
+    e.version.store(version + 1, std::memory_order_seq_cst);
+    if (pinned(cache, *i)) {
+        e.version.store(version, std::memory_order_release);
+        e.lock.unlock();
+        return false;
+    }
+    unlink(cache, bucket, *i);
+    e.bucket.store(0u, std::memory_order_relaxed);
+    cache.control.size.fetch_sub(1u, std::memory_order_relaxed);
+    release(cache, Found{*i, version + 1});
+    return true;
+}
+
+std::size_t
+release_dead_pins(Cache cache)
+{
+    std::map<ProcessId, bool> alive;
+    auto const me = ProcessId::current();
+    std::size_t result = 0;
+    for (std::uint32_t r = 0; r < cache.npins; ++r) {
+        auto & record = cache.pins[r];
+        auto owner = record.owner.load(std::memory_order_relaxed);
+        if (owner == ProcessId::null()) {
+            continue;
+        }
+        auto [entry, added] = alive.emplace(owner, true);
+        if (added) {
+            entry->second = owner == me || owner.alive();
+        }
+        // The entry is left as it is; a record whose owner is null pins
+        // nothing, and the next owner sets it before relying on it.
+        if (not entry->second &&
+            record.owner.compare_exchange_strong(
+                owner,
+                ProcessId::null(),
+                std::memory_order_release,
+                std::memory_order_relaxed))
+        {
+            ++result;
+        }
+    }
+    return result;
+}
+
+} // namespace clockcache_detail
+} // namespace wjh
@@ -0,0 +1,310 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_e2b7a4c9f1d64e08b5a3c7d2e9f6b041
+#define WJH_e2b7a4c9f1d64e08b5a3c7d2e9f6b041
+
+#include "Atomic.hpp"
+#include "ProcessId.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace wjh {
+
+namespace clockcache_detail {
+
+struct Entry
+{
+    // Held by the process that is evicting, erasing, or writing the entry.
+    ProcessIdLock lock;
+    // Even while stable; odd while the entry is being changed.
+    Atomic<std::uint32_t> version;
+    // The next entry in the bucket's chain, plus one.
+    Atomic<std::uint32_t> next;
+    // The bucket whose chain the entry is in, plus one, or zero if none.
+    Atomic<std::uint32_t> bucket;
+    Atomic<std::uint64_t> hash;
+};
+
+struct PinRecord
+{
+    Atomic<ProcessId> owner;
+    // The pinned entry, plus one.
+    Atomic<std::uint32_t> entry;
+};
+
+struct Control
+{
+    // The CLOCK hand.
+    Atomic<std::uint32_t> hand;
+    Atomic<std::uint32_t> size;
+};
+
+// The type-erased parts of an IpcClockCache.
+struct Cache
+{
+    Control & control;
+    Atomic<std::uint32_t> * heads;
+    std::uint32_t buckets;
+    ProcessIdLock * stripes;
+    std::uint32_t nstripes;
+    Atomic<std::uint64_t> * referenced;
+    PinRecord * pins;
+    std::uint32_t npins;
+    std::byte * entries;
+    std::size_t stride;
+    std::uint32_t capacity;
+    std::size_t key_offset;
+    std::size_t key_size;
+    std::size_t value_offset;
+    std::size_t value_size;
+};
+
+struct Pinned
+{
+    std::uint32_t record;
+    std::uint32_t entry;
+};
+
+bool get(Cache cache, void const * key, void * value);
+
+std::optional<Pinned> pin(Cache cache, void const * key);
+
+void unpin(Cache cache, std::uint32_t record) noexcept;
+
+bool insert(Cache cache, void const * key, void const * value);
+
+bool erase(Cache cache, void const * key);
+
+std::size_t release_dead_pins(Cache cache);
+
+} // namespace clockcache_detail
+
+/**
+ * A fixed capacity cache of V, keyed by K, shared between processes.
+ *
+ * Entries are found through a hash index of chained buckets.  Lookups are
+ * lock free: each entry has a version, and a reader copies what it needs,
+ * then checks that the version did not change.  A hit writes nothing but
+ * the entry's reference bit, and only if it is not already set.  Writers
+ * lock one of Stripes ProcessIdLocks, chosen by bucket, so writers to
+ * different stripes do not contend.  An entry that a process was changing
+ * when it died is repaired when the CLOCK hand next reaches it.
+ *
+ * When the cache is full, insert() evicts with the CLOCK algorithm: the
+ * hand sweeps the entries, clearing reference bits, and evicts the first
+ * entry whose bit is clear, and which is not pinned.
+ *
+ * A Pin is a reference to a cached value that keeps the entry from being
+ * evicted or erased while it is held.  Each of the MaxPins pin records
+ * names the process that holds it, so release_dead_pins() can release the
+ * pins of processes that died; pin() does so itself if it finds no free
+ * record.  A value is never changed once inserted, so a pinned value can be
+ * read in place.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized cache is empty.
+ *
+ * @note  Lookups may miss an entry that is being inserted, or that is in a
+ * bucket whose chain is changing under them; as always with a cache, a miss
+ * means only that the caller must compute the value.
+ */
+template <
+    typename K,
+    typename V,
+    std::size_t Capacity,
+    std::size_t MaxPins = 64,
+    std::size_t Stripes = 16>
+requires std::is_trivially_copyable_v<K> &&
+    std::has_unique_object_representations_v<K> &&
+    std::is_trivially_copyable_v<V> &&
+    std::is_trivially_default_constructible_v<V> &&
+    (Capacity > 0 && Capacity < (std::size_t(1) << 31)) && (MaxPins > 0) &&
+    (Stripes > 0)
+class IpcClockCache
+{
+    struct Slot
+    {
+        clockcache_detail::Entry entry;
+        K key;
+        V value;
+    };
+
+public:
+    static constexpr std::size_t capacity = Capacity;
+    static constexpr std::size_t buckets = std::bit_ceil(Capacity);
+
+    /**
+     * A pinned reference to a cached value.
+     */
+    class Pin
+    {
+    public:
+        Pin() = default;
+
+        Pin(Pin && that) noexcept
+        : cache_(std::exchange(that.cache_, nullptr))
+        , pinned_(that.pinned_)
+        { }
+
+        Pin & operator = (Pin && that) noexcept
+        {
+            if (this != &that) {
+                reset();
+                cache_ = std::exchange(that.cache_, nullptr);
+                pinned_ = that.pinned_;
+            }
+            return *this;
+        }
+
+        ~Pin() { reset(); }
+
+        /**
+         * false if the lookup missed.
+         */
+        explicit operator bool () const noexcept { return cache_ != nullptr; }
+
+        V const & operator * () const noexcept { return slot().value; }
+        V const * operator -> () const noexcept { return &slot().value; }
+        K const & key() const noexcept { return slot().key; }
+
+        /**
+         * Release the pin.
+         */
+        void reset() noexcept
+        {
+            if (cache_) {
+                clockcache_detail::unpin(cache_->detail(), pinned_.record);
+                cache_ = nullptr;
+            }
+        }
+
+    private:
+        friend class IpcClockCache;
+
+        Pin(IpcClockCache * cache, clockcache_detail::Pinned pinned) noexcept
+        : cache_(cache)
+        , pinned_(pinned)
+        { }
+
+        Slot const & slot() const noexcept
+        {
+            return cache_->slots_[pinned_.entry];
+        }
+
+        IpcClockCache * cache_ = nullptr;
+        clockcache_detail::Pinned pinned_{};
+    };
+
+    /**
+     * A copy of the value of @p key, or std::nullopt on a miss.
+     */
+    std::optional<V> get(K const & key)
+    {
+        V result;
+        if (not clockcache_detail::get(detail(), &key, &result)) {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    /**
+     * Pin the value of @p key.
+     *
+     * @return  The pin, which is empty on a miss.
+     *
+     * @throw  std::length_error if all MaxPins pins are held by live
+     * processes.
+     */
+    Pin pin(K const & key)
+    {
+        auto const pinned = clockcache_detail::pin(detail(), &key);
+        return pinned ? Pin(this, *pinned) : Pin();
+    }
+
+    /**
+     * Insert @p value for @p key, evicting an entry if the cache is full.
+     *
+     * @return  false if @p key is already cached, or every entry is pinned.
+     */
+    bool insert(K const & key, V const & value)
+    {
+        return clockcache_detail::insert(detail(), &key, &value);
+    }
+
+    /**
+     * Remove @p key.
+     *
+     * @return  false if @p key is not cached, or is pinned, or is being
+     * evicted.
+     */
+    bool erase(K const & key)
+    {
+        return clockcache_detail::erase(detail(), &key);
+    }
+
+    /**
+     * Release every pin held by a process that has died.
+     *
+     * @return  The number of pins released.
+     */
+    std::size_t release_dead_pins()
+    {
+        return clockcache_detail::release_dead_pins(detail());
+    }
+
+    /**
+     * The number of cached entries.
+     */
+    std::size_t size() const noexcept
+    {
+        return control_.size.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    clockcache_detail::Cache detail() noexcept
+    {
+        auto * const base = reinterpret_cast<std::byte *>(&slots_[0]);
+        return clockcache_detail::Cache{
+            control_,
+            heads_,
+            std::uint32_t(buckets),
+            stripes_,
+            std::uint32_t(Stripes),
+            referenced_,
+            pins_,
+            std::uint32_t(MaxPins),
+            base,
+            sizeof(Slot),
+            std::uint32_t(Capacity),
+            std::size_t(reinterpret_cast<std::byte *>(&slots_[0].key) - base),
+            sizeof(K),
+            std::size_t(
+                reinterpret_cast<std::byte *>(&slots_[0].value) - base),
+            sizeof(V)};
+    }
+
+    clockcache_detail::Control control_;
+    Atomic<std::uint32_t> heads_[buckets];
+    ProcessIdLock stripes_[Stripes];
+    Atomic<std::uint64_t> referenced_[(Capacity + 63) / 64];
+    clockcache_detail::PinRecord pins_[MaxPins];
+    Slot slots_[Capacity];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcClockCache<int, int, 4>>);
+
+} // namespace wjh
+
+#endif // WJH_e2b7a4c9f1d64e08b5a3c7d2e9f6b041
@@ -0,0 +1,71 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcCounterGroup.hpp"
+
+#include <stdexcept>
+
+namespace wjh {
+namespace countergroup_detail {
+
+namespace {
+
+Atomic<ProcessId> &
+owner(std::byte * slots, std::size_t stride, std::uint32_t i) noexcept
+{
+    return *reinterpret_cast<Atomic<ProcessId> *>(slots + i * stride);
+}
+
+} // anonymous namespace
+
+std::uint32_t
+claim(std::byte * slots, std::size_t stride, std::uint32_t count)
+{
+    auto const me = ProcessId::current();
+    for (int pass = 0; pass < 2; ++pass) {
+        for (std::uint32_t i = 0; i < count; ++i) {
+            auto & slot = owner(slots, stride, i);
+            auto expected = slot.load(std::memory_order_relaxed);
+            if (expected == ProcessId::null() &&
+                slot.compare_exchange_strong(
+                    expected,
+                    me,
+                    std::memory_order_acquire,
+                    std::memory_order_relaxed))
+            {
+                return i;
+            }
+        }
+
+        // Free the slots of processes that died; their shares stay.
+        bool freed = false;
+        for (std::uint32_t i = 0; i < count; ++i) {
+            auto & slot = owner(slots, stride, i);
+            auto expected = slot.load(std::memory_order_relaxed);
+            if (expected != ProcessId::null() && not expected.alive()) {
+                freed = slot.compare_exchange_strong(
+                            expected,
+                            ProcessId::null(),
+                            std::memory_order_release,
+                            std::memory_order_relaxed) ||
+                    freed;
+            }
+        }
+        if (not freed) {
+            break;
+        }
+    }
+    throw std::length_error("IpcCounterGroup has too many writers");
+}
+
+void
+release(Atomic<ProcessId> & owner) noexcept
+{
+    owner.store(ProcessId::null(), std::memory_order_release);
+}
+
+} // namespace countergroup_detail
+} // namespace wjh
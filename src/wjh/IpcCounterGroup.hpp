@@ -0,0 +1,236 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_a62f0c8e4b7d41d39e5c2b8f07d1a6e3
+#define WJH_a62f0c8e4b7d41d39e5c2b8f07d1a6e3
+
+#include "Atomic.hpp"
+#include "ProcessId.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+namespace wjh {
+
+namespace countergroup_detail {
+
+/**
+ * Claim one of the @p count slots at @p slots, which are @p stride bytes
+ * apart, and each start with an Atomic<ProcessId>, for the calling process,
+ * freeing the slots of dead processes if they are all taken.
+ *
+ * @throw  std::length_error if every slot belongs to a live process.
+ */
+std::uint32_t
+claim(std::byte * slots, std::size_t stride, std::uint32_t count);
+
+void release(Atomic<ProcessId> & owner) noexcept;
+
+} // namespace countergroup_detail
+
+/**
+ * A group of N counters, which are read together as a consistent snapshot.
+ *
+ * Each writer has a slot of its own, on its own cache lines, holding its
+ * share of every counter, so writers never contend.  A writer changes any
+ * number of its counters in one update, which readers see whole, or not at
+ * all, so a snapshot never shows, say, an error without its request.
+ *
+ * A slot keeps two copies of its counters, and a sequence number whose low
+ * bit names the current copy.  An update writes the other copy, then bumps
+ * the sequence, and a reader retries a slot only if the sequence changed
+ * while it read.  Readers write nothing, and never wait for a writer, even
+ * one that died in the middle of an update; its last complete update still
+ * counts.  Shares outlive their writers, and the next writer to claim a slot
+ * carries on from its share.
+ *
+ * A snapshot sums the slots one at a time, so it includes every update that
+ * finished before it started, and none that started after it finished, and
+ * each update either wholly or not at all.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized group has every counter zero.
+ */
+template <std::size_t N, std::size_t Writers = 64>
+requires (N > 0) && (Writers > 0 && Writers < (std::size_t(1) << 31))
+class IpcCounterGroup
+{
+    struct alignas(64) Slot
+    {
+        Atomic<ProcessId> owner;
+        // The number of updates; the low bit names the current copy.
+        Atomic<std::uint64_t> sequence;
+        Atomic<std::int64_t> values[2][N];
+    };
+
+public:
+    static constexpr std::size_t size = N;
+    static constexpr std::size_t max_writers = Writers;
+
+    struct Delta
+    {
+        std::size_t counter;
+        std::int64_t amount;
+    };
+
+    /**
+     * A process-local handle on a writer slot, for one thread at a time.
+     */
+    class Writer
+    {
+    public:
+        Writer(Writer && that) noexcept
+        : slot_(std::exchange(that.slot_, nullptr))
+        , values_(that.values_)
+        { }
+
+        ~Writer()
+        {
+            if (slot_) {
+                countergroup_detail::release(slot_->owner);
+            }
+        }
+
+        void operator = (Writer &&) = delete;
+
+        /**
+         * Add @p amount to counter @p counter.
+         *
+         * @pre  @p counter < N
+         */
+        void add(std::size_t counter, std::int64_t amount = 1) noexcept
+        {
+            update([&](auto & values) { values[counter] += amount; });
+        }
+
+        /**
+         * Add every delta of @p deltas, as one update.
+         *
+         * @pre  Each counter < N
+         */
+        void add(std::initializer_list<Delta> deltas) noexcept
+        {
+            update([&](auto & values) {
+                for (auto const & delta : deltas) {
+                    values[delta.counter] += delta.amount;
+                }
+            });
+        }
+
+        /**
+         * Call @p f with a std::array<std::int64_t, N> & of this writer's
+         * shares of the counters, and publish whatever it changes as one
+         * update.
+         */
+        template <typename F>
+        void update(F && f)
+        {
+            f(values_);
+            auto const sequence =
+                slot_->sequence.load(std::memory_order_relaxed) + 1;
+            auto & copy = slot_->values[sequence & 1];
+            // A reader that sees any of these stores must then see the last
+            // update's sequence, and retry, so they are fenced after it.
+            std::atomic_thread_fence(std::memory_order_release);
+            for (std::size_t i = 0; i < N; ++i) {
+                copy[i].store(values_[i], std::memory_order_relaxed);
+            }
+            slot_->sequence.store(sequence, std::memory_order_release);
+        }
+
+    private:
+        friend class IpcCounterGroup;
+
+        explicit Writer(Slot & slot) noexcept
+        : slot_(&slot)
+        {
+            auto const sequence =
+                slot.sequence.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < N; ++i) {
+                values_[i] =
+                    slot.values[sequence & 1][i].load(
+                        std::memory_order_relaxed);
+            }
+        }
+
+        Slot * slot_;
+        std::array<std::int64_t, N> values_;
+    };
+
+    /**
+     * Claim a writer slot for the calling thread.
+     *
+     * @throw  std::length_error if every slot belongs to a live process.
+     */
+    Writer writer()
+    {
+        auto const slot = countergroup_detail::claim(
+            reinterpret_cast<std::byte *>(slots_),
+            sizeof(Slot),
+            std::uint32_t(Writers));
+        return Writer(slots_[slot]);
+    }
+
+    /**
+     * The values of all N counters, at once.
+     */
+    std::array<std::int64_t, N> snapshot() const noexcept
+    {
+        std::array<std::int64_t, N> result{};
+        std::array<std::int64_t, N> share;
+        for (auto const & slot : slots_) {
+            for (;;) {
+                auto const sequence =
+                    slot.sequence.load(std::memory_order_acquire);
+                auto const & copy = slot.values[sequence & 1];
+                for (std::size_t i = 0; i < N; ++i) {
+                    share[i] = copy[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) ==
+                    sequence)
+                {
+                    break;
+                }
+            }
+            for (std::size_t i = 0; i < N; ++i) {
+                result[i] += share[i];
+            }
+        }
+        return result;
+    }
+
+    /**
+     * The value of counter @p counter.
+     *
+     * @pre  @p counter < N
+     */
+    std::int64_t load(std::size_t counter) const noexcept
+    {
+        std::int64_t result = 0;
+        for (auto const & slot : slots_) {
+            auto const sequence =
+                slot.sequence.load(std::memory_order_acquire);
+            result += slot.values[sequence & 1][counter].load(
+                std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+private:
+    Slot slots_[Writers];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcCounterGroup<4>>);
+
+} // namespace wjh
+
+#endif // WJH_a62f0c8e4b7d41d39e5c2b8f07d1a6e3
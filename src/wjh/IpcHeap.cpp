@@ -0,0 +1,201 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcHeap.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+#include <stdexcept>
+
+namespace wjh {
+
+using namespace heap_detail;
+
+namespace {
+
+// Free list words hold a granule index in 32 bits, which limits the region.
+constexpr std::uint64_t max_capacity = granule << 32;
+
+constexpr std::uint64_t index_mask = 0xffff'ffff;
+
+constexpr std::size_t header_end =
+    (sizeof(Header) + granule - 1) / granule * granule;
+
+std::size_t
+class_of(std::size_t block) noexcept
+{
+    return static_cast<std::size_t>(std::countr_zero(block / granule));
+}
+
+// Blocks are aligned to their size, up to the largest alignment, so a block
+// from a free list satisfies any request its size class does.
+std::size_t
+alignment_of(std::size_t block) noexcept
+{
+    return std::min(block, max_alignment);
+}
+
+Atomic<std::uint32_t> &
+next_of(std::byte * base, std::uint64_t index) noexcept
+{
+    return *reinterpret_cast<Atomic<std::uint32_t> *>(base + index * granule);
+}
+
+void
+push(
+    Header & header,
+    std::byte * base,
+    std::uint64_t offset,
+    std::size_t block)
+{
+    auto & list = header.free[class_of(block)];
+    auto const index = offset / granule;
+    auto head = list.load(std::memory_order_relaxed);
+    do {
+        next_of(base, index).store(
+            static_cast<std::uint32_t>(head & index_mask),
+            std::memory_order_relaxed);
+    } while (not list.compare_exchange_weak(
+        head,
+        ((head & ~index_mask) + (index_mask + 1)) | index,
+        std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+std::uint64_t
+pop(Header & header, std::byte * base, std::size_t block)
+{
+    auto & list = header.free[class_of(block)];
+    auto head = list.load(std::memory_order_acquire);
+    for (;;) {
+        auto const index = head & index_mask;
+        if (index == 0) {
+            return 0;
+        }
+        // The block may be popped and reused under us, so this can read
+        // garbage, but then the count in the head has moved on, and the
+        // exchange fails.
+        auto const next = next_of(base, index).load(std::memory_order_relaxed);
+        if (list.compare_exchange_weak(
+                head,
+                ((head & ~index_mask) + (index_mask + 1)) | next,
+                std::memory_order_acquire,
+                std::memory_order_acquire))
+        {
+            return index * granule;
+        }
+    }
+}
+
+} // anonymous namespace
+
+IpcHeap::
+IpcHeap(std::span<std::byte> region)
+: base_(region.data())
+, capacity_(std::min<std::size_t>(region.size(), max_capacity))
+{
+    if (capacity_ < header_end + granule) {
+        throw std::invalid_argument("region is too small for a heap");
+    }
+    std::uint64_t expected = 0;
+    if (not header().capacity.compare_exchange_strong(expected, capacity_) &&
+        expected != capacity_)
+    {
+        throw std::invalid_argument("region was used with another size");
+    }
+}
+
+Header &
+IpcHeap::
+header() const noexcept
+{
+    return *reinterpret_cast<Header *>(base_);
+}
+
+std::size_t
+IpcHeap::
+block_size(std::size_t size, std::size_t alignment) noexcept
+{
+    return std::bit_ceil(std::max({size, alignment, granule}));
+}
+
+std::size_t
+IpcHeap::
+used() const noexcept
+{
+    return std::max<std::size_t>(
+        header().top.load(std::memory_order_relaxed),
+        header_end);
+}
+
+void *
+IpcHeap::
+allocate(std::size_t size, std::size_t alignment)
+{
+    if (alignment > max_alignment || size > capacity_) {
+        throw std::bad_alloc();
+    }
+    auto const block = block_size(size, alignment);
+    if (auto offset = pop(header(), base_, block)) {
+        return base_ + offset;
+    }
+
+    // Split a larger free block, and free the rest of it, in halves.
+    for (auto larger = block * 2; class_of(larger) < classes; larger *= 2) {
+        if (auto offset = pop(header(), base_, larger)) {
+            for (auto half = larger / 2; half >= block; half /= 2) {
+                push(header(), base_, offset + half, half);
+            }
+            return base_ + offset;
+        }
+    }
+    return base_ + bump(block, alignment_of(block));
+}
+
+std::size_t
+IpcHeap::
+bump(std::size_t block, std::size_t alignment)
+{
+    auto & top = header().top;
+    auto current = top.load(std::memory_order_relaxed);
+    std::uint64_t start;
+    std::uint64_t offset;
+    do {
+        start = std::max<std::uint64_t>(current, header_end);
+        offset = (start + alignment - 1) / alignment * alignment;
+        if (offset + block > capacity_) {
+            throw std::bad_alloc();
+        }
+    } while (not top.compare_exchange_weak(
+        current,
+        offset + block,
+        std::memory_order_relaxed,
+        std::memory_order_relaxed));
+
+    // Rather than waste the gap left by aligning the block, free it, in the
+    // largest aligned blocks that fit.
+    while (start < offset) {
+        auto gap = std::bit_floor(offset - start);
+        while (start % alignment_of(gap) != 0) {
+            gap /= 2;
+        }
+        push(header(), base_, start, gap);
+        start += gap;
+    }
+    return offset;
+}
+
+void
+IpcHeap::
+deallocate(void * p, std::size_t size, std::size_t alignment) noexcept
+{
+    if (p) {
+        push(header(), base_, offset_of(p), block_size(size, alignment));
+    }
+}
+
+} // namespace wjh
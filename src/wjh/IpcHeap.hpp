@@ -0,0 +1,149 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_2b9d6e4f8a1c43b7a9e5c0d3f7b1e862
+#define WJH_2b9d6e4f8a1c43b7a9e5c0d3f7b1e862
+
+#include "Atomic.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace wjh {
+
+namespace heap_detail {
+
+// Every block is aligned to a granule, which is enough for every Atomic.
+inline constexpr std::size_t granule = 16;
+
+// Blocks come in power of two sizes, from one granule up.
+inline constexpr std::size_t classes = 33;
+
+// The largest alignment a block can have.
+inline constexpr std::size_t max_alignment = 4096;
+
+struct Header
+{
+    // The size of the region, set by the first process to use it.
+    Atomic<std::uint64_t> capacity;
+    // The offset of the first byte never handed out; zero means the first
+    // byte after this header.
+    Atomic<std::uint64_t> top;
+    // The free list of each class: the granule index of the first block in
+    // the low half, and a count that defeats ABA in the high half.
+    Atomic<std::uint64_t> free[classes];
+};
+static_assert(std::is_trivially_constructible_v<Header>);
+
+} // namespace heap_detail
+
+/**
+ * A lock-free allocator for the memory of a region that is shared between
+ * processes, such as a Segment.
+ *
+ * The state of the allocator lives at the front of the region, so every
+ * process that maps the region, and makes an IpcHeap over it, allocates from
+ * the same memory.  A zero-filled region is an empty heap.
+ *
+ * Blocks are rounded up to a power of two, at least 16 bytes, and aligned to
+ * at least 16 bytes, which is enough for every Atomic.  Freed blocks go on a
+ * free list for their size, and are handed out again before any new memory.
+ * Memory is never returned from a free list to the region, so the heap suits
+ * allocations of similar sizes best.
+ *
+ * Pointers into the region are only meaningful in the process that made
+ * them; store offset_of() in shared memory instead.
+ *
+ * An IpcHeap is a process-local handle.  Its member functions are thread
+ * safe, and safe to use from several processes at once.
+ */
+class IpcHeap
+{
+public:
+    /**
+     * Use the heap at the front of @p region.
+     *
+     * @pre  @p region is aligned to heap_detail::max_alignment, and is the
+     * same region (perhaps at another address) in every process.
+     *
+     * @throw  std::invalid_argument if @p region is too small for the heap,
+     * or was first used with a different size.
+     */
+    explicit IpcHeap(std::span<std::byte> region);
+
+    /**
+     * Allocate @p size bytes, aligned to @p alignment.
+     *
+     * @pre  @p alignment is a power of two.
+     *
+     * @throw  std::bad_alloc if the region has no room, or @p alignment is
+     * larger than heap_detail::max_alignment.
+     */
+    void * allocate(std::size_t size, std::size_t alignment = 16);
+
+    /**
+     * Free the block at @p p, which came from allocate() with the same
+     * @p size and @p alignment, in this or any other process.
+     */
+    void deallocate(
+        void * p,
+        std::size_t size,
+        std::size_t alignment = 16) noexcept;
+
+    /**
+     * The size of the block that allocate() hands out for a request.
+     */
+    static std::size_t block_size(
+        std::size_t size,
+        std::size_t alignment = 16) noexcept;
+
+    /**
+     * The offset of @p p from the start of the region, which is the same in
+     * every process.
+     */
+    std::uint64_t offset_of(void const * p) const noexcept
+    {
+        return static_cast<std::uint64_t>(
+            static_cast<std::byte const *>(p) - base_);
+    }
+
+    /**
+     * The address, in this process, of @p offset.
+     */
+    void * at(std::uint64_t offset) const noexcept { return base_ + offset; }
+
+    /**
+     * The size of the region.
+     */
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    /**
+     * The number of bytes of the region that have ever been handed out,
+     * including the heap itself, and whether or not they have been freed.
+     */
+    std::size_t used() const noexcept;
+
+    /**
+     * true if both handles use the same heap.
+     */
+    bool operator == (IpcHeap const & that) const noexcept
+    {
+        return base_ == that.base_;
+    }
+
+private:
+    heap_detail::Header & header() const noexcept;
+    std::size_t bump(std::size_t size, std::size_t alignment);
+
+    std::byte * base_;
+    std::size_t capacity_;
+};
+
+} // namespace wjh
+
+#endif // WJH_2b9d6e4f8a1c43b7a9e5c0d3f7b1e862
@@ -0,0 +1,260 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcIdGenerator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace wjh {
+
+namespace {
+
+using idgen_detail::Header;
+using idgen_detail::max_slots;
+
+constexpr std::uint64_t magic = 0x776a682d69646701; // "wjh-idg", 1
+
+constexpr int sequence_bits = 12;
+constexpr int slot_bits = 10;
+constexpr std::uint32_t max_sequence = (1u << sequence_bits) - 1;
+
+static_assert(max_slots == 1u << slot_bits);
+
+// 2020-01-01T00:00:00Z
+constexpr auto epoch = std::chrono::sys_days(std::chrono::days(18262));
+
+std::uint64_t
+now() noexcept
+{
+    auto const since = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now() - epoch);
+    return static_cast<std::uint64_t>(
+        std::max<std::int64_t>(since.count(), 0));
+}
+
+void
+raise(Atomic<std::uint64_t> & word, std::uint64_t value) noexcept
+{
+    auto current = word.load(std::memory_order_relaxed);
+    while (current < value &&
+           not word.compare_exchange_weak(
+               current,
+               value,
+               std::memory_order_acq_rel,
+               std::memory_order_relaxed))
+    { }
+}
+
+std::uint32_t
+claim(Header & header)
+{
+    auto const me = ProcessId::current();
+    for (int pass = 0; pass < 2; ++pass) {
+        for (std::uint32_t i = 0; i < max_slots; ++i) {
+            auto & owner = header.slots[i].owner;
+            auto expected = owner.load(std::memory_order_relaxed);
+            if (expected == ProcessId::null() &&
+                owner.compare_exchange_strong(
+                    expected,
+                    me,
+                    std::memory_order_acquire,
+                    std::memory_order_relaxed))
+            {
+                return i;
+            }
+        }
+
+        // Free the slots of processes that died; they keep their last
+        // millisecond.
+        bool freed = false;
+        for (auto & slot : header.slots) {
+            auto expected = slot.owner.load(std::memory_order_relaxed);
+            if (expected != ProcessId::null() && not expected.alive()) {
+                freed = slot.owner.compare_exchange_strong(
+                            expected,
+                            ProcessId::null(),
+                            std::memory_order_release,
+                            std::memory_order_relaxed) ||
+                    freed;
+            }
+        }
+        if (not freed) {
+            break;
+        }
+    }
+    throw std::length_error("IpcIdGenerator has too many issuers");
+}
+
+} // anonymous namespace
+
+std::chrono::system_clock::time_point
+IpcIdGenerator::Snowflake::
+time() const noexcept
+{
+    return epoch +
+        std::chrono::milliseconds(static_cast<std::int64_t>(millisecond));
+}
+
+IpcIdGenerator::
+IpcIdGenerator(
+    std::filesystem::path path,
+    Mode mode,
+    std::uint64_t block_size)
+: segment_(
+      std::move(path),
+      std::max(sizeof(Header), Segment::page_size()))
+, header_(reinterpret_cast<Header *>(segment_.data()))
+, mode_(mode)
+, block_size_(mode == Mode::snowflake ? 0 : block_size)
+{
+    if (mode_ == Mode::blocks && block_size_ == 0) {
+        throw std::invalid_argument("IpcIdGenerator block size is zero");
+    }
+    auto & header = *header_;
+    if (header.magic.load(std::memory_order_acquire) != magic) {
+        auto guard = std::lock_guard(header.init);
+        if (header.magic.load(std::memory_order_acquire) != magic) {
+            header.mode.store(
+                static_cast<std::uint64_t>(mode_),
+                std::memory_order_relaxed);
+            header.block_size.store(block_size_, std::memory_order_relaxed);
+            header.next.store(1u, std::memory_order_relaxed);
+            header.limit.store(1u, std::memory_order_relaxed);
+            header.durable.store(1u, std::memory_order_relaxed);
+            header.magic.store(magic, std::memory_order_release);
+            segment_.sync();
+        }
+    }
+    if (header.mode.load(std::memory_order_relaxed) !=
+            static_cast<std::uint64_t>(mode_) ||
+        header.block_size.load(std::memory_order_relaxed) != block_size_)
+    {
+        throw std::invalid_argument(
+            segment_.path().string() + " holds a different IpcIdGenerator");
+    }
+
+    // The counter in the file may be behind ids that were handed out before
+    // a system crash, but the limit is not.
+    raise(
+        header.next,
+        std::max(
+            header.limit.load(std::memory_order_acquire),
+            header.durable.load(std::memory_order_acquire)));
+}
+
+IpcIdGenerator::
+~IpcIdGenerator() = default;
+
+IpcIdGenerator::Issuer
+IpcIdGenerator::
+issuer()
+{
+    if (mode_ == Mode::snowflake) {
+        return Issuer(*this, claim(*header_));
+    }
+    return Issuer(*this, max_slots);
+}
+
+std::uint64_t
+IpcIdGenerator::
+high_water() const noexcept
+{
+    return header_->durable.load(std::memory_order_acquire);
+}
+
+IpcIdGenerator::Snowflake
+IpcIdGenerator::
+decode(std::uint64_t id) noexcept
+{
+    return Snowflake{
+        id >> (slot_bits + sequence_bits),
+        static_cast<std::uint32_t>(id >> sequence_bits) & (max_slots - 1),
+        static_cast<std::uint32_t>(id) & max_sequence};
+}
+
+IpcIdGenerator::Issuer::
+Issuer(IpcIdGenerator & generator, std::uint32_t slot) noexcept
+: generator_(&generator)
+, slot_(slot)
+{
+    if (slot_ < max_slots) {
+        // Carry on after the last millisecond the slot used.
+        millisecond_ = generator.header_->slots[slot_].last.load(
+            std::memory_order_acquire);
+        sequence_ = max_sequence;
+    }
+}
+
+IpcIdGenerator::Issuer::
+Issuer(Issuer && that) noexcept
+: generator_(std::exchange(that.generator_, nullptr))
+, next_(that.next_)
+, end_(that.end_)
+, slot_(that.slot_)
+, sequence_(that.sequence_)
+, millisecond_(that.millisecond_)
+{ }
+
+IpcIdGenerator::Issuer::
+~Issuer()
+{
+    if (generator_ && slot_ < max_slots) {
+        generator_->header_->slots[slot_].owner.store(
+            ProcessId::null(),
+            std::memory_order_release);
+    }
+}
+
+std::uint64_t
+IpcIdGenerator::Issuer::
+refill()
+{
+    auto & header = *generator_->header_;
+    if (slot_ < max_slots) {
+        auto const millisecond = now();
+        if (millisecond > millisecond_) {
+            millisecond_ = millisecond;
+            sequence_ = 0;
+        } else if (sequence_ < max_sequence) {
+            ++sequence_;
+            return millisecond_ << (slot_bits + sequence_bits) |
+                std::uint64_t(slot_) << sequence_bits | sequence_;
+        } else {
+            ++millisecond_;
+            sequence_ = 0;
+        }
+        header.slots[slot_].last.store(
+            millisecond_,
+            std::memory_order_relaxed);
+        return millisecond_ << (slot_bits + sequence_bits) |
+            std::uint64_t(slot_) << sequence_bits;
+    }
+
+    auto const block = generator_->block_size_;
+    auto const start = header.next.fetch_add(block, std::memory_order_relaxed);
+    if (start > std::numeric_limits<std::uint64_t>::max() - block) {
+        throw std::overflow_error("IpcIdGenerator has run out of ids");
+    }
+    auto const end = start + block;
+    if (end > header.durable.load(std::memory_order_acquire)) {
+        // Extend the limit well ahead, and write it back to the file before
+        // handing out anything under it.
+        raise(header.limit, end + block * reserve_blocks);
+        auto const limit = header.limit.load(std::memory_order_acquire);
+        generator_->segment_.sync(0, Segment::page_size());
+        raise(header.durable, limit);
+    }
+    next_ = start + 1;
+    end_ = end;
+    return start;
+}
+
+} // namespace wjh
@@ -0,0 +1,190 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_fdc3013a7c0d4419b290ba4244598ce3
+#define WJH_fdc3013a7c0d4419b290ba4244598ce3
+
+#include "Atomic.hpp"
+#include "ProcessId.hpp"
+#include "ProcessIdLock.hpp"
+#include "Segment.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace wjh {
+
+namespace idgen_detail {
+
+// A Snowflake issuer.
+struct Slot
+{
+    Atomic<ProcessId> owner;
+    // The last millisecond its ids were stamped with.
+    Atomic<std::uint64_t> last;
+};
+
+inline constexpr std::uint32_t max_slots = 1024;
+
+struct Header
+{
+    Atomic<std::uint64_t> magic;
+    ProcessIdLock init;
+    Atomic<std::uint64_t> mode;
+    Atomic<std::uint64_t> block_size;
+    // The first id not yet handed out.
+    alignas(64) Atomic<std::uint64_t> next;
+    // No id at or above the limit has been handed out.  It only grows, and
+    // is written back to the file before any id it covers is handed out.
+    alignas(64) Atomic<std::uint64_t> limit;
+    // How much of the limit is known to be in the file.
+    Atomic<std::uint64_t> durable;
+    alignas(64) Slot slots[max_slots];
+};
+
+} // namespace idgen_detail
+
+/**
+ * Issues unique 64-bit ids, to any number of threads in any number of
+ * processes, from a small memory-mapped file.
+ *
+ * In the default blocks mode, ids count up from 1.  Each thread issues ids
+ * from a block of its own, with no atomic operations, and takes the next
+ * block with a single fetch_add on the shared counter.  Ids are unique, and
+ * increase within a thread, but blocks are interleaved across threads.
+ *
+ * Ids never repeat, even after a system crash: the file keeps a high-water
+ * mark, which is extended well ahead of the counter, and written back to
+ * disk before any id beyond it is handed out.  Opening the generator skips
+ * ahead to the mark, since the counter in the file may be older than ids
+ * handed out before the crash.  The ids skipped that way are never issued.
+ *
+ * In snowflake mode, an id is a millisecond timestamp, a 10-bit issuer slot,
+ * and a 12-bit sequence number within the millisecond, so ids are roughly
+ * ordered by time across processes.  Each thread claims a slot of its own,
+ * and reads the clock for every id, but needs no atomic read-modify-write
+ * operations.  A thread that issues more than 4096 ids in a millisecond, or
+ * whose clock goes backwards, borrows from the following milliseconds
+ * instead of waiting.  The last millisecond of each slot is kept in the
+ * file, so a slot never reissues an id after a process restart.  After a
+ * system crash, that relies on the clock being later than before the crash.
+ *
+ * An IpcIdGenerator is a process-local handle, and its methods are thread
+ * safe.
+ */
+class IpcIdGenerator
+{
+public:
+    enum class Mode : std::uint64_t { blocks = 1, snowflake = 2 };
+
+    /**
+     * The milliseconds since 2020-01-01T00:00:00Z, the slot, and the
+     * sequence number of a snowflake id.
+     */
+    struct Snowflake
+    {
+        std::uint64_t millisecond;
+        std::uint32_t slot;
+        std::uint32_t sequence;
+
+        std::chrono::system_clock::time_point time() const noexcept;
+    };
+
+    static constexpr std::uint64_t reserve_blocks = 64;
+
+    /**
+     * Open the generator in the file at @p path, creating it if it does not
+     * exist.  In blocks mode, each thread takes @p block_size ids at a time,
+     * and the high-water mark is extended by reserve_blocks blocks at a
+     * time.  Snowflake mode ignores @p block_size.
+     *
+     * @throw  std::invalid_argument if @p block_size is zero, or if the file
+     * holds a generator with a different mode or block size.
+     * @throw  std::system_error if the file can't be opened or synced.
+     */
+    explicit IpcIdGenerator(
+        std::filesystem::path path,
+        Mode mode = Mode::blocks,
+        std::uint64_t block_size = 1024);
+
+    ~IpcIdGenerator();
+
+    void operator = (IpcIdGenerator &&) = delete;
+
+    /**
+     * A process-local source of ids, for one thread at a time.
+     */
+    class Issuer
+    {
+    public:
+        Issuer(Issuer && that) noexcept;
+        ~Issuer();
+
+        void operator = (Issuer &&) = delete;
+
+        /**
+         * A new id, which is never zero.
+         *
+         * @throw  std::system_error if the high-water mark can't be synced.
+         * @throw  std::overflow_error if blocks mode has run out of ids.
+         */
+        std::uint64_t next()
+        {
+            if (next_ != end_) {
+                return next_++;
+            }
+            return refill();
+        }
+
+    private:
+        friend class IpcIdGenerator;
+
+        Issuer(IpcIdGenerator & generator, std::uint32_t slot) noexcept;
+
+        std::uint64_t refill();
+
+        IpcIdGenerator * generator_;
+        std::uint64_t next_ = 0;
+        std::uint64_t end_ = 0;
+        std::uint32_t slot_;
+        std::uint32_t sequence_ = 0;
+        std::uint64_t millisecond_ = 0;
+    };
+
+    /**
+     * A source of ids for the calling thread.
+     *
+     * @throw  std::length_error in snowflake mode, if every slot belongs to
+     * a live process.
+     */
+    Issuer issuer();
+
+    Mode mode() const noexcept { return mode_; }
+    std::uint64_t block_size() const noexcept { return block_size_; }
+
+    /**
+     * In blocks mode, a bound on every id handed out so far, or ever handed
+     * out before a crash.
+     */
+    std::uint64_t high_water() const noexcept;
+
+    /**
+     * The parts of @p id, which was issued in snowflake mode.
+     */
+    static Snowflake decode(std::uint64_t id) noexcept;
+
+private:
+    Segment segment_;
+    idgen_detail::Header * header_;
+    Mode mode_;
+    std::uint64_t block_size_;
+};
+
+} // namespace wjh
+
+#endif // WJH_fdc3013a7c0d4419b290ba4244598ce3
@@ -0,0 +1,260 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcInternTable.hpp"
+
+#include "IpcBloomFilter.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace wjh {
+
+namespace {
+
+using intern_detail::Header;
+
+constexpr std::uint64_t magic = 0x776a682d696e7401; // "wjh-int", 1
+
+// The arena is handed out in words, and a slot holds the word offset of a
+// string in its lower half, and the upper half of the string's hash.
+constexpr std::size_t word = 8;
+constexpr std::uint64_t tag_mask = ~std::uint64_t(0) << 32;
+
+// Each string in the arena is preceded by a word holding its length, and
+// padded with zeros to a whole number of words.
+struct Record
+{
+    std::uint32_t length;
+    std::uint32_t unused;
+};
+static_assert(sizeof(Record) == word);
+
+std::size_t
+words(std::size_t bytes) noexcept
+{
+    return (bytes + word - 1) / word;
+}
+
+std::uint32_t
+index_size(std::uint32_t capacity)
+{
+    if (capacity == 0 || capacity > (std::uint32_t(1) << 31)) {
+        throw std::invalid_argument("bad IpcInternTable capacity");
+    }
+    return std::bit_ceil(capacity);
+}
+
+std::uint64_t
+arena_words(std::size_t arena_size)
+{
+    if (words(arena_size) > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("IpcInternTable arena is too large");
+    }
+    return words(arena_size);
+}
+
+constexpr std::size_t
+index_offset() noexcept
+{
+    return (sizeof(Header) + 63) / 64 * 64;
+}
+
+std::size_t
+arena_offset(std::uint32_t capacity) noexcept
+{
+    return index_offset() + capacity * sizeof(Atomic<std::uint64_t>);
+}
+
+// Compare @p s with the string of the same length at @p p.  Short strings,
+// which are most of them, are compared a word at a time, without a call or
+// a loop over bytes, since the record is padded with zeros.
+bool
+equal(char const * p, std::string_view s) noexcept
+{
+    if (s.size() <= 2 * word) {
+        std::uint64_t key[2] = {};
+        std::uint64_t have[2] = {};
+        if (not s.empty()) {
+            std::memcpy(key, s.data(), s.size());
+            std::memcpy(have, p, words(s.size()) * word);
+        }
+        return ((key[0] ^ have[0]) | (key[1] ^ have[1])) == 0;
+    }
+    return std::memcmp(p, s.data(), s.size()) == 0;
+}
+
+} // anonymous namespace
+
+IpcInternTable::
+IpcInternTable(
+    std::filesystem::path path,
+    std::uint32_t capacity,
+    std::size_t arena_size)
+: segment_(
+      std::move(path),
+      arena_offset(index_size(capacity)) + arena_words(arena_size) * word)
+, header_(reinterpret_cast<Header *>(segment_.data()))
+, index_(reinterpret_cast<Atomic<std::uint64_t> *>(
+      segment_.data() + index_offset()))
+, arena_(segment_.data() + arena_offset(index_size(capacity)))
+, mask_(index_size(capacity) - 1)
+, arena_size_(arena_words(arena_size) * word)
+{
+    auto & header = *header_;
+    if (header.magic.load(std::memory_order_acquire) != magic) {
+        auto guard = std::lock_guard(header.init);
+        if (header.magic.load(std::memory_order_acquire) != magic) {
+            header.capacity.store(mask_ + 1u, std::memory_order_relaxed);
+            header.arena_size.store(arena_size_, std::memory_order_relaxed);
+            // The first word is never handed out, so no slot is zero.
+            header.arena_used.store(word, std::memory_order_relaxed);
+            header.size.store(0u, std::memory_order_relaxed);
+            header.magic.store(magic, std::memory_order_release);
+            segment_.sync();
+        }
+    }
+    if (header.capacity.load(std::memory_order_relaxed) != mask_ + 1u ||
+        header.arena_size.load(std::memory_order_relaxed) != arena_size_)
+    {
+        throw std::invalid_argument(
+            segment_.path().string() + " holds a different IpcInternTable");
+    }
+}
+
+IpcInternTable::
+~IpcInternTable() = default;
+
+IpcInternTable::Id
+IpcInternTable::
+intern(std::string_view s)
+{
+    auto const hash = bloom_detail::hash(s);
+    auto const tag = hash & tag_mask;
+    std::uint64_t mine = 0;
+    auto i = static_cast<std::uint32_t>(hash) & mask_;
+    for (std::uint64_t n = 0; n <= mask_; ++n, i = (i + 1) & mask_) {
+        auto entry = index_[i].load(std::memory_order_acquire);
+        if (entry == 0) {
+            // A string only ever goes in the first empty slot it probes, so
+            // it is not further along.
+            if (mine == 0) {
+                mine = tag | append(s);
+            }
+            if (index_[i].compare_exchange_strong(
+                    entry,
+                    mine,
+                    std::memory_order_release,
+                    std::memory_order_acquire))
+            {
+                header_->size.fetch_add(1u, std::memory_order_relaxed);
+                return i;
+            }
+        }
+        if ((entry & tag_mask) == tag) {
+            auto const found = at(entry);
+            if (found.size() == s.size() && equal(found.data(), s)) {
+                return i;
+            }
+        }
+    }
+    throw std::length_error("IpcInternTable is full");
+}
+
+std::optional<IpcInternTable::Id>
+IpcInternTable::
+find(std::string_view s) const noexcept
+{
+    auto const hash = bloom_detail::hash(s);
+    auto const tag = hash & tag_mask;
+    auto i = static_cast<std::uint32_t>(hash) & mask_;
+    for (std::uint64_t n = 0; n <= mask_; ++n, i = (i + 1) & mask_) {
+        auto const entry = index_[i].load(std::memory_order_acquire);
+        if (entry == 0) {
+            break;
+        }
+        if ((entry & tag_mask) == tag) {
+            auto const found = at(entry);
+            if (found.size() == s.size() && equal(found.data(), s)) {
+                return i;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view
+IpcInternTable::
+lookup(Id id) const
+{
+    if (id <= mask_) {
+        if (auto const entry = index_[id].load(std::memory_order_acquire)) {
+            return at(entry);
+        }
+    }
+    throw std::out_of_range("no string has that IpcInternTable id");
+}
+
+std::uint32_t
+IpcInternTable::
+size() const noexcept
+{
+    return header_->size.load(std::memory_order_relaxed);
+}
+
+void
+IpcInternTable::
+sync() const
+{
+    segment_.sync();
+}
+
+std::string_view
+IpcInternTable::
+at(std::uint64_t entry) const noexcept
+{
+    auto const * const record = arena_ + (entry & ~tag_mask) * word;
+    Record header;
+    std::memcpy(&header, record, sizeof(header));
+    return std::string_view(
+        reinterpret_cast<char const *>(record + sizeof(Record)),
+        header.length);
+}
+
+std::uint64_t
+IpcInternTable::
+append(std::string_view s)
+{
+    if (s.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("string too long for an IpcInternTable");
+    }
+    auto const size = sizeof(Record) + words(s.size()) * word;
+    auto & used = header_->arena_used;
+    auto offset = used.load(std::memory_order_relaxed);
+    do {
+        if (size > arena_size_ - offset) {
+            throw std::length_error("IpcInternTable arena is full");
+        }
+    } while (not used.compare_exchange_weak(
+        offset,
+        offset + size,
+        std::memory_order_relaxed,
+        std::memory_order_relaxed));
+
+    auto const record = Record{static_cast<std::uint32_t>(s.size()), 0};
+    std::memcpy(arena_ + offset, &record, sizeof(record));
+    if (not s.empty()) {
+        std::memcpy(arena_ + offset + sizeof(record), s.data(), s.size());
+    }
+    return offset / word;
+}
+
+} // namespace wjh
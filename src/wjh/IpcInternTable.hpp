@@ -0,0 +1,136 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_01746c507e9c4031b5deb5b899db8071
+#define WJH_01746c507e9c4031b5deb5b899db8071
+
+#include "Atomic.hpp"
+#include "ProcessIdLock.hpp"
+#include "Segment.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+namespace wjh {
+
+namespace intern_detail {
+
+struct Header
+{
+    Atomic<std::uint64_t> magic;
+    ProcessIdLock init;
+    Atomic<std::uint64_t> capacity;
+    Atomic<std::uint64_t> arena_size;
+    // The bytes of the arena handed out so far.
+    alignas(64) Atomic<std::uint64_t> arena_used;
+    alignas(64) Atomic<std::uint32_t> size;
+};
+
+} // namespace intern_detail
+
+/**
+ * A table of interned strings, in a memory-mapped file shared by any number
+ * of processes, which gives every distinct string the same 32-bit id in
+ * every process, and for the life of the file.
+ *
+ * Strings are appended to an arena, and never move or change, so the
+ * string_view of an id stays valid as long as the table is open.  They are
+ * found through an open-addressed hash index, whose slots are single words
+ * holding the upper half of the string's hash and its place in the arena.
+ * The id of a string is the index of its slot, so ids are less than
+ * capacity(), but not dense.
+ *
+ * Lookups are lock-free, and write nothing.  Most mismatches are rejected on
+ * the hash in the slot, without touching the arena.  An insert appends the
+ * string to the arena, and publishes it with a compare-and-swap on an empty
+ * slot.  If another process publishes the same string first, the loser's
+ * copy stays in the arena, unused.  A process that dies while inserting
+ * leaves, at worst, such an unused copy.
+ *
+ * Interned strings reach the file through the page cache, so they survive a
+ * process crash; sync() makes them survive a system crash.
+ *
+ * An IpcInternTable is a process-local handle, and its methods are thread
+ * safe.
+ *
+ * @note  Probes get longer as the index fills, so its capacity should be
+ * well above the number of distinct strings.
+ */
+class IpcInternTable
+{
+public:
+    using Id = std::uint32_t;
+
+    /**
+     * Open the table in the file at @p path, creating it if it does not
+     * exist, with an index of @p capacity slots, rounded up to a power of
+     * two, and an arena of @p arena_size bytes.
+     *
+     * @throw  std::invalid_argument if @p capacity is zero or more than
+     * 2^31, or if the file holds a table of a different size.
+     * @throw  std::system_error if the file can't be opened or synced.
+     */
+    IpcInternTable(
+        std::filesystem::path path,
+        std::uint32_t capacity,
+        std::size_t arena_size);
+
+    ~IpcInternTable();
+
+    void operator = (IpcInternTable &&) = delete;
+
+    /**
+     * The id of @p s, which is interned if it was not already.
+     *
+     * @throw  std::length_error if the index or the arena is full.
+     */
+    Id intern(std::string_view s);
+
+    /**
+     * The id of @p s, if it has been interned.
+     */
+    std::optional<Id> find(std::string_view s) const noexcept;
+
+    /**
+     * The string whose id is @p id.
+     *
+     * @throw  std::out_of_range if no string has that id.
+     */
+    std::string_view lookup(Id id) const;
+
+    /**
+     * The number of strings interned.
+     */
+    std::uint32_t size() const noexcept;
+
+    std::uint32_t capacity() const noexcept { return mask_ + 1; }
+
+    /**
+     * Write every interned string back to the file, and wait for the writes
+     * to complete.
+     *
+     * @throw  std::system_error on failure.
+     */
+    void sync() const;
+
+private:
+    std::string_view at(std::uint64_t entry) const noexcept;
+    std::uint64_t append(std::string_view s);
+
+    Segment segment_;
+    intern_detail::Header * header_;
+    Atomic<std::uint64_t> * index_;
+    std::byte * arena_;
+    std::uint32_t mask_;
+    std::uint64_t arena_size_;
+};
+
+} // namespace wjh
+
+#endif // WJH_01746c507e9c4031b5deb5b899db8071
@@ -0,0 +1,163 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcMemoryResource.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <utility>
+
+namespace wjh {
+
+struct IpcMemoryResource::Cache
+{
+    // Blocks of up to 1KiB are cached, at most 32 of each size.
+    static constexpr std::size_t max_block = 1024;
+    static constexpr std::size_t classes = 7;
+    static constexpr std::size_t depth = 32;
+
+    struct Bin
+    {
+        std::size_t size = 0;
+        void * blocks[depth];
+    };
+
+    static std::size_t class_of(std::size_t block) noexcept
+    {
+        return static_cast<std::size_t>(
+            std::countr_zero(block / heap_detail::granule));
+    }
+
+    Bin bins[classes];
+    std::atomic<std::size_t> count{0};
+};
+
+namespace {
+
+std::atomic<std::uint64_t> next_id{1};
+
+} // anonymous namespace
+
+IpcMemoryResource::
+IpcMemoryResource(IpcHeap & heap, bool thread_cache)
+: heap_(heap)
+, thread_cache_(thread_cache)
+, id_(next_id.fetch_add(1u, std::memory_order_relaxed))
+{ }
+
+IpcMemoryResource::
+~IpcMemoryResource()
+{
+    for (auto const & cache : caches_) {
+        for (std::size_t c = 0; c < Cache::classes; ++c) {
+            auto const & bin = cache->bins[c];
+            auto const block = heap_detail::granule << c;
+            for (std::size_t i = 0; i < bin.size; ++i) {
+                heap_.deallocate(bin.blocks[i], block);
+            }
+        }
+    }
+}
+
+std::size_t
+IpcMemoryResource::
+cached() const
+{
+    auto guard = std::lock_guard(mutex_);
+    std::size_t result = 0;
+    for (auto const & cache : caches_) {
+        result += cache->count.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+IpcMemoryResource::Cache *
+IpcMemoryResource::
+cache()
+{
+    // Each thread finds its cache for this resource by the id of the
+    // resource, which is never reused, so entries left by resources that
+    // are gone never match.  The resource owns the caches, so those entries
+    // are the ones whose cache has expired, and they are dropped whenever
+    // the thread adds another.
+    struct Entry
+    {
+        std::uint64_t id;
+        Cache * cache;
+        std::weak_ptr<Cache> owner;
+    };
+    thread_local std::vector<Entry> mine;
+    for (auto const & entry : mine) {
+        if (entry.id == id_) {
+            return entry.cache;
+        }
+    }
+    std::erase_if(mine, [](Entry const & entry) {
+        return entry.owner.expired();
+    });
+    auto cache = std::make_shared<Cache>();
+    {
+        auto guard = std::lock_guard(mutex_);
+        caches_.push_back(cache);
+    }
+    mine.push_back(Entry{id_, cache.get(), cache});
+    return cache.get();
+}
+
+void *
+IpcMemoryResource::
+do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    auto const block = IpcHeap::block_size(bytes, alignment);
+    if (thread_cache_ && block <= Cache::max_block) {
+        auto & cache = *this->cache();
+        auto & bin = cache.bins[Cache::class_of(block)];
+        if (bin.size > 0) {
+            cache.count.fetch_sub(1u, std::memory_order_relaxed);
+            return bin.blocks[--bin.size];
+        }
+    }
+    return heap_.allocate(block, alignment);
+}
+
+void
+IpcMemoryResource::
+do_deallocate(void * p, std::size_t bytes, std::size_t alignment) noexcept
+{
+    auto const block = IpcHeap::block_size(bytes, alignment);
+    if (thread_cache_ && block <= Cache::max_block) {
+        // Making a cache fails only when the process is out of memory, and
+        // then the block goes straight back to the heap.
+        Cache * cache = nullptr;
+        try {
+            cache = this->cache();
+        } catch (...) {
+        }
+        if (cache) {
+            auto & bin = cache->bins[Cache::class_of(block)];
+            if (bin.size < Cache::depth) {
+                bin.blocks[bin.size++] = p;
+                cache->count.fetch_add(1u, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+    heap_.deallocate(p, block);
+}
+
+bool
+IpcMemoryResource::
+do_is_equal(std::pmr::memory_resource const & that) const noexcept
+{
+    if (this == &that) {
+        return true;
+    }
+    auto const other = dynamic_cast<IpcMemoryResource const *>(&that);
+    return other && other->heap_ == heap_;
+}
+
+} // namespace wjh
@@ -0,0 +1,83 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_e7c3a9f1b5d24c8ea6f0b2d9c4e1a853
+#define WJH_e7c3a9f1b5d24c8ea6f0b2d9c4e1a853
+
+#include "IpcHeap.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace wjh {
+
+/**
+ * A std::pmr::memory_resource that allocates from an IpcHeap, so standard
+ * containers can keep their storage in shared memory.
+ *
+ * The containers themselves hold pointers, so they are private to the
+ * process that made them; this is for staging data in a process before
+ * publishing it to shared structures, without going through malloc.
+ *
+ * Every allocation is aligned to at least 16 bytes, which is enough for
+ * every Atomic.
+ *
+ * With a thread cache, each thread keeps a few freed blocks of each small
+ * size, and reuses them without touching the shared free lists.  Cached
+ * blocks go back to the heap when the resource is destroyed.
+ *
+ * @note  The resource is process-local, and must outlive every container
+ * that uses it.  Its member functions are thread safe.
+ */
+class IpcMemoryResource final
+: public std::pmr::memory_resource
+{
+public:
+    /**
+     * Allocate from @p heap, which must outlive the resource.
+     *
+     * @param thread_cache  Keep freed small blocks in a per-thread cache.
+     */
+    explicit IpcMemoryResource(IpcHeap & heap, bool thread_cache = false);
+
+    ~IpcMemoryResource() override;
+
+    void operator = (IpcMemoryResource &&) = delete;
+
+    IpcHeap & heap() const noexcept { return heap_; }
+
+    /**
+     * The number of blocks held in the thread caches.
+     */
+    std::size_t cached() const;
+
+private:
+    struct Cache;
+
+    void * do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(
+        void * p,
+        std::size_t bytes,
+        std::size_t alignment) noexcept override;
+    bool do_is_equal(
+        std::pmr::memory_resource const & that) const noexcept override;
+
+    Cache * cache();
+
+    IpcHeap & heap_;
+    bool const thread_cache_;
+    std::uint64_t const id_;
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<Cache>> caches_;
+};
+
+} // namespace wjh
+
+#endif // WJH_e7c3a9f1b5d24c8ea6f0b2d9c4e1a853
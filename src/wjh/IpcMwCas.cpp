@@ -0,0 +1,457 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcMwCas.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+
+namespace wjh {
+namespace mwcas_detail {
+
+namespace {
+
+// A reference is the top bit, the sequence number of the update, the
+// descriptor, and the index of the word's entry.  A marker is the top two
+// bits, a count, and the descriptor that holds what it stands for.
+constexpr std::uint64_t flag = std::uint64_t(1) << 63;
+constexpr std::uint64_t marker = std::uint64_t(1) << 62;
+constexpr unsigned entry_bits = 5;
+constexpr unsigned slot_bits = 12;
+constexpr unsigned seq_shift = entry_bits + slot_bits;
+constexpr std::uint64_t seq_mask = (std::uint64_t(1) << (62 - seq_shift)) - 1;
+constexpr std::uint64_t slot_mask = (std::uint64_t(1) << slot_bits) - 1;
+constexpr std::uint64_t count_mask = (marker >> slot_bits) - 1;
+
+enum : std::uint64_t { complete = 0, undecided = 1, succeeded = 2, failed = 3 };
+
+struct Ref
+{
+    std::uint32_t slot;
+    std::uint32_t entry;
+    std::uint64_t seq;
+};
+
+std::uint64_t
+encode(std::uint32_t slot, std::uint32_t entry, std::uint64_t seq) noexcept
+{
+    return flag | (seq & seq_mask) << seq_shift |
+        std::uint64_t(slot) << entry_bits | entry;
+}
+
+Ref
+decode(std::uint64_t value) noexcept
+{
+    return Ref{
+        std::uint32_t(value >> entry_bits & slot_mask),
+        std::uint32_t(value) & ((1u << entry_bits) - 1),
+        (value >> seq_shift) & seq_mask};
+}
+
+std::uint64_t
+seq_of(std::uint64_t state) noexcept
+{
+    return (state >> 2) & seq_mask;
+}
+
+std::uint64_t
+status_of(std::uint64_t state) noexcept
+{
+    return state & 3u;
+}
+
+bool
+is_marker(std::uint64_t value) noexcept
+{
+    return (value & (flag | marker)) == (flag | marker);
+}
+
+Entry &
+entry(Pool pool, std::uint32_t slot, std::uint32_t i) noexcept
+{
+    return pool.entries[std::size_t(slot) * pool.words + i];
+}
+
+Atomic<std::uint64_t> &
+word(Pool pool, std::int64_t offset) noexcept
+{
+    return *reinterpret_cast<Atomic<std::uint64_t> *>(pool.base + offset);
+}
+
+// The value that the marker @p m, found in a word, stands for, or
+// std::nullopt if it has already been replaced.
+std::optional<std::uint64_t>
+marked(Pool pool, std::uint64_t m) noexcept
+{
+    auto const & header = pool.headers[m & slot_mask];
+    auto const value = header.value.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header.mark.load(std::memory_order_relaxed) != m) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// Replace the marker @p m in @p w with the reference it installs, if that
+// update is still undecided, or else with the value it replaced.
+void
+resolve(Pool pool, Atomic<std::uint64_t> & w, std::uint64_t m) noexcept
+{
+    auto const & header = pool.headers[m & slot_mask];
+    auto const target = header.target.load(std::memory_order_relaxed);
+    auto const value = header.value.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header.mark.load(std::memory_order_relaxed) != m) {
+        // The holder has gone on to another word, so resolved this one.
+        return;
+    }
+    auto const ref = decode(target);
+    auto const state =
+        pool.headers[ref.slot].state.load(std::memory_order_acquire);
+    auto const install = state == (ref.seq << 2 | undecided);
+    w.compare_exchange_strong(
+        m,
+        install ? target : value,
+        std::memory_order_acq_rel,
+        std::memory_order_relaxed);
+}
+
+// Put the reference @p target in @p w, if @p w has @p expected, and the
+// update is undecided, by way of a marker kept in @p self, the descriptor
+// that the caller holds.
+void
+place(
+    Pool pool,
+    std::uint32_t self,
+    Atomic<std::uint64_t> & w,
+    std::uint64_t expected,
+    std::uint64_t target) noexcept
+{
+    auto & header = pool.headers[self];
+    auto const count = header.mark.load(std::memory_order_relaxed) >>
+        slot_bits;
+    auto const m = flag | marker | ((count + 1) & count_mask) << slot_bits |
+        self;
+    header.mark.store(m, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header.target.store(target, std::memory_order_relaxed);
+    header.offset.store(
+        reinterpret_cast<std::byte *>(&w) - pool.base,
+        std::memory_order_relaxed);
+    header.value.store(expected, std::memory_order_relaxed);
+    if (w.compare_exchange_strong(
+            expected,
+            m,
+            std::memory_order_acq_rel,
+            std::memory_order_relaxed))
+    {
+        resolve(pool, w, m);
+    }
+}
+
+bool run(
+    Pool pool,
+    std::uint32_t slot,
+    std::uint64_t seq,
+    std::uint32_t self,
+    std::uint32_t depth);
+
+// Help the update that the reference @p value in @p w refers to: finish it
+// if it is undecided, or else give @p w its final value.
+void
+help(
+    Pool pool,
+    Atomic<std::uint64_t> & w,
+    std::uint64_t value,
+    std::uint32_t self,
+    std::uint32_t depth)
+{
+    auto const ref = decode(value);
+    auto & header = pool.headers[ref.slot];
+    auto const state = header.state.load(std::memory_order_acquire);
+    if (seq_of(state) != ref.seq || status_of(state) == complete) {
+        // The update is complete, and the word has moved on.
+        return;
+    }
+    if (status_of(state) == undecided) {
+        // Updates wait on words in address order, so a chain of them is no
+        // longer than the pool, unless they changed on the way.
+        if (depth < pool.descriptors) {
+            run(pool, ref.slot, ref.seq, self, depth + 1);
+        }
+        return;
+    }
+    auto const & e = entry(pool, ref.slot, ref.entry);
+    auto const final = status_of(state) == succeeded ?
+        e.desired.load(std::memory_order_relaxed) :
+        e.expected.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header.state.load(std::memory_order_relaxed) == state) {
+        w.compare_exchange_strong(
+            value,
+            final,
+            std::memory_order_acq_rel,
+            std::memory_order_relaxed);
+    }
+}
+
+// Install references to the update @p seq in @p slot in each of its words,
+// in order, as long as it is undecided, and they have their expected
+// values, then decide it, and replace the references with final values.
+// Any number of threads can run an update at once; @p self is the
+// descriptor that the caller holds, for its markers.
+//
+// @return  Whether the update succeeded.
+bool
+run(Pool pool,
+    std::uint32_t slot,
+    std::uint64_t seq,
+    std::uint32_t self,
+    std::uint32_t depth)
+{
+    auto & header = pool.headers[slot];
+    auto const live = seq << 2 | undecided;
+    auto const count = std::min(
+        header.count.load(std::memory_order_relaxed),
+        pool.words);
+    std::uint64_t outcome = succeeded;
+    for (std::uint32_t i = 0; i < count && outcome == succeeded; ++i) {
+        auto const & e = entry(pool, slot, i);
+        auto const offset = e.offset.load(std::memory_order_relaxed);
+        auto const expected = e.expected.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header.state.load(std::memory_order_relaxed) != live) {
+            // Decided by someone else, or, for a helper, long finished.
+            break;
+        }
+        auto & w = word(pool, offset);
+        auto const ref = encode(slot, i, seq);
+        for (;;) {
+            auto const value = w.load(std::memory_order_acquire);
+            if (value == ref) {
+                break;
+            }
+            if (is_marker(value)) {
+                resolve(pool, w, value);
+            } else if (value & flag) {
+                help(pool, w, value, self, depth);
+            } else if (value != expected) {
+                outcome = failed;
+                break;
+            } else {
+                place(pool, self, w, expected, ref);
+            }
+            if (header.state.load(std::memory_order_acquire) != live) {
+                break;
+            }
+        }
+    }
+
+    // Every reference stays until the update is decided, so if they were
+    // all installed, they all are now.
+    auto state = live;
+    if (not header.state.compare_exchange_strong(
+            state,
+            seq << 2 | outcome,
+            std::memory_order_acq_rel,
+            std::memory_order_acquire))
+    {
+        if (seq_of(state) != seq || status_of(state) == complete) {
+            return false;
+        }
+        outcome = status_of(state);
+    }
+
+    // A marker for the update, installed late, is resolved to the value it
+    // replaced, so once this pass ends no reference can be added.
+    for (std::uint32_t i = 0; i < count; ++i) {
+        auto const & e = entry(pool, slot, i);
+        auto const offset = e.offset.load(std::memory_order_relaxed);
+        auto const final = outcome == succeeded ?
+            e.desired.load(std::memory_order_relaxed) :
+            e.expected.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header.state.load(std::memory_order_relaxed) !=
+            (seq << 2 | outcome))
+        {
+            break;
+        }
+        auto & w = word(pool, offset);
+        auto ref = encode(slot, i, seq);
+        for (auto value = w.load(std::memory_order_acquire);
+             is_marker(value);
+             value = w.load(std::memory_order_acquire))
+        {
+            resolve(pool, w, value);
+        }
+        w.compare_exchange_strong(
+            ref,
+            final,
+            std::memory_order_acq_rel,
+            std::memory_order_relaxed);
+    }
+    return outcome == succeeded;
+}
+
+// Complete whatever the last holder of @p slot, whose lock the caller now
+// holds, left: the marker it was installing, and its update.
+//
+// @return  Whether there was an update to complete.
+bool
+settle(Pool pool, std::uint32_t slot)
+{
+    auto & header = pool.headers[slot];
+    if (auto const m = header.mark.load(std::memory_order_relaxed)) {
+        resolve(
+            pool,
+            word(pool, header.offset.load(std::memory_order_relaxed)),
+            m);
+    }
+    auto const state = header.state.load(std::memory_order_acquire);
+    if (status_of(state) == complete) {
+        return false;
+    }
+    run(pool, slot, seq_of(state), slot, 0);
+    header.state.store(
+        seq_of(state) << 2 | complete,
+        std::memory_order_release);
+    return true;
+}
+
+// Lock a descriptor, settling anything that a dead process left in it.
+std::uint32_t
+claim(Pool pool)
+{
+    thread_local std::uint32_t hint = 0;
+    for (std::uint32_t n = 0; n < pool.descriptors; ++n) {
+        auto const slot = (hint + n) % pool.descriptors;
+        if (pool.headers[slot].lock.try_lock()) {
+            settle(pool, slot);
+            hint = slot;
+            return slot;
+        }
+    }
+    throw std::length_error("every IpcMwCas descriptor is in use");
+}
+
+} // anonymous namespace
+
+std::uint64_t
+load(Pool pool, Atomic<std::uint64_t> const & word) noexcept
+{
+    for (;;) {
+        auto const value = word.load(std::memory_order_acquire);
+        if (not (value & flag)) {
+            return value;
+        }
+        if (value & marker) {
+            // The reference is not in yet, so the word has its old value.
+            if (auto const result = marked(pool, value)) {
+                return *result;
+            }
+            continue;
+        }
+        auto const ref = decode(value);
+        auto & header = pool.headers[ref.slot];
+        auto const state = header.state.load(std::memory_order_acquire);
+        if (seq_of(state) != ref.seq || status_of(state) == complete) {
+            // The word has its final value by now.
+            continue;
+        }
+        auto const & e = entry(pool, ref.slot, ref.entry);
+        auto const result = status_of(state) == succeeded ?
+            e.desired.load(std::memory_order_relaxed) :
+            e.expected.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header.state.load(std::memory_order_relaxed) == state) {
+            return result;
+        }
+    }
+}
+
+bool
+compare_exchange(Pool pool, std::span<Update const> updates)
+{
+    if (updates.size() > pool.words) {
+        throw std::length_error("too many words for IpcMwCas");
+    }
+    struct Target
+    {
+        std::int64_t offset;
+        std::uint64_t expected;
+        std::uint64_t desired;
+    };
+    Target targets[32];
+    auto const count = static_cast<std::uint32_t>(updates.size());
+    for (std::uint32_t i = 0; i < count; ++i) {
+        auto const & update = updates[i];
+        if (update.expected > max_value || update.desired > max_value) {
+            throw std::invalid_argument("IpcMwCas value is too large");
+        }
+        targets[i] = Target{
+            reinterpret_cast<std::byte *>(&update.word) - pool.base,
+            update.expected,
+            update.desired};
+    }
+
+    // Installing in address order keeps two updates from each waiting for
+    // a word the other has.
+    std::sort(targets, targets + count, [](auto const & a, auto const & b) {
+        return a.offset < b.offset;
+    });
+    auto const duplicate = std::adjacent_find(
+        targets,
+        targets + count,
+        [](auto const & a, auto const & b) { return a.offset == b.offset; });
+    if (duplicate != targets + count) {
+        throw std::invalid_argument("IpcMwCas word appears twice");
+    }
+
+    auto const slot = claim(pool);
+    auto & header = pool.headers[slot];
+    auto const seq =
+        (seq_of(header.state.load(std::memory_order_relaxed)) + 1) & seq_mask;
+
+    // Helpers of the last update check that it is still undecided after
+    // they read its entries, so see that it is complete if they read these.
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        auto & e = entry(pool, slot, i);
+        e.offset.store(targets[i].offset, std::memory_order_relaxed);
+        e.expected.store(targets[i].expected, std::memory_order_relaxed);
+        e.desired.store(targets[i].desired, std::memory_order_relaxed);
+    }
+    header.count.store(count, std::memory_order_relaxed);
+    header.state.store(seq << 2 | undecided, std::memory_order_release);
+
+    auto const success = run(pool, slot, seq, slot, 0);
+    header.state.store(seq << 2 | complete, std::memory_order_release);
+    header.lock.unlock();
+    return success;
+}
+
+std::size_t
+recover(Pool pool)
+{
+    std::size_t result = 0;
+    for (std::uint32_t slot = 0; slot < pool.descriptors; ++slot) {
+        auto & header = pool.headers[slot];
+        auto const owner = header.lock.owner();
+        if (owner == ProcessId::null() || owner.alive() ||
+            not header.lock.try_lock())
+        {
+            continue;
+        }
+        result += settle(pool, slot);
+        header.lock.unlock();
+    }
+    return result;
+}
+
+} // namespace mwcas_detail
+} // namespace wjh
@@ -0,0 +1,182 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_8c41e7b25d9a4f3e9b06a1d7c3e58f24
+#define WJH_8c41e7b25d9a4f3e9b06a1d7c3e58f24
+
+#include "Atomic.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <type_traits>
+
+namespace wjh {
+
+namespace mwcas_detail {
+
+// Words whose top bit is set refer to a descriptor.
+inline constexpr std::uint64_t max_value = (std::uint64_t(1) << 63) - 1;
+
+struct Update
+{
+    Atomic<std::uint64_t> & word;
+    std::uint64_t expected;
+    std::uint64_t desired;
+};
+
+struct Header
+{
+    // Held by the process using the descriptor, from before it fills in the
+    // entries until the last word has its final value.
+    ProcessIdLock lock;
+    // The sequence number of the update, shifted left two bits, and its
+    // status.
+    Atomic<std::uint64_t> state;
+    Atomic<std::uint32_t> count;
+    // The last marker that the lock holder put in a word, to install a
+    // reference to an update, its own or another's, and what it stands for:
+    // the reference, the word, as an offset, and the value it replaced.
+    Atomic<std::uint64_t> mark;
+    Atomic<std::uint64_t> target;
+    Atomic<std::int64_t> offset;
+    Atomic<std::uint64_t> value;
+};
+
+struct Entry
+{
+    // The word, as an offset from the IpcMwCas.
+    Atomic<std::int64_t> offset;
+    Atomic<std::uint64_t> expected;
+    Atomic<std::uint64_t> desired;
+};
+
+// The type-erased parts of an IpcMwCas.
+struct Pool
+{
+    std::byte * base;
+    Header * headers;
+    std::uint32_t descriptors;
+    Entry * entries;
+    std::uint32_t words;
+};
+
+std::uint64_t load(Pool pool, Atomic<std::uint64_t> const & word) noexcept;
+
+bool compare_exchange(Pool pool, std::span<Update const> updates);
+
+std::size_t recover(Pool pool);
+
+} // namespace mwcas_detail
+
+/**
+ * Multi-word compare and swap, for up to Words Atomic<std::uint64_t> words
+ * in shared memory at once.
+ *
+ * This follows Harris, Fraser, and Pratt, and PMwCAS: an update fills in
+ * one of Descriptors descriptors with its words, and their expected and
+ * desired values, then installs a reference to the descriptor in each word,
+ * in address order, decides, and replaces each reference with the word's
+ * final value.  load() reads through references without waiting: a word
+ * that refers to an undecided update has its expected value.
+ *
+ * An update that finds a word referring to another update helps it: it
+ * installs the rest of that update's references, decides it, and replaces
+ * them, just as the process making it would, so no update waits for
+ * another, even one whose process has stalled.  Each reference goes in by
+ * RDCSS: a marker, kept in the descriptor of whoever installs it, first
+ * replaces the expected value, and becomes the reference only if the
+ * update is still undecided, so a helper that falls behind can't install a
+ * reference to an update that was already decided.
+ *
+ * The process using a descriptor holds its ProcessIdLock until the update
+ * is complete, and the descriptor is reused only after that.  The first
+ * update to find the descriptor of a process that died settles what it
+ * left.  So compare_exchange() is lock free while a descriptor is free;
+ * when all are in use, it throws rather than wait for one.
+ *
+ * Every word changed through an IpcMwCas must be read with load(), and
+ * changed only with compare_exchange(), and must be in the same mapping as
+ * the IpcMwCas, since descriptors name words by their offset from it.
+ * Values are limited to max_value.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized IpcMwCas is ready to use.
+ */
+template <std::size_t Words = 4, std::size_t Descriptors = 64>
+requires (Words > 0 && Words <= 32) &&
+    (Descriptors > 0 && Descriptors <= 4096)
+class IpcMwCas
+{
+public:
+    using Update = mwcas_detail::Update;
+
+    static constexpr std::size_t max_words = Words;
+    static constexpr std::uint64_t max_value = mwcas_detail::max_value;
+
+    /**
+     * The value of @p word.
+     */
+    std::uint64_t load(Atomic<std::uint64_t> const & word) noexcept
+    {
+        return mwcas_detail::load(detail(), word);
+    }
+
+    /**
+     * Set each word of @p updates to its desired value, if every one of
+     * them has its expected value, as a single atomic step.
+     *
+     * @return  false, and change nothing, if any word has another value.
+     *
+     * @throw  std::length_error if there are more than Words updates, or
+     * every descriptor is in use by an update of another thread.
+     * @throw  std::invalid_argument if a value is larger than max_value, or
+     * a word appears twice.
+     */
+    bool compare_exchange(std::span<Update const> updates)
+    {
+        return mwcas_detail::compare_exchange(detail(), updates);
+    }
+
+    bool compare_exchange(std::initializer_list<Update> updates)
+    {
+        return compare_exchange(std::span(updates.begin(), updates.size()));
+    }
+
+    /**
+     * Complete the update of every process that died making one.
+     *
+     * This happens anyway when another update needs one of its words, so
+     * this is only needed to settle the words before they are read in some
+     * other way, such as after every process has stopped, or to free the
+     * descriptors of dead processes.
+     *
+     * @return  The number of updates completed.
+     */
+    std::size_t recover() { return mwcas_detail::recover(detail()); }
+
+private:
+    mwcas_detail::Pool detail() noexcept
+    {
+        return mwcas_detail::Pool{
+            reinterpret_cast<std::byte *>(this),
+            headers_,
+            std::uint32_t(Descriptors),
+            &entries_[0][0],
+            std::uint32_t(Words)};
+    }
+
+    mwcas_detail::Header headers_[Descriptors];
+    mwcas_detail::Entry entries_[Descriptors][Words];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcMwCas<>>);
+
+} // namespace wjh
+
+#endif // WJH_8c41e7b25d9a4f3e9b06a1d7c3e58f24
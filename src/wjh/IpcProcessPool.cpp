@@ -0,0 +1,292 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcProcessPool.hpp"
+
+#include <cerrno>
+#include <map>
+#include <system_error>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace wjh {
+namespace pool_detail {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+[[noreturn]] void
+throw_errno(char const * what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+bool
+finished(TaskState state) noexcept
+{
+    return state != TaskState::filling && state != TaskState::pending &&
+        state != TaskState::running;
+}
+
+// Find a slot in @p from, starting at @p hint, and lock it, then move it to
+// @p to with the lock held.
+std::optional<std::uint32_t>
+take(Slots slots, Atomic<std::uint32_t> & hint, TaskState from, TaskState to)
+{
+    auto const start = hint.load(std::memory_order_relaxed);
+    for (std::uint32_t i = 0; i < slots.capacity; ++i) {
+        auto const index = (start + i) % slots.capacity;
+        auto & state = slots.states[index];
+        auto w = state.load(std::memory_order_acquire);
+        if (state_of(w) != from) {
+            continue;
+        }
+
+        // Skip slots whose lock is held, rather than have try_lock() check
+        // whether the holder is still alive; recover() releases the locks
+        // of dead processes.
+        auto & lock = slots.slots[index].lock;
+        if (lock.owner() != ProcessId::null() || not lock.try_lock()) {
+            continue;
+        }
+        if (state.compare_exchange_strong(
+                w,
+                word(generation_of(w), to),
+                std::memory_order_acquire,
+                std::memory_order_relaxed))
+        {
+            hint.store(index + 1, std::memory_order_relaxed);
+            return index;
+        }
+        lock.unlock();
+    }
+    return std::nullopt;
+}
+
+} // anonymous namespace
+
+std::optional<std::uint32_t>
+acquire(Slots slots)
+{
+    auto const index = take(
+        slots,
+        slots.control.next_free,
+        TaskState::free,
+        TaskState::filling);
+    if (index) {
+        slots.slots[*index].attempts.store(0u, std::memory_order_relaxed);
+    }
+    return index;
+}
+
+TaskId
+publish(Slots slots, std::uint32_t index)
+{
+    auto & state = slots.states[index];
+    auto const generation =
+        generation_of(state.load(std::memory_order_relaxed));
+    state.store(
+        word(generation, TaskState::pending),
+        std::memory_order_release);
+    slots.slots[index].lock.unlock();
+    return TaskId::make(index, generation);
+}
+
+std::optional<std::uint32_t>
+claim(Slots slots)
+{
+    return take(
+        slots,
+        slots.control.next_claim,
+        TaskState::pending,
+        TaskState::running);
+}
+
+void
+finish(Slots slots, std::uint32_t index, bool ok)
+{
+    auto & state = slots.states[index];
+    auto const generation =
+        generation_of(state.load(std::memory_order_relaxed));
+    state.store(
+        word(generation, ok ? TaskState::done : TaskState::failed),
+        std::memory_order_release);
+    slots.slots[index].lock.unlock();
+    slots.control.done.ring();
+}
+
+bool
+release(Slots slots, TaskId id) noexcept
+{
+    if (id.index() >= slots.capacity) {
+        return false;
+    }
+    auto & state = slots.states[id.index()];
+    auto w = state.load(std::memory_order_relaxed);
+    auto const s = state_of(w);
+    return generation_of(w) == id.generation() &&
+        (s == TaskState::done || s == TaskState::failed) &&
+        state.compare_exchange_strong(
+            w,
+            word(id.generation() + 1, TaskState::free),
+            std::memory_order_release,
+            std::memory_order_relaxed);
+}
+
+TaskState
+state(Slots slots, TaskId id) noexcept
+{
+    if (id.index() >= slots.capacity) {
+        return TaskState::free;
+    }
+    auto const w = slots.states[id.index()].load(std::memory_order_acquire);
+    return generation_of(w) == id.generation() ? state_of(w) : TaskState::free;
+}
+
+bool
+wait(
+    Slots slots,
+    std::span<TaskId const> ids,
+    std::optional<std::chrono::nanoseconds> timeout)
+{
+    auto const start = Clock::now();
+
+    // A task, once finished, stays finished, so each is checked until it is.
+    std::size_t first = 0;
+    for (;;) {
+        auto const key = slots.control.done.prepare_wait();
+        while (first < ids.size() && finished(state(slots, ids[first]))) {
+            ++first;
+        }
+        if (first == ids.size()) {
+            slots.control.done.cancel_wait();
+            return true;
+        }
+
+        std::optional<std::chrono::nanoseconds> remaining;
+        if (timeout) {
+            auto const elapsed = Clock::now() - start;
+            if (elapsed >= *timeout) {
+                slots.control.done.cancel_wait();
+                return false;
+            }
+            remaining = *timeout - elapsed;
+        }
+        slots.control.done.wait(key, remaining);
+    }
+}
+
+std::size_t
+recover(Slots slots, std::uint32_t max_attempts)
+{
+    std::map<ProcessId, bool> alive;
+    auto const me = ProcessId::current();
+    std::size_t result = 0;
+    bool resubmitted = false;
+    bool failed = false;
+    for (std::uint32_t index = 0; index < slots.capacity; ++index) {
+        auto & state = slots.states[index];
+        auto const w = state.load(std::memory_order_acquire);
+        auto const s = state_of(w);
+        auto & slot = slots.slots[index];
+        auto const owner = slot.lock.owner();
+        if (owner == ProcessId::null()) {
+            continue;
+        }
+        auto [entry, added] = alive.emplace(owner, true);
+        if (added) {
+            entry->second = owner == me || owner.alive();
+        }
+        if (entry->second) {
+            continue;
+        }
+
+        // A process that died between locking a slot and changing its state
+        // leaves only the lock behind.  Otherwise, take the lock from the
+        // dead owner, and make sure the slot did not change hands meanwhile.
+        if (slot.lock.force_unlock(owner) && s == TaskState::pending) {
+            resubmitted = true;
+        }
+        if ((s != TaskState::filling && s != TaskState::running) ||
+            not slot.lock.try_lock())
+        {
+            continue;
+        }
+        if (state.load(std::memory_order_acquire) == w) {
+            auto const generation = generation_of(w);
+            if (s == TaskState::filling) {
+                state.store(
+                    word(generation + 1, TaskState::free),
+                    std::memory_order_release);
+            } else if (
+                slot.attempts.fetch_add(1u, std::memory_order_relaxed) + 1 >=
+                max_attempts)
+            {
+                state.store(
+                    word(generation, TaskState::failed),
+                    std::memory_order_release);
+                failed = true;
+            } else {
+                state.store(
+                    word(generation, TaskState::pending),
+                    std::memory_order_release);
+                resubmitted = true;
+            }
+            ++result;
+        }
+        slot.lock.unlock();
+    }
+    if (resubmitted) {
+        slots.control.work.ring();
+    }
+    if (failed) {
+        slots.control.done.ring();
+    }
+    return result;
+}
+
+pid_t
+spawn(std::function<void()> const & fn)
+{
+    auto const pid = ::fork();
+    if (pid == -1) {
+        throw_errno("fork");
+    }
+    if (pid == 0) {
+        int status = 0;
+        try {
+            fn();
+        } catch (...) {
+            status = 1;
+        }
+        ::_exit(status);
+    }
+    return pid;
+}
+
+bool
+exited(pid_t pid)
+{
+    int status = 0;
+    auto const result = ::waitpid(pid, &status, WNOHANG);
+    if (result == -1 && errno != ECHILD) {
+        throw_errno("waitpid");
+    }
+    return result != 0;
+}
+
+void
+join(pid_t pid) noexcept
+{
+    int status = 0;
+    while (::waitpid(pid, &status, 0) == -1 && errno == EINTR) {
+    }
+}
+
+} // namespace pool_detail
+} // namespace wjh
@@ -0,0 +1,532 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_c47e1a9b3d6f4825a0e8b2d9f5c1a764
+#define WJH_c47e1a9b3d6f4825a0e8b2d9f5c1a764
+
+#include "Atomic.hpp"
+#include "AtomicWait.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace wjh {
+
+/**
+ * The life of a task in an IpcTaskQueue.
+ */
+enum class TaskState : std::uint32_t
+{
+    /// The slot holds no task.
+    free,
+    /// A submitter is writing the task.
+    filling,
+    /// The task is waiting for a worker.
+    pending,
+    /// A worker is running the task.
+    running,
+    /// The task ran, and its result is waiting to be collected.
+    done,
+    /// The task threw, or killed too many workers, and has no result.
+    failed,
+};
+
+/**
+ * A reference to a task in an IpcTaskQueue: the index of its slot, and the
+ * generation of the slot when the task was submitted.
+ *
+ * Once the task is collected, the slot moves to a new generation, so the id
+ * no longer matches it, even after the slot is reused.
+ */
+struct TaskId
+{
+    std::uint64_t value = 0;
+
+    static constexpr TaskId
+    make(std::uint32_t index, std::uint32_t generation) noexcept
+    {
+        return TaskId{(std::uint64_t(generation) << 32) | index};
+    }
+
+    constexpr std::uint32_t index() const noexcept
+    {
+        return static_cast<std::uint32_t>(value);
+    }
+
+    constexpr std::uint32_t generation() const noexcept
+    {
+        return static_cast<std::uint32_t>(value >> 32);
+    }
+
+    friend constexpr auto operator <=> (TaskId, TaskId) noexcept = default;
+};
+
+namespace pool_detail {
+
+// The state of a slot is one word: its TaskState in the low bits, and its
+// generation above them, so every transition is a single compare-exchange
+// that also pins the generation.
+inline constexpr std::uint32_t state_bits = 3;
+inline constexpr std::uint32_t state_mask = (1u << state_bits) - 1;
+
+constexpr std::uint32_t
+word(std::uint32_t generation, TaskState state) noexcept
+{
+    return (generation << state_bits) | static_cast<std::uint32_t>(state);
+}
+
+constexpr TaskState
+state_of(std::uint32_t word) noexcept
+{
+    return static_cast<TaskState>(word & state_mask);
+}
+
+constexpr std::uint32_t
+generation_of(std::uint32_t word) noexcept
+{
+    return word >> state_bits;
+}
+
+struct Slot
+{
+    // Held by the process filling the slot, or running its task, so one
+    // that dies is detected.
+    ProcessIdLock lock;
+    // The number of workers that died running the task.
+    Atomic<std::uint32_t> attempts;
+};
+
+struct Control
+{
+    // Rung when tasks are submitted or resubmitted, and on stop().
+    IpcDoorbell work;
+    // Rung when tasks finish.
+    IpcDoorbell done;
+    // Where the next searches for a free and a pending slot start.
+    Atomic<std::uint32_t> next_free;
+    Atomic<std::uint32_t> next_claim;
+    Atomic<std::uint32_t> stopping;
+};
+
+struct Slots
+{
+    Control & control;
+    Atomic<std::uint32_t> * states;
+    Slot * slots;
+    std::uint32_t capacity;
+};
+
+// Move a free slot to filling.
+std::optional<std::uint32_t> acquire(Slots slots);
+
+// Move a filling slot to pending, and return its id.
+TaskId publish(Slots slots, std::uint32_t index);
+
+// Move a pending slot to running, holding its lock.
+std::optional<std::uint32_t> claim(Slots slots);
+
+// Move a running slot to done or failed, and release its lock.
+void finish(Slots slots, std::uint32_t index, bool ok);
+
+// Move a done or failed slot back to free, in the next generation.
+bool release(Slots slots, TaskId id) noexcept;
+
+TaskState state(Slots slots, TaskId id) noexcept;
+
+bool wait(
+    Slots slots,
+    std::span<TaskId const> ids,
+    std::optional<std::chrono::nanoseconds> timeout);
+
+std::size_t recover(Slots slots, std::uint32_t max_attempts);
+
+} // namespace pool_detail
+
+/**
+ * A fixed capacity queue of tasks, and their results, shared between a set
+ * of submitting and working processes.
+ *
+ * Each slot holds a task, its result, and a single state word, so
+ * submitting, claiming, finishing, and collecting a task are each an atomic
+ * transition of that word, with no system call unless someone is waiting.
+ * Submitters wait on a completion doorbell, and idle workers on a work
+ * doorbell.
+ *
+ * A worker holds the ProcessIdLock of the slot it is running, so recover()
+ * can tell the tasks of dead workers from those of slow ones, and resubmits
+ * them.  A task that kills max_attempts workers is marked failed, rather
+ * than being allowed to take down the whole pool.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized queue is empty.
+ *
+ * @tparam Task  The argument of a task, copied into the queue.
+ *
+ * @tparam Result  The result of a task, copied out of the queue.
+ *
+ * @note  Work in a process is run by serve() or run_one(); IpcProcessPool
+ * forks processes that serve a queue, but any process that maps the queue
+ * can serve it as well.
+ */
+template <typename Task, typename Result, std::size_t Capacity>
+requires std::is_trivially_copyable_v<Task> &&
+    std::is_trivially_default_constructible_v<Task> &&
+    std::is_trivially_copyable_v<Result> &&
+    std::is_trivially_default_constructible_v<Result> &&
+    (Capacity > 0 && Capacity < (std::size_t(1) << 31))
+class IpcTaskQueue
+{
+public:
+    static constexpr std::size_t capacity = Capacity;
+
+    /**
+     * Submit @p task.
+     *
+     * @return  The id of the task, or std::nullopt if the queue is full.
+     */
+    std::optional<TaskId> submit(Task const & task)
+    {
+        auto const id = push(task);
+        if (id) {
+            control_.work.ring();
+        }
+        return id;
+    }
+
+    /**
+     * Submit each of @p tasks, and store their ids in @p ids, ringing the
+     * work doorbell once for the whole batch.
+     *
+     * @return  The number of tasks submitted, which is less than the size of
+     * @p tasks only if the queue filled up.
+     *
+     * @pre  @p ids has room for an id for each of @p tasks.
+     */
+    std::size_t submit(std::span<Task const> tasks, TaskId * ids)
+    {
+        std::size_t n = 0;
+        for (; n < tasks.size(); ++n) {
+            auto const id = push(tasks[n]);
+            if (not id) {
+                break;
+            }
+            ids[n] = *id;
+        }
+        if (n != 0) {
+            control_.work.ring();
+        }
+        return n;
+    }
+
+    /**
+     * The state of the task @p id, or TaskState::free if it has been
+     * collected.
+     */
+    TaskState state(TaskId id) const noexcept
+    {
+        return pool_detail::state(slots(), id);
+    }
+
+    /**
+     * Block until the task @p id has finished, or @p timeout elapses.
+     *
+     * @return  true if the task is done or failed.
+     */
+    bool wait(
+        TaskId id,
+        std::optional<std::chrono::nanoseconds> timeout = std::nullopt)
+    {
+        return pool_detail::wait(slots(), std::span(&id, 1), timeout);
+    }
+
+    /**
+     * Block until every one of @p ids has finished, or @p timeout elapses.
+     *
+     * @return  true if every task is done or failed.
+     */
+    bool wait_all(
+        std::span<TaskId const> ids,
+        std::optional<std::chrono::nanoseconds> timeout = std::nullopt)
+    {
+        return pool_detail::wait(slots(), ids, timeout);
+    }
+
+    /**
+     * Take the result of the finished task @p id, and free its slot.
+     *
+     * @return  The result, or std::nullopt if the task failed, or @p id does
+     * not name a finished task.
+     */
+    std::optional<Result> collect(TaskId id) noexcept
+    {
+        auto const s = state(id);
+        if (s != TaskState::done && s != TaskState::failed) {
+            return std::nullopt;
+        }
+        auto const result = results_[id.index()];
+        if (not pool_detail::release(slots(), id) || s != TaskState::done) {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    /**
+     * Claim a pending task, if there is one, and run it with @p fn.
+     *
+     * @p fn is called with a Task const &, and returns the Result.  If it
+     * throws, the task fails.
+     *
+     * @return  true if a task was run.
+     */
+    template <typename FnT>
+    bool run_one(FnT && fn)
+    {
+        auto const index = pool_detail::claim(slots());
+        if (not index) {
+            return false;
+        }
+        bool ok = true;
+        try {
+            results_[*index] = std::invoke(fn, tasks_[*index]);
+        } catch (...) {
+            ok = false;
+        }
+        pool_detail::finish(slots(), *index, ok);
+        return true;
+    }
+
+    /**
+     * Run tasks with @p fn until stop() is called.
+     *
+     * While idle, this waits on the work doorbell, and every @p idle
+     * without work, it calls recover(@p max_attempts).
+     */
+    template <typename FnT>
+    void serve(
+        FnT && fn,
+        std::uint32_t max_attempts = 3,
+        std::chrono::nanoseconds idle = std::chrono::milliseconds(100))
+    {
+        for (;;) {
+            auto const key = control_.work.prepare_wait();
+            if (stopping()) {
+                control_.work.cancel_wait();
+                return;
+            }
+            if (run_one(fn)) {
+                control_.work.cancel_wait();
+            } else if (not control_.work.wait(key, idle)) {
+                recover(max_attempts);
+            }
+        }
+    }
+
+    /**
+     * Resubmit the tasks of workers that died while running them, and free
+     * the slots of submitters that died while filling them.
+     *
+     * A task whose workers have died @p max_attempts times is marked failed.
+     *
+     * @return  The number of slots recovered.
+     */
+    std::size_t recover(std::uint32_t max_attempts = 3)
+    {
+        return pool_detail::recover(slots(), max_attempts);
+    }
+
+    /**
+     * Tell every serve() loop to return once it finishes its current task.
+     */
+    void stop() noexcept
+    {
+        control_.stopping.store(1u, std::memory_order_release);
+        control_.work.ring();
+    }
+
+    /**
+     * Undo stop(), so the queue can be served again.
+     */
+    void restart() noexcept
+    {
+        control_.stopping.store(0u, std::memory_order_release);
+    }
+
+    bool stopping() const noexcept
+    {
+        return control_.stopping.load(std::memory_order_acquire) != 0;
+    }
+
+private:
+    pool_detail::Slots slots() const noexcept
+    {
+        return pool_detail::Slots{
+            const_cast<pool_detail::Control &>(control_),
+            const_cast<Atomic<std::uint32_t> *>(states_),
+            const_cast<pool_detail::Slot *>(slots_),
+            std::uint32_t(Capacity)};
+    }
+
+    std::optional<TaskId> push(Task const & task)
+    {
+        auto const index = pool_detail::acquire(slots());
+        if (not index) {
+            return std::nullopt;
+        }
+        tasks_[*index] = task;
+        return pool_detail::publish(slots(), *index);
+    }
+
+    pool_detail::Control control_;
+    Atomic<std::uint32_t> states_[Capacity];
+    pool_detail::Slot slots_[Capacity];
+    Task tasks_[Capacity];
+    Result results_[Capacity];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcTaskQueue<int, int, 4>>);
+
+namespace pool_detail {
+
+pid_t spawn(std::function<void()> const & fn);
+
+bool exited(pid_t pid);
+
+void join(pid_t pid) noexcept;
+
+} // namespace pool_detail
+
+/**
+ * A set of forked worker processes that serve an IpcTaskQueue.
+ *
+ * The pool supervises its workers: wait() and reap() notice workers that
+ * have died, resubmit the tasks they were running, and fork replacements.
+ *
+ * @note  The queue must be in memory that is shared with the forked
+ * workers, such as a Segment or a MAP_SHARED mapping.
+ */
+template <typename Task, typename Result, std::size_t Capacity>
+class IpcProcessPool
+{
+public:
+    using Queue = IpcTaskQueue<Task, Result, Capacity>;
+    using Function = std::function<Result(Task const &)>;
+
+    /**
+     * Fork @p workers processes that serve @p queue with @p fn.
+     *
+     * @throw  std::system_error if a process can't be forked.
+     */
+    IpcProcessPool(
+        Queue & queue,
+        std::size_t workers,
+        std::type_identity_t<Function> fn,
+        std::uint32_t max_attempts = 3)
+    : queue_(queue)
+    , fn_(std::move(fn))
+    , max_attempts_(max_attempts)
+    {
+        queue_.restart();
+        try {
+            for (std::size_t i = 0; i < workers; ++i) {
+                pids_.push_back(spawn());
+            }
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    /**
+     * Stop the workers, and wait for them to exit.
+     */
+    ~IpcProcessPool() { stop(); }
+
+    void operator = (IpcProcessPool &&) = delete;
+
+    Queue & queue() const noexcept { return queue_; }
+
+    std::size_t workers() const noexcept { return pids_.size(); }
+
+    /**
+     * Replace every worker that has died, after resubmitting the tasks it
+     * was running.
+     *
+     * @return  The number of workers replaced.
+     *
+     * @throw  std::system_error if a process can't be forked.
+     */
+    std::size_t reap()
+    {
+        std::size_t result = 0;
+        for (auto & pid : pids_) {
+            if (pool_detail::exited(pid)) {
+                queue_.recover(max_attempts_);
+                pid = spawn();
+                ++result;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Block until the task @p id has finished, reaping dead workers while
+     * waiting.
+     */
+    void wait(TaskId id) { wait_all(std::span(&id, 1)); }
+
+    /**
+     * Block until every one of @p ids has finished, reaping dead workers
+     * while waiting.
+     */
+    void wait_all(std::span<TaskId const> ids)
+    {
+        while (not queue_.wait_all(ids, std::chrono::milliseconds(10))) {
+            reap();
+        }
+    }
+
+    /**
+     * Stop the workers, and wait for them to exit.  Tasks that are still
+     * pending stay in the queue.
+     */
+    void stop() noexcept
+    {
+        queue_.stop();
+        for (auto pid : pids_) {
+            pool_detail::join(pid);
+        }
+        pids_.clear();
+    }
+
+private:
+    pid_t spawn()
+    {
+        return pool_detail::spawn([this] {
+            queue_.serve(fn_, max_attempts_);
+        });
+    }
+
+    Queue & queue_;
+    Function fn_;
+    std::uint32_t max_attempts_;
+    std::vector<pid_t> pids_;
+};
+
+} // namespace wjh
+
+#endif // WJH_c47e1a9b3d6f4825a0e8b2d9f5c1a764
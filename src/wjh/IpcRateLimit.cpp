@@ -0,0 +1,282 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcRateLimit.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace wjh {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint64_t token_bits = 20;
+constexpr std::uint64_t token_mask = (std::uint64_t(1) << token_bits) - 1;
+constexpr std::uint64_t time_mask = ~std::uint64_t(0) >> token_bits;
+constexpr std::uint64_t micros_per_second = 1'000'000;
+
+std::uint64_t
+micros(Clock::time_point now) noexcept
+{
+    auto const us = std::chrono::duration_cast<std::chrono::microseconds>(
+        now.time_since_epoch());
+    return static_cast<std::uint64_t>(us.count()) & time_mask;
+}
+
+struct Bucket
+{
+    std::uint64_t tokens;
+    std::uint64_t last;
+};
+
+Bucket
+unpack(std::uint64_t state) noexcept
+{
+    return Bucket{state & token_mask, state >> token_bits};
+}
+
+std::uint64_t
+pack(Bucket bucket) noexcept
+{
+    return (bucket.last << token_bits) | bucket.tokens;
+}
+
+// The bucket at @p now, after adding the tokens that have accrued since its
+// last refill.  The time of the refill advances only by the time it took to
+// accrue whole tokens, so fractions of a token are not lost.
+Bucket
+refill(
+    std::uint64_t state,
+    std::uint64_t now,
+    std::uint64_t rate,
+    std::uint64_t burst) noexcept
+{
+    if (state == 0) {
+        return Bucket{burst, now};
+    }
+    auto bucket = unpack(state);
+    bucket.tokens = std::min(bucket.tokens, burst);
+
+    // Another process may have refilled with a later reading of the clock;
+    // the time field wraps, so a "negative" difference is very large.
+    auto const elapsed = (now - bucket.last) & time_mask;
+    if (elapsed > (time_mask >> 1) || rate == 0) {
+        return bucket;
+    }
+
+    auto const missing = burst - bucket.tokens;
+    auto const accrued =
+        static_cast<__uint128_t>(elapsed) * rate / micros_per_second;
+    if (accrued >= missing) {
+        return Bucket{burst, now};
+    }
+    auto const added = static_cast<std::uint64_t>(accrued);
+    bucket.tokens += added;
+    bucket.last = (bucket.last +
+                   (added * micros_per_second + rate - 1) / rate) &
+        time_mask;
+    return bucket;
+}
+
+constexpr std::uint64_t count_mask = 0xffff'ffff;
+constexpr std::uint64_t nanos_per_second = 1'000'000'000;
+
+struct Second
+{
+    // The second, plus one, so that a zero bucket holds no second at all.
+    std::uint64_t key;
+    std::uint64_t fraction;
+};
+
+Second
+second_of(Clock::time_point now) noexcept
+{
+    auto const ns = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now.time_since_epoch())
+            .count());
+    return Second{
+        (ns / nanos_per_second + 1) & count_mask,
+        ns % nanos_per_second};
+}
+
+void
+sub(std::span<Atomic<std::uint64_t>> buckets,
+    std::uint32_t n,
+    Clock::time_point now)
+{
+    auto const second = second_of(now);
+    auto & bucket = buckets[second.key % buckets.size()];
+    auto w = bucket.load(std::memory_order_relaxed);
+    while ((w >> 32) == second.key &&
+           not bucket.compare_exchange_weak(
+               w,
+               w - std::min<std::uint64_t>(n, w & count_mask),
+               std::memory_order_relaxed,
+               std::memory_order_relaxed))
+    {
+    }
+}
+
+} // anonymous namespace
+
+void
+IpcTokenBucket::
+configure(std::uint32_t rate, std::uint32_t burst)
+{
+    if (burst > max_burst) {
+        throw std::invalid_argument("IpcTokenBucket burst is too large");
+    }
+    rate_.store(rate, std::memory_order_relaxed);
+    burst_.store(burst, std::memory_order_relaxed);
+}
+
+bool
+IpcTokenBucket::
+try_acquire(std::uint32_t n, Clock::time_point now)
+{
+    return take(n, n, now) == n;
+}
+
+std::uint32_t
+IpcTokenBucket::
+acquire_up_to(std::uint32_t n, Clock::time_point now)
+{
+    return take(1, n, now);
+}
+
+std::uint32_t
+IpcTokenBucket::
+available(Clock::time_point now) const
+{
+    return static_cast<std::uint32_t>(
+        refill(
+            state_.load(std::memory_order_relaxed),
+            micros(now),
+            rate(),
+            burst())
+            .tokens);
+}
+
+std::uint32_t
+IpcTokenBucket::
+take(std::uint32_t min, std::uint32_t max, Clock::time_point now)
+{
+    auto const t = micros(now);
+    auto const rate = this->rate();
+    auto const burst = this->burst();
+    auto state = state_.load(std::memory_order_relaxed);
+    for (;;) {
+        auto bucket = refill(state, t, rate, burst);
+        if (bucket.tokens < min) {
+            return 0;
+        }
+        auto const n = std::min<std::uint64_t>(bucket.tokens, max);
+        bucket.tokens -= n;
+        if (state_.compare_exchange_weak(
+                state,
+                pack(bucket),
+                std::memory_order_relaxed,
+                std::memory_order_relaxed))
+        {
+            return static_cast<std::uint32_t>(n);
+        }
+    }
+}
+
+namespace ratelimit_detail {
+
+std::uint64_t
+count(std::span<Atomic<std::uint64_t> const> buckets, Clock::time_point now)
+{
+    auto const second = second_of(now);
+    std::uint64_t result = 0;
+    auto index = second.key % buckets.size();
+    for (std::uint64_t k = 0; k < buckets.size() && k < second.key; ++k) {
+        auto const key = second.key - k;
+        auto const w = buckets[index].load(std::memory_order_relaxed);
+        index = (index == 0 ? buckets.size() : index) - 1;
+        if ((w >> 32) != key) {
+            continue;
+        }
+        auto const n = w & count_mask;
+        if (k + 1 < buckets.size()) {
+            result += n;
+        } else {
+            // Only the part of the oldest second that is still in the window.
+            result += n * (nanos_per_second - second.fraction) /
+                nanos_per_second;
+        }
+    }
+    return result;
+}
+
+std::uint32_t
+acquire(
+    std::span<Atomic<std::uint64_t>> buckets,
+    std::uint64_t limit,
+    std::uint32_t min,
+    std::uint32_t max,
+    Clock::time_point now)
+{
+    auto const before = count(buckets, now);
+    if (before >= limit) {
+        return 0;
+    }
+    auto n = static_cast<std::uint32_t>(
+        std::min<std::uint64_t>(max, limit - before));
+    if (n < min || n == 0) {
+        return 0;
+    }
+
+    // Record first, then check, so that racing callers can refuse each
+    // other, but never all get in.
+    add(buckets, n, now);
+    auto const after = count(buckets, now);
+    if (after > limit) {
+        auto const excess =
+            static_cast<std::uint32_t>(std::min<std::uint64_t>(
+                after - limit,
+                n));
+        if (n - excess < min || n == excess) {
+            sub(buckets, n, now);
+            return 0;
+        }
+        sub(buckets, excess, now);
+        n -= excess;
+    }
+    return n;
+}
+
+void
+add(std::span<Atomic<std::uint64_t>> buckets,
+    std::uint32_t n,
+    Clock::time_point now)
+{
+    auto const second = second_of(now);
+    auto & bucket = buckets[second.key % buckets.size()];
+    auto w = bucket.load(std::memory_order_relaxed);
+    std::uint64_t desired;
+    do {
+        if ((w >> 32) >= second.key) {
+            // The current second, or one a process with a later reading of
+            // the clock has already started.
+            desired = (w & ~count_mask) |
+                std::min<std::uint64_t>((w & count_mask) + n, count_mask);
+        } else {
+            desired = (second.key << 32) | n;
+        }
+    } while (not bucket.compare_exchange_weak(
+        w,
+        desired,
+        std::memory_order_relaxed,
+        std::memory_order_relaxed));
+}
+
+} // namespace ratelimit_detail
+} // namespace wjh
@@ -0,0 +1,207 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_8d2f6b1e4a9c47d3b5e0f7a2c6d9e814
+#define WJH_8d2f6b1e4a9c47d3b5e0f7a2c6d9e814
+
+#include "Atomic.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace wjh {
+
+/**
+ * A token bucket rate limiter, shared between processes.
+ *
+ * The whole state of the bucket is one 64-bit word, which packs the number
+ * of tokens with the time they were last refilled, so acquiring is a clock
+ * read and a single compare and exchange, and a rejection writes nothing.
+ * The bucket is refilled lazily, by whoever acquires next.
+ *
+ * Time is the steady clock, which is shared by every process on the host,
+ * kept in microseconds.  Tokens accrue at rate per second, up to burst.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized bucket admits nothing until configure()
+ * is called; once configured, it starts out full.
+ */
+class IpcTokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// The largest burst a bucket can hold.
+    static constexpr std::uint32_t max_burst = (1u << 20) - 1;
+
+    /**
+     * Set the rate, in tokens per second, and the burst, which is the most
+     * tokens the bucket can hold.
+     *
+     * @throw  std::invalid_argument if @p burst is more than max_burst.
+     *
+     * @note  Every process should configure a shared bucket the same way;
+     * usually whoever creates the segment configures it.
+     */
+    void configure(std::uint32_t rate, std::uint32_t burst);
+
+    std::uint32_t rate() const noexcept
+    {
+        return rate_.load(std::memory_order_relaxed);
+    }
+
+    std::uint32_t burst() const noexcept
+    {
+        return burst_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Take @p n tokens, if the bucket has that many.
+     *
+     * @return  true if the tokens were taken.
+     */
+    bool try_acquire(std::uint32_t n = 1, Clock::time_point now = Clock::now());
+
+    /**
+     * Take as many tokens as the bucket has, up to @p n.
+     *
+     * A process that takes a batch of tokens at once, and spends them
+     * locally, touches the shared word once per batch, rather than once per
+     * token.
+     *
+     * @return  The number of tokens taken.
+     */
+    std::uint32_t
+    acquire_up_to(std::uint32_t n, Clock::time_point now = Clock::now());
+
+    /**
+     * The number of tokens in the bucket at @p now.
+     */
+    std::uint32_t available(Clock::time_point now = Clock::now()) const;
+
+private:
+    std::uint32_t take(std::uint32_t min, std::uint32_t max, Clock::time_point);
+
+    // The time of the last refill, in microseconds, in the high bits, and
+    // the number of tokens in the low bits.
+    Atomic<std::uint64_t> state_;
+    Atomic<std::uint32_t> rate_;
+    Atomic<std::uint32_t> burst_;
+};
+
+static_assert(std::is_trivially_constructible_v<IpcTokenBucket>);
+
+namespace ratelimit_detail {
+
+using Clock = std::chrono::steady_clock;
+
+std::uint64_t
+count(std::span<Atomic<std::uint64_t> const> buckets, Clock::time_point now);
+
+std::uint32_t acquire(
+    std::span<Atomic<std::uint64_t>> buckets,
+    std::uint64_t limit,
+    std::uint32_t min,
+    std::uint32_t max,
+    Clock::time_point now);
+
+void add(
+    std::span<Atomic<std::uint64_t>> buckets,
+    std::uint32_t n,
+    Clock::time_point now);
+
+} // namespace ratelimit_detail
+
+/**
+ * A sliding window rate limiter, shared between processes, that admits at
+ * most limit events in any Seconds long window.
+ *
+ * Events are counted in a ring of per-second buckets, each one 64-bit word
+ * that packs the second with its count, so recording an event is a single
+ * compare and exchange.  The count for the window is the sum of the buckets
+ * of the last Seconds seconds, plus the part of the bucket before them that
+ * the window still overlaps, assuming its events were spread evenly.
+ *
+ * try_acquire() records the events before checking the window, and takes
+ * them back if that put the window over the limit, so concurrent callers
+ * can cause each other to be refused, but never to overshoot.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized counter admits nothing until configure()
+ * is called.
+ */
+template <std::size_t Seconds>
+requires(Seconds > 0)
+class IpcSlidingWindowCounter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t seconds = Seconds;
+
+    /**
+     * Set the most events to admit in a window.
+     */
+    void configure(std::uint64_t limit) noexcept
+    {
+        limit_.store(limit, std::memory_order_relaxed);
+    }
+
+    std::uint64_t limit() const noexcept
+    {
+        return limit_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Record @p n events, if that keeps the window within the limit.
+     *
+     * @return  true if the events were recorded.
+     */
+    bool try_acquire(std::uint32_t n = 1, Clock::time_point now = Clock::now())
+    {
+        return ratelimit_detail::acquire(buckets_, limit(), n, n, now) == n;
+    }
+
+    /**
+     * Record as many events as the window has room for, up to @p n.
+     *
+     * @return  The number of events recorded.
+     */
+    std::uint32_t
+    acquire_up_to(std::uint32_t n, Clock::time_point now = Clock::now())
+    {
+        return ratelimit_detail::acquire(buckets_, limit(), 1, n, now);
+    }
+
+    /**
+     * Record @p n events, whatever the limit.
+     */
+    void add(std::uint32_t n = 1, Clock::time_point now = Clock::now())
+    {
+        ratelimit_detail::add(buckets_, n, now);
+    }
+
+    /**
+     * The number of events in the window that ends at @p now.
+     */
+    std::uint64_t count(Clock::time_point now = Clock::now()) const
+    {
+        return ratelimit_detail::count(buckets_, now);
+    }
+
+private:
+    Atomic<std::uint64_t> limit_;
+    Atomic<std::uint64_t> buckets_[Seconds + 1];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcSlidingWindowCounter<4>>);
+
+} // namespace wjh
+
+#endif // WJH_8d2f6b1e4a9c47d3b5e0f7a2c6d9e814
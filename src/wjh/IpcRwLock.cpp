@@ -0,0 +1,102 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcRwLock.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+#if defined(__linux__)
+    #include <sched.h>
+#endif
+
+namespace wjh::rwlock_detail {
+
+namespace {
+
+std::uint64_t
+mix(std::uint64_t x)
+{
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58'476d'1ce4'e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d0'49bb'1331'11ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+std::uint64_t
+current_cpu()
+{
+#if defined(__linux__)
+    if (auto const cpu = ::sched_getcpu(); cpu >= 0) {
+        return static_cast<std::uint64_t>(cpu);
+    }
+#endif
+    // No cheap way to ask, so spread threads out instead of CPUs.
+    return std::hash<std::thread::id>{}(std::this_thread::get_id());
+}
+
+struct Held
+{
+    void const * lock;
+    std::uint32_t slot;
+};
+
+constexpr std::size_t max_held = 32;
+thread_local Held held[max_held];
+thread_local std::size_t num_held = 0;
+
+} // anonymous namespace
+
+std::size_t
+reader_hash()
+{
+    auto const me = ProcessId::current();
+    auto const tv = me.start_time();
+    auto h = mix(static_cast<std::uint64_t>(me.pid()));
+    h = mix(h ^ static_cast<std::uint64_t>(tv.tv_usec));
+    return static_cast<std::size_t>(mix(h ^ current_cpu()));
+}
+
+std::uint64_t
+now_ns()
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+void
+push_held(void const * lock, std::uint32_t slot)
+{
+    if (num_held == max_held) {
+        throw std::length_error("too many read locks held by this thread");
+    }
+    held[num_held++] = Held{lock, slot};
+}
+
+std::uint32_t
+pop_held(void const * lock)
+{
+    // Read locks are almost always released in LIFO order, so search from
+    // the most recent.
+    for (auto i = num_held; i > 0; --i) {
+        if (held[i - 1].lock == lock) {
+            auto const slot = held[i - 1].slot;
+            for (; i < num_held; ++i) {
+                held[i - 1] = held[i];
+            }
+            --num_held;
+            return slot;
+        }
+    }
+    return not_held;
+}
+
+} // namespace wjh::rwlock_detail
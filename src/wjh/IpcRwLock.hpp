@@ -0,0 +1,312 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_b7d41f0e2a6c4d93915e8c3a0f72d6b4
+#define WJH_b7d41f0e2a6c4d93915e8c3a0f72d6b4
+
+#include "Atomic.hpp"
+#include "ProcessId.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+namespace wjh {
+
+namespace rwlock_detail {
+
+/**
+ * The preferred starting slot in the visible readers table for the calling
+ * thread, based on its ProcessId and the CPU on which it is running.
+ */
+std::size_t reader_hash();
+
+/**
+ * A monotonic clock, in nanoseconds, that is comparable across processes.
+ */
+std::uint64_t now_ns();
+
+/**
+ * Remember, for the calling thread, which slot it used to read-lock @p lock.
+ *
+ * @throw  std::length_error if the calling thread holds too many read locks.
+ */
+void push_held(void const * lock, std::uint32_t slot);
+
+/**
+ * The slot returned by pop_held() when the calling thread does not hold a
+ * read lock on the lock.
+ */
+inline constexpr std::uint32_t not_held = 0xffff'ffffu;
+
+/**
+ * Forget, and return, the slot the calling thread used to read-lock @p lock,
+ * or not_held if it did not.
+ */
+std::uint32_t pop_held(void const * lock);
+
+} // namespace rwlock_detail
+
+/**
+ * A scalable inter-process reader-writer lock, in the style of BRAVO
+ * (Biased Locking for Reader-Writer Locks, Dice and Kogan, 2019).
+ *
+ * A centralized reader count is itself a contended cache line, even when no
+ * writer ever shows up.  Instead, while the lock is "reader biased," readers
+ * publish their presence in a hashed table of visible readers, keyed by their
+ * ProcessId and the CPU they are running on.  Readers on different CPUs thus
+ * touch different cache lines.
+ *
+ * A writer acquires the underlying ProcessIdLock, revokes the reader bias, and
+ * then waits until the table is empty.  Slots held by processes that have died
+ * are cleared during that scan, so a reader that crashes does not wedge the
+ * lock.  While the bias is revoked, readers take the slow path: they briefly
+ * acquire the underlying lock to claim a slot, which means they queue behind
+ * writers instead of starving them.  To keep revocation from dominating
+ * write-heavy phases, the bias is not re-enabled until some multiple of the
+ * time the last revocation took has passed.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized lock is unlocked.
+ *
+ * @tparam Slots  The number of slots in the visible readers table.  It must be
+ * a power of two.  This bounds the number of concurrent readers that can be
+ * tracked in the table; additional readers fall back to holding the
+ * underlying lock.
+ *
+ * @note  lock_shared and unlock_shared keep a small amount of thread-local
+ * bookkeeping, so a read lock must be released by the thread that acquired
+ * it.
+ */
+template <std::size_t Slots = 128>
+class IpcRwLock
+{
+    static_assert(std::has_single_bit(Slots));
+    static_assert(Slots < 0xffff'ffffu);
+
+public:
+    /**
+     * Obtain exclusive ownership, blocking (busy-wait) until obtained.
+     *
+     * @pre  Calling thread does not already hold the lock, in any mode.
+     */
+    void lock()
+    {
+        writer_.lock();
+        drain_readers(true);
+    }
+
+    /**
+     * Try to obtain exclusive ownership.
+     *
+     * @return  true if the calling thread obtained the lock; false otherwise.
+     *
+     * @pre  Calling thread does not already hold the lock, in any mode.
+     */
+    bool try_lock()
+    {
+        if (not writer_.try_lock()) {
+            return false;
+        }
+        if (not drain_readers(false)) {
+            writer_.unlock();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Release exclusive ownership.
+     *
+     * @pre  Calling thread holds the lock exclusively.
+     */
+    void unlock() { writer_.unlock(); }
+
+    /**
+     * Obtain shared ownership, blocking (busy-wait) until obtained.
+     *
+     * @throw  std::length_error if the calling thread already holds too many
+     * read locks.
+     */
+    void lock_shared()
+    {
+        auto const me = ProcessId::current();
+        auto const hash = rwlock_detail::reader_hash();
+        auto slot = try_fast_shared(me, hash);
+        if (slot == Slots) {
+            writer_.lock();
+            slot = claim_slot_slow(me, hash);
+        }
+        remember(slot);
+    }
+
+    /**
+     * Try to obtain shared ownership.
+     *
+     * @return  true if the calling thread obtained the lock; false otherwise.
+     *
+     * @throw  std::length_error if the calling thread already holds too many
+     * read locks.
+     */
+    bool try_lock_shared()
+    {
+        auto const me = ProcessId::current();
+        auto const hash = rwlock_detail::reader_hash();
+        auto slot = try_fast_shared(me, hash);
+        if (slot == Slots) {
+            if (not writer_.try_lock()) {
+                return false;
+            }
+            slot = claim_slot_slow(me, hash);
+        }
+        remember(slot);
+        return true;
+    }
+
+    /**
+     * Release shared ownership.
+     *
+     * @pre  Calling thread holds the lock in shared mode.  If it does not,
+     * nothing is released, rather than another reader's slot.
+     */
+    void unlock_shared()
+    {
+        if (auto const slot = rwlock_detail::pop_held(this);
+            slot != rwlock_detail::not_held)
+        {
+            release(slot);
+        }
+    }
+
+    /**
+     * Return true if readers are currently allowed to take the fast path.
+     */
+    bool reader_biased() const noexcept
+    {
+        return rbias_.load(std::memory_order_relaxed) != 0u;
+    }
+
+private:
+    static constexpr std::size_t mask = Slots - 1;
+
+    // How many probes a fast-path reader makes before giving up, and how many
+    // multiples of the revocation time the bias stays disabled.
+    static constexpr std::size_t fast_probes = 4;
+    static constexpr std::uint64_t inhibit_multiplier = 9;
+
+    void remember(std::uint32_t slot)
+    {
+        try {
+            rwlock_detail::push_held(this, slot);
+        } catch (...) {
+            release(slot);
+            throw;
+        }
+    }
+
+    void release(std::uint32_t slot)
+    {
+        if (slot == Slots) {
+            writer_.unlock();
+        } else {
+            readers_[slot].store(ProcessId::null(), std::memory_order_release);
+        }
+    }
+
+    // Returns the claimed slot, or Slots if the fast path is not available.
+    std::uint32_t try_fast_shared(ProcessId const & me, std::size_t hash)
+    {
+        if (rbias_.load(std::memory_order_relaxed) == 0u) {
+            return Slots;
+        }
+        for (std::size_t i = 0; i < fast_probes; ++i) {
+            auto const slot = (hash + i) & mask;
+            auto expected = ProcessId::null();
+            if (readers_[slot].compare_exchange_strong(expected, me)) {
+                // The writer clears rbias_ and then scans the table; we set a
+                // slot and then check rbias_.  Both sides are seq_cst.
+                if (rbias_.load() != 0u) {
+                    return static_cast<std::uint32_t>(slot);
+                }
+                readers_[slot].store(ProcessId::null());
+                break;
+            }
+        }
+        return Slots;
+    }
+
+    // Called while holding writer_; releases it unless every slot is full.
+    std::uint32_t claim_slot_slow(ProcessId const & me, std::size_t hash)
+    {
+        if (rbias_.load(std::memory_order_relaxed) == 0u &&
+            rwlock_detail::now_ns() >=
+                inhibit_until_.load(std::memory_order_relaxed))
+        {
+            rbias_.store(1u);
+        }
+        for (std::size_t i = 0; i < Slots; ++i) {
+            auto const slot = (hash + i) & mask;
+            auto expected = ProcessId::null();
+            if (readers_[slot].compare_exchange_strong(expected, me)) {
+                writer_.unlock();
+                return static_cast<std::uint32_t>(slot);
+            }
+        }
+
+        // The table is full, so the underlying lock is the read lock.
+        return Slots;
+    }
+
+    // Called while holding writer_.  Revoke the reader bias and wait for all
+    // visible readers to leave, clearing slots held by dead processes.
+    bool drain_readers(bool wait)
+    {
+        auto const revoking = rbias_.load(std::memory_order_relaxed) != 0u;
+        auto const start = revoking ? rwlock_detail::now_ns() : 0u;
+        if (revoking) {
+            rbias_.store(0u);
+        }
+
+        for (auto & reader : readers_) {
+            for (unsigned spins = 0;; ++spins) {
+                auto pid = reader.load();
+                if (pid == ProcessId::null()) {
+                    break;
+                }
+                if ((not wait || spins % 256u == 255u) && not pid.alive()) {
+                    reader.compare_exchange_strong(pid, ProcessId::null());
+                    continue;
+                }
+                if (not wait) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        if (revoking) {
+            auto const now = rwlock_detail::now_ns();
+            inhibit_until_.store(
+                now + (now - start) * inhibit_multiplier,
+                std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    ProcessIdLock writer_;
+    Atomic<std::uint32_t> rbias_;
+    Atomic<std::uint64_t> inhibit_until_;
+    alignas(64) Atomic<ProcessId> readers_[Slots];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcRwLock<>>);
+
+} // namespace wjh
+
+#endif // WJH_b7d41f0e2a6c4d93915e8c3a0f72d6b4
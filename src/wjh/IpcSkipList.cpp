@@ -0,0 +1,220 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcSkipList.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+namespace wjh {
+namespace skiplist_detail {
+
+namespace {
+
+std::uint64_t
+announcement(std::uint64_t epoch) noexcept
+{
+    return (epoch << 1) | 1u;
+}
+
+// Free the nodes of a limbo list.
+void
+free_list(IpcHeap & heap, std::uint64_t offset) noexcept
+{
+    while (offset != 0) {
+        auto * const node = static_cast<Node *>(heap.at(offset));
+        auto const next = node->retired.load(std::memory_order_relaxed);
+        heap.deallocate(node, node->bytes);
+        offset = next;
+    }
+}
+
+// Move to the next epoch, if every live reader has announced the current
+// one, and free the nodes retired two epochs before the new one.  Nodes
+// retired in the current epoch may still be held by readers that announced
+// it, and the list of the new one is being filled.
+void
+advance(Root & root, IpcHeap & heap)
+{
+    auto epoch = root.epoch.load(std::memory_order_seq_cst);
+    auto const current = announcement(epoch);
+    std::map<ProcessId, bool> alive;
+    for (auto & participant : root.participants) {
+        auto const announced =
+            participant.epoch.load(std::memory_order_seq_cst);
+        if (announced == 0 || announced == current) {
+            continue;
+        }
+        auto owner = participant.owner.load(std::memory_order_relaxed);
+        if (owner == ProcessId::null()) {
+            continue;
+        }
+        auto [entry, added] = alive.emplace(owner, true);
+        if (added) {
+            entry->second = owner.alive();
+        }
+        if (entry->second) {
+            return;
+        }
+
+        // The handle's process died while reading; free the participant.
+        participant.epoch.store(0u, std::memory_order_relaxed);
+        participant.owner.compare_exchange_strong(
+            owner,
+            ProcessId::null(),
+            std::memory_order_release,
+            std::memory_order_relaxed);
+    }
+    if (root.epoch.compare_exchange_strong(
+            epoch,
+            epoch + 1,
+            std::memory_order_seq_cst,
+            std::memory_order_relaxed))
+    {
+        free_list(
+            heap,
+            root.limbo[(epoch + 2) % 3].exchange(
+                0u,
+                std::memory_order_acquire));
+    }
+}
+
+} // anonymous namespace
+
+std::uint64_t
+attach(IpcHeap & heap, Atomic<std::uint64_t> & anchor, std::size_t head_bytes)
+{
+    if (auto const root = anchor.load(std::memory_order_acquire)) {
+        return root;
+    }
+
+    auto * const root = static_cast<Root *>(heap.allocate(sizeof(Root)));
+    auto * const head = heap.allocate(head_bytes);
+    std::memset(static_cast<void *>(root), 0, sizeof(Root));
+    std::memset(head, 0, head_bytes);
+    static_cast<Node *>(head)->bytes = static_cast<std::uint32_t>(head_bytes);
+    static_cast<Node *>(head)->height = max_height;
+    root->head.store(heap.offset_of(head), std::memory_order_relaxed);
+
+    std::uint64_t expected = 0;
+    if (anchor.compare_exchange_strong(
+            expected,
+            heap.offset_of(root),
+            std::memory_order_acq_rel,
+            std::memory_order_acquire))
+    {
+        return heap.offset_of(root);
+    }
+    heap.deallocate(head, head_bytes);
+    heap.deallocate(root, sizeof(Root));
+    return expected;
+}
+
+std::uint32_t
+join(Root & root)
+{
+    auto const me = ProcessId::current();
+    for (int pass = 0; pass < 2; ++pass) {
+        for (std::uint32_t i = 0; i < max_handles; ++i) {
+            auto & participant = root.participants[i];
+            auto owner = participant.owner.load(std::memory_order_relaxed);
+            if (owner == ProcessId::null() &&
+                participant.owner.compare_exchange_strong(
+                    owner,
+                    me,
+                    std::memory_order_acquire,
+                    std::memory_order_relaxed))
+            {
+                participant.epoch.store(0u, std::memory_order_relaxed);
+                return i;
+            }
+        }
+
+        // Free the participants of processes that died.
+        bool freed = false;
+        for (auto & participant : root.participants) {
+            auto owner = participant.owner.load(std::memory_order_relaxed);
+            if (owner != ProcessId::null() && not owner.alive()) {
+                participant.epoch.store(0u, std::memory_order_relaxed);
+                freed = participant.owner.compare_exchange_strong(
+                            owner,
+                            ProcessId::null(),
+                            std::memory_order_release,
+                            std::memory_order_relaxed) ||
+                    freed;
+            }
+        }
+        if (not freed) {
+            break;
+        }
+    }
+    throw std::length_error("IpcSkipList has too many handles");
+}
+
+void
+leave(Root & root, std::uint32_t slot) noexcept
+{
+    auto & participant = root.participants[slot];
+    participant.epoch.store(0u, std::memory_order_release);
+    participant.owner.store(ProcessId::null(), std::memory_order_release);
+}
+
+void
+enter(Root & root, std::uint32_t slot) noexcept
+{
+    // Announcing an epoch that has just passed only holds back the next
+    // advance; nodes retired before it are already unreachable.
+    root.participants[slot].epoch.store(
+        announcement(root.epoch.load(std::memory_order_seq_cst)),
+        std::memory_order_seq_cst);
+}
+
+void
+exit(Root & root, std::uint32_t slot) noexcept
+{
+    root.participants[slot].epoch.store(0u, std::memory_order_release);
+}
+
+void
+retire(Root & root, IpcHeap & heap, std::uint64_t node)
+{
+    auto & retired = static_cast<Node *>(heap.at(node))->retired;
+    auto & limbo =
+        root.limbo[root.epoch.load(std::memory_order_seq_cst) % 3];
+    auto head = limbo.load(std::memory_order_relaxed);
+    do {
+        retired.store(head, std::memory_order_relaxed);
+    } while (not limbo.compare_exchange_weak(
+        head,
+        node,
+        std::memory_order_release,
+        std::memory_order_relaxed));
+    advance(root, heap);
+}
+
+unsigned
+random_height() noexcept
+{
+    thread_local std::uint64_t state =
+        static_cast<std::uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count()) |
+        1u;
+
+    // xorshift64
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    auto const zeros = static_cast<unsigned>(
+        std::countr_zero(state | (std::uint64_t(1) << 31)));
+    return std::min(zeros / 2 + 1, max_height);
+}
+
+} // namespace skiplist_detail
+} // namespace wjh
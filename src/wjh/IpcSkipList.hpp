@@ -0,0 +1,573 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_8c3f1a6e9d2b47c5b0e4a7d1f5c9b236
+#define WJH_8c3f1a6e9d2b47c5b0e4a7d1f5c9b236
+
+#include "Atomic.hpp"
+#include "IpcHeap.hpp"
+#include "ProcessId.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace wjh {
+
+namespace skiplist_detail {
+
+// Four times as many nodes per level as the level above, so 16 levels index
+// about four billion nodes.
+inline constexpr unsigned max_height = 16;
+
+// The number of handles that can be attached to one list at once.
+inline constexpr std::size_t max_handles = 64;
+
+// The low bit of a tower offset marks its node as deleted at that level;
+// nodes are aligned to IpcHeap's 16 byte granule, so the bit is free.
+inline constexpr std::uint64_t mark = 1;
+
+// The state of a node.
+inline constexpr std::uint32_t linked = 1;
+inline constexpr std::uint32_t deleted = 2;
+
+struct Participant
+{
+    Atomic<ProcessId> owner;
+    // The epoch the handle is reading in, times two, plus one; or zero if
+    // it is not reading.
+    Atomic<std::uint64_t> epoch;
+};
+
+struct Root
+{
+    // The offset of the head node, whose tower is max_height tall.
+    Atomic<std::uint64_t> head;
+    Atomic<std::uint64_t> size;
+    Atomic<std::uint64_t> epoch;
+    // The nodes retired in each of the last three epochs, chained through
+    // Node::retired.
+    Atomic<std::uint64_t> limbo[3];
+    Participant participants[max_handles];
+};
+
+// The front of every node; the key and value follow, then the tower of
+// next offsets, one per level.
+struct Node
+{
+    Atomic<std::uint64_t> retired;
+    Atomic<std::uint32_t> state;
+    std::uint32_t bytes;
+    std::uint32_t height;
+};
+
+/**
+ * The offset of the Root in @p heap that @p anchor names, making it, and
+ * the head node of @p head_bytes, if @p anchor is zero.
+ */
+std::uint64_t attach(
+    IpcHeap & heap,
+    Atomic<std::uint64_t> & anchor,
+    std::size_t head_bytes);
+
+/**
+ * Claim a participant of @p root for the calling process.
+ *
+ * @throw  std::length_error if max_handles are attached to @p root.
+ */
+std::uint32_t join(Root & root);
+
+void leave(Root & root, std::uint32_t slot) noexcept;
+
+void enter(Root & root, std::uint32_t slot) noexcept;
+
+void exit(Root & root, std::uint32_t slot) noexcept;
+
+/**
+ * Free @p node once no reader can be looking at it.
+ */
+void retire(Root & root, IpcHeap & heap, std::uint64_t node);
+
+/**
+ * A random tower height from 1 to max_height, each 1/4 as likely as the one
+ * below it.
+ */
+unsigned random_height() noexcept;
+
+} // namespace skiplist_detail
+
+/**
+ * An ordered map of K to V, shared between processes, kept in a skip list
+ * whose nodes are allocated from an IpcHeap.
+ *
+ * Nodes link to each other by their offsets in the heap, so the list works
+ * wherever each process maps the heap.  insert() and erase() are lock free:
+ * a node is linked at the bottom level by one compare and exchange, and
+ * deleted by marking the offsets in its tower, after which any operation
+ * that passes it helps unlink it.  get(), contains(), and scan() never
+ * write shared memory, except to announce their epoch, and only step past
+ * deleted nodes, never retrying, so they are wait free.
+ *
+ * Unlinked nodes are freed by epoch based reclamation.  Each handle is a
+ * participant that announces the epoch it reads in, and a node is freed
+ * two epochs after it was retired, when no reader can still hold it.  The
+ * announcement of a process that died is ignored, so it cannot stop
+ * reclamation.
+ *
+ * Keys and values are never changed once inserted.
+ *
+ * An IpcSkipList is a process-local handle for one thread; every thread
+ * that uses the list makes its own handle.  The list itself lives in the
+ * heap, and is found through an anchor in shared memory.
+ *
+ * @note  A process that dies in the middle of insert() or erase() leaves
+ * the list consistent, but the node it was working on may never be freed.
+ */
+template <typename K, typename V, typename Compare = std::less<K>>
+requires std::is_trivially_copyable_v<K> &&
+    std::is_trivially_copyable_v<V> && std::is_empty_v<Compare> &&
+    std::is_default_constructible_v<Compare>
+class IpcSkipList
+{
+    struct Node
+    {
+        skiplist_detail::Node header;
+        K key;
+        V value;
+    };
+
+    static constexpr unsigned max_height = skiplist_detail::max_height;
+    static constexpr std::uint64_t mark = skiplist_detail::mark;
+
+public:
+    /**
+     * Attach to the list named by @p anchor, making the list if the anchor
+     * is zero.
+     *
+     * @param heap  The heap that holds the list.
+     * @param anchor  The offset of the list in @p heap, in shared memory
+     * that every process using the list can reach; zero-initialized, it
+     * names no list yet.
+     *
+     * @throw  std::bad_alloc if @p heap has no room for the list.
+     * @throw  std::length_error if skiplist_detail::max_handles handles are
+     * already attached.
+     */
+    IpcSkipList(IpcHeap & heap, Atomic<std::uint64_t> & anchor)
+    : heap_(heap)
+    , root_(*static_cast<skiplist_detail::Root *>(heap.at(
+          skiplist_detail::attach(heap, anchor, node_bytes(max_height)))))
+    , head_(root_.head.load(std::memory_order_acquire))
+    , slot_(skiplist_detail::join(root_))
+    { }
+
+    ~IpcSkipList() { skiplist_detail::leave(root_, slot_); }
+
+    void operator = (IpcSkipList &&) = delete;
+
+    /**
+     * Add @p key, with @p value.
+     *
+     * @return  false, and change nothing, if @p key is already present.
+     *
+     * @throw  std::bad_alloc if the heap has no room for the node.
+     */
+    bool insert(K const & key, V const & value)
+    {
+        auto const guard = Guard(*this);
+        std::uint64_t preds[max_height];
+        std::uint64_t succs[max_height];
+        if (find(key, preds, succs)) {
+            return false;
+        }
+
+        auto const height = skiplist_detail::random_height();
+        auto const bytes = node_bytes(height);
+        auto * const n = static_cast<Node *>(heap_.allocate(bytes));
+        auto const offset = heap_.offset_of(n);
+        n->header.retired.store(0u, std::memory_order_relaxed);
+        n->header.state.store(0u, std::memory_order_relaxed);
+        n->header.bytes = static_cast<std::uint32_t>(bytes);
+        n->header.height = height;
+        n->key = key;
+        n->value = value;
+
+        for (;;) {
+            for (unsigned level = 0; level < height; ++level) {
+                tower(n)[level].store(succs[level], std::memory_order_relaxed);
+            }
+            auto expected = succs[0];
+            if (next(preds[0], 0).compare_exchange_strong(
+                    expected,
+                    offset,
+                    std::memory_order_release,
+                    std::memory_order_relaxed))
+            {
+                break;
+            }
+            if (find(key, preds, succs)) {
+                heap_.deallocate(n, bytes);
+                return false;
+            }
+        }
+        root_.size.fetch_add(1u, std::memory_order_relaxed);
+
+        for (unsigned level = 1; level < height; ++level) {
+            if (not link(n, level, key, preds, succs)) {
+                break;
+            }
+        }
+        finish(offset, key, skiplist_detail::linked);
+        return true;
+    }
+
+    /**
+     * Remove @p key.
+     *
+     * @return  false if @p key is not present.
+     */
+    bool erase(K const & key)
+    {
+        auto const guard = Guard(*this);
+        std::uint64_t preds[max_height];
+        std::uint64_t succs[max_height];
+        if (not find(key, preds, succs)) {
+            return false;
+        }
+
+        // Mark the tower from the top down; the process that marks the
+        // bottom level is the one that erased the key.
+        auto const offset = succs[0];
+        auto * const n = node(offset);
+        for (auto level = n->header.height; level-- > 1;) {
+            auto & link = tower(n)[level];
+            auto old = link.load(std::memory_order_acquire);
+            while ((old & mark) == 0 &&
+                   not link.compare_exchange_weak(
+                       old,
+                       old | mark,
+                       std::memory_order_acq_rel,
+                       std::memory_order_acquire))
+            {
+            }
+        }
+        auto & bottom = tower(n)[0];
+        auto old = bottom.load(std::memory_order_acquire);
+        do {
+            if (old & mark) {
+                return false;
+            }
+        } while (not bottom.compare_exchange_weak(
+            old,
+            old | mark,
+            std::memory_order_acq_rel,
+            std::memory_order_acquire));
+        root_.size.fetch_sub(1u, std::memory_order_relaxed);
+        finish(offset, key, skiplist_detail::deleted);
+        return true;
+    }
+
+    /**
+     * A copy of the value of @p key, or std::nullopt if it is not present.
+     */
+    std::optional<V> get(K const & key) const
+    {
+        auto const guard = Guard(*this);
+        if (auto const offset = lower_bound(key, true)) {
+            return node(offset)->value;
+        }
+        return std::nullopt;
+    }
+
+    bool contains(K const & key) const
+    {
+        auto const guard = Guard(*this);
+        return lower_bound(key, true) != 0;
+    }
+
+    /**
+     * Call @p f(key, value) for each entry with @p from <= key < @p to, in
+     * order.
+     *
+     * The walk prefetches the nodes ahead of the one being visited, so their
+     * cache misses overlap with the work of @p f.  The references passed to
+     * @p f are into shared memory, and are only valid during the call.
+     *
+     * @return  The number of entries visited.
+     */
+    template <typename F>
+    std::size_t scan(K const & from, K const & to, F && f) const
+    {
+        auto const guard = Guard(*this);
+        std::size_t result = 0;
+        auto curr = lower_bound(from, false);
+        while (curr != 0) {
+            auto * const n = node(curr);
+            auto const succ = tower(n)[0].load(std::memory_order_acquire);
+
+            // The next node, and the one a level up, which is usually a few
+            // nodes further on.
+            if (succ & ~mark) {
+                __builtin_prefetch(node(succ));
+                if (n->header.height > 1) {
+                    auto const far =
+                        tower(n)[1].load(std::memory_order_relaxed) & ~mark;
+                    if (far != 0) {
+                        __builtin_prefetch(node(far));
+                    }
+                }
+            }
+
+            if (not less(n->key, to)) {
+                break;
+            }
+            if ((succ & mark) == 0) {
+                f(std::as_const(n->key), std::as_const(n->value));
+                ++result;
+            }
+            curr = succ & ~mark;
+        }
+        return result;
+    }
+
+    /**
+     * The number of entries.
+     */
+    std::size_t size() const noexcept
+    {
+        return root_.size.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    // Keeps the handle's epoch announced while any operation is running, so
+    // that a scan() callback can use the list too.
+    class Guard
+    {
+    public:
+        explicit Guard(IpcSkipList const & list) noexcept
+        : list_(list)
+        {
+            if (list_.depth_++ == 0) {
+                skiplist_detail::enter(list_.root_, list_.slot_);
+            }
+        }
+
+        ~Guard()
+        {
+            if (--list_.depth_ == 0) {
+                skiplist_detail::exit(list_.root_, list_.slot_);
+            }
+        }
+
+        void operator = (Guard &&) = delete;
+
+    private:
+        IpcSkipList const & list_;
+    };
+
+    static constexpr std::size_t node_bytes(unsigned height) noexcept
+    {
+        return sizeof(Node) + height * sizeof(Atomic<std::uint64_t>);
+    }
+
+    Node * node(std::uint64_t offset) const noexcept
+    {
+        return static_cast<Node *>(heap_.at(offset & ~mark));
+    }
+
+    static Atomic<std::uint64_t> * tower(Node * node) noexcept
+    {
+        return reinterpret_cast<Atomic<std::uint64_t> *>(
+            reinterpret_cast<std::byte *>(node) + sizeof(Node));
+    }
+
+    Atomic<std::uint64_t> &
+    next(std::uint64_t offset, unsigned level) const noexcept
+    {
+        return tower(node(offset))[level];
+    }
+
+    static bool less(K const & a, K const & b) { return Compare{}(a, b); }
+
+    // Find the nodes before and after @p key at every level, unlinking
+    // deleted nodes on the way, as in Herlihy and Shavit's lock-free skip
+    // list.
+    bool find(K const & key, std::uint64_t * preds, std::uint64_t * succs)
+    {
+    retry:
+        auto pred = head_;
+        for (unsigned level = max_height; level-- > 0;) {
+            auto curr =
+                next(pred, level).load(std::memory_order_acquire) & ~mark;
+            while (curr != 0) {
+                auto succ = next(curr, level).load(std::memory_order_acquire);
+                while (succ & mark) {
+                    auto expected = curr;
+                    if (not next(pred, level).compare_exchange_strong(
+                            expected,
+                            succ & ~mark,
+                            std::memory_order_acq_rel,
+                            std::memory_order_acquire))
+                    {
+                        goto retry;
+                    }
+                    curr = succ & ~mark;
+                    if (curr == 0) {
+                        break;
+                    }
+                    succ = next(curr, level).load(std::memory_order_acquire);
+                }
+                if (curr == 0 || not less(node(curr)->key, key)) {
+                    break;
+                }
+                pred = curr;
+                curr = succ;
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+        return succs[0] != 0 && not less(key, node(succs[0])->key);
+    }
+
+    // The first node whose key is not less than @p key, or, if @p exact,
+    // the node whose key is @p key; zero if there is none.  Deleted nodes
+    // are stepped over, never unlinked, so this never writes, or retries.
+    std::uint64_t lower_bound(K const & key, bool exact) const
+    {
+        auto pred = head_;
+        std::uint64_t curr = 0;
+        for (unsigned level = max_height; level-- > 0;) {
+            curr = next(pred, level).load(std::memory_order_acquire) & ~mark;
+            while (curr != 0) {
+                auto const succ =
+                    next(curr, level).load(std::memory_order_acquire);
+                if (succ & mark) {
+                    curr = succ & ~mark;
+                } else if (less(node(curr)->key, key)) {
+                    pred = curr;
+                    curr = succ;
+                } else {
+                    break;
+                }
+            }
+        }
+        if (exact && curr != 0 && less(key, node(curr)->key)) {
+            return 0;
+        }
+        return curr;
+    }
+
+    // Unlink every deleted node with @p key, at every level.  Unlike find(),
+    // this walks past the nodes whose key is @p key, since a node inserted
+    // with the same key can be linked in front of a deleted one.
+    void unlink(K const & key)
+    {
+    retry:
+        auto start = head_;
+        for (unsigned level = max_height; level-- > 0;) {
+            auto pred = start;
+            auto curr =
+                next(pred, level).load(std::memory_order_acquire) & ~mark;
+            while (curr != 0) {
+                auto const succ =
+                    next(curr, level).load(std::memory_order_acquire);
+                if (succ & mark) {
+                    auto expected = curr;
+                    if (not next(pred, level).compare_exchange_strong(
+                            expected,
+                            succ & ~mark,
+                            std::memory_order_acq_rel,
+                            std::memory_order_acquire))
+                    {
+                        goto retry;
+                    }
+                    curr = succ & ~mark;
+                } else if (less(key, node(curr)->key)) {
+                    break;
+                } else {
+                    // The level below starts before the first node with
+                    // the key.
+                    if (less(node(curr)->key, key)) {
+                        start = curr;
+                    }
+                    pred = curr;
+                    curr = succ;
+                }
+            }
+        }
+    }
+
+    // Link the node @p n in at @p level.  Return false if it has been
+    // deleted, so the levels above should not be linked.
+    bool link(
+        Node * n,
+        unsigned level,
+        K const & key,
+        std::uint64_t * preds,
+        std::uint64_t * succs)
+    {
+        auto const offset = heap_.offset_of(n);
+        for (;;) {
+            // Point the node at its successor, unless it has been marked.
+            auto old = tower(n)[level].load(std::memory_order_acquire);
+            if (old != succs[level] &&
+                ((old & mark) ||
+                 not tower(n)[level].compare_exchange_strong(
+                     old,
+                     succs[level],
+                     std::memory_order_acq_rel,
+                     std::memory_order_acquire)))
+            {
+                return false;
+            }
+            auto expected = succs[level];
+            if (next(preds[level], level).compare_exchange_strong(
+                    expected,
+                    offset,
+                    std::memory_order_release,
+                    std::memory_order_relaxed))
+            {
+                return true;
+            }
+            find(key, preds, succs);
+            if (succs[0] != offset) {
+                // Deleted, and unlinked at the bottom level.
+                return false;
+            }
+        }
+    }
+
+    // Record that the inserter or the eraser of the node at @p offset is
+    // done with it; whichever is last unlinks it for good, and retires it.
+    void finish(std::uint64_t offset, K const & key, std::uint32_t state)
+    {
+        using namespace skiplist_detail;
+        auto const old = node(offset)->header.state.fetch_or(
+            state,
+            std::memory_order_acq_rel);
+        if ((old | state) == (linked | deleted)) {
+            // The tower is all marked, and no more levels will be linked,
+            // so once this pass is done, nothing leads to the node.
+            unlink(key);
+            retire(root_, heap_, offset);
+        }
+    }
+
+    IpcHeap & heap_;
+    skiplist_detail::Root & root_;
+    std::uint64_t const head_;
+    std::uint32_t const slot_;
+    mutable std::uint32_t depth_ = 0;
+};
+
+} // namespace wjh
+
+#endif // WJH_8c3f1a6e9d2b47c5b0e4a7d1f5c9b236
@@ -0,0 +1,258 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcSlotMap.hpp"
+
+#include <map>
+#include <vector>
+
+namespace wjh {
+namespace slotmap_detail {
+
+namespace {
+
+constexpr std::uint64_t index_mask = 0xffff'ffff;
+
+// The free list head with @p first as its first slot, plus one, and the
+// count moved on.
+std::uint64_t
+bump(std::uint64_t head, std::uint64_t first) noexcept
+{
+    return ((head & ~index_mask) + (index_mask + 1)) | first;
+}
+
+// Push the slots from @p first to @p last, already linked, onto the free
+// list.
+void
+push(
+    Control & control,
+    Slot * slots,
+    std::uint32_t first,
+    std::uint32_t last) noexcept
+{
+    auto head = control.free.load(std::memory_order_relaxed);
+    do {
+        slots[last].next.store(
+            static_cast<std::uint32_t>(head & index_mask),
+            std::memory_order_relaxed);
+    } while (not control.free.compare_exchange_weak(
+        head,
+        bump(head, first + 1u),
+        std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+// Record @p me as the owner of @p slot, which we have taken off the free
+// list, or emptied, with @p generation, unless reclaim() has claimed the slot
+// to free it, by moving its generation on.  reclaim() checks the owner after
+// claiming, and we check the generation after recording, so at least one of
+// us sees the other.
+bool
+take(Slot & slot, ProcessId me, std::uint32_t generation) noexcept
+{
+    slot.owner.store(me, std::memory_order_seq_cst);
+    if (slot.generation.load(std::memory_order_seq_cst) == generation) {
+        return true;
+    }
+    slot.owner.compare_exchange_strong(
+        me,
+        ProcessId::null(),
+        std::memory_order_release,
+        std::memory_order_relaxed);
+    return false;
+}
+
+// Which of the slots ever used are on the free list with @p head.
+std::vector<bool>
+listed(Control & control, Slot * slots, std::uint64_t head)
+{
+    auto const high_water =
+        control.high_water.load(std::memory_order_acquire);
+    std::vector<bool> result(high_water);
+    for (auto i = static_cast<std::uint32_t>(head & index_mask);
+         i != 0 && i <= high_water && not result[i - 1];
+         i = slots[i - 1].next.load(std::memory_order_relaxed))
+    {
+        result[i - 1] = true;
+    }
+    return result;
+}
+
+// Put back on the free list the empty slots that are neither on it nor held
+// by a live process: those a process took or emptied, and died before it
+// was done with them.
+template <typename DeadT>
+void
+free_stranded(Control & control, Slot * slots, DeadT const & dead)
+{
+    // Claim each by moving its generation on, which take() checks for.
+    auto head = control.free.load(std::memory_order_acquire);
+    auto on_list = listed(control, slots, head);
+    std::vector<std::uint32_t> claimed;
+    for (std::uint32_t i = 0; i < on_list.size(); ++i) {
+        auto & slot = slots[i];
+        auto generation = slot.generation.load(std::memory_order_seq_cst);
+        auto const owner = slot.owner.load(std::memory_order_seq_cst);
+        if (on_list[i] || (generation & 1u) ||
+            (owner != ProcessId::null() && not dead(owner)))
+        {
+            continue;
+        }
+        if (slot.generation.compare_exchange_strong(
+                generation,
+                generation + 2,
+                std::memory_order_seq_cst,
+                std::memory_order_relaxed) &&
+            slot.owner.load(std::memory_order_seq_cst) == owner)
+        {
+            claimed.push_back(i);
+        }
+    }
+
+    // A slot freed since we walked the list may have been claimed on it, so
+    // splice the claimed slots in only while the list is as we last walked
+    // it.  Nobody frees a claimed slot, so once off the list it stays off,
+    // and the list stays in use throughout.  Any left over after a few
+    // tries are found again next time.
+    constexpr int attempts = 16;
+    for (int attempt = 1; not claimed.empty(); ++attempt) {
+        auto const n = claimed.size();
+        for (std::size_t k = 0; k < n; ++k) {
+            slots[claimed[k]].next.store(
+                k + 1 < n ? claimed[k + 1] + 1u
+                          : static_cast<std::uint32_t>(head & index_mask),
+                std::memory_order_relaxed);
+        }
+        if (control.free.compare_exchange_strong(
+                head,
+                bump(head, claimed.front() + 1u),
+                std::memory_order_release,
+                std::memory_order_acquire) ||
+            attempt == attempts)
+        {
+            return;
+        }
+        on_list = listed(control, slots, head);
+        std::erase_if(claimed, [&](std::uint32_t i) { return on_list[i]; });
+    }
+}
+
+} // anonymous namespace
+
+std::optional<std::uint32_t>
+acquire(Control & control, Slot * slots, std::uint32_t capacity) noexcept
+{
+    // Each slot is taken first, and then recorded as ours, so nobody waits
+    // on anybody else.  A process that dies in between leaves a slot that
+    // reclaim() can find, as it is on no list and has no live owner.
+    auto const me = ProcessId::current();
+    auto head = control.free.load(std::memory_order_acquire);
+    while (auto const first = head & index_mask) {
+        // A slot popped and reused under us can make these reads garbage,
+        // but then the count in the head has moved on, and the exchange
+        // fails.
+        auto & slot = slots[first - 1];
+        auto const generation =
+            slot.generation.load(std::memory_order_relaxed);
+        auto const next = slot.next.load(std::memory_order_relaxed);
+        if (not control.free.compare_exchange_weak(
+                head,
+                bump(head, next),
+                std::memory_order_acquire,
+                std::memory_order_acquire))
+        {
+            continue;
+        }
+        if (take(slot, me, generation)) {
+            return static_cast<std::uint32_t>(first - 1);
+        }
+        head = control.free.load(std::memory_order_acquire);
+    }
+
+    // Nothing has been freed, so take a slot that has never been used.
+    auto high_water = control.high_water.load(std::memory_order_acquire);
+    while (high_water < capacity) {
+        auto const index = high_water;
+        auto const generation =
+            slots[index].generation.load(std::memory_order_relaxed);
+        if (control.high_water.compare_exchange_weak(
+                high_water,
+                index + 1,
+                std::memory_order_acq_rel,
+                std::memory_order_acquire) &&
+            take(slots[index], me, generation))
+        {
+            return index;
+        }
+    }
+    return std::nullopt;
+}
+
+bool
+release(Control & control, Slot * slots, SlotHandle handle) noexcept
+{
+    auto & slot = slots[handle.index()];
+    auto expected = handle.generation();
+    if ((expected & 1u) == 0 ||
+        slot.generation.load(std::memory_order_acquire) != expected)
+    {
+        return false;
+    }
+    if (not slot.generation.compare_exchange_strong(
+            expected,
+            expected + 1,
+            std::memory_order_acq_rel,
+            std::memory_order_relaxed))
+    {
+        return false;
+    }
+    control.size.fetch_sub(1u, std::memory_order_relaxed);
+
+    // Take the slot over from the owner, to free it.  If the owner has died,
+    // reclaim() may have claimed the slot first, and then it frees the slot.
+    auto me = ProcessId::current();
+    if (take(slot, me, expected + 1)) {
+        push(control, slots, handle.index(), handle.index());
+        slot.owner.compare_exchange_strong(
+            me,
+            ProcessId::null(),
+            std::memory_order_release,
+            std::memory_order_relaxed);
+    }
+    return true;
+}
+
+std::size_t
+reclaim(Control & control, Slot * slots)
+{
+    std::map<ProcessId, bool> alive;
+    auto const me = ProcessId::current();
+    auto const dead = [&](ProcessId owner) {
+        auto [entry, added] = alive.emplace(owner, true);
+        if (added) {
+            entry->second = owner == me || owner.alive();
+        }
+        return not entry->second;
+    };
+
+    std::size_t result = 0;
+    auto const n = control.high_water.load(std::memory_order_acquire);
+    for (std::uint32_t i = 0; i < n; ++i) {
+        auto & slot = slots[i];
+        auto const generation = slot.generation.load(std::memory_order_acquire);
+        auto const owner = slot.owner.load(std::memory_order_relaxed);
+        if ((generation & 1u) && owner != ProcessId::null() && dead(owner) &&
+            release(control, slots, SlotHandle::make(i, generation)))
+        {
+            ++result;
+        }
+    }
+    free_stranded(control, slots, dead);
+    return result;
+}
+
+} // namespace slotmap_detail
+} // namespace wjh
@@ -0,0 +1,268 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_a6f2c8e4d1b947e5b3c9f7a0e2d6b418
+#define WJH_a6f2c8e4d1b947e5b3c9f7a0e2d6b418
+
+#include "Atomic.hpp"
+#include "ProcessId.hpp"
+
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+namespace wjh {
+
+/**
+ * A reference to an element of an IpcSlotMap: the index of its slot, and the
+ * generation of the slot when the element was inserted.
+ *
+ * Once the element is erased, the slot moves to a new generation, so the
+ * handle no longer matches it, even after the slot is reused.
+ */
+struct SlotHandle
+{
+    std::uint64_t value = 0;
+
+    static constexpr SlotHandle
+    make(std::uint32_t index, std::uint32_t generation) noexcept
+    {
+        return SlotHandle{(std::uint64_t(generation) << 32) | index};
+    }
+
+    constexpr std::uint32_t index() const noexcept
+    {
+        return static_cast<std::uint32_t>(value);
+    }
+
+    constexpr std::uint32_t generation() const noexcept
+    {
+        return static_cast<std::uint32_t>(value >> 32);
+    }
+
+    /**
+     * false for the null handle, which never matches an element.
+     */
+    explicit constexpr operator bool () const noexcept { return value != 0; }
+
+    friend constexpr auto
+    operator <=> (SlotHandle, SlotHandle) noexcept = default;
+};
+
+namespace slotmap_detail {
+
+struct Slot
+{
+    // Odd while the slot holds an element.
+    Atomic<std::uint32_t> generation;
+    // The next free slot, plus one, while the slot is on the free list.
+    Atomic<std::uint32_t> next;
+    // The process that inserted the element, while there is one.  A process
+    // taking the slot to insert into it, or freeing it, records itself here
+    // too, so that if it dies the slot is not lost.  Otherwise left over,
+    // or null.
+    Atomic<ProcessId> owner;
+};
+
+struct Control
+{
+    // The first free slot, plus one, in the low half, and a count that
+    // defeats ABA in the high half.
+    Atomic<std::uint64_t> free;
+    // The number of slots ever used; slots past it have never held anything.
+    Atomic<std::uint32_t> high_water;
+    Atomic<std::uint32_t> size;
+};
+
+std::optional<std::uint32_t>
+acquire(Control & control, Slot * slots, std::uint32_t capacity) noexcept;
+
+bool release(Control & control, Slot * slots, SlotHandle handle) noexcept;
+
+std::size_t reclaim(Control & control, Slot * slots);
+
+} // namespace slotmap_detail
+
+/**
+ * A fixed capacity table of T, shared between processes, whose elements are
+ * named by SlotHandle.
+ *
+ * Insert, erase, and lookup are constant time and lock free.  Free slots
+ * are kept on a list, and reused most recently freed first, so the elements
+ * stay packed at the front of the table, and for_each() visits only the
+ * slots that have ever been used.  An insert takes the first free slot off
+ * the list, and only then records itself as the slot's owner.
+ *
+ * Checking a handle is a single load of the generation of its slot, and a
+ * compare.  Erasing moves the slot to the next generation, so a stale
+ * handle never finds the element that reuses its slot.
+ *
+ * Each element records the process that inserted it, and reclaim_orphans()
+ * erases those whose process has died, and frees the slots of processes
+ * that died in the middle of an insert or erase.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized map is empty.
+ *
+ * @note  get() returns a pointer into the table, which the element's erasure
+ * and the slot's reuse may overwrite, so callers must agree on who erases
+ * what.  load() instead copies the element, and fails if it was erased
+ * during the copy.
+ */
+template <typename T, std::size_t Capacity>
+requires std::is_trivially_copyable_v<T> &&
+    std::is_trivially_default_constructible_v<T> &&
+    (Capacity > 0 && Capacity < (std::size_t(1) << 32))
+class IpcSlotMap
+{
+public:
+    static constexpr std::size_t capacity = Capacity;
+
+    /**
+     * Insert @p value.
+     *
+     * @return  The handle of the new element, or a null handle if the map
+     * is full.
+     */
+    SlotHandle insert(T const & value) noexcept
+    {
+        auto const index = slotmap_detail::acquire(control_, slots_, Capacity);
+        if (not index) {
+            return SlotHandle{};
+        }
+        auto & slot = slots_[*index];
+        std::memcpy(&values_[*index], &value, sizeof(T));
+        auto const generation =
+            slot.generation.load(std::memory_order_relaxed) + 1;
+        slot.generation.store(generation, std::memory_order_release);
+        control_.size.fetch_add(1u, std::memory_order_relaxed);
+        return SlotHandle::make(*index, generation);
+    }
+
+    /**
+     * Erase the element of @p handle.
+     *
+     * @return  false if @p handle does not name an element.
+     */
+    bool erase(SlotHandle handle) noexcept
+    {
+        return handle.index() < Capacity &&
+            slotmap_detail::release(control_, slots_, handle);
+    }
+
+    /**
+     * true if @p handle names an element.
+     */
+    bool contains(SlotHandle handle) const noexcept
+    {
+        return handle.index() < Capacity &&
+            slots_[handle.index()].generation.load(
+                std::memory_order_acquire) == handle.generation() &&
+            (handle.generation() & 1u);
+    }
+
+    /**
+     * The element of @p handle, or nullptr if there is none.
+     */
+    T * get(SlotHandle handle) noexcept
+    {
+        return contains(handle) ? &values_[handle.index()] : nullptr;
+    }
+
+    T const * get(SlotHandle handle) const noexcept
+    {
+        return contains(handle) ? &values_[handle.index()] : nullptr;
+    }
+
+    /**
+     * A copy of the element of @p handle, or std::nullopt if there is none,
+     * or it was erased while being copied.
+     */
+    std::optional<T> load(SlotHandle handle) const noexcept
+    {
+        if (not contains(handle)) {
+            return std::nullopt;
+        }
+        T result;
+        std::memcpy(&result, &values_[handle.index()], sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slots_[handle.index()].generation.load(
+                std::memory_order_relaxed) != handle.generation())
+        {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    /**
+     * The process that inserted the element of @p handle, or
+     * ProcessId::null() if there is none.
+     */
+    ProcessId owner(SlotHandle handle) const noexcept
+    {
+        if (not contains(handle)) {
+            return ProcessId::null();
+        }
+        auto const owner =
+            slots_[handle.index()].owner.load(std::memory_order_relaxed);
+        return contains(handle) ? owner : ProcessId::null();
+    }
+
+    /**
+     * Call @p fn with the handle and a reference to each element.
+     */
+    template <typename FnT>
+    void for_each(FnT && fn)
+    {
+        auto const n = control_.high_water.load(std::memory_order_acquire);
+        for (std::uint32_t i = 0; i < n && i < Capacity; ++i) {
+            auto const generation =
+                slots_[i].generation.load(std::memory_order_acquire);
+            if (generation & 1u) {
+                fn(SlotHandle::make(i, generation), values_[i]);
+            }
+        }
+    }
+
+    /**
+     * Erase every element inserted by a process that has died, and free the
+     * slots of processes that died while inserting or erasing.
+     *
+     * Each distinct owner is checked for liveness once.  Inserts and erases
+     * carry on meanwhile, with the free list left in place.
+     *
+     * @return  The number of elements erased.
+     */
+    std::size_t reclaim_orphans()
+    {
+        return slotmap_detail::reclaim(control_, slots_);
+    }
+
+    /**
+     * The number of elements.
+     */
+    std::size_t size() const noexcept
+    {
+        return control_.size.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    slotmap_detail::Control control_;
+    slotmap_detail::Slot slots_[Capacity];
+    T values_[Capacity];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcSlotMap<int, 4>>);
+
+} // namespace wjh
+
+#endif // WJH_a6f2c8e4d1b947e5b3c9f7a0e2d6b418
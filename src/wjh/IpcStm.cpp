@@ -0,0 +1,339 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcStm.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+namespace wjh {
+namespace stm_detail {
+
+namespace {
+
+enum : std::uint32_t { idle = 0, locking = 1, writing = 2 };
+
+bool
+locked(std::uint64_t lock) noexcept
+{
+    return lock & 1u;
+}
+
+std::uint64_t
+locked_by(std::uint32_t record) noexcept
+{
+    return std::uint64_t(record) << 1 | 1u;
+}
+
+std::uint32_t
+stripe_of(Stm stm, std::int64_t offset) noexcept
+{
+    return static_cast<std::uint32_t>(offset >> 3) & (stm.nstripes - 1);
+}
+
+Atomic<std::uint64_t> &
+word(Stm stm, std::int64_t offset) noexcept
+{
+    return *reinterpret_cast<Atomic<std::uint64_t> *>(stm.base + offset);
+}
+
+// Finish the commit in @p record, whose lock the caller holds, and whose
+// process died: write what it logged, or release what it locked.  Only
+// stripes that are still locked by the record are touched, since the others
+// are either not yet locked, or already released.
+void
+settle(Stm stm, std::uint32_t record)
+{
+    auto & header = stm.records[record];
+    auto const state = header.state.load(std::memory_order_acquire);
+    auto const mine = locked_by(record);
+    auto const locks = std::min(
+        header.locks.load(std::memory_order_acquire),
+        stm.max_writes);
+    auto * const entries = stm.locks + std::size_t(record) * stm.max_writes;
+    if (state == writing) {
+        auto const writes = std::min(
+            header.writes.load(std::memory_order_relaxed),
+            stm.max_writes);
+        auto * const log = stm.writes + std::size_t(record) * stm.max_writes;
+        for (std::uint32_t i = 0; i < writes; ++i) {
+            auto const offset = log[i].offset.load(std::memory_order_relaxed);
+            if (stm.stripes[stripe_of(stm, offset)].load(
+                    std::memory_order_acquire) == mine)
+            {
+                word(stm, offset).store(
+                    log[i].value.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+            }
+        }
+    }
+    auto const version = header.version.load(std::memory_order_relaxed);
+    for (std::uint32_t i = 0; i < locks; ++i) {
+        auto expected = mine;
+        stm.stripes[entries[i].stripe.load(std::memory_order_relaxed)]
+            .compare_exchange_strong(
+                expected,
+                state == writing ?
+                    version << 1 :
+                    entries[i].old.load(std::memory_order_relaxed),
+                std::memory_order_release,
+                std::memory_order_relaxed);
+    }
+    header.state.store(idle, std::memory_order_release);
+}
+
+// Lock a record, settling any commit that a dead process left in it.
+std::uint32_t
+claim(Stm stm)
+{
+    thread_local std::uint32_t hint = 0;
+    for (;;) {
+        for (std::uint32_t n = 0; n < stm.nrecords; ++n) {
+            auto const record = (hint + n) % stm.nrecords;
+            auto & header = stm.records[record];
+            if (header.lock.try_lock()) {
+                if (header.state.load(std::memory_order_acquire) != idle) {
+                    settle(stm, record);
+                }
+                hint = record;
+                return record;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+// Settle the commit holding @p lock, a stripe's lock word, if its process
+// has died.
+void
+unblock(Stm stm, std::uint64_t lock)
+{
+    auto const record = static_cast<std::uint32_t>(lock >> 1);
+    if (record >= stm.nrecords) {
+        return;
+    }
+    auto & header = stm.records[record];
+    auto const owner = header.lock.owner();
+    if (owner == ProcessId::null() || owner.alive() ||
+        not header.lock.try_lock())
+    {
+        return;
+    }
+    if (header.state.load(std::memory_order_acquire) != idle) {
+        settle(stm, record);
+    }
+    header.lock.unlock();
+}
+
+} // anonymous namespace
+
+std::size_t
+recover(Stm stm)
+{
+    std::size_t result = 0;
+    for (std::uint32_t record = 0; record < stm.nrecords; ++record) {
+        auto & header = stm.records[record];
+        auto const owner = header.lock.owner();
+        if (owner == ProcessId::null() || owner.alive() ||
+            not header.lock.try_lock())
+        {
+            continue;
+        }
+        if (header.state.load(std::memory_order_acquire) != idle) {
+            settle(stm, record);
+            ++result;
+        }
+        header.lock.unlock();
+    }
+    return result;
+}
+
+} // namespace stm_detail
+
+std::uint64_t
+IpcTx::
+load(Atomic<std::uint64_t> const & word)
+{
+    auto const offset =
+        reinterpret_cast<std::byte const *>(&word) - stm_.base;
+    for (auto i = writes_.size(); i > 0; --i) {
+        if (writes_[i - 1].offset == offset) {
+            return writes_[i - 1].value;
+        }
+    }
+
+    auto const s = stripe(offset);
+    auto & lock = stm_.stripes[s];
+    auto const before = lock.load(std::memory_order_acquire);
+    if (stm_detail::locked(before)) {
+        conflict(before);
+    }
+    auto const result = word.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto const after = lock.load(std::memory_order_relaxed);
+    if (after != before) {
+        conflict(after);
+    }
+    if ((before >> 1) > version_) {
+        conflict(0);
+    }
+    reads_.push_back(s);
+    return result;
+}
+
+void
+IpcTx::
+store(Atomic<std::uint64_t> & word, std::uint64_t value)
+{
+    auto const offset = reinterpret_cast<std::byte *>(&word) - stm_.base;
+    for (auto & write : writes_) {
+        if (write.offset == offset) {
+            write.value = value;
+            return;
+        }
+    }
+    if (writes_.size() == stm_.max_writes) {
+        throw std::length_error("too many writes for an IpcStm transaction");
+    }
+    writes_.push_back(Write{offset, value});
+}
+
+void
+IpcTx::
+begin()
+{
+    version_ = stm_.clock.load(std::memory_order_acquire);
+    blocker_ = 0;
+    reads_.clear();
+    writes_.clear();
+}
+
+bool
+IpcTx::
+commit()
+{
+    if (writes_.empty()) {
+        // Every read was checked against the start of the transaction.
+        return true;
+    }
+
+    stripes_.clear();
+    for (auto const & write : writes_) {
+        stripes_.push_back(stripe(write.offset));
+    }
+    std::sort(stripes_.begin(), stripes_.end());
+    stripes_.erase(
+        std::unique(stripes_.begin(), stripes_.end()),
+        stripes_.end());
+
+    auto const record = stm_detail::claim(stm_);
+    auto const mine = stm_detail::locked_by(record);
+    auto & header = stm_.records[record];
+    auto * const locks = stm_.locks + std::size_t(record) * stm_.max_writes;
+    header.locks.store(0u, std::memory_order_relaxed);
+    header.writes.store(0u, std::memory_order_relaxed);
+    header.state.store(stm_detail::locking, std::memory_order_release);
+
+    std::uint32_t held = 0;
+    auto const abort = [&] {
+        for (std::uint32_t i = 0; i < held; ++i) {
+            stm_.stripes[stripes_[i]].store(
+                locks[i].old.load(std::memory_order_relaxed),
+                std::memory_order_release);
+        }
+        header.state.store(stm_detail::idle, std::memory_order_release);
+        header.lock.unlock();
+        return false;
+    };
+
+    // Log each lock before taking it, so that a process settling the
+    // record finds it.
+    for (; held < stripes_.size(); ++held) {
+        auto & lock = stm_.stripes[stripes_[held]];
+        auto old = lock.load(std::memory_order_acquire);
+        do {
+            if (stm_detail::locked(old)) {
+                blocker_ = old;
+                return abort();
+            }
+            locks[held].stripe.store(stripes_[held], std::memory_order_relaxed);
+            locks[held].old.store(old, std::memory_order_relaxed);
+            header.locks.store(held + 1, std::memory_order_release);
+        } while (not lock.compare_exchange_weak(
+            old,
+            mine,
+            std::memory_order_acq_rel,
+            std::memory_order_acquire));
+    }
+
+    auto const version =
+        stm_.clock.fetch_add(1u, std::memory_order_acq_rel) + 1;
+    if (version != version_ + 1) {
+        // Another transaction committed since this one started, so check
+        // that it changed nothing this one read.
+        for (auto const s : reads_) {
+            auto current = stm_.stripes[s].load(std::memory_order_acquire);
+            if (current == mine) {
+                auto const i = static_cast<std::size_t>(
+                    std::lower_bound(stripes_.begin(), stripes_.end(), s) -
+                    stripes_.begin());
+                current = locks[i].old.load(std::memory_order_relaxed);
+            }
+            if (stm_detail::locked(current) || (current >> 1) > version_) {
+                blocker_ = current;
+                return abort();
+            }
+        }
+    }
+
+    // The commit point: once the writes are logged, a process settling the
+    // record writes them.
+    auto * const log = stm_.writes + std::size_t(record) * stm_.max_writes;
+    for (std::size_t i = 0; i < writes_.size(); ++i) {
+        log[i].offset.store(writes_[i].offset, std::memory_order_relaxed);
+        log[i].value.store(writes_[i].value, std::memory_order_relaxed);
+    }
+    header.writes.store(
+        static_cast<std::uint32_t>(writes_.size()),
+        std::memory_order_relaxed);
+    header.version.store(version, std::memory_order_relaxed);
+    header.state.store(stm_detail::writing, std::memory_order_release);
+
+    for (auto const & write : writes_) {
+        stm_detail::word(stm_, write.offset)
+            .store(write.value, std::memory_order_relaxed);
+    }
+    for (auto const s : stripes_) {
+        stm_.stripes[s].store(version << 1, std::memory_order_release);
+    }
+    header.state.store(stm_detail::idle, std::memory_order_release);
+    header.lock.unlock();
+    return true;
+}
+
+void
+IpcTx::
+backoff(unsigned attempts)
+{
+    if (stm_detail::locked(blocker_) && attempts % 8 == 7) {
+        stm_detail::unblock(stm_, blocker_);
+    }
+    if (attempts >= 2) {
+        std::this_thread::yield();
+    }
+}
+
+void
+IpcTx::
+conflict(std::uint64_t lock)
+{
+    blocker_ = lock;
+    throw stm_detail::Conflict{};
+}
+
+} // namespace wjh
@@ -0,0 +1,283 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_5b0e9d3a7c2f46e1a8d4f61b93c7e052
+#define WJH_5b0e9d3a7c2f46e1a8d4f61b93c7e052
+
+#include "Atomic.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace wjh {
+
+namespace stm_detail {
+
+// A stripe's lock word is its version shifted left one bit, or, while it is
+// locked, the index of the locking record shifted left one bit, plus one.
+struct LockEntry
+{
+    Atomic<std::uint32_t> stripe;
+    // The lock word before it was locked.
+    Atomic<std::uint64_t> old;
+};
+
+struct WriteEntry
+{
+    // The word, as an offset from the IpcStm.
+    Atomic<std::int64_t> offset;
+    Atomic<std::uint64_t> value;
+};
+
+struct RecordHeader
+{
+    // Held by the process committing with the record.
+    ProcessIdLock lock;
+    // Idle, locking, or writing.
+    Atomic<std::uint32_t> state;
+    Atomic<std::uint32_t> locks;
+    Atomic<std::uint32_t> writes;
+    // The version the commit gives the stripes it writes.
+    Atomic<std::uint64_t> version;
+};
+
+// The type-erased parts of an IpcStm.
+struct Stm
+{
+    std::byte * base;
+    Atomic<std::uint64_t> & clock;
+    Atomic<std::uint64_t> * stripes;
+    std::uint32_t nstripes;
+    RecordHeader * records;
+    std::uint32_t nrecords;
+    LockEntry * locks;
+    WriteEntry * writes;
+    std::uint32_t max_writes;
+};
+
+// Thrown, through the transaction function, to restart a transaction.
+struct Conflict
+{ };
+
+std::size_t recover(Stm stm);
+
+} // namespace stm_detail
+
+/**
+ * A transaction of an IpcStm, which is process local.
+ *
+ * Reads see a consistent snapshot of the words, as of the start of the
+ * transaction; a read that can't throws an internal conflict exception,
+ * which ipc_atomically() catches to run the transaction again.  Writes are
+ * buffered until commit.
+ */
+class IpcTx
+{
+public:
+    explicit IpcTx(stm_detail::Stm stm)
+    : stm_(stm)
+    { }
+
+    void operator = (IpcTx &&) = delete;
+
+    /**
+     * The value of @p word, as of the start of the transaction, or as
+     * written by it.
+     */
+    std::uint64_t load(Atomic<std::uint64_t> const & word);
+
+    /**
+     * Set @p word to @p value when the transaction commits.
+     *
+     * @throw  std::length_error if the transaction writes more words than
+     * the IpcStm allows.
+     */
+    void store(Atomic<std::uint64_t> & word, std::uint64_t value);
+
+    /**
+     * Start, or restart, the transaction.
+     */
+    void begin();
+
+    /**
+     * Make the writes of the transaction visible, all at once.  A
+     * transaction that wrote nothing writes nothing to shared memory.
+     *
+     * @return  false if another transaction changed what this one read.
+     */
+    bool commit();
+
+    /**
+     * Wait before running the transaction again, after @p attempts failed
+     * attempts, and release any stripe that blocked it, if the process that
+     * locked it has died.
+     */
+    void backoff(unsigned attempts);
+
+private:
+    struct Write
+    {
+        std::int64_t offset;
+        std::uint64_t value;
+    };
+
+    std::uint32_t stripe(std::int64_t offset) const noexcept
+    {
+        return static_cast<std::uint32_t>(offset >> 3) & (stm_.nstripes - 1);
+    }
+
+    [[noreturn]] void conflict(std::uint64_t lock);
+
+    stm_detail::Stm stm_;
+    std::uint64_t version_ = 0;
+    // The lock word that last stopped the transaction, if it was locked.
+    std::uint64_t blocker_ = 0;
+    std::vector<std::uint32_t> reads_;
+    std::vector<Write> writes_;
+    std::vector<std::uint32_t> stripes_;
+};
+
+/**
+ * A word-based software transactional memory for Atomic<std::uint64_t>
+ * words in shared memory, after TL2 (Dice, Shalev, and Shavit).
+ *
+ * Words hash to Stripes versioned locks, and a global clock orders
+ * commits.  A transaction notes the clock when it starts, and each read
+ * checks that the word's stripe is unlocked, and no newer than that, so a
+ * transaction never sees another's partial writes.  Writes are buffered.
+ * To commit, a transaction that wrote something locks the stripes of its
+ * writes, takes a new version from the clock, checks that the stripes it
+ * read have not changed, and writes its words, giving their stripes the new
+ * version.  A transaction that only read commits without writing to shared
+ * memory.
+ *
+ * A committing process logs its locks, then its writes, in one of Records
+ * records, which it holds with a ProcessIdLock.  If it dies, the process
+ * that next finds one of its stripes locked, or recover(), either rolls
+ * the commit forward, if it had logged its writes, or releases its locks.
+ *
+ * Words are named by their offset from the IpcStm, so they must be in the
+ * same mapping.  Each transaction can write up to MaxWrites words.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized IpcStm is ready to use.
+ */
+template <
+    std::size_t Stripes = 1024,
+    std::size_t Records = 64,
+    std::size_t MaxWrites = 64>
+requires (std::has_single_bit(Stripes) && Stripes <= (std::size_t(1) << 31)) &&
+    (Records > 0) && (MaxWrites > 0)
+class IpcStm
+{
+public:
+    using Tx = IpcTx;
+
+    static constexpr std::size_t max_writes = MaxWrites;
+
+    /**
+     * Run @p f(tx) as a transaction, with tx an IpcTx &, until it commits.
+     *
+     * @return  What @p f returned on the run that committed.
+     *
+     * @note  @p f may run several times, and may be stopped by an exception
+     * when a read conflicts, so it must not catch every exception, and any
+     * effects outside the transaction must be safe to repeat.  An exception
+     * of its own ends the transaction without writing anything.
+     */
+    template <typename F>
+    std::invoke_result_t<F &, IpcTx &> atomically(F && f)
+    {
+        auto tx = IpcTx(detail());
+        for (unsigned attempts = 0;; ++attempts) {
+            tx.begin();
+            try {
+                if constexpr (std::is_void_v<
+                                  std::invoke_result_t<F &, IpcTx &>>)
+                {
+                    f(tx);
+                    if (tx.commit()) {
+                        return;
+                    }
+                } else {
+                    auto result = f(tx);
+                    if (tx.commit()) {
+                        return result;
+                    }
+                }
+            } catch (stm_detail::Conflict const &) {
+            }
+            tx.backoff(attempts);
+        }
+    }
+
+    /**
+     * Complete or release the commit of every process that died during one.
+     *
+     * This happens anyway when a transaction finds a stripe locked by a
+     * dead process, so this is only needed to settle the words before they
+     * are read in some other way.
+     *
+     * @return  The number of commits completed or released.
+     */
+    std::size_t recover() { return stm_detail::recover(detail()); }
+
+    /**
+     * The number of transactions that have committed writes.
+     */
+    std::uint64_t version() const noexcept
+    {
+        return clock_.load(std::memory_order_relaxed);
+    }
+
+private:
+    stm_detail::Stm detail() noexcept
+    {
+        return stm_detail::Stm{
+            reinterpret_cast<std::byte *>(this),
+            clock_,
+            stripes_,
+            std::uint32_t(Stripes),
+            records_,
+            std::uint32_t(Records),
+            &locks_[0][0],
+            &writes_[0][0],
+            std::uint32_t(MaxWrites)};
+    }
+
+    Atomic<std::uint64_t> clock_;
+    Atomic<std::uint64_t> stripes_[Stripes];
+    stm_detail::RecordHeader records_[Records];
+    stm_detail::LockEntry locks_[Records][MaxWrites];
+    stm_detail::WriteEntry writes_[Records][MaxWrites];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcStm<>>);
+
+/**
+ * Run @p f(tx) as a transaction of @p stm, until it commits.
+ *
+ * @see  IpcStm::atomically
+ */
+template <
+    std::size_t Stripes,
+    std::size_t Records,
+    std::size_t MaxWrites,
+    typename F>
+std::invoke_result_t<F &, IpcTx &>
+ipc_atomically(IpcStm<Stripes, Records, MaxWrites> & stm, F && f)
+{
+    return stm.atomically(std::forward<F>(f));
+}
+
+} // namespace wjh
+
+#endif // WJH_5b0e9d3a7c2f46e1a8d4f61b93c7e052
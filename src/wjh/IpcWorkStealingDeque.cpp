@@ -0,0 +1,36 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "IpcWorkStealingDeque.hpp"
+
+namespace wjh {
+namespace wsdeque_detail {
+
+bool
+claim(Atomic<ProcessId> & owner)
+{
+    auto const me = ProcessId::current();
+    auto current = owner.load(std::memory_order_acquire);
+    for (;;) {
+        if (current == me) {
+            return true;
+        }
+        if (current != ProcessId::null() && current.alive()) {
+            return false;
+        }
+        if (owner.compare_exchange_strong(
+                current,
+                me,
+                std::memory_order_acq_rel,
+                std::memory_order_acquire))
+        {
+            return true;
+        }
+    }
+}
+
+} // namespace wsdeque_detail
+} // namespace wjh
@@ -0,0 +1,249 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_f3b8d2a6c9e145f7a1d4b0e8c6f2a937
+#define WJH_f3b8d2a6c9e145f7a1d4b0e8c6f2a937
+
+#include "Atomic.hpp"
+#include "ProcessId.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+
+namespace wjh {
+
+namespace wsdeque_detail {
+
+/**
+ * Make the calling process the owner of @p owner, if it has no owner, or
+ * its owner has died.
+ *
+ * @return  true if the calling process is now the owner.
+ */
+bool claim(Atomic<ProcessId> & owner);
+
+} // namespace wsdeque_detail
+
+/**
+ * A Chase-Lev work-stealing deque, shared between processes.
+ *
+ * One process, the owner, pushes and pops tasks at the bottom; pushing never
+ * uses a read-modify-write, and popping uses one only to race thieves for
+ * the last task.  Any process can steal from the top with a compare and
+ * exchange.
+ *
+ * The ring holds Capacity tasks.  When it is full, pushes spill into a
+ * second, lock-protected, stack of SpillCapacity tasks that lives beside it,
+ * so spilled tasks can still be stolen.  The owner and thieves go to the
+ * spill stack only once the ring is empty.
+ *
+ * The owner is recorded as a ProcessId, so a thief can claim() the deque of
+ * an owner that has died, and carry on with its tasks.  A task the dead
+ * owner was in the middle of popping is lost; every other task is run at
+ * most once.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized deque is empty and unowned.
+ *
+ * @tparam T  Tasks are small values, such as indexes or offsets, that fit in
+ * a lock-free Atomic.
+ *
+ * @note  Ownership is per process; only one thread of the owner may push or
+ * pop.
+ */
+template <
+    typename T,
+    std::size_t Capacity,
+    std::size_t SpillCapacity = Capacity>
+requires(std::has_single_bit(Capacity) && SpillCapacity > 0)
+class IpcWorkStealingDeque
+{
+public:
+    static constexpr std::size_t capacity = Capacity;
+    static constexpr std::size_t spill_capacity = SpillCapacity;
+
+    /**
+     * Become the owner, if there is none, or the owner has died.
+     *
+     * @return  true if the calling process is now the owner.
+     */
+    bool claim()
+    {
+        if (not wsdeque_detail::claim(owner_)) {
+            return false;
+        }
+
+        // A dead owner may have died in pop() with bottom below top.
+        auto const top = top_.load(std::memory_order_acquire);
+        if (bottom_.load(std::memory_order_relaxed) < top) {
+            bottom_.store(top, std::memory_order_release);
+        }
+        return true;
+    }
+
+    /**
+     * Give up ownership, so another process can claim() the deque.
+     *
+     * @pre  The calling process is the owner.
+     */
+    void release() noexcept
+    {
+        owner_.store(ProcessId::null(), std::memory_order_release);
+    }
+
+    /**
+     * The owner, or ProcessId::null() if there is none.
+     */
+    ProcessId owner() const noexcept
+    {
+        return owner_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Push @p task at the bottom.
+     *
+     * @return  false if the ring and the spill stack are both full.
+     *
+     * @pre  The calling process is the owner.
+     */
+    bool push(T task)
+    {
+        auto const bottom = bottom_.load(std::memory_order_relaxed);
+        auto const top = top_.load(std::memory_order_acquire);
+        if (bottom - top >= std::int64_t(Capacity)) {
+            return spill(task);
+        }
+        slot(bottom).store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Pop the task at the bottom, which is the one pushed most recently.
+     *
+     * @pre  The calling process is the owner.
+     */
+    std::optional<T> pop()
+    {
+        auto const bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = top_.load(std::memory_order_relaxed);
+        if (top <= bottom) {
+            auto task = slot(bottom).load(std::memory_order_relaxed);
+            if (top < bottom) {
+                return task;
+            }
+
+            // This is the last task, so race the thieves for it.
+            bool const won = top_.compare_exchange_strong(
+                top,
+                top + 1,
+                std::memory_order_seq_cst,
+                std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            if (won) {
+                return task;
+            }
+        } else {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return unspill();
+    }
+
+    /**
+     * Steal the task at the top, which is the oldest one.
+     *
+     * @return  std::nullopt if the deque is empty, or another process took
+     * the task first.
+     */
+    std::optional<T> steal()
+    {
+        auto top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto const bottom = bottom_.load(std::memory_order_acquire);
+        if (top < bottom) {
+            auto task = slot(top).load(std::memory_order_relaxed);
+            if (top_.compare_exchange_strong(
+                    top,
+                    top + 1,
+                    std::memory_order_seq_cst,
+                    std::memory_order_relaxed))
+            {
+                return task;
+            }
+            return std::nullopt;
+        }
+        return unspill();
+    }
+
+    /**
+     * The number of tasks, which may be stale as soon as it is returned.
+     */
+    std::size_t size() const noexcept
+    {
+        auto const bottom = bottom_.load(std::memory_order_acquire);
+        auto const top = top_.load(std::memory_order_acquire);
+        return (bottom > top ? std::size_t(bottom - top) : 0u) +
+            spilled_.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    Atomic<T> & slot(std::int64_t index) noexcept
+    {
+        return ring_[std::size_t(index) & (Capacity - 1)];
+    }
+
+    bool spill(T task)
+    {
+        auto guard = std::lock_guard(spill_lock_);
+        auto const n = spilled_.load(std::memory_order_relaxed);
+        if (n >= SpillCapacity) {
+            return false;
+        }
+        spill_[n] = task;
+        spilled_.store(n + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> unspill()
+    {
+        if (spilled_.load(std::memory_order_acquire) == 0) {
+            return std::nullopt;
+        }
+        auto guard = std::lock_guard(spill_lock_);
+        auto const n = spilled_.load(std::memory_order_relaxed);
+        if (n == 0) {
+            return std::nullopt;
+        }
+        spilled_.store(n - 1, std::memory_order_release);
+        return spill_[n - 1];
+    }
+
+    Atomic<ProcessId> owner_;
+    alignas(64) Atomic<std::int64_t> top_;
+    alignas(64) Atomic<std::int64_t> bottom_;
+    alignas(64) Atomic<T> ring_[Capacity];
+    ProcessIdLock spill_lock_;
+    Atomic<std::uint64_t> spilled_;
+    T spill_[SpillCapacity];
+};
+
+static_assert(
+    std::is_trivially_constructible_v<IpcWorkStealingDeque<int, 4>>);
+
+} // namespace wjh
+
+#endif // WJH_f3b8d2a6c9e145f7a1d4b0e8c6f2a937
@@ -0,0 +1,154 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "Numa.hpp"
+
+#include "Segment.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if defined(__linux__)
+    #include <sched.h>
+    #include <sys/syscall.h>
+
+    #include <unistd.h>
+#endif
+
+namespace wjh {
+
+namespace {
+
+// The kernel's memory policy modes and mbind flags, from
+// <linux/mempolicy.h>, which is not always installed.
+constexpr int mpol_default = 0;
+constexpr int mpol_preferred = 1;
+constexpr int mpol_bind = 2;
+constexpr int mpol_interleave = 3;
+constexpr unsigned mpol_mf_move = 1u << 1;
+
+// Parse a kernel node list, like "0" or "0-1,4-7", and return one more than
+// the largest node in it.
+std::size_t
+parse_node_count(std::string const & list)
+{
+    std::size_t result = 0;
+    std::size_t value = 0;
+    bool digits = false;
+    for (char c : list) {
+        if (c >= '0' && c <= '9') {
+            value = value * 10 + static_cast<std::size_t>(c - '0');
+            digits = true;
+        } else {
+            if (digits) {
+                result = std::max(result, value + 1);
+            }
+            value = 0;
+            digits = false;
+        }
+    }
+    if (digits) {
+        result = std::max(result, value + 1);
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+std::size_t
+numa_nodes() noexcept
+{
+    static std::size_t const count = [] {
+        std::string list;
+        try {
+            std::ifstream in("/sys/devices/system/node/online");
+            std::getline(in, list);
+        } catch (...) {
+        }
+        return std::max<std::size_t>(parse_node_count(list), 1u);
+    }();
+    return count;
+}
+
+unsigned
+current_numa_node() noexcept
+{
+#if defined(__linux__)
+    if (numa_nodes() > 1) {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (::getcpu(&cpu, &node) == 0) {
+            return node;
+        }
+    }
+#endif
+    return 0;
+}
+
+bool
+set_numa_policy(
+    std::span<std::byte> region,
+    NumaPolicy policy,
+    unsigned node,
+    bool move)
+{
+#if defined(__linux__)
+    if (region.empty()) {
+        return true;
+    }
+    auto const page = Segment::page_size();
+    auto const first = reinterpret_cast<std::uintptr_t>(region.data());
+    auto const begin = first / page * page;
+    auto const end = (first + region.size() + page - 1) / page * page;
+
+    constexpr std::size_t bits = sizeof(unsigned long) * CHAR_BIT;
+    auto const nodes = numa_nodes();
+    std::vector<unsigned long> mask((nodes + bits - 1) / bits);
+    int mode = mpol_default;
+    if (policy == NumaPolicy::interleave) {
+        mode = mpol_interleave;
+        for (std::size_t i = 0; i < nodes; ++i) {
+            mask[i / bits] |= 1ul << (i % bits);
+        }
+    } else if (policy != NumaPolicy::local) {
+        if (node >= nodes) {
+            throw std::system_error(
+                std::make_error_code(std::errc::invalid_argument),
+                "no such NUMA node");
+        }
+        mode = policy == NumaPolicy::bind ? mpol_bind : mpol_preferred;
+        mask[node / bits] |= 1ul << (node % bits);
+    }
+
+    // The kernel counts one more node than the mask holds.
+    auto const result = ::syscall(
+        SYS_mbind,
+        begin,
+        end - begin,
+        mode,
+        mode == mpol_default ? nullptr : mask.data(),
+        mode == mpol_default ? 0 : mask.size() * bits + 1,
+        move ? mpol_mf_move : 0u);
+    if (result == 0) {
+        return true;
+    }
+    if (errno != ENOSYS) {
+        throw std::system_error(errno, std::generic_category(), "mbind");
+    }
+#else
+    (void)region;
+    (void)policy;
+    (void)node;
+    (void)move;
+#endif
+    return false;
+}
+
+} // namespace wjh
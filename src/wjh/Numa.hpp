@@ -0,0 +1,294 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_8e4b1f7a3c6d42e9b5a1d0f6c3e8a714
+#define WJH_8e4b1f7a3c6d42e9b5a1d0f6c3e8a714
+
+#include "Atomic.hpp"
+#include "ProcessIdLock.hpp"
+#include "Segment.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace wjh {
+
+/**
+ * One more than the largest NUMA node that is online, which is 1 when the
+ * kernel does not support NUMA.  Nodes the machine could have, but does
+ * not, are not counted.
+ */
+std::size_t numa_nodes() noexcept;
+
+/**
+ * The NUMA node of the CPU the calling thread is running on.
+ *
+ * @note  The thread may migrate to another node as soon as this returns, so
+ * the result is a hint.
+ */
+unsigned current_numa_node() noexcept;
+
+/**
+ * Where the kernel places the pages of a memory region.
+ */
+enum class NumaPolicy
+{
+    /// On the node of the CPU that first touches each page.
+    local,
+    /// On the given node, or elsewhere when it has no free memory.
+    preferred,
+    /// Only on the given node.
+    bind,
+    /// Round robin across every node.
+    interleave
+};
+
+/**
+ * Set the NUMA policy of the pages covering @p region, which is rounded out
+ * to whole pages.
+ *
+ * The policy applies to the pages first touched after the call.  With
+ * @p move, pages already in memory are migrated to conform, if no other
+ * process has them mapped.
+ *
+ * @note  The kernel honors the policy of shared memory (tmpfs and
+ * /dev/shm) files for every process that maps them.  Pages of files on
+ * other filesystems are placed by the policy of the process that reads
+ * them in.
+ *
+ * @return  false if the kernel does not support NUMA.
+ *
+ * @throw  std::system_error if the policy can't be set.
+ */
+bool set_numa_policy(
+    std::span<std::byte> region,
+    NumaPolicy policy,
+    unsigned node = 0,
+    bool move = false);
+
+namespace numa_detail {
+
+template <typename T>
+struct Replica
+{
+    // Odd while a writer is changing the value.
+    Atomic<std::uint64_t> seq;
+    T value;
+};
+
+} // namespace numa_detail
+
+/**
+ * A read-mostly value that keeps a copy on each NUMA node, so that readers
+ * never pay for a remote read.
+ *
+ * Readers copy the replica of their own node, under a sequence count, so
+ * they never block a writer or each other.  Writers take a ProcessIdLock
+ * and update every replica in turn.  On a machine with one node, or with
+ * NUMA disabled, there is just one replica.
+ *
+ * A writer that dies part way through a write leaves at most one replica
+ * marked as changing.  The next writer, or a reader that gives up waiting
+ * on it, repairs it from the others.  With a single replica there is
+ * nothing to repair from, so the value is left as the dead writer left it.
+ *
+ * Each replica starts on a page of its own, so each can be bound to its own
+ * node, and pages are only known at run time.  So the replicas follow the
+ * object, and it must be placed at the start of a page-aligned region of
+ * required_size() bytes.  This is an implicit lifetime type, and the region
+ * can be in shared memory and mmap files.  Zero-initialized, it holds a
+ * zero-initialized T.
+ *
+ * @tparam MaxNodes  The most replicas to keep; machines with more nodes
+ * share the replicas among them.
+ */
+template <typename T, std::size_t MaxNodes = 8>
+requires std::is_trivially_copyable_v<T> &&
+    std::is_trivially_default_constructible_v<T> && (MaxNodes > 0)
+class IpcNodeReplicated
+{
+public:
+    static constexpr std::size_t max_nodes = MaxNodes;
+
+    /**
+     * The number of replicas in use on this machine.
+     */
+    static std::size_t replicas() noexcept
+    {
+        return std::min(numa_nodes(), MaxNodes);
+    }
+
+    /**
+     * The size of the page-aligned region that holds the object and its
+     * replicas.
+     */
+    static std::size_t required_size() noexcept
+    {
+        return Segment::page_size() + replicas() * stride();
+    }
+
+    /**
+     * A copy of the value, read from the replica of the caller's node.
+     */
+    T load()
+    {
+        auto const n = replicas();
+        auto index = current_numa_node() % n;
+        for (int spins = 0;; ++spins) {
+            auto & replica = replica_at(index);
+            auto const seq = replica.seq.load(std::memory_order_acquire);
+            if ((seq & 1u) == 0) {
+                T result;
+                std::memcpy(&result, &replica.value, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (replica.seq.load(std::memory_order_relaxed) == seq) {
+                    return result;
+                }
+            } else if (n > 1) {
+                // Any other replica is just as good as this one.
+                index = (index + 1) % n;
+            } else if (spins > 1000) {
+                // The writer may have died; lock() takes the lock from a
+                // dead owner.
+                auto guard = std::lock_guard(lock_);
+                repair();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * Set every replica to @p value.
+     */
+    void store(T const & value)
+    {
+        auto guard = std::lock_guard(lock_);
+        repair();
+        write(value);
+    }
+
+    /**
+     * Atomically replace the value with the result of calling @p fn on it,
+     * with respect to other writers.
+     *
+     * @return  The new value.
+     */
+    template <typename FnT>
+    T update(FnT fn)
+    {
+        auto guard = std::lock_guard(lock_);
+        repair();
+        T value;
+        std::memcpy(&value, &replica_at(0).value, sizeof(T));
+        value = fn(std::as_const(value));
+        write(value);
+        return value;
+    }
+
+    /**
+     * Bind each replica to the memory of its node, and migrate it there.
+     *
+     * @return  false if the kernel does not support NUMA.
+     *
+     * @throw  std::system_error if the replicas can't be bound.
+     */
+    bool place()
+    {
+        auto const n = replicas();
+        for (std::size_t i = 0; i < n; ++i) {
+            auto const bytes = reinterpret_cast<std::byte *>(&replica_at(i));
+            if (not set_numa_policy(
+                    std::span(bytes, sizeof(Replica)),
+                    NumaPolicy::preferred,
+                    static_cast<unsigned>(i),
+                    true))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    using Replica = numa_detail::Replica<T>;
+
+    // Whole pages, so no two replicas share one.
+    static std::size_t stride() noexcept
+    {
+        auto const page = Segment::page_size();
+        return (sizeof(Replica) + page - 1) / page * page;
+    }
+
+    // The object has the first page to itself, and replica i comes after.
+    Replica & replica_at(std::size_t i) noexcept
+    {
+        auto const page = Segment::page_size();
+        auto const base = reinterpret_cast<std::byte *>(this);
+        assert(reinterpret_cast<std::uintptr_t>(base) % page == 0);
+        return *reinterpret_cast<Replica *>(base + page + i * stride());
+    }
+
+    void write(T const & value)
+    {
+        auto const n = replicas();
+        for (std::size_t i = 0; i < n; ++i) {
+            auto & replica = replica_at(i);
+            // A replica left odd by a dead writer stays odd until now.
+            auto const odd = replica.seq.load(std::memory_order_relaxed) | 1u;
+            replica.seq.store(odd, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&replica.value, &value, sizeof(T));
+            replica.seq.store(odd + 1, std::memory_order_release);
+        }
+    }
+
+    // Finish the write of a writer that died part way through it.  Every
+    // replica it had written has a larger count than the rest, so the one
+    // with the largest count holds the value it was writing.
+    void repair()
+    {
+        auto const n = replicas();
+        auto newest = n;
+        bool torn = false;
+        for (std::size_t i = 0; i < n; ++i) {
+            auto const seq = replica_at(i).seq.load(std::memory_order_acquire);
+            if (seq & 1u) {
+                torn = true;
+            } else if (
+                newest == n ||
+                seq > replica_at(newest).seq.load(std::memory_order_relaxed))
+            {
+                newest = i;
+            }
+        }
+        if (torn) {
+            T value;
+            std::memcpy(
+                &value,
+                &replica_at(newest == n ? 0 : newest).value,
+                sizeof(T));
+            write(value);
+        }
+    }
+
+    ProcessIdLock lock_;
+};
+
+static_assert(std::is_trivially_constructible_v<IpcNodeReplicated<int>>);
+
+} // namespace wjh
+
+#endif // WJH_8e4b1f7a3c6d42e9b5a1d0f6c3e8a714
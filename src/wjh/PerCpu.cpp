@@ -0,0 +1,525 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "PerCpu.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <sched.h>
+
+#if defined(__linux__) && defined(__x86_64__)
+    #include <sys/syscall.h>
+
+    #include <unistd.h>
+
+    #if __has_include(<sys/rseq.h>)
+        #include <sys/rseq.h>
+        #define WJH_GLIBC_RSEQ 1
+    #endif
+
+    #define WJH_RSEQ 1
+#endif
+
+namespace wjh {
+
+namespace {
+
+#if defined(WJH_RSEQ)
+// The fixed part of the kernel's struct rseq.
+struct alignas(32) RseqArea
+{
+    std::uint32_t cpu_id_start;
+    std::uint32_t cpu_id;
+    std::uint64_t rseq_cs;
+    std::uint32_t flags;
+};
+
+// The signature glibc registers with on x86, which must precede every abort
+// handler.
+constexpr std::uint32_t rseq_sig = 0x53053053;
+
+RseqArea *
+register_rseq() noexcept
+{
+    #if defined(WJH_GLIBC_RSEQ)
+    if (__rseq_size > 0) {
+        return reinterpret_cast<RseqArea *>(
+            static_cast<char *>(__builtin_thread_pointer()) + __rseq_offset);
+    }
+    #endif
+    alignas(32) thread_local RseqArea area{0u, ~0u, 0u, 0u};
+    if (::syscall(__NR_rseq, &area, sizeof(area), 0, rseq_sig) == 0) {
+        return &area;
+    }
+    return nullptr;
+}
+
+// The kernel updates the CPU fields behind our back.
+std::uint32_t
+load_cpu(std::uint32_t & field) noexcept
+{
+    return std::atomic_ref<std::uint32_t>(field).load(
+        std::memory_order_relaxed);
+}
+
+RseqArea *
+rseq_area() noexcept
+{
+    thread_local RseqArea * const area = register_rseq();
+    return area;
+}
+
+// The restartable sequence runs from label 1 to label 2, and jumps to label
+// 4, in a separate section, if it is preempted, migrated, or signaled.  The
+// descriptor, at label 3, is installed before the CPU check, and the last
+// instruction before label 2 must be the single store that commits.
+    #define WJH_RSEQ_BEGIN                                                     \
+        ".pushsection __rseq_cs, \"aw\"\n\t"                                   \
+        ".balign 32\n\t"                                                       \
+        "3:\n\t"                                                               \
+        ".long 0x0, 0x0\n\t"                                                   \
+        ".quad 1f, (2f - 1f), 4f\n\t"                                          \
+        ".popsection\n\t"                                                      \
+        "1:\n\t"                                                               \
+        "leaq 3b(%%rip), %%rax\n\t"                                            \
+        "movq %%rax, %[rseq_cs]\n\t"                                           \
+        "cmpl %[cpu], %[cpu_id]\n\t"                                           \
+        "jnz 4f\n\t"
+
+    #define WJH_RSEQ_END                                                       \
+        "2:\n\t"                                                               \
+        ".pushsection __rseq_failure, \"ax\"\n\t"                              \
+        ".byte 0x0f, 0xb9, 0x3d\n\t"                                           \
+        ".long 0x53053053\n\t"                                                 \
+        "4:\n\t"                                                               \
+        "jmp %l[abort]\n\t"                                                    \
+        ".popsection\n\t"
+
+// Each of these returns false if the sequence aborted, and must be retried,
+// after re-reading the CPU.
+
+bool
+rseq_add(RseqArea * rs, std::uint32_t cpu, std::int64_t * p, std::int64_t n)
+{
+    asm goto(
+        WJH_RSEQ_BEGIN
+        "addq %[n], %[v]\n\t"
+        WJH_RSEQ_END
+        :
+        : [cpu_id] "m"(rs->cpu_id),
+          [rseq_cs] "m"(rs->rseq_cs),
+          [cpu] "r"(cpu),
+          [v] "m"(*p),
+          [n] "er"(n)
+        : "memory", "cc", "rax"
+        : abort);
+    return true;
+abort:
+    return false;
+}
+
+bool
+rseq_push(
+    RseqArea * rs,
+    std::uint32_t cpu,
+    std::uint64_t * head,
+    std::uint32_t * node_next,
+    std::uint64_t node)
+{
+    asm goto(
+        WJH_RSEQ_BEGIN
+        "movl %[head], %%ecx\n\t"
+        "movl %%ecx, %[next]\n\t"
+        "movq %[node], %[head]\n\t"
+        WJH_RSEQ_END
+        :
+        : [cpu_id] "m"(rs->cpu_id),
+          [rseq_cs] "m"(rs->rseq_cs),
+          [cpu] "r"(cpu),
+          [head] "m"(*head),
+          [next] "m"(*node_next),
+          [node] "r"(node)
+        : "memory", "cc", "rax", "rcx"
+        : abort);
+    return true;
+abort:
+    return false;
+}
+
+// Sets *result to one more than the popped index, or to zero if the list is
+// empty.
+bool
+rseq_pop(
+    RseqArea * rs,
+    std::uint32_t cpu,
+    std::uint64_t * head,
+    std::uint32_t const * next,
+    std::uint32_t * result)
+{
+    asm goto(
+        WJH_RSEQ_BEGIN
+        "movl %[head], %%ecx\n\t"
+        "movl %%ecx, %[result]\n\t"
+        "testl %%ecx, %%ecx\n\t"
+        "jz 5f\n\t"
+        "movl -4(%[next], %%rcx, 4), %%edx\n\t"
+        "movq %%rdx, %[head]\n\t"
+        WJH_RSEQ_END
+        "5:\n\t"
+        :
+        : [cpu_id] "m"(rs->cpu_id),
+          [rseq_cs] "m"(rs->rseq_cs),
+          [cpu] "r"(cpu),
+          [head] "m"(*head),
+          [next] "r"(next),
+          [result] "m"(*result)
+        : "memory", "cc", "rax", "rcx", "rdx"
+        : abort);
+    return true;
+abort:
+    return false;
+}
+
+// Sets *full if the ring has no room.
+bool
+rseq_ring_push(
+    RseqArea * rs,
+    std::uint32_t cpu,
+    std::uint32_t * head,
+    std::uint32_t * tail,
+    std::uint64_t * slots,
+    std::uint32_t capacity,
+    std::uint64_t value,
+    bool * full)
+{
+    asm goto(
+        WJH_RSEQ_BEGIN
+        "movl %[tail], %%ecx\n\t"
+        "movl %%ecx, %%edx\n\t"
+        "subl %[head], %%edx\n\t"
+        "cmpl %[capacity], %%edx\n\t"
+        "jae 5f\n\t"
+        "movl %%ecx, %%edx\n\t"
+        "andl %[mask], %%edx\n\t"
+        "movq %[value], (%[slots], %%rdx, 8)\n\t"
+        "incl %%ecx\n\t"
+        "movl %%ecx, %[tail]\n\t"
+        WJH_RSEQ_END
+        "jmp 6f\n\t"
+        "5:\n\t"
+        "movb $1, %[full]\n\t"
+        "6:\n\t"
+        :
+        : [cpu_id] "m"(rs->cpu_id),
+          [rseq_cs] "m"(rs->rseq_cs),
+          [cpu] "r"(cpu),
+          [head] "m"(*head),
+          [tail] "m"(*tail),
+          [slots] "r"(slots),
+          [capacity] "r"(capacity),
+          [mask] "r"(capacity - 1),
+          [value] "r"(value),
+          [full] "m"(*full)
+        : "memory", "cc", "rax", "rcx", "rdx"
+        : abort);
+    return true;
+abort:
+    return false;
+}
+
+    #undef WJH_RSEQ_BEGIN
+    #undef WJH_RSEQ_END
+
+// The address of the value of an Atomic, for the plain instructions of a
+// restartable sequence.
+template <typename T>
+T *
+raw(Atomic<T> & atomic) noexcept
+{
+    static_assert(sizeof(Atomic<T>) == sizeof(T));
+    return reinterpret_cast<T *>(std::addressof(atomic));
+}
+#endif
+
+// The CPU to use with the atomic fallback, and the shared slot for CPUs
+// beyond ncpus.
+std::size_t
+fallback_cpu(std::size_t ncpus) noexcept
+{
+    auto const cpu = current_cpu();
+    return cpu < ncpus ? cpu : ncpus;
+}
+
+constexpr std::uint64_t tag_one = std::uint64_t(1) << 32;
+
+void
+atomic_push(
+    percpu_detail::FreelistHead & list,
+    Atomic<std::uint32_t> * next,
+    std::uint32_t index) noexcept
+{
+    auto head = list.head.load(std::memory_order_relaxed);
+    std::uint64_t desired;
+    do {
+        next[index].store(
+            static_cast<std::uint32_t>(head),
+            std::memory_order_relaxed);
+        desired = ((head & ~0xffffffffull) + tag_one) | (index + 1u);
+    } while (not list.head.compare_exchange_weak(
+        head,
+        desired,
+        std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+std::uint32_t
+atomic_pop(
+    percpu_detail::FreelistHead & list,
+    Atomic<std::uint32_t> * next) noexcept
+{
+    auto head = list.head.load(std::memory_order_acquire);
+    for (;;) {
+        auto const first = static_cast<std::uint32_t>(head);
+        if (first == 0u) {
+            return 0u;
+        }
+        auto const desired = ((head & ~0xffffffffull) + tag_one) |
+            next[first - 1].load(std::memory_order_relaxed);
+        if (list.head.compare_exchange_weak(
+                head,
+                desired,
+                std::memory_order_acquire,
+                std::memory_order_acquire))
+        {
+            return first;
+        }
+    }
+}
+
+bool
+atomic_ring_push(
+    percpu_detail::RingHeader & header,
+    Atomic<std::uint64_t> * slots,
+    std::uint32_t capacity,
+    std::uint64_t value) noexcept
+{
+    auto ticket = header.reserve.load(std::memory_order_relaxed);
+    do {
+        if (ticket - header.head.load(std::memory_order_acquire) >= capacity) {
+            return false;
+        }
+    } while (not header.reserve.compare_exchange_weak(
+        ticket,
+        ticket + 1,
+        std::memory_order_relaxed,
+        std::memory_order_relaxed));
+
+    slots[ticket & (capacity - 1)].store(value, std::memory_order_relaxed);
+
+    // Publish in order, so the consumer only needs to look at the tail.
+    while (header.tail.load(std::memory_order_acquire) != ticket) {
+        std::this_thread::yield();
+    }
+    header.tail.store(ticket + 1, std::memory_order_release);
+    return true;
+}
+
+percpu_detail::RingHeader &
+ring_header(unsigned char * ring) noexcept
+{
+    return *reinterpret_cast<percpu_detail::RingHeader *>(ring);
+}
+
+Atomic<std::uint64_t> *
+ring_slots(unsigned char * ring) noexcept
+{
+    return reinterpret_cast<Atomic<std::uint64_t> *>(
+        ring + sizeof(percpu_detail::RingHeader));
+}
+
+} // anonymous namespace
+
+bool
+rseq_supported() noexcept
+{
+#if defined(WJH_RSEQ)
+    return rseq_area() != nullptr;
+#else
+    return false;
+#endif
+}
+
+unsigned
+current_cpu() noexcept
+{
+#if defined(WJH_RSEQ)
+    if (auto rs = rseq_area()) {
+        return load_cpu(rs->cpu_id);
+    }
+#endif
+    auto const cpu = ::sched_getcpu();
+    return cpu < 0 ? 0u : static_cast<unsigned>(cpu);
+}
+
+namespace percpu_detail {
+
+void
+add(CounterSlot * slots, std::size_t ncpus, std::int64_t n) noexcept
+{
+#if defined(WJH_RSEQ)
+    if (auto rs = rseq_area()) {
+        for (;;) {
+            auto const cpu = load_cpu(rs->cpu_id_start);
+            if (cpu >= ncpus) {
+                slots[ncpus].value.fetch_add(n, std::memory_order_relaxed);
+                return;
+            }
+            if (rseq_add(rs, cpu, raw(slots[cpu].value), n)) {
+                return;
+            }
+        }
+    }
+#endif
+    slots[fallback_cpu(ncpus)].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+void
+push(
+    FreelistHead * heads,
+    std::size_t ncpus,
+    Atomic<std::uint32_t> * next,
+    std::uint32_t index) noexcept
+{
+#if defined(WJH_RSEQ)
+    if (auto rs = rseq_area()) {
+        for (;;) {
+            auto const cpu = load_cpu(rs->cpu_id_start);
+            if (cpu >= ncpus) {
+                atomic_push(heads[ncpus], next, index);
+                return;
+            }
+            if (rseq_push(
+                    rs,
+                    cpu,
+                    raw(heads[cpu].head),
+                    raw(next[index]),
+                    index + 1u))
+            {
+                return;
+            }
+        }
+    }
+#endif
+    atomic_push(heads[fallback_cpu(ncpus)], next, index);
+}
+
+std::optional<std::uint32_t>
+pop(FreelistHead * heads, std::size_t ncpus, Atomic<std::uint32_t> * next)
+    noexcept
+{
+    std::uint32_t first = 0;
+#if defined(WJH_RSEQ)
+    if (auto rs = rseq_area()) {
+        for (;;) {
+            auto const cpu = load_cpu(rs->cpu_id_start);
+            if (cpu >= ncpus) {
+                break;
+            }
+            if (rseq_pop(rs, cpu, raw(heads[cpu].head), raw(next[0]), &first))
+            {
+                break;
+            }
+        }
+    } else
+#endif
+    {
+        if (auto const cpu = fallback_cpu(ncpus); cpu < ncpus) {
+            first = atomic_pop(heads[cpu], next);
+        }
+    }
+    if (first == 0u) {
+        first = atomic_pop(heads[ncpus], next);
+    }
+    if (first == 0u) {
+        return std::nullopt;
+    }
+    return first - 1;
+}
+
+bool
+push(
+    unsigned char * rings,
+    std::size_t stride,
+    std::size_t ncpus,
+    std::uint32_t capacity,
+    std::uint64_t value) noexcept
+{
+#if defined(WJH_RSEQ)
+    if (auto rs = rseq_area()) {
+        for (;;) {
+            auto const cpu = load_cpu(rs->cpu_id_start);
+            if (cpu >= ncpus) {
+                auto const ring = rings + ncpus * stride;
+                return atomic_ring_push(
+                    ring_header(ring),
+                    ring_slots(ring),
+                    capacity,
+                    value);
+            }
+            auto const ring = rings + cpu * stride;
+            auto & header = ring_header(ring);
+            bool full = false;
+            if (rseq_ring_push(
+                    rs,
+                    cpu,
+                    raw(header.head),
+                    raw(header.tail),
+                    raw(*ring_slots(ring)),
+                    capacity,
+                    value,
+                    &full))
+            {
+                return not full;
+            }
+        }
+    }
+#endif
+    auto const ring = rings + fallback_cpu(ncpus) * stride;
+    return atomic_ring_push(
+        ring_header(ring),
+        ring_slots(ring),
+        capacity,
+        value);
+}
+
+std::size_t
+consume(
+    unsigned char * ring,
+    std::uint32_t capacity,
+    std::span<std::uint64_t> out) noexcept
+{
+    auto & header = ring_header(ring);
+    auto const slots = ring_slots(ring);
+    auto const head = header.head.load(std::memory_order_relaxed);
+    auto const tail = header.tail.load(std::memory_order_acquire);
+    auto const n = std::min<std::size_t>(tail - head, out.size());
+    for (std::size_t i = 0; i < n; ++i) {
+        auto const index = (head + static_cast<std::uint32_t>(i)) &
+            (capacity - 1);
+        out[i] = slots[index].load(std::memory_order_relaxed);
+    }
+    header.head.store(
+        head + static_cast<std::uint32_t>(n),
+        std::memory_order_release);
+    return n;
+}
+
+} // namespace percpu_detail
+
+} // namespace wjh
@@ -0,0 +1,265 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_c4e9a2f70b1d4c58a6e3f8b2d5a7c091
+#define WJH_c4e9a2f70b1d4c58a6e3f8b2d5a7c091
+
+#include "Atomic.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+namespace wjh {
+
+/**
+ * Return true if the calling thread runs per-CPU operations as restartable
+ * sequences (rseq), rather than with atomic instructions.
+ *
+ * This requires Linux on x86-64, with an rseq area registered for the thread.
+ * If glibc (2.35+) registered one, it is used; otherwise, one is registered
+ * directly.
+ *
+ * @note  A per-CPU object must not be shared between threads that disagree on
+ * this, because the rseq operations use plain (not locked) instructions.
+ * Since every thread of every process on a machine sees the same kernel, that
+ * only happens if something else has already claimed a thread's rseq
+ * registration without telling glibc.
+ */
+bool rseq_supported() noexcept;
+
+/**
+ * The CPU the calling thread is running on, as of the call.
+ */
+unsigned current_cpu() noexcept;
+
+namespace percpu_detail {
+
+struct alignas(64) CounterSlot
+{
+    Atomic<std::int64_t> value;
+};
+
+// The low 32 bits hold one more than the index of the first free entry (so
+// zero means empty), and the high 32 bits hold an ABA tag for the atomic
+// fallback.
+struct alignas(64) FreelistHead
+{
+    Atomic<std::uint64_t> head;
+};
+
+struct alignas(64) RingHeader
+{
+    Atomic<std::uint32_t> head;
+    Atomic<std::uint32_t> tail;
+    // Only used by the atomic fallback, to reserve slots before publishing.
+    Atomic<std::uint32_t> reserve;
+};
+
+void add(CounterSlot * slots, std::size_t ncpus, std::int64_t n) noexcept;
+
+void push(
+    FreelistHead * heads,
+    std::size_t ncpus,
+    Atomic<std::uint32_t> * next,
+    std::uint32_t index) noexcept;
+
+std::optional<std::uint32_t> pop(
+    FreelistHead * heads,
+    std::size_t ncpus,
+    Atomic<std::uint32_t> * next) noexcept;
+
+// Each ring is a RingHeader, immediately followed by capacity slots, and the
+// rings are stride bytes apart.
+bool push(
+    unsigned char * rings,
+    std::size_t stride,
+    std::size_t ncpus,
+    std::uint32_t capacity,
+    std::uint64_t value) noexcept;
+
+std::size_t consume(
+    unsigned char * ring,
+    std::uint32_t capacity,
+    std::span<std::uint64_t> out) noexcept;
+
+} // namespace percpu_detail
+
+/**
+ * A counter with one slot per CPU, so that increments from different CPUs
+ * never touch the same cache line.
+ *
+ * With rseq, an increment is a plain add to the slot for the current CPU,
+ * with no atomic or locked instruction.  Otherwise, it is an atomic add to
+ * that slot.  Threads on CPUs at or beyond MaxCpus share one extra slot, which
+ * is always updated atomically.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized counter has value zero.
+ */
+template <std::size_t MaxCpus = 256>
+class IpcPerCpuCounter
+{
+public:
+    static constexpr std::size_t max_cpus = MaxCpus;
+
+    /**
+     * Add @p n to the counter.
+     */
+    void add(std::int64_t n = 1) noexcept
+    {
+        percpu_detail::add(slots_, MaxCpus, n);
+    }
+
+    /**
+     * The sum of all the per-CPU slots.
+     *
+     * @note  The result is not a snapshot; increments that happen during the
+     * call may or may not be included.
+     */
+    std::int64_t value() const noexcept
+    {
+        std::int64_t result = 0;
+        for (auto const & slot : slots_) {
+            result += slot.value.load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+private:
+    percpu_detail::CounterSlot slots_[MaxCpus + 1];
+};
+
+/**
+ * A freelist of indices in [0, Capacity), with one list per CPU.
+ *
+ * push() and pop() work on the list for the current CPU.  With rseq, neither
+ * needs an atomic or locked instruction; otherwise, each is a compare and
+ * exchange on the list head, with an ABA tag.  Threads on CPUs at or beyond
+ * MaxCpus share one extra list, which is always updated atomically.
+ *
+ * An index freed on one CPU is only available to threads running on that
+ * CPU, so pop() can fail while other CPUs still hold free indices.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized freelist is empty.
+ */
+template <std::size_t MaxCpus, std::uint32_t Capacity>
+class IpcPerCpuFreelist
+{
+public:
+    static constexpr std::size_t max_cpus = MaxCpus;
+    static constexpr std::uint32_t capacity = Capacity;
+
+    /**
+     * Return @p index to the list for the current CPU.
+     *
+     * @pre  @p index < Capacity, and is not already in any list.
+     */
+    void push(std::uint32_t index) noexcept
+    {
+        percpu_detail::push(heads_, MaxCpus, next_, index);
+    }
+
+    /**
+     * Take an index from the list for the current CPU, or from the shared
+     * list, if the former is empty.
+     *
+     * @return  The index, or std::nullopt if both lists are empty.
+     */
+    std::optional<std::uint32_t> pop() noexcept
+    {
+        return percpu_detail::pop(heads_, MaxCpus, next_);
+    }
+
+private:
+    percpu_detail::FreelistHead heads_[MaxCpus + 1];
+    Atomic<std::uint32_t> next_[Capacity];
+};
+
+/**
+ * A bounded ring of 64-bit values for each CPU, with many producers and one
+ * consumer per ring.
+ *
+ * try_push() commits a value to the ring for the current CPU.  With rseq, the
+ * slot write and tail update are a restartable sequence, so no atomic or
+ * locked instruction is needed.  Otherwise, producers reserve a slot with a
+ * compare and exchange, and publish in order.  Threads on CPUs at or beyond
+ * MaxCpus share one extra ring, which always uses the atomic protocol.
+ *
+ * consume() drains one ring.  Only one thread at a time may consume any
+ * given ring.
+ *
+ * @note  In the atomic protocol, a producer that dies between reserving and
+ * publishing a slot stalls that ring.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized ring is empty.
+ */
+template <std::size_t MaxCpus, std::uint32_t Capacity>
+class IpcPerCpuRing
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0);
+
+    struct Ring
+    {
+        percpu_detail::RingHeader header;
+        Atomic<std::uint64_t> slots[Capacity];
+    };
+    static_assert(offsetof(Ring, slots) == sizeof(percpu_detail::RingHeader));
+
+public:
+    static constexpr std::size_t max_cpus = MaxCpus;
+    static constexpr std::uint32_t capacity = Capacity;
+
+    /**
+     * The number of rings; ring max_cpus is shared by the CPUs without one.
+     */
+    static constexpr std::size_t rings = MaxCpus + 1;
+
+    /**
+     * Append @p value to the ring for the current CPU.
+     *
+     * @return  false if that ring is full.
+     */
+    bool try_push(std::uint64_t value) noexcept
+    {
+        return percpu_detail::push(
+            reinterpret_cast<unsigned char *>(rings_),
+            sizeof(Ring),
+            MaxCpus,
+            Capacity,
+            value);
+    }
+
+    /**
+     * Remove up to out.size() values, oldest first, from ring @p ring.
+     *
+     * @return  The number of values written to @p out.
+     *
+     * @pre  @p ring < rings, and no other thread is consuming it.
+     */
+    std::size_t consume(std::size_t ring, std::span<std::uint64_t> out) noexcept
+    {
+        return percpu_detail::consume(
+            reinterpret_cast<unsigned char *>(&rings_[ring]),
+            Capacity,
+            out);
+    }
+
+private:
+    Ring rings_[MaxCpus + 1];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcPerCpuCounter<>>);
+static_assert(std::is_trivially_constructible_v<IpcPerCpuFreelist<4, 4>>);
+static_assert(std::is_trivially_constructible_v<IpcPerCpuRing<4, 4>>);
+
+} // namespace wjh
+
+#endif // WJH_c4e9a2f70b1d4c58a6e3f8b2d5a7c091
@@ -0,0 +1,156 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "Prefault.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace wjh {
+
+namespace {
+
+[[noreturn]] void
+throw_errno(char const * what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+#if defined(__linux__)
+// These are in the kernel headers from Linux 5.14, but older C libraries do
+// not define them.
+    #if defined(MADV_POPULATE_READ)
+constexpr int populate_read = MADV_POPULATE_READ;
+    #else
+constexpr int populate_read = 22;
+    #endif
+    #if defined(MADV_POPULATE_WRITE)
+constexpr int populate_write = MADV_POPULATE_WRITE;
+    #else
+constexpr int populate_write = 23;
+    #endif
+#endif
+
+void
+touch(std::byte * begin, std::byte * end, PrefaultMode mode)
+{
+    auto const page = Segment::page_size();
+    for (auto p = begin; p < end; p += page) {
+        if (mode == PrefaultMode::write) {
+            // Adding zero dirties the page without changing the byte, even
+            // if another process writes it at the same time.
+            __atomic_fetch_add(
+                reinterpret_cast<unsigned char *>(p),
+                0u,
+                __ATOMIC_RELAXED);
+        } else {
+            __atomic_load_n(
+                reinterpret_cast<unsigned char *>(p),
+                __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Populate [begin, end), which is page aligned.
+//
+// @return  true if the kernel populated the pages; false if they were
+// touched.
+bool
+populate(std::byte * begin, std::byte * end, PrefaultMode mode)
+{
+#if defined(__linux__)
+    auto const advice =
+        mode == PrefaultMode::write ? populate_write : populate_read;
+    if (::madvise(begin, static_cast<std::size_t>(end - begin), advice) == 0) {
+        return true;
+    }
+    if (errno != EINVAL) {
+        throw_errno("madvise");
+    }
+#endif
+    touch(begin, end, mode);
+    return false;
+}
+
+} // anonymous namespace
+
+PrefaultReport
+prefault(
+    std::span<std::byte> range,
+    unsigned threads,
+    PrefaultMode mode,
+    bool lock)
+{
+    using Clock = std::chrono::steady_clock;
+    auto const start = Clock::now();
+    auto report = PrefaultReport{};
+    if (range.empty()) {
+        return report;
+    }
+
+    auto const page = Segment::page_size();
+    auto const first = reinterpret_cast<std::uintptr_t>(range.data());
+    auto const last = first + range.size();
+    auto const begin = reinterpret_cast<std::byte *>(first / page * page);
+    auto const end =
+        reinterpret_cast<std::byte *>((last + page - 1) / page * page);
+    report.pages = static_cast<std::size_t>(end - begin) / page;
+
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = static_cast<unsigned>(
+        std::min<std::size_t>(threads, report.pages));
+    report.threads = threads;
+
+    auto const share = (report.pages + threads - 1) / threads * page;
+    auto by_kernel = std::atomic<bool>(true);
+    std::vector<std::exception_ptr> errors(threads);
+    auto const work = [&](unsigned i) {
+        try {
+            auto const from = begin + i * share;
+            auto const to = std::min(end, from + share);
+            if (from < to && not populate(from, to, mode)) {
+                by_kernel.store(false, std::memory_order_relaxed);
+            }
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    {
+        std::vector<std::jthread> helpers;
+        for (unsigned i = 1; i < threads; ++i) {
+            helpers.emplace_back(work, i);
+        }
+        work(0);
+    }
+    for (auto const & error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    report.populated_by_kernel = by_kernel.load();
+
+    if (lock) {
+        if (::mlock(begin, static_cast<std::size_t>(end - begin)) != 0) {
+            throw_errno("mlock");
+        }
+        report.locked = true;
+    }
+
+    report.elapsed = Clock::now() - start;
+    return report;
+}
+
+} // namespace wjh
@@ -0,0 +1,107 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_5d2a8f6c1e9b47d3b6a0e4c7f1d8b235
+#define WJH_5d2a8f6c1e9b47d3b6a0e4c7f1d8b235
+
+#include "GrowableSegment.hpp"
+#include "Segment.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+
+namespace wjh {
+
+/**
+ * How prefault() populates pages.
+ */
+enum class PrefaultMode
+{
+    /// Map the pages readable.  A later write to a page may still fault.
+    read,
+    /// Map the pages writable, so that no later access faults.
+    write
+};
+
+/**
+ * The result of prefault().
+ */
+struct PrefaultReport
+{
+    /// The number of pages populated.
+    std::size_t pages = 0;
+    /// The number of threads that did the work.
+    unsigned threads = 0;
+    /// true if the kernel populated the pages (MADV_POPULATE_READ/WRITE);
+    /// false if they were touched one at a time.
+    bool populated_by_kernel = false;
+    /// true if the pages were locked into memory.
+    bool locked = false;
+    std::chrono::nanoseconds elapsed{};
+};
+
+/**
+ * Fault in every page of @p range now, so that the first accesses to it
+ * later do not.
+ *
+ * The range is split across @p threads threads.  Each one asks the kernel to
+ * populate its share with MADV_POPULATE_READ or MADV_POPULATE_WRITE, and if
+ * the kernel is older than Linux 5.14, touches each page instead.  Write
+ * touches are atomic adds of zero, so they are safe while other processes
+ * are using the memory.
+ *
+ * @param threads  The number of threads to use; zero means one per CPU.
+ * @param lock  Also mlock the range, so the pages stay resident.
+ *
+ * @pre  @p range is part of a mapping that is readable, and writable if
+ * @p mode is PrefaultMode::write.
+ *
+ * @throw  std::system_error if populating or locking the pages fails.
+ */
+PrefaultReport prefault(
+    std::span<std::byte> range,
+    unsigned threads = 0,
+    PrefaultMode mode = PrefaultMode::write,
+    bool lock = false);
+
+/**
+ * Fault in every page of @p segment.
+ */
+inline PrefaultReport
+prefault(
+    Segment & segment,
+    unsigned threads = 0,
+    PrefaultMode mode = PrefaultMode::write,
+    bool lock = false)
+{
+    return prefault(
+        std::span(segment.data(), segment.size()),
+        threads,
+        mode,
+        lock);
+}
+
+/**
+ * Fault in every page of @p segment that is mapped into this process.
+ */
+inline PrefaultReport
+prefault(
+    GrowableSegment & segment,
+    unsigned threads = 0,
+    PrefaultMode mode = PrefaultMode::write,
+    bool lock = false)
+{
+    return prefault(
+        std::span(segment.data(), segment.size()),
+        threads,
+        mode,
+        lock);
+}
+
+} // namespace wjh
+
+#endif // WJH_5d2a8f6c1e9b47d3b6a0e4c7f1d8b235
@@ -263,6 +263,14 @@ start_time() const
     }
 }
 
+bool
+ProcessId::
+alive() const
+{
+    auto const p = maybe(pid());
+    return p && *p == *this;
+}
+
 ProcessId
 ProcessId::
 current()
@@ -274,4 +282,11 @@ current()
     return id;
 }
 
+::time_t
+ProcessId::
+boot_time()
+{
+    return wjh::boot_time;
+}
+
 } // namespace wjh
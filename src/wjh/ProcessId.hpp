@@ -102,6 +102,15 @@ struct ProcessId
      */
     ::timeval start_time() const;
 
+    /**
+     * Return true if the process identified by this ProcessId is running.
+     *
+     * @note  As with maybe(), a process that the caller does not have
+     * permission to inspect is reported as not running.  A process whose pid
+     * has been reused by a new process is also reported as not running.
+     */
+    bool alive() const;
+
     /**
      * Get a ProcessId for a specific running process.
      *
@@ -124,6 +133,12 @@ struct ProcessId
      */
     static ProcessId current();
 
+    /**
+     * The time the machine started, in seconds since the epoch, which
+     * changes only when the machine restarts.
+     */
+    static ::time_t boot_time();
+
     auto operator <=> (ProcessId const &) const = default;
 
 private:
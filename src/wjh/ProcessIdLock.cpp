@@ -40,6 +40,20 @@ unlock()
     assert(released);
 }
 
+ProcessId
+ProcessIdLock::
+owner() const
+{
+    return pid_.load();
+}
+
+bool
+ProcessIdLock::
+force_unlock(ProcessId owner)
+{
+    return owner != PID::null() && exchange(owner, PID::null());
+}
+
 bool
 ProcessIdLock::
 exchange(ProcessId & expected, ProcessId const & desired)
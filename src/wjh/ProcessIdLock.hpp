@@ -58,6 +58,22 @@ struct ProcessIdLock
      */
     void unlock();
 
+    /**
+     * The process that holds the lock, or ProcessId::null() if unlocked.
+     */
+    ProcessId owner() const;
+
+    /**
+     * Release the lock, if it is held by @p owner.
+     *
+     * This is for recovery sweeps, which release the locks of processes known
+     * to be dead, so that the first try_lock() after a restart does not have
+     * to discover that.
+     *
+     * @return  true if the lock was held by @p owner, and has been released.
+     */
+    bool force_unlock(ProcessId owner);
+
 private:
     bool exchange(ProcessId & expected, ProcessId const & desired);
     bool try_lock_impl(ProcessId const & me);
@@ -0,0 +1,149 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "Segment.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace wjh {
+
+namespace {
+
+[[noreturn]] void
+throw_errno(char const * what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+int
+open_file(std::filesystem::path const & path, int flags)
+{
+    int fd = ::open(path.c_str(), flags | O_CLOEXEC, 0666);
+    if (fd == -1) {
+        throw_errno("open");
+    }
+    return fd;
+}
+
+std::size_t
+file_size(int fd)
+{
+    struct ::stat st;
+    if (::fstat(fd, &st) != 0) {
+        throw_errno("fstat");
+    }
+    return static_cast<std::size_t>(st.st_size);
+}
+
+} // anonymous namespace
+
+Segment::
+Segment(std::filesystem::path path, std::size_t size)
+: path_(std::move(path))
+, fd_(open_file(path_, O_RDWR | O_CREAT))
+{
+    try {
+        if (file_size(fd_) < size) {
+            if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+                throw_errno("ftruncate");
+            }
+        }
+        map(file_size(fd_));
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+Segment::
+Segment(std::filesystem::path path)
+: path_(std::move(path))
+, fd_(open_file(path_, O_RDWR))
+{
+    try {
+        map(file_size(fd_));
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+Segment::
+~Segment()
+{
+    if (data_) {
+        ::munmap(data_, size_);
+    }
+    ::close(fd_);
+}
+
+void
+Segment::
+map(std::size_t size)
+{
+    if (size == 0) {
+        throw std::system_error(
+            std::make_error_code(std::errc::invalid_argument),
+            "empty segment");
+    }
+    void * addr = ::mmap(
+        nullptr,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        fd_,
+        0);
+    if (addr == MAP_FAILED) {
+        throw_errno("mmap");
+    }
+    data_ = static_cast<std::byte *>(addr);
+    size_ = size;
+}
+
+void
+Segment::
+sync(std::size_t offset, std::size_t length) const
+{
+    auto const page = page_size();
+    auto const begin = offset / page * page;
+    auto const end = std::min(size_, offset + length);
+    if (begin >= end) {
+        return;
+    }
+    if (::msync(data_ + begin, end - begin, MS_SYNC) != 0) {
+        throw_errno("msync");
+    }
+}
+
+void
+Segment::
+sync() const
+{
+    if (::msync(data_, size_, MS_SYNC) != 0) {
+        throw_errno("msync");
+    }
+    if (::fsync(fd_) != 0) {
+        throw_errno("fsync");
+    }
+}
+
+std::size_t
+Segment::
+page_size() noexcept
+{
+    static auto const size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+} // namespace wjh
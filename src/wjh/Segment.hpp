@@ -0,0 +1,83 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_7b3e1d9a4c2f4a8e9d6b0f5c8a1e3d27
+#define WJH_7b3e1d9a4c2f4a8e9d6b0f5c8a1e3d27
+
+#include <cstddef>
+#include <filesystem>
+
+namespace wjh {
+
+/**
+ * A file, mapped shared into the address space of the calling process.
+ *
+ * Every process that maps the same file sees the same bytes, so a Segment is
+ * the usual home for the implicit lifetime types in this library.  A newly
+ * created (or extended) file reads as zeros, which is the initial state of
+ * all of those types.
+ *
+ * A Segment is a process-local handle; it is neither copyable nor movable.
+ */
+class Segment
+{
+public:
+    /**
+     * Map the file at @p path, creating it if it does not exist, and
+     * extending it with zeros to at least @p size bytes.
+     *
+     * @throw  std::system_error if the file can't be opened, sized, or mapped.
+     */
+    Segment(std::filesystem::path path, std::size_t size);
+
+    /**
+     * Map the whole of the existing file at @p path.
+     *
+     * @throw  std::system_error if the file can't be opened or mapped.
+     */
+    explicit Segment(std::filesystem::path path);
+
+    ~Segment();
+
+    void operator = (Segment &&) = delete;
+
+    std::byte * data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+    int fd() const noexcept { return fd_; }
+    std::filesystem::path const & path() const noexcept { return path_; }
+
+    /**
+     * Write the pages covering [offset, offset + length) back to the file,
+     * and wait for the writes to complete.
+     *
+     * @throw  std::system_error on failure.
+     */
+    void sync(std::size_t offset, std::size_t length) const;
+
+    /**
+     * Write the whole mapping, and the file metadata, back to the file.
+     *
+     * @throw  std::system_error on failure.
+     */
+    void sync() const;
+
+    /**
+     * The size of a page, which is the granularity of mapping and sync.
+     */
+    static std::size_t page_size() noexcept;
+
+private:
+    void map(std::size_t size);
+
+    std::filesystem::path path_;
+    int fd_ = -1;
+    std::byte * data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+} // namespace wjh
+
+#endif // WJH_7b3e1d9a4c2f4a8e9d6b0f5c8a1e3d27
@@ -0,0 +1,172 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "SegmentRecovery.hpp"
+
+#include <map>
+#include <stdexcept>
+
+namespace wjh {
+
+namespace recovery_detail {
+
+bool
+add(
+    Atomic<std::uint32_t> & size,
+    std::span<Entry> entries,
+    Segment const & segment,
+    void const * word,
+    RecoveryKind kind,
+    std::uint32_t tag,
+    RecoveryAction action)
+{
+    auto const base = reinterpret_cast<std::uintptr_t>(segment.data());
+    auto const address = reinterpret_cast<std::uintptr_t>(word);
+    if (address < base || address >= base + segment.size()) {
+        throw std::out_of_range("recovery word is not in the segment");
+    }
+    auto const offset = address - base;
+
+    auto const n = std::min<std::size_t>(size.load(), entries.size());
+    for (auto const & entry : entries.first(n)) {
+        if (entry.offset == offset &&
+            entry.kind.load(std::memory_order_acquire) == kind)
+        {
+            return true;
+        }
+    }
+
+    auto const index = size.fetch_add(1u);
+    if (index >= entries.size()) {
+        size.fetch_sub(1u);
+        return false;
+    }
+    auto & entry = entries[index];
+    entry.offset = offset;
+    entry.tag = tag;
+    entry.action = action;
+    entry.kind.store(kind, std::memory_order_release);
+    return true;
+}
+
+} // namespace recovery_detail
+
+namespace {
+
+template <typename T>
+T &
+word_at(Segment & segment, std::uint64_t offset)
+{
+    return *reinterpret_cast<T *>(segment.data() + offset);
+}
+
+ProcessId
+owner_of(Segment & segment, recovery_detail::Entry const & entry)
+{
+    auto const offset = entry.offset;
+    auto const kind = entry.kind.load(std::memory_order_acquire);
+    if (kind == RecoveryKind::lock) {
+        return word_at<ProcessIdLock>(segment, offset).owner();
+    } else if (kind == RecoveryKind::waitable_lock) {
+        return word_at<WaitableProcessIdLock>(segment, offset).owner();
+    } else if (kind == RecoveryKind::owner) {
+        return word_at<Atomic<ProcessId>>(segment, offset).load();
+    }
+    return ProcessId::null();
+}
+
+bool
+release(
+    Segment & segment,
+    recovery_detail::Entry const & entry,
+    ProcessId owner)
+{
+    auto const offset = entry.offset;
+    auto const kind = entry.kind.load(std::memory_order_acquire);
+    if (kind == RecoveryKind::lock) {
+        return word_at<ProcessIdLock>(segment, offset).force_unlock(owner);
+    } else if (kind == RecoveryKind::waitable_lock) {
+        return word_at<WaitableProcessIdLock>(segment, offset)
+            .force_unlock(owner);
+    } else if (kind == RecoveryKind::owner) {
+        return word_at<Atomic<ProcessId>>(segment, offset)
+            .compare_exchange_strong(owner, ProcessId::null());
+    }
+    return false;
+}
+
+// The size of the word an entry of @p kind describes, or zero if the kind
+// is not one we know.
+constexpr std::size_t
+word_size(RecoveryKind kind)
+{
+    if (kind == RecoveryKind::lock) {
+        return sizeof(ProcessIdLock);
+    } else if (kind == RecoveryKind::waitable_lock) {
+        return sizeof(WaitableProcessIdLock);
+    } else if (kind == RecoveryKind::owner) {
+        return sizeof(Atomic<ProcessId>);
+    }
+    return 0;
+}
+
+} // anonymous namespace
+
+RecoveryReport
+recover_segment(
+    Segment & segment,
+    std::span<recovery_detail::Entry const> entries)
+{
+    using Clock = std::chrono::steady_clock;
+    auto const start = Clock::now();
+    auto report = RecoveryReport{};
+
+    // Gather the owners first, so each distinct one is probed only once.
+    std::vector<ProcessId> owners(entries.size(), ProcessId::null());
+    std::map<ProcessId, bool> alive;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        auto const & entry = entries[i];
+        auto const size =
+            word_size(entry.kind.load(std::memory_order_acquire));
+        if (size == 0 || size > segment.size() ||
+            entry.offset > segment.size() - size)
+        {
+            continue;
+        }
+        ++report.scanned;
+        owners[i] = owner_of(segment, entry);
+        if (owners[i] != ProcessId::null()) {
+            alive.emplace(owners[i], true);
+        }
+    }
+
+    auto const me = ProcessId::current();
+    for (auto & [owner, is_alive] : alive) {
+        is_alive = owner == me || owner.alive();
+        report.dead_owners += not is_alive;
+    }
+    report.owners_checked = alive.size();
+
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        auto const owner = owners[i];
+        if (owner == ProcessId::null() || alive[owner]) {
+            continue;
+        }
+        auto const & entry = entries[i];
+        report.recovered.push_back(RecoveredWord{
+            entry.offset,
+            entry.kind.load(std::memory_order_relaxed),
+            entry.tag,
+            owner,
+            entry.action == RecoveryAction::release &&
+                release(segment, entry, owner)});
+    }
+
+    report.elapsed = Clock::now() - start;
+    return report;
+}
+
+} // namespace wjh
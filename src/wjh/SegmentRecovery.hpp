@@ -0,0 +1,219 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_3f8a5c1e7d2b4e96a0c4b8f2e6d1a957
+#define WJH_3f8a5c1e7d2b4e96a0c4b8f2e6d1a957
+
+#include "Atomic.hpp"
+#include "ProcessId.hpp"
+#include "ProcessIdLock.hpp"
+#include "Segment.hpp"
+#include "WaitableProcessIdLock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace wjh {
+
+/**
+ * The kinds of words a recovery table can hold.
+ */
+enum class RecoveryKind : std::uint32_t
+{
+    /// A ProcessIdLock.
+    lock = 1,
+    /// A WaitableProcessIdLock.
+    waitable_lock,
+    /// An Atomic<ProcessId> that records which process owns something.
+    owner
+};
+
+/**
+ * What recover_segment() does with a word whose owner is dead.
+ */
+enum class RecoveryAction : std::uint32_t
+{
+    /// Release the lock, or reset the owner to ProcessId::null().
+    release,
+    /// Leave the word alone, and only report it, so the application can
+    /// repair whatever the dead owner was in the middle of changing.
+    report
+};
+
+namespace recovery_detail {
+
+struct Entry
+{
+    std::uint64_t offset;
+    std::uint32_t tag;
+    RecoveryAction action;
+    // Zero until the entry is completely written.
+    Atomic<RecoveryKind> kind;
+};
+
+bool add(
+    Atomic<std::uint32_t> & size,
+    std::span<Entry> entries,
+    Segment const & segment,
+    void const * word,
+    RecoveryKind kind,
+    std::uint32_t tag,
+    RecoveryAction action);
+
+} // namespace recovery_detail
+
+/**
+ * A table of the lock and ownership words in a segment, stored in the segment
+ * itself, so that a process that maps it after a crash can find every word
+ * that a dead process may still hold.
+ *
+ * Entries are offsets from the start of the segment, so they are valid in
+ * every process, wherever it maps the segment.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized table is empty.
+ */
+template <std::size_t Capacity>
+class IpcRecoveryTable
+{
+public:
+    static constexpr std::size_t capacity = Capacity;
+
+    /**
+     * Register @p word, which lives in @p segment.
+     *
+     * Registering a word that is already in the table does nothing, so a
+     * process can register its words every time it starts.
+     *
+     * @param tag  An application value that is reported with the word.
+     *
+     * @return  false if the table is full.
+     *
+     * @throw  std::out_of_range if @p word is not inside @p segment.
+     */
+    bool add(
+        Segment const & segment,
+        ProcessIdLock const & word,
+        std::uint32_t tag = 0,
+        RecoveryAction action = RecoveryAction::release)
+    {
+        return add(segment, &word, RecoveryKind::lock, tag, action);
+    }
+
+    bool add(
+        Segment const & segment,
+        WaitableProcessIdLock const & word,
+        std::uint32_t tag = 0,
+        RecoveryAction action = RecoveryAction::release)
+    {
+        return add(segment, &word, RecoveryKind::waitable_lock, tag, action);
+    }
+
+    bool add(
+        Segment const & segment,
+        Atomic<ProcessId> const & word,
+        std::uint32_t tag = 0,
+        RecoveryAction action = RecoveryAction::release)
+    {
+        return add(segment, &word, RecoveryKind::owner, tag, action);
+    }
+
+    /**
+     * The registered entries.
+     */
+    std::span<recovery_detail::Entry const> entries() const noexcept
+    {
+        return std::span(entries_).first(
+            std::min<std::size_t>(size_.load(), Capacity));
+    }
+
+private:
+    bool add(
+        Segment const & segment,
+        void const * word,
+        RecoveryKind kind,
+        std::uint32_t tag,
+        RecoveryAction action)
+    {
+        return recovery_detail::add(
+            size_,
+            entries_,
+            segment,
+            word,
+            kind,
+            tag,
+            action);
+    }
+
+    Atomic<std::uint32_t> size_;
+    recovery_detail::Entry entries_[Capacity];
+};
+
+static_assert(std::is_trivially_constructible_v<IpcRecoveryTable<4>>);
+
+/**
+ * A word whose owner was found to be dead.
+ */
+struct RecoveredWord
+{
+    std::uint64_t offset;
+    RecoveryKind kind;
+    std::uint32_t tag;
+    ProcessId owner;
+    /// true if the word was released; false if it was only reported, or if
+    /// someone else released it first.
+    bool released;
+};
+
+/**
+ * The result of recover_segment().
+ */
+struct RecoveryReport
+{
+    /// The number of registered words that were examined.
+    std::size_t scanned = 0;
+    /// The number of distinct owners whose liveness was checked.
+    std::size_t owners_checked = 0;
+    /// The number of those owners that were dead.
+    std::size_t dead_owners = 0;
+    /// The words held by dead owners.
+    std::vector<RecoveredWord> recovered;
+    std::chrono::nanoseconds elapsed{};
+};
+
+/**
+ * Sweep the words in @p entries, which live in @p segment, and release (or
+ * report) those held by dead processes.
+ *
+ * Each distinct owner is checked for liveness once, no matter how many words
+ * it holds, so a restart pays one probe per process rather than one per
+ * stale word, and pays it up front instead of under live traffic.
+ *
+ * Words are released with a compare and exchange against the dead owner, so
+ * the sweep is safe to run while other processes use the segment.
+ */
+RecoveryReport recover_segment(
+    Segment & segment,
+    std::span<recovery_detail::Entry const> entries);
+
+/**
+ * Sweep the words registered in @p table.
+ */
+template <std::size_t Capacity>
+RecoveryReport
+recover_segment(Segment & segment, IpcRecoveryTable<Capacity> const & table)
+{
+    return recover_segment(segment, table.entries());
+}
+
+} // namespace wjh
+
+#endif // WJH_3f8a5c1e7d2b4e96a0c4b8f2e6d1a957
@@ -0,0 +1,67 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "WaitableProcessIdLock.hpp"
+
+#include "AtomicWait.hpp"
+
+namespace wjh {
+
+bool
+WaitableProcessIdLock::
+try_lock()
+{
+    return lock_.try_lock();
+}
+
+void
+WaitableProcessIdLock::
+lock()
+{
+    while (not lock_.try_lock()) {
+        // Register before sampling the word, so that an unlock that we miss
+        // is guaranteed to see us and issue a wakeup.
+        add_waiter();
+        auto const seq = seq_.load();
+        if (lock_.try_lock()) {
+            remove_waiter();
+            return;
+        }
+        atomic_wait(seq_, seq, owner_check_interval);
+        remove_waiter();
+    }
+}
+
+void
+WaitableProcessIdLock::
+unlock()
+{
+    lock_.unlock();
+    wake();
+}
+
+bool
+WaitableProcessIdLock::
+force_unlock(ProcessId owner)
+{
+    if (not lock_.force_unlock(owner)) {
+        return false;
+    }
+    wake();
+    return true;
+}
+
+void
+WaitableProcessIdLock::
+wake()
+{
+    seq_.fetch_add(1u);
+    if (waiters_.load() != 0u) {
+        atomic_notify_all(seq_);
+    }
+}
+
+} // namespace wjh
@@ -0,0 +1,111 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_8e2c6f1a9b3d4e7f8a0c5d2b1e4f7a96
+#define WJH_8e2c6f1a9b3d4e7f8a0c5d2b1e4f7a96
+
+#include "Atomic.hpp"
+#include "ProcessIdLock.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+namespace wjh {
+
+/**
+ * A ProcessIdLock that waiters can sleep on, instead of spinning.
+ *
+ * Every unlock bumps a 32-bit release word, and wakes any thread blocked on
+ * it.  Blocking lock() sleeps on that word, and asynchronous waiters (e.g.,
+ * AsyncWaiter) can submit their own waits on it.
+ *
+ * If the owner dies while holding the lock, nobody bumps the release word, so
+ * waiters never sleep longer than owner_check_interval before re-checking.
+ *
+ * This is an implicit lifetime type, and can be placed in shared memory and
+ * mmap files.  A zero-initialized lock is unlocked.
+ */
+struct WaitableProcessIdLock
+{
+    /**
+     * The longest a waiter sleeps before checking whether the owner has died.
+     */
+    static constexpr auto owner_check_interval = std::chrono::milliseconds(50);
+
+    /**
+     * Try to obtain the lock.
+     *
+     * @return  true if the calling thread obtained the lock; false otherwise.
+     *
+     * @pre  Calling thread does not already hold the lock.
+     */
+    bool try_lock();
+
+    /**
+     * Obtain the lock, sleeping until the lock has been obtained.
+     *
+     * @pre  Calling thread does not already hold the lock.
+     */
+    void lock();
+
+    /**
+     * Unlocks the lock, and wakes any waiters.
+     *
+     * @pre  Calling thread holds the lock.
+     */
+    void unlock();
+
+    /**
+     * The process that holds the lock, or ProcessId::null() if unlocked.
+     */
+    ProcessId owner() const { return lock_.owner(); }
+
+    /**
+     * Release the lock, if it is held by @p owner, and wake any waiters.
+     *
+     * @return  true if the lock was held by @p owner, and has been released.
+     *
+     * @see  ProcessIdLock::force_unlock
+     */
+    bool force_unlock(ProcessId owner);
+
+    /**
+     * The word that changes every time the lock is released.
+     *
+     * To wait for the lock without blocking a thread, load this word, then
+     * call try_lock(), and if that fails, wait for the word to change from the
+     * loaded value.  Asynchronous waiters should be counted with
+     * add_waiter()/remove_waiter(), so unlock() knows to issue a wakeup.
+     */
+    Atomic<std::uint32_t> const & release_word() const noexcept
+    {
+        return seq_;
+    }
+
+    /**
+     * Register an asynchronous waiter.
+     */
+    void add_waiter() noexcept { waiters_.fetch_add(1u); }
+
+    /**
+     * Deregister an asynchronous waiter.
+     */
+    void remove_waiter() noexcept { waiters_.fetch_sub(1u); }
+
+private:
+    void wake();
+
+    ProcessIdLock lock_;
+    Atomic<std::uint32_t> seq_;
+    Atomic<std::uint32_t> waiters_;
+};
+
+static_assert(std::is_trivially_constructible_v<WaitableProcessIdLock>);
+
+} // namespace wjh
+
+#endif // WJH_8e2c6f1a9b3d4e7f8a0c5d2b1e4f7a96
@@ -0,0 +1,200 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+// Forks a set of workers that run tasks of uneven cost.  Most of the root
+// tasks start in the first worker, and each task may spawn children in the
+// worker that runs it, so the load is badly skewed unless it is spread by
+// stealing.  The same work is run once with stealing and once without,
+// and the elapsed time and per-worker task counts of each are reported.
+//
+// usage: WorkStealing_bench [workers [roots]]
+// ======================================================================
+#include "wjh/IpcWorkStealingDeque.hpp"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+using wjh::Atomic;
+
+constexpr int max_workers = 64;
+
+// A task is its depth in the spawn tree, in the high byte, and a seed.
+using Task = std::uint32_t;
+using Deque = wjh::IpcWorkStealingDeque<Task, 4096, 1 << 16>;
+
+struct Worker
+{
+    Deque deque;
+    Atomic<std::uint64_t> ran;
+    Atomic<std::uint64_t> stolen;
+};
+
+struct Shared
+{
+    Atomic<std::uint64_t> outstanding;
+    Atomic<std::uint32_t> ready;
+    Worker workers[max_workers];
+};
+
+std::uint64_t volatile sink;
+
+// Spin for a cost that is usually small, but occasionally large.
+void
+run(Task task)
+{
+    auto x = std::uint64_t(task) * 0x9e3779b97f4a7c15u;
+    auto const cost = (task & 0xff) < 8 ? 20000u : 500u;
+    for (unsigned i = 0; i < cost; ++i) {
+        x ^= x >> 13;
+        x *= 0xff51afd7ed558ccdu;
+    }
+    sink = x;
+}
+
+void
+work(Shared & shared, int self, int nworkers, bool steal)
+{
+    auto & me = shared.workers[self];
+    shared.ready.fetch_add(1u);
+    while (shared.ready.load() < unsigned(nworkers)) {
+    }
+
+    auto rng = std::minstd_rand(unsigned(self) + 1u);
+    auto pick = std::uniform_int_distribution<int>(0, nworkers - 1);
+    while (shared.outstanding.load(std::memory_order_acquire) != 0) {
+        auto task = me.deque.pop();
+        if (not task && steal) {
+            auto const victim = pick(rng);
+            if (victim != self) {
+                task = shared.workers[victim].deque.steal();
+                if (task) {
+                    me.stolen.fetch_add(1u, std::memory_order_relaxed);
+                }
+            }
+        }
+        if (not task) {
+            continue;
+        }
+
+        run(*task);
+        me.ran.fetch_add(1u, std::memory_order_relaxed);
+
+        // Shallow tasks spawn children in the worker that runs them.
+        auto const depth = *task >> 24;
+        if (depth < 3) {
+            auto const children = std::uint32_t(rng() % 4);
+            shared.outstanding.fetch_add(children);
+            for (std::uint32_t i = 0; i < children; ++i) {
+                auto const seed = std::uint32_t(rng()) & 0xffffff;
+                if (not me.deque.push(((depth + 1) << 24) | seed)) {
+                    run(seed);
+                    shared.outstanding.fetch_sub(1u);
+                }
+            }
+        }
+        shared.outstanding.fetch_sub(1u, std::memory_order_release);
+    }
+    std::_Exit(0);
+}
+
+void
+measure(int nworkers, std::uint32_t nroots, bool steal)
+{
+    auto * shared = static_cast<Shared *>(::mmap(
+        nullptr,
+        sizeof(Shared),
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS,
+        -1,
+        0));
+    if (shared == MAP_FAILED) {
+        std::perror("mmap");
+        std::exit(1);
+    }
+
+    // Seed the roots before forking: about 90% go to the first worker, and
+    // the rest are spread over the others.
+    auto rng = std::minstd_rand(42);
+    auto roots = std::vector<std::vector<Task>>(std::size_t(nworkers));
+    for (std::uint32_t i = 0; i < nroots; ++i) {
+        auto const w = nworkers == 1 || rng() % 10 != 0
+            ? 0
+            : 1 + int(rng() % unsigned(nworkers - 1));
+        roots[std::size_t(w)].push_back(std::uint32_t(rng()) & 0xffffff);
+    }
+    shared->outstanding.store(nroots);
+
+    auto const start = std::chrono::steady_clock::now();
+    std::vector<pid_t> pids;
+    for (int w = 0; w < nworkers; ++w) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            auto & deque = shared->workers[w].deque;
+            deque.claim();
+            for (auto task : roots[std::size_t(w)]) {
+                if (not deque.push(task)) {
+                    std::fprintf(stderr, "too many roots\n");
+                    std::_Exit(1);
+                }
+            }
+            work(*shared, w, nworkers, steal);
+        }
+        pids.push_back(pid);
+    }
+    for (auto pid : pids) {
+        ::waitpid(pid, nullptr, 0);
+    }
+    auto const elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start);
+
+    std::uint64_t total = 0;
+    for (int w = 0; w < nworkers; ++w) {
+        total += shared->workers[w].ran.load();
+    }
+    std::printf(
+        "%-12s %10.1f ms %10llu tasks %12.0f tasks/s\n",
+        steal ? "stealing" : "no stealing",
+        elapsed.count(),
+        static_cast<unsigned long long>(total),
+        double(total) * 1000.0 / elapsed.count());
+    for (int w = 0; w < nworkers; ++w) {
+        std::printf(
+            "    worker %2d: %10llu ran %10llu stolen\n",
+            w,
+            static_cast<unsigned long long>(shared->workers[w].ran.load()),
+            static_cast<unsigned long long>(
+                shared->workers[w].stolen.load()));
+    }
+    ::munmap(shared, sizeof(Shared));
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char * argv[])
+{
+    auto const nworkers = argc > 1 ? std::atoi(argv[1]) : 4;
+    auto const nroots =
+        argc > 2 ? std::uint32_t(std::atol(argv[2])) : std::uint32_t(2000);
+    if (nworkers < 1 || nworkers > max_workers) {
+        std::fprintf(stderr, "workers must be in [1, %d]\n", max_workers);
+        return 1;
+    }
+    std::printf("%d workers, %u root tasks\n", nworkers, nroots);
+    measure(nworkers, nroots, false);
+    measure(nworkers, nroots, true);
+}
@@ -0,0 +1,136 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "WatchThread.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace wjh::watch_detail {
+
+WatchThread::
+WatchThread(std::function<void()> on_ready, IpcDoorbell * doorbell)
+: on_ready_(std::move(on_ready))
+, doorbell_(doorbell)
+, thread_([this] { run(); })
+{ }
+
+WatchThread::
+~WatchThread()
+{
+    {
+        auto guard = std::lock_guard(mutex_);
+        stop_ = true;
+    }
+    kick();
+    thread_.join();
+    for (auto & watch : watches_) {
+        watch.finish();
+    }
+}
+
+bool
+WatchThread::
+add(Watch watch)
+{
+    bool done = false;
+    {
+        auto guard = std::lock_guard(mutex_);
+        done = watch.done();
+        if (done) {
+            watch.finish();
+            ready_.push_back(watch.tag);
+            announce_ = true;
+        } else {
+            watches_.push_back(watch);
+        }
+    }
+    kick();
+    return done;
+}
+
+std::size_t
+WatchThread::
+take(std::span<std::uint64_t> out)
+{
+    auto guard = std::lock_guard(mutex_);
+    auto const n = std::min(out.size(), ready_.size());
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = ready_.front();
+        ready_.pop_front();
+    }
+    return n;
+}
+
+std::size_t
+WatchThread::
+ready() const
+{
+    auto guard = std::lock_guard(mutex_);
+    return ready_.size();
+}
+
+std::size_t
+WatchThread::
+pending() const
+{
+    auto guard = std::lock_guard(mutex_);
+    return watches_.size() + ready_.size();
+}
+
+void
+WatchThread::
+kick()
+{
+    control_.fetch_add(1u);
+    notify(control_, doorbell_);
+}
+
+void
+WatchThread::
+run()
+{
+    std::vector<AtomicWaitTarget> targets;
+    for (;;) {
+        targets.clear();
+        targets.push_back(AtomicWaitTarget{&control_, control_.load()});
+        bool announce = false;
+        {
+            auto guard = std::lock_guard(mutex_);
+            if (stop_) {
+                return;
+            }
+            auto const done = std::partition(
+                watches_.begin(),
+                watches_.end(),
+                [](Watch & watch) { return not watch.done(); });
+            for (auto i = done; i != watches_.end(); ++i) {
+                i->finish();
+                ready_.push_back(i->tag);
+                announce_ = true;
+            }
+            watches_.erase(done, watches_.end());
+            announce = std::exchange(announce_, false);
+            for (auto const & watch : watches_) {
+                targets.push_back(
+                    AtomicWaitTarget{watch.word, watch.expected});
+            }
+        }
+
+        // Announce outside the lock, because the owner may well add watches
+        // right away.
+        if (announce) {
+            on_ready_();
+            continue;
+        }
+        wait_any(
+            targets,
+            WaitableProcessIdLock::owner_check_interval,
+            doorbell_);
+    }
+}
+
+} // namespace wjh::watch_detail
@@ -0,0 +1,127 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_6f16527452f24ab692ba354b0a55696e
+#define WJH_6f16527452f24ab692ba354b0a55696e
+
+#include "../Atomic.hpp"
+#include "../AtomicWait.hpp"
+#include "../WaitableProcessIdLock.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace wjh::watch_detail {
+
+// An outstanding wait, for a word to change, or for a lock, tagged with
+// whatever identifies it to its owner.
+struct Watch
+{
+    Atomic<std::uint32_t> const * word;
+    std::uint32_t expected;
+    WaitableProcessIdLock * lock;
+    std::uint64_t tag;
+
+    // For a lock, sample the release word and try to take the lock.  If that
+    // fails, the watch waits for the release word to change from the sample.
+    bool try_lock()
+    {
+        expected = word->load();
+        return lock->try_lock();
+    }
+
+    bool done() { return lock ? try_lock() : word->load() != expected; }
+
+    // A lock watch counts as a waiter from when it is made until it is done
+    // or abandoned.
+    void finish() noexcept
+    {
+        if (lock) {
+            lock->remove_waiter();
+        }
+    }
+};
+
+inline Watch
+watch_word(
+    Atomic<std::uint32_t> const & word,
+    std::uint32_t expected,
+    std::uint64_t tag) noexcept
+{
+    return Watch{&word, expected, nullptr, tag};
+}
+
+inline Watch
+watch_lock(WaitableProcessIdLock & lock, std::uint64_t tag) noexcept
+{
+    lock.add_waiter();
+    return Watch{&lock.release_word(), 0u, &lock, tag};
+}
+
+/**
+ * A helper thread that waits on every outstanding watch at once, with
+ * wait_any(), and queues the tags of those that are done.
+ *
+ * Whenever tags have been queued, the helper thread calls the on_ready
+ * callback, outside of any lock, and the owner collects them with take().
+ * Destroying a WatchThread abandons the outstanding watches.
+ */
+class WatchThread
+{
+public:
+    WatchThread(std::function<void()> on_ready, IpcDoorbell * doorbell);
+    ~WatchThread();
+
+    void operator = (WatchThread &&) = delete;
+
+    /**
+     * Add @p watch, which is queued at once if it is already done.
+     *
+     * @return  true if it was already done.
+     */
+    bool add(Watch watch);
+
+    /**
+     * Move up to out.size() queued tags to @p out.
+     *
+     * @return  The number of tags moved.
+     */
+    std::size_t take(std::span<std::uint64_t> out);
+
+    /**
+     * The number of queued tags.
+     */
+    std::size_t ready() const;
+
+    /**
+     * The number of watches not yet taken, whether or not they are done.
+     */
+    std::size_t pending() const;
+
+private:
+    void kick();
+    void run();
+
+    std::function<void()> on_ready_;
+    IpcDoorbell * doorbell_;
+    mutable std::mutex mutex_;
+    std::vector<Watch> watches_;
+    std::deque<std::uint64_t> ready_;
+    bool announce_ = false;
+    Atomic<std::uint32_t> control_{0u};
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+} // namespace wjh::watch_detail
+
+#endif // WJH_6f16527452f24ab692ba354b0a55696e
@@ -0,0 +1,262 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/AsyncWaiter.hpp"
+
+#include "wjh/AtomicWait.hpp"
+
+#include <sys/wait.h>
+
+#include <array>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+using wjh::AsyncWaiter;
+using wjh::Atomic;
+using wjh::WaitableProcessIdLock;
+
+TEST_SUITE("AsyncWaiter")
+{
+    struct SharedData
+    {
+        std::array<Atomic<std::uint32_t>, 4> words;
+        WaitableProcessIdLock lock;
+        Atomic<std::uint32_t> counter;
+    };
+
+    using Shared = wjh::testing::Shared<SharedData>;
+
+    // Run @p cases, which has subcases of its own, under a subcase for each
+    // backend; a subcase is entered only once per run, so a loop over the
+    // backends would skip them for all but the first.
+    template <typename FnT>
+    void for_each_backend(FnT cases)
+    {
+        SUBCASE("thread backend") {
+            cases(AsyncWaiter::Backend::thread);
+        }
+        if (wjh::io_uring_futex_supported()) {
+            SUBCASE("io_uring backend") {
+                cases(AsyncWaiter::Backend::io_uring);
+            }
+        }
+    }
+
+    bool readable(int fd, int timeout_ms)
+    {
+        ::pollfd pfd{.fd = fd, .events = POLLIN, .revents = 0};
+        return ::poll(&pfd, 1, timeout_ms) == 1;
+    }
+
+    TEST_CASE("WaitableProcessIdLock")
+    {
+        auto shared = Shared{};
+
+        SUBCASE("lock and unlock") {
+            CHECK(shared->lock.try_lock());
+            CHECK(not shared->lock.try_lock());
+            shared->lock.unlock();
+            shared->lock.lock();
+            shared->lock.unlock();
+        }
+
+        SUBCASE("unlock bumps the release word") {
+            auto const seq = shared->lock.release_word().load();
+            shared->lock.lock();
+            shared->lock.unlock();
+            CHECK(shared->lock.release_word().load() != seq);
+        }
+
+        SUBCASE("excludes other processes") {
+            constexpr int nprocs = 4;
+            constexpr std::uint32_t iterations = 500;
+            std::vector<pid_t> pids;
+            for (int i = 0; i < nprocs; ++i) {
+                pid_t pid = ::fork();
+                if (pid == 0) {
+                    for (std::uint32_t j = 0; j < iterations; ++j) {
+                        shared->lock.lock();
+                        auto const n = shared->counter.load();
+                        std::this_thread::yield();
+                        shared->counter.store(n + 1);
+                        shared->lock.unlock();
+                    }
+                    ::_exit(0);
+                }
+                pids.push_back(pid);
+            }
+            for (auto pid : pids) {
+                ::waitpid(pid, nullptr, 0);
+            }
+            CHECK(shared->counter.load() == nprocs * iterations);
+        }
+
+        SUBCASE("recovers from a dead owner") {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                shared->lock.lock();
+                ::_exit(0);
+            }
+            ::waitpid(pid, nullptr, 0);
+            shared->lock.lock();
+            shared->lock.unlock();
+        }
+    }
+
+    TEST_CASE("io_uring backend")
+    {
+        if (wjh::io_uring_futex_supported()) {
+            CHECK(AsyncWaiter().backend() == AsyncWaiter::Backend::io_uring);
+        } else {
+            CHECK_THROWS_AS(
+                AsyncWaiter(AsyncWaiter::Backend::io_uring),
+                std::invalid_argument);
+        }
+    }
+
+    TEST_CASE("async_wait")
+    {
+        auto shared = Shared{};
+        std::array<AsyncWaiter::Completion, 4> out{};
+
+        for_each_backend([&](AsyncWaiter::Backend backend) {
+            auto waiter = AsyncWaiter(backend);
+            CHECK(waiter.backend() == backend);
+            CHECK(waiter.pending() == 0u);
+
+            SUBCASE("completes at once if the value differs") {
+                shared->words[0].store(1u);
+                waiter.async_wait(shared->words[0], 0u, 42);
+                CHECK(readable(waiter.fd(), 1000));
+                REQUIRE(waiter.wait(out, 1s) == 1u);
+                CHECK(out[0].user_data == 42u);
+                CHECK(waiter.pending() == 0u);
+            }
+
+            SUBCASE("does not complete until notified") {
+                waiter.async_wait(shared->words[0], 0u, 1);
+                CHECK(waiter.pending() == 1u);
+                CHECK(waiter.wait(out, 20ms) == 0u);
+                CHECK(not readable(waiter.fd(), 0));
+            }
+
+            SUBCASE("is woken by another thread") {
+                waiter.async_wait(shared->words[0], 0u, 1);
+                waiter.async_wait(shared->words[1], 0u, 2);
+                std::thread t([&] {
+                    std::this_thread::sleep_for(10ms);
+                    shared->words[1].store(1u);
+                    wjh::atomic_notify_all(shared->words[1]);
+                });
+                REQUIRE(waiter.wait(out, 10s) == 1u);
+                CHECK(out[0].user_data == 2u);
+                CHECK(waiter.pending() == 1u);
+                t.join();
+            }
+
+            SUBCASE("is woken by another process") {
+                waiter.async_wait(shared->words[2], 0u, 7);
+                pid_t pid = ::fork();
+                if (pid == 0) {
+                    std::this_thread::sleep_for(10ms);
+                    shared->words[2].store(1u);
+                    wjh::atomic_notify_all(shared->words[2]);
+                    ::_exit(0);
+                }
+                CHECK(readable(waiter.fd(), 10000));
+                REQUIRE(waiter.wait(out, 10s) == 1u);
+                CHECK(out[0].user_data == 7u);
+                ::waitpid(pid, nullptr, 0);
+            }
+
+            SUBCASE("more waits than the ring has entries") {
+                constexpr std::uint64_t count = 5000;
+                for (std::uint64_t i = 0; i < count; ++i) {
+                    waiter.async_wait(shared->words[3], 0u, i);
+                }
+                CHECK(waiter.pending() == count);
+                shared->words[3].store(1u);
+                wjh::atomic_notify_all(shared->words[3]);
+
+                std::set<std::uint64_t> seen;
+                while (seen.size() < count) {
+                    auto const n = waiter.wait(out, 1s);
+                    if (n == 0) {
+                        break;
+                    }
+                    for (std::size_t i = 0; i < n; ++i) {
+                        seen.insert(out[i].user_data);
+                    }
+                }
+                CHECK(seen.size() == count);
+                CHECK(waiter.pending() == 0u);
+            }
+        });
+    }
+
+    TEST_CASE("async_lock")
+    {
+        auto shared = Shared{};
+        std::array<AsyncWaiter::Completion, 4> out{};
+
+        for_each_backend([&](AsyncWaiter::Backend backend) {
+            auto waiter = AsyncWaiter(backend);
+
+            SUBCASE("completes at once if the lock is free") {
+                waiter.async_lock(shared->lock, 3);
+                REQUIRE(waiter.wait(out, 1s) == 1u);
+                CHECK(out[0].user_data == 3u);
+                CHECK(not shared->lock.try_lock());
+                shared->lock.unlock();
+            }
+
+            SUBCASE("acquires after the holder unlocks") {
+                pid_t pid = ::fork();
+                if (pid == 0) {
+                    shared->lock.lock();
+                    shared->words[0].store(1u);
+                    wjh::atomic_notify_all(shared->words[0]);
+                    std::this_thread::sleep_for(20ms);
+                    shared->lock.unlock();
+                    ::_exit(0);
+                }
+                while (shared->words[0].load() == 0u) {
+                    wjh::atomic_wait(shared->words[0], 0u, 10ms);
+                }
+                waiter.async_lock(shared->lock, 4);
+                REQUIRE(waiter.wait(out, 10s) == 1u);
+                CHECK(out[0].user_data == 4u);
+                shared->lock.unlock();
+                ::waitpid(pid, nullptr, 0);
+            }
+
+            SUBCASE("recovers from a dead owner") {
+                pid_t pid = ::fork();
+                if (pid == 0) {
+                    shared->lock.lock();
+                    ::_exit(0);
+                }
+                ::waitpid(pid, nullptr, 0);
+                waiter.async_lock(shared->lock, 5);
+                REQUIRE(waiter.wait(out, 10s) == 1u);
+                CHECK(out[0].user_data == 5u);
+                shared->lock.unlock();
+            }
+        });
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,178 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/AtomicWait.hpp"
+
+#include <sys/wait.h>
+
+#include <array>
+#include <chrono>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+using wjh::Atomic;
+using wjh::AtomicWaitTarget;
+using wjh::IpcDoorbell;
+
+TEST_SUITE("AtomicWait")
+{
+    struct SharedData
+    {
+        std::array<Atomic<std::uint32_t>, 200> words;
+        IpcDoorbell doorbell;
+    };
+
+    using Shared = wjh::testing::Shared<SharedData>;
+
+    auto targets_for(SharedData & data, std::size_t n)
+    {
+        std::vector<AtomicWaitTarget> result;
+        for (std::size_t i = 0; i < n; ++i) {
+            result.push_back(AtomicWaitTarget{&data.words[i], 0u});
+        }
+        return result;
+    }
+
+    TEST_CASE("atomic_wait")
+    {
+        auto word = Atomic<std::uint32_t>{0u};
+
+        SUBCASE("returns at once if the value differs") {
+            CHECK(wjh::atomic_wait(word, 1u, 1s));
+        }
+
+        SUBCASE("times out") {
+            CHECK(not wjh::atomic_wait(word, 0u, 10ms));
+        }
+
+        SUBCASE("is woken by a notification") {
+            std::thread t([&] {
+                std::this_thread::sleep_for(10ms);
+                word.store(1u);
+                wjh::atomic_notify_one(word);
+            });
+            while (word.load() == 0u) {
+                CHECK(wjh::atomic_wait(word, 0u, 10s));
+            }
+            t.join();
+        }
+    }
+
+    TEST_CASE("IpcDoorbell")
+    {
+        auto doorbell = IpcDoorbell{};
+
+        SUBCASE("a ring after prepare_wait is not lost") {
+            auto const key = doorbell.prepare_wait();
+            doorbell.ring();
+            CHECK(doorbell.wait(key, 1s));
+        }
+
+        SUBCASE("times out") {
+            auto const key = doorbell.prepare_wait();
+            CHECK(not doorbell.wait(key, 10ms));
+        }
+
+        SUBCASE("is woken by another thread") {
+            auto const key = doorbell.prepare_wait();
+            std::thread t([&] {
+                std::this_thread::sleep_for(10ms);
+                doorbell.ring();
+            });
+            CHECK(doorbell.wait(key, 10s));
+            t.join();
+        }
+    }
+
+    TEST_CASE("wait_any")
+    {
+        auto shared = Shared{};
+        auto const targets = targets_for(*shared, 16);
+
+        SUBCASE("returns the first ready target") {
+            shared->words[9].store(1u);
+            shared->words[12].store(1u);
+            CHECK(wjh::wait_any(targets, 1s) == 9u);
+        }
+
+        SUBCASE("times out") {
+            CHECK(wjh::wait_any(targets, 10ms) == std::nullopt);
+        }
+
+        SUBCASE("rejects no targets") {
+            auto const none = std::span<wjh::AtomicWaitTarget const>{};
+            CHECK_THROWS_AS(wjh::wait_any(none, 10ms), std::invalid_argument);
+            CHECK_THROWS_AS(wjh::wait_any(none), std::invalid_argument);
+        }
+
+        SUBCASE("is woken by another thread") {
+            std::thread t([&] {
+                std::this_thread::sleep_for(10ms);
+                shared->words[5].store(7u);
+                wjh::notify(shared->words[5]);
+            });
+            CHECK(wjh::wait_any(targets) == 5u);
+            t.join();
+        }
+
+        SUBCASE("is woken by another process") {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                std::this_thread::sleep_for(10ms);
+                shared->words[15].store(1u);
+                wjh::notify(shared->words[15], &shared->doorbell);
+                ::_exit(0);
+            }
+            CHECK(wjh::wait_any(targets, 10s, &shared->doorbell) == 15u);
+            ::waitpid(pid, nullptr, 0);
+        }
+    }
+
+    TEST_CASE("wait_any with more targets than futex_waitv allows")
+    {
+        auto shared = Shared{};
+        auto const targets = targets_for(*shared, 200);
+        REQUIRE(targets.size() > wjh::futex_waitv_max);
+
+        SUBCASE("uses the doorbell") {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                std::this_thread::sleep_for(10ms);
+                shared->words[150].store(1u);
+                wjh::notify(shared->words[150], &shared->doorbell);
+                ::_exit(0);
+            }
+            CHECK(wjh::wait_any(targets, 10s, &shared->doorbell) == 150u);
+            ::waitpid(pid, nullptr, 0);
+        }
+
+        SUBCASE("doorbell wait times out") {
+            CHECK(
+                wjh::wait_any(targets, 10ms, &shared->doorbell) ==
+                std::nullopt);
+        }
+
+        SUBCASE("polls without a doorbell") {
+            std::thread t([&] {
+                std::this_thread::sleep_for(10ms);
+                shared->words[199].store(1u);
+            });
+            CHECK(wjh::wait_any(targets, 10s) == 199u);
+            t.join();
+        }
+    }
+}
+
+} // anonymous namespace
@@ -200,6 +200,9 @@ TEST_SUITE("Atomic")
 
         x.store({123}, std::memory_order_relaxed);
         CHECK(x.load(std::memory_order_relaxed).x == 123);
+
+        x.store({7}, std::memory_order_release);
+        CHECK(x.load(std::memory_order_acquire).x == 7);
     }
 
     TEST_CASE("basic exchange")
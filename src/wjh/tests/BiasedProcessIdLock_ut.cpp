@@ -0,0 +1,212 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/BiasedProcessIdLock.hpp"
+
+#include <sys/wait.h>
+
+#include <chrono>
+#include <cstring>
+#include <latch>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+
+TEST_SUITE("BiasedProcessIdLock")
+{
+    using wjh::BiasedProcessIdLock;
+
+    struct SharedData
+    {
+        BiasedProcessIdLock lock;
+        int counter;
+        wjh::Atomic<int> inside;
+    };
+
+    using Shared = wjh::testing::Shared<SharedData>;
+
+    void make_biased(BiasedProcessIdLock & lock)
+    {
+        for (unsigned i = 0; i < BiasedProcessIdLock::rebias_threshold; ++i) {
+            lock.lock();
+            lock.unlock();
+        }
+    }
+
+    TEST_CASE("Can zero initialize")
+    {
+        alignas(BiasedProcessIdLock) unsigned char
+            storage[sizeof(BiasedProcessIdLock)];
+        std::memset(storage, 0xff, sizeof(storage));
+        auto lock = ::new (storage) BiasedProcessIdLock{};
+
+        unsigned char zeros[sizeof(BiasedProcessIdLock)] = {};
+        CHECK(std::memcmp(zeros, lock, sizeof(zeros)) == 0);
+        CHECK(not lock->biased());
+    }
+
+    TEST_CASE("Can lock and unlock")
+    {
+        auto lock = BiasedProcessIdLock{};
+        REQUIRE(lock.try_lock());
+        CHECK(not lock.try_lock());
+        lock.unlock();
+        lock.lock();
+        lock.unlock();
+    }
+
+    TEST_CASE("Repeated acquisition establishes the bias")
+    {
+        auto lock = BiasedProcessIdLock{};
+        make_biased(lock);
+        CHECK(lock.biased());
+
+        // Biased acquisition is still exclusive.
+        REQUIRE(lock.try_lock());
+        std::thread([&] { CHECK(not lock.try_lock()); }).join();
+        lock.unlock();
+        CHECK(not lock.biased());
+    }
+
+    TEST_CASE("Another thread revokes the bias")
+    {
+        auto lock = BiasedProcessIdLock{};
+        make_biased(lock);
+        REQUIRE(lock.biased());
+
+        std::thread([&] {
+            lock.lock();
+            CHECK(not lock.biased());
+            lock.unlock();
+        }).join();
+        CHECK(not lock.biased());
+
+        // The original home thread gets the bias back once it proves it is
+        // the only user again.
+        make_biased(lock);
+        CHECK(lock.biased());
+    }
+
+    TEST_CASE("Revocation waits for the home thread")
+    {
+        auto shared = Shared{};
+        make_biased(shared->lock);
+        REQUIRE(shared->lock.biased());
+
+        shared->lock.lock();
+        auto started = std::latch{1};
+        std::thread t([&] {
+            started.count_down();
+            shared->lock.lock();
+            shared->counter = 2;
+            shared->lock.unlock();
+        });
+        started.wait();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(shared->counter == 0);
+        shared->counter = 1;
+        shared->lock.unlock();
+        t.join();
+        CHECK(shared->counter == 2);
+    }
+
+    TEST_CASE("Concurrent Locking with Threads")
+    {
+        auto shared = Shared{};
+        make_biased(shared->lock);
+
+        int const num_threads = 8;
+        int const iterations = 10000;
+        auto latch = std::latch{num_threads};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&, i] {
+                latch.arrive_and_wait();
+                // Thread 0 hammers the lock so it keeps winning the bias back.
+                auto const n = i == 0 ? iterations * 4 : iterations;
+                for (int k = 0; k < n; ++k) {
+                    auto guard = std::lock_guard(shared->lock);
+                    CHECK(shared->inside.fetch_add(1) == 0);
+                    ++shared->counter;
+                    shared->inside.fetch_sub(1);
+                }
+            });
+        }
+        for (auto & t : threads) {
+            t.join();
+        }
+        CHECK(shared->counter == iterations * (num_threads + 3));
+    }
+
+    TEST_CASE("Concurrent Locking with Processes")
+    {
+        auto shared = Shared{};
+        int const num_processes = 6;
+        int const iterations = 5000;
+        for (int i = 0; i < num_processes; ++i) {
+            if (::fork() == 0) {
+                int failures = 0;
+                for (int k = 0; k < iterations; ++k) {
+                    auto guard = std::lock_guard(shared->lock);
+                    failures += shared->inside.fetch_add(1) != 0;
+                    ++shared->counter;
+                    shared->inside.fetch_sub(1);
+                }
+                ::_exit(failures == 0 ? 0 : 1);
+            }
+        }
+
+        // The parent takes the lock often enough to become biased.
+        for (int k = 0; k < iterations; ++k) {
+            auto guard = std::lock_guard(shared->lock);
+            CHECK(shared->inside.fetch_add(1) == 0);
+            ++shared->counter;
+            shared->inside.fetch_sub(1);
+        }
+
+        for (int i = 0; i < num_processes; ++i) {
+            int status = -1;
+            ::wait(&status);
+            CHECK(WIFEXITED(status));
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+        CHECK(shared->counter == iterations * (num_processes + 1));
+    }
+
+    TEST_CASE("Home process dies holding the lock")
+    {
+        auto shared = Shared{};
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            make_biased(shared->lock);
+            auto const biased = shared->lock.biased();
+            shared->lock.lock();
+            ::_exit(biased ? 0 : 1);
+        }
+
+        int status = -1;
+        ::waitpid(pid, &status, 0);
+        REQUIRE(WIFEXITED(status));
+        REQUIRE(WEXITSTATUS(status) == 0);
+        CHECK(shared->lock.biased());
+
+        shared->lock.lock();
+        CHECK(not shared->lock.biased());
+        shared->lock.unlock();
+        REQUIRE(shared->lock.try_lock());
+        shared->lock.unlock();
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,218 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/CoroutineWaker.hpp"
+
+#include <sys/wait.h>
+
+#include <array>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+using wjh::Atomic;
+using wjh::CoroutineWaker;
+using wjh::WaitableProcessIdLock;
+
+TEST_SUITE("CoroutineWaker")
+{
+    struct SharedData
+    {
+        std::array<Atomic<std::uint32_t>, 200> words;
+        WaitableProcessIdLock lock;
+        wjh::IpcDoorbell doorbell;
+    };
+
+    using Shared = wjh::testing::Shared<SharedData>;
+
+    // A fire-and-forget coroutine.
+    struct Task
+    {
+        struct promise_type
+        {
+            Task get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() { }
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+#if defined(__GNUC__) && not defined(__clang__)
+    // GCC lowers coroutine bodies to a switch that has no default.
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-default"
+#endif
+    Task wait_for(
+        Atomic<std::uint32_t> const & word,
+        std::uint32_t old,
+        Atomic<std::uint32_t> & result,
+        CoroutineWaker & waker)
+    {
+        auto const value = co_await wjh::wait_async(word, old, waker);
+        result.store(value);
+        wjh::atomic_notify_all(result);
+    }
+
+    Task lock_then_count(
+        WaitableProcessIdLock & lock,
+        Atomic<std::uint32_t> & count,
+        CoroutineWaker & waker)
+    {
+        co_await wjh::lock_async(lock, waker);
+        count.fetch_add(1u);
+        lock.unlock();
+        wjh::atomic_notify_all(count);
+    }
+#if defined(__GNUC__) && not defined(__clang__)
+    #pragma GCC diagnostic pop
+#endif
+
+    void wait_until(Atomic<std::uint32_t> & word, std::uint32_t value)
+    {
+        for (auto n = word.load(); n != value; n = word.load()) {
+            wjh::atomic_wait(word, n, 10ms);
+        }
+    }
+
+    TEST_CASE("wait_async")
+    {
+        auto shared = Shared{};
+        auto result = Atomic<std::uint32_t>{0u};
+        auto & waker = CoroutineWaker::instance();
+
+        SUBCASE("does not suspend if the value differs") {
+            shared->words[0].store(3u);
+            wait_for(shared->words[0], 0u, result, waker);
+            CHECK(result.load() == 3u);
+        }
+
+        SUBCASE("is resumed after a notification from another thread") {
+            wait_for(shared->words[0], 0u, result, waker);
+            CHECK(result.load() == 0u);
+            std::thread t([&] {
+                shared->words[0].store(5u);
+                wjh::atomic_notify_all(shared->words[0]);
+            });
+            wait_until(result, 5u);
+            t.join();
+            CHECK(waker.pending() == 0u);
+        }
+
+        SUBCASE("is resumed after a notification from another process") {
+            wait_for(shared->words[1], 0u, result, waker);
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                std::this_thread::sleep_for(10ms);
+                shared->words[1].store(9u);
+                wjh::atomic_notify_all(shared->words[1]);
+                ::_exit(0);
+            }
+            wait_until(result, 9u);
+            ::waitpid(pid, nullptr, 0);
+        }
+    }
+
+    TEST_CASE("lock_async")
+    {
+        auto shared = Shared{};
+        auto count = Atomic<std::uint32_t>{0u};
+        auto & waker = CoroutineWaker::instance();
+
+        SUBCASE("does not suspend if the lock is free") {
+            lock_then_count(shared->lock, count, waker);
+            CHECK(count.load() == 1u);
+        }
+
+        SUBCASE("many coroutines take turns") {
+            shared->lock.lock();
+            for (int i = 0; i < 10; ++i) {
+                lock_then_count(shared->lock, count, waker);
+            }
+            CHECK(count.load() == 0u);
+            shared->lock.unlock();
+            wait_until(count, 10u);
+        }
+
+        SUBCASE("recovers from a dead owner") {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                shared->lock.lock();
+                ::_exit(0);
+            }
+            ::waitpid(pid, nullptr, 0);
+            lock_then_count(shared->lock, count, waker);
+            wait_until(count, 1u);
+        }
+    }
+
+    TEST_CASE("resume hook")
+    {
+        auto shared = Shared{};
+        auto result = Atomic<std::uint32_t>{0u};
+        std::mutex mutex;
+        std::vector<std::coroutine_handle<>> queue;
+        auto waker = CoroutineWaker([&](std::coroutine_handle<> handle) {
+            auto guard = std::lock_guard(mutex);
+            queue.push_back(handle);
+        });
+
+        wait_for(shared->words[0], 0u, result, waker);
+        shared->words[0].store(1u);
+        wjh::atomic_notify_all(shared->words[0]);
+
+        std::coroutine_handle<> handle;
+        while (not handle) {
+            std::this_thread::sleep_for(1ms);
+            auto guard = std::lock_guard(mutex);
+            if (not queue.empty()) {
+                handle = queue.front();
+            }
+        }
+        CHECK(result.load() == 0u);
+        handle.resume();
+        CHECK(result.load() == 1u);
+    }
+
+    TEST_CASE("more waiters than futex_waitv allows")
+    {
+        auto shared = Shared{};
+        auto waker = CoroutineWaker({}, &shared->doorbell);
+        auto const n = static_cast<std::uint32_t>(shared->words.size());
+        REQUIRE(n > wjh::futex_waitv_max);
+
+        std::vector<Atomic<std::uint32_t>> results(n);
+        for (std::uint32_t i = 0; i < n; ++i) {
+            wait_for(shared->words[i], 0u, results[i], waker);
+        }
+        CHECK(waker.pending() <= n);
+
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            for (std::uint32_t i = 0; i < n; ++i) {
+                shared->words[i].store(i + 1);
+                wjh::notify(shared->words[i], &shared->doorbell);
+            }
+            ::_exit(0);
+        }
+        for (std::uint32_t i = 0; i < n; ++i) {
+            wait_until(results[i], i + 1);
+        }
+        CHECK(waker.pending() == 0u);
+        ::waitpid(pid, nullptr, 0);
+    }
+}
+
+} // anonymous namespace
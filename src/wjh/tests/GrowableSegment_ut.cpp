@@ -0,0 +1,177 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/GrowableSegment.hpp"
+
+#include "wjh/Segment.hpp"
+
+#include <sys/wait.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::GrowableSegment;
+using wjh::Segment;
+
+TEST_SUITE("GrowableSegment")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_grow.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    auto const page = Segment::page_size();
+
+    TEST_CASE("grow in place")
+    {
+        auto dir = TempDir{};
+        auto segment = GrowableSegment(dir.path / "seg", 100, 64 * page);
+        CHECK(segment.size() == page);
+        CHECK(segment.reserve() == 64 * page);
+        CHECK(segment.generation() == 1u);
+
+        auto const data = segment.data();
+        std::memcpy(data + 10, "hello", 5);
+        CHECK(segment.grow(10 * page) == 10 * page);
+        CHECK(segment.data() == data);
+        CHECK(segment.generation() == 2u);
+        CHECK(std::memcmp(data + 10, "hello", 5) == 0);
+        CHECK(data[9 * page] == std::byte{0});
+        data[9 * page] = std::byte{7};
+
+        SUBCASE("never shrinks") {
+            CHECK(segment.grow(page) == 10 * page);
+            CHECK(segment.generation() == 2u);
+        }
+
+        SUBCASE("within the reserve") {
+            CHECK(segment.grow(64 * page) == 64 * page);
+            CHECK_THROWS_AS(segment.grow(64 * page + 1), std::length_error);
+            CHECK_THROWS_AS(segment.at(64 * page), std::out_of_range);
+        }
+
+        SUBCASE("reopen") {
+            auto other = GrowableSegment(dir.path / "seg");
+            CHECK(other.size() == 10 * page);
+            CHECK(other.reserve() == 64 * page);
+            CHECK(other.data()[9 * page] == std::byte{7});
+        }
+
+        SUBCASE("the creator's reserve wins") {
+            auto other = GrowableSegment(dir.path / "seg", page, 2 * page);
+            CHECK(other.reserve() == 64 * page);
+        }
+    }
+
+    TEST_CASE("peers map growth lazily")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "seg";
+        auto segment = GrowableSegment(path, page, 256 * page);
+        auto peer = GrowableSegment(path);
+        auto const data = peer.data();
+
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            auto child = GrowableSegment(path);
+            for (std::size_t n = 2; n <= 100; ++n) {
+                child.grow(n * page);
+                *child.at((n - 1) * page) = std::byte{42};
+            }
+            ::_exit(0);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        REQUIRE(WIFEXITED(status));
+
+        CHECK(peer.size() == page);
+        CHECK(peer.generation() == 100u);
+        CHECK(*peer.at(99 * page) == std::byte{42});
+        CHECK(peer.size() == 100 * page);
+        CHECK(peer.data() == data);
+        for (std::size_t n = 1; n < 100; ++n) {
+            CHECK(data[n * page] == std::byte{42});
+        }
+        CHECK_THROWS_AS(peer.at(100 * page), std::out_of_range);
+
+        CHECK(segment.refresh() == 100 * page);
+        segment.sync();
+    }
+
+    TEST_CASE("concurrent growth")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "seg";
+        auto segment = GrowableSegment(path, page, 64 * page);
+
+        std::vector<pid_t> pids;
+        for (int p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto child = GrowableSegment(path);
+                for (std::size_t n = 1; n <= 64; ++n) {
+                    child.grow(n * page);
+                    child.at(0, n * page)[(n - 1) * page + std::size_t(p)] =
+                        std::byte{1};
+                }
+                ::_exit(0);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WIFEXITED(status));
+        }
+
+        REQUIRE(segment.refresh() == 64 * page);
+        for (std::size_t n = 0; n < 64; ++n) {
+            for (std::size_t p = 0; p < 4; ++p) {
+                CHECK(segment.data()[n * page + p] == std::byte{1});
+            }
+        }
+        CHECK(segment.generation() == 64u);
+    }
+
+    TEST_CASE("errors")
+    {
+        auto dir = TempDir{};
+        CHECK_THROWS_AS(
+            GrowableSegment(dir.path / "missing"),
+            std::system_error);
+        auto plain = Segment(dir.path / "plain", page);
+        CHECK_THROWS_AS(
+            GrowableSegment(dir.path / "plain"),
+            std::invalid_argument);
+        CHECK_THROWS_AS(
+            GrowableSegment(dir.path / "big", 4 * page, page),
+            std::length_error);
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,289 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcAppendLog.hpp"
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcAppendLog;
+using Position = IpcAppendLog::Position;
+
+TEST_SUITE("IpcAppendLog")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_log.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    std::span<std::byte const> bytes(std::string const & s)
+    {
+        return std::as_bytes(std::span(s));
+    }
+
+    std::string text(std::span<std::byte const> record)
+    {
+        return std::string(
+            reinterpret_cast<char const *>(record.data()),
+            record.size());
+    }
+
+    std::vector<std::string> read_all(IpcAppendLog & log)
+    {
+        std::vector<std::string> result;
+        auto cursor = Position{};
+        while (auto record = log.read(cursor)) {
+            result.push_back(text(*record));
+        }
+        return result;
+    }
+
+    // The segment files of the log in @p directory that are mapped.
+    std::size_t mapped_segments(std::filesystem::path const & directory)
+    {
+        std::set<std::string> files;
+        auto maps = std::ifstream("/proc/self/maps");
+        for (std::string line; std::getline(maps, line);) {
+            if (line.find(directory.string()) != std::string::npos &&
+                line.ends_with(".seg"))
+            {
+                files.insert(line.substr(line.find('/')));
+            }
+        }
+        return files.size();
+    }
+
+    TEST_CASE("append and read")
+    {
+        auto dir = TempDir{};
+        auto log = IpcAppendLog(dir.path, 4096);
+        CHECK(log.committed() == Position{0, 0});
+
+        auto const first = log.append(bytes("hello"));
+        auto const second = log.append(bytes("world!"));
+        CHECK(first == Position{0, 0});
+        CHECK(second > first);
+        CHECK(log.committed() > second);
+        CHECK(read_all(log) == std::vector<std::string>{"hello", "world!"});
+
+        SUBCASE("in place") {
+            log.append(3, [](std::span<std::byte> data) {
+                std::memcpy(data.data(), "abc", 3);
+            });
+            CHECK(read_all(log).back() == "abc");
+        }
+
+        SUBCASE("empty records") {
+            log.append(bytes(""));
+            CHECK(read_all(log).size() == 3u);
+        }
+
+        SUBCASE("too large") {
+            auto const big = std::string(log.max_record_size() + 1, 'x');
+            CHECK_THROWS_AS(log.append(bytes(big)), std::length_error);
+            auto const max = std::string(log.max_record_size(), 'x');
+            log.append(bytes(max));
+            CHECK(read_all(log).back() == max);
+        }
+
+        SUBCASE("reopen") {
+            auto other = IpcAppendLog(dir.path);
+            CHECK(
+                read_all(other) ==
+                std::vector<std::string>{"hello", "world!"});
+        }
+    }
+
+    TEST_CASE("uncommitted records hide what follows")
+    {
+        auto dir = TempDir{};
+        auto log = IpcAppendLog(dir.path, 4096);
+        log.append(bytes("one"));
+        std::jthread writer;
+        auto started = std::atomic<bool>(false);
+        auto release = std::atomic<bool>(false);
+        writer = std::jthread([&] {
+            log.append(3, [&](std::span<std::byte> data) {
+                started = true;
+                while (not release) {
+                    std::this_thread::yield();
+                }
+                std::memcpy(data.data(), "two", 3);
+            });
+        });
+        while (not started) {
+            std::this_thread::yield();
+        }
+        log.append(bytes("three"));
+        CHECK(read_all(log) == std::vector<std::string>{"one"});
+        release = true;
+        writer.join();
+        CHECK(
+            read_all(log) ==
+            std::vector<std::string>{"one", "two", "three"});
+    }
+
+    TEST_CASE("rolls over to new segments")
+    {
+        auto dir = TempDir{};
+        auto log = IpcAppendLog(dir.path, 4096);
+        std::vector<std::string> expected;
+        for (int i = 0; i < 2000; ++i) {
+            expected.push_back("record " + std::to_string(i));
+            log.append(bytes(expected.back()));
+        }
+        CHECK(log.committed().segment > 0u);
+        CHECK(read_all(log) == expected);
+
+        auto other = IpcAppendLog(dir.path);
+        CHECK(read_all(other) == expected);
+        CHECK(other.committed() == log.committed());
+
+        // Only the last few segments each handle used stay mapped.
+        REQUIRE(log.committed().segment > 8u);
+        CHECK(
+            mapped_segments(dir.path) <=
+            2 * wjh::appendlog_detail::max_open_segments);
+    }
+
+    TEST_CASE("concurrent appenders")
+    {
+        auto dir = TempDir{};
+        constexpr int nprocs = 3;
+        constexpr int nthreads = 2;
+        constexpr int count = 400;
+        {
+            // Create it before forking, so everyone agrees on the capacity.
+            auto log = IpcAppendLog(dir.path, 8192);
+        }
+
+        std::vector<pid_t> pids;
+        for (int p = 0; p < nprocs; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto log = IpcAppendLog(dir.path);
+                std::vector<std::thread> threads;
+                for (int t = 0; t < nthreads; ++t) {
+                    threads.emplace_back([&, t] {
+                        for (int i = 0; i < count; ++i) {
+                            auto const s = std::to_string(p) + ":" +
+                                std::to_string(t) + ":" + std::to_string(i);
+                            log.append(bytes(s));
+                        }
+                    });
+                }
+                for (auto & t : threads) {
+                    t.join();
+                }
+                ::_exit(0);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WIFEXITED(status));
+        }
+
+        // Every record is there once, and each writer's are in order.
+        auto log = IpcAppendLog(dir.path);
+        std::map<std::string, int> next;
+        int total = 0;
+        for (auto const & record : read_all(log)) {
+            auto const colon = record.rfind(':');
+            auto const writer = record.substr(0, colon);
+            auto const i = std::stoi(record.substr(colon + 1));
+            CHECK(next[writer] == i);
+            next[writer] = i + 1;
+            ++total;
+        }
+        CHECK(total == nprocs * nthreads * count);
+    }
+
+    TEST_CASE("durability")
+    {
+        auto dir = TempDir{};
+        auto log = IpcAppendLog(dir.path, 4096);
+
+        SUBCASE("flush") {
+            log.append(bytes("a"));
+            CHECK(log.flush() > 0u);
+            CHECK(log.flush() == 0u);
+        }
+
+        SUBCASE("sync without a flusher") {
+            auto const position = log.append(bytes("a"));
+            log.sync(position);
+            CHECK(log.flush() == 0u);
+        }
+
+        SUBCASE("sync with a flusher in another process") {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto child = IpcAppendLog(dir.path);
+                auto flusher = child.start_flusher(std::chrono::seconds(10));
+                ::pause();
+                ::_exit(0);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+            // The flusher holds the lease, so sync() asks it to flush.
+            for (int i = 0; i < 50; ++i) {
+                log.sync(log.append(bytes(std::to_string(i))));
+            }
+            CHECK(log.flush() == 0u);
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+
+            // The lease of a dead flusher is recovered.
+            log.append(bytes("after"));
+            CHECK(log.flush() > 0u);
+        }
+
+        SUBCASE("across segments") {
+            std::vector<Position> positions;
+            for (int i = 0; i < 300; ++i) {
+                positions.push_back(log.append(bytes(std::to_string(i))));
+            }
+            REQUIRE(positions.back().segment > 0u);
+            log.sync(positions.back());
+            for (auto const & position : positions) {
+                log.sync(position);
+            }
+        }
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,460 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcBTree.hpp"
+
+#include "wjh/Segment.hpp"
+
+#include <sys/wait.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::GrowableSegment;
+using wjh::IpcBTree;
+
+TEST_SUITE("IpcBTree")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_btree.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    constexpr std::size_t reserve = 256 << 20;
+
+    using Tree = IpcBTree<std::uint64_t, std::uint64_t>;
+
+    // Small pages, so that a few thousand keys make a deep tree.
+    using Small =
+        IpcBTree<std::uint64_t, std::uint64_t, std::less<std::uint64_t>, 256>;
+
+    template <typename T>
+    std::vector<std::uint64_t> keys(T const & tree)
+    {
+        std::vector<std::uint64_t> result;
+        tree.scan(0, ~std::uint64_t(0), [&](auto key, auto value) {
+            CHECK(value == key * 3);
+            result.push_back(key);
+        });
+        return result;
+    }
+
+    TEST_CASE("insert, get, and erase")
+    {
+        auto dir = TempDir{};
+        auto segment = GrowableSegment(dir.path / "tree", 0, reserve);
+        auto tree = Tree(segment);
+        CHECK(tree.empty());
+        CHECK(not tree.get(1));
+
+        auto writer = tree.write();
+        CHECK(writer.insert(1, 100));
+        CHECK(not writer.insert(1, 200));
+        CHECK(writer.get(1) == 100);
+        CHECK(not tree.get(1));
+        writer.commit();
+        CHECK(tree.get(1) == 100);
+        CHECK(tree.contains(1));
+        CHECK(tree.size() == 1);
+
+        auto eraser = tree.write();
+        CHECK(eraser.erase(1));
+        CHECK(not eraser.erase(1));
+        CHECK(not eraser.get(1));
+        CHECK(tree.get(1) == 100);
+        eraser.commit();
+        CHECK(not tree.contains(1));
+        CHECK(tree.empty());
+    }
+
+    TEST_CASE("ordered")
+    {
+        auto dir = TempDir{};
+        auto segment = GrowableSegment(dir.path / "tree", 0, reserve);
+        auto tree = Small(segment);
+        {
+            auto writer = tree.write();
+            for (std::uint64_t i = 0; i < 20000; ++i) {
+                auto const key = (i * 7919) % 20000;
+                CHECK(writer.insert(key, key * 3));
+            }
+            writer.commit();
+        }
+        CHECK(tree.size() == 20000);
+        {
+            // Erase in several transactions, so pages are copied from the
+            // committed tree as well as changed in place.
+            for (std::uint64_t key = 0; key < 20000; key += 300) {
+                auto writer = tree.write();
+                for (auto k = key; k < key + 300 && k < 20000; k += 3) {
+                    CHECK(writer.erase(k));
+                }
+                writer.commit();
+            }
+        }
+
+        std::vector<std::uint64_t> expected;
+        for (std::uint64_t key = 0; key < 20000; ++key) {
+            if (key % 3 != 0) {
+                expected.push_back(key);
+            }
+        }
+        CHECK(keys(tree) == expected);
+        CHECK(tree.size() == expected.size());
+        for (std::uint64_t key = 0; key < 20000; key += 7) {
+            CHECK(tree.contains(key) == (key % 3 != 0));
+        }
+
+        SUBCASE("range") {
+            std::vector<std::uint64_t> seen;
+            auto const n = tree.scan(100, 110, [&](auto key, auto) {
+                seen.push_back(key);
+            });
+            CHECK(n == seen.size());
+            auto const range =
+                std::vector<std::uint64_t>{100, 101, 103, 104, 106, 107, 109};
+            CHECK(seen == range);
+            CHECK(tree.scan(30000, 40000, [](auto, auto) { }) == 0);
+        }
+
+        SUBCASE("erase everything") {
+            auto writer = tree.write();
+            for (auto key : expected) {
+                CHECK(writer.erase(key));
+            }
+            writer.commit();
+            CHECK(tree.empty());
+            CHECK(keys(tree).empty());
+            auto const pages = tree.pages();
+
+            // Every page is free again.
+            auto again = tree.write();
+            for (std::uint64_t key = 0; key < 1000; ++key) {
+                again.insert(key, key * 3);
+            }
+            again.commit();
+            CHECK(tree.pages() == pages);
+        }
+    }
+
+    TEST_CASE("comparator")
+    {
+        auto dir = TempDir{};
+        auto segment = GrowableSegment(dir.path / "tree", 0, reserve);
+        auto tree = IpcBTree<int, int, std::greater<int>, 256>(segment);
+        auto writer = tree.write();
+        for (int i = 0; i < 100; ++i) {
+            writer.insert(i, i);
+        }
+        writer.commit();
+        std::vector<int> seen;
+        tree.scan(7, 2, [&](int key, int) { seen.push_back(key); });
+        CHECK(seen == std::vector<int>{7, 6, 5, 4, 3});
+    }
+
+    TEST_CASE("reopen")
+    {
+        auto dir = TempDir{};
+        {
+            auto segment = GrowableSegment(dir.path / "tree", 0, reserve);
+            auto tree = Small(segment);
+            auto writer = tree.write();
+            for (std::uint64_t key = 0; key < 5000; ++key) {
+                writer.insert(key, key * 3);
+            }
+            writer.commit(true);
+        }
+
+        auto segment = GrowableSegment(dir.path / "tree");
+        auto tree = Small(segment);
+        CHECK(tree.size() == 5000);
+        CHECK(tree.get(4321) == 4321 * 3);
+        CHECK(keys(tree).size() == 5000);
+
+        SUBCASE("with another layout") {
+            CHECK_THROWS_AS(Tree(segment), std::invalid_argument);
+        }
+    }
+
+    TEST_CASE("synced pages are readable in the file")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "tree";
+        std::size_t pages = 0;
+        {
+            auto segment = GrowableSegment(path, 0, reserve);
+            auto tree = Small(segment);
+            auto writer = tree.write();
+            for (std::uint64_t key = 0; key < 2000; ++key) {
+                writer.insert(key, key * 3);
+            }
+            writer.commit(true);
+            pages = tree.pages();
+        }
+        REQUIRE(pages > 10);
+
+        // Every page was written by the one transaction, so is in the tree,
+        // and its version, at the front of the page, must be even.
+        auto file = std::ifstream(path, std::ios::binary);
+        bool even = true;
+        for (std::size_t n = 1; n < pages; ++n) {
+            std::uint64_t version = 1;
+            auto const offset =
+                wjh::Segment::page_size() + n * Small::page_size;
+            file.seekg(static_cast<std::streamoff>(offset));
+            file.read(reinterpret_cast<char *>(&version), sizeof(version));
+            REQUIRE(file);
+            even = even && version % 2 == 0;
+        }
+        CHECK(even);
+    }
+
+    TEST_CASE("free list after the machine restarts")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "tree";
+        std::size_t pages = 0;
+        {
+            auto segment = GrowableSegment(path, 0, reserve);
+            auto tree = Small(segment);
+            auto writer = tree.write();
+            for (std::uint64_t key = 0; key < 2000; ++key) {
+                writer.insert(key, key * 3);
+            }
+            writer.commit(true);
+            auto eraser = tree.write();
+            for (std::uint64_t key = 1000; key < 2000; ++key) {
+                eraser.erase(key);
+            }
+            eraser.commit(true);
+            pages = tree.pages();
+
+            // The free list, never written back, may be anything, even
+            // pages of the tree.
+            auto & meta =
+                *reinterpret_cast<wjh::btree_detail::Meta *>(segment.data());
+            meta.free.store(meta.root.load());
+            meta.boot.store(0);
+        }
+
+        auto segment = GrowableSegment(path);
+        auto tree = Small(segment);
+        auto writer = tree.write();
+        for (std::uint64_t key = 2000; key < 2100; ++key) {
+            writer.insert(key, key * 3);
+        }
+        writer.commit();
+        CHECK(tree.pages() == pages);
+        CHECK(tree.size() == 1100);
+        auto const found = keys(tree);
+        REQUIRE(found.size() == 1100);
+        CHECK(found[999] == 999);
+        CHECK(found[1000] == 2000);
+    }
+
+    TEST_CASE("abort")
+    {
+        auto dir = TempDir{};
+        auto segment = GrowableSegment(dir.path / "tree", 0, reserve);
+        auto tree = Small(segment);
+        {
+            auto writer = tree.write();
+            for (std::uint64_t key = 0; key < 1000; ++key) {
+                writer.insert(key, key * 3);
+            }
+            writer.commit();
+        }
+        auto const abort = [&] {
+            auto writer = tree.write();
+            for (std::uint64_t key = 0; key < 1000; key += 2) {
+                writer.erase(key);
+            }
+            for (std::uint64_t key = 1000; key < 2000; ++key) {
+                writer.insert(key, key * 3);
+            }
+            CHECK(writer.get(1500) == 4500);
+        };
+        abort();
+        CHECK(tree.size() == 1000);
+        CHECK(keys(tree).size() == 1000);
+        CHECK(not tree.contains(1500));
+
+        // Later transactions reuse the pages written by the first.
+        auto const pages = tree.pages();
+        for (int round = 0; round < 10; ++round) {
+            abort();
+        }
+        CHECK(tree.pages() == pages);
+        CHECK(keys(tree).size() == 1000);
+    }
+
+    TEST_CASE("replaced pages are reused")
+    {
+        auto dir = TempDir{};
+        auto segment = GrowableSegment(dir.path / "tree", 0, reserve);
+        auto tree = Small(segment);
+        {
+            auto writer = tree.write();
+            for (std::uint64_t key = 0; key < 1000; ++key) {
+                writer.insert(key * 2, key * 6);
+            }
+            writer.commit();
+        }
+        auto const replace = [&](std::uint64_t key) {
+            auto writer = tree.write();
+            CHECK(writer.erase(key * 2));
+            CHECK(writer.insert(key * 2, key * 6));
+            writer.commit();
+        };
+        replace(0);
+        auto const pages = tree.pages();
+        for (std::uint64_t key = 0; key < 1000; ++key) {
+            replace(key);
+        }
+        CHECK(tree.pages() == pages);
+        CHECK(tree.size() == 1000);
+    }
+
+    TEST_CASE("one writer")
+    {
+        auto dir = TempDir{};
+        auto segment = GrowableSegment(dir.path / "tree", 0, reserve);
+        auto tree = Tree(segment);
+        auto writer = tree.try_write();
+        REQUIRE(writer);
+        CHECK(not tree.try_write());
+        auto moved = std::move(*writer);
+        writer.reset();
+        CHECK(not tree.try_write());
+        moved.insert(1, 1);
+        moved.commit();
+        CHECK(tree.try_write());
+    }
+
+    TEST_CASE("readers in other processes")
+    {
+        auto dir = TempDir{};
+        auto segment = GrowableSegment(dir.path / "tree", 0, reserve);
+        auto tree = Small(segment);
+        {
+            // Even keys stay put while odd keys come and go.
+            auto writer = tree.write();
+            for (std::uint64_t key = 0; key < 4000; key += 2) {
+                writer.insert(key, key * 3);
+            }
+            writer.commit();
+        }
+
+        std::vector<pid_t> pids;
+        for (int p = 0; p < 3; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto mine = GrowableSegment(dir.path / "tree");
+                auto reader = Small(mine);
+                bool ok = true;
+                for (std::uint64_t round = 0; round < 200; ++round) {
+                    std::uint64_t even = 0;
+                    std::uint64_t last = 0;
+                    bool first = true;
+                    reader.scan(0, 4000, [&](auto key, auto value) {
+                        ok = ok && value == key * 3 && (first || key > last);
+                        even += key % 2 == 0;
+                        first = false;
+                        last = key;
+                    });
+                    ok = ok && even == 2000;
+                    for (std::uint64_t key = round; key < 4000; key += 97) {
+                        auto const value = reader.get(key);
+                        ok = ok && (key % 2 == 1 || value == key * 3);
+                        ok = ok && (not value || *value == key * 3);
+                    }
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+
+        for (std::uint64_t round = 0; round < 200; ++round) {
+            auto writer = tree.write();
+            for (auto key = 1 + round % 7 * 2; key < 4000; key += 14) {
+                if (not writer.insert(key, key * 3)) {
+                    writer.erase(key);
+                }
+            }
+            writer.commit();
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+    }
+
+    TEST_CASE("a dead writer")
+    {
+        auto dir = TempDir{};
+        auto segment = GrowableSegment(dir.path / "tree", 0, reserve);
+        auto tree = Small(segment);
+        {
+            auto writer = tree.write();
+            for (std::uint64_t key = 0; key < 1000; ++key) {
+                writer.insert(key, key * 3);
+            }
+            writer.commit();
+        }
+        auto const expected = keys(tree);
+
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            auto mine = GrowableSegment(dir.path / "tree");
+            auto child = Small(mine);
+            auto writer = child.write();
+            for (std::uint64_t key = 0; key < 1000; key += 2) {
+                writer.erase(key);
+            }
+            for (std::uint64_t key = 1000; key < 2000; ++key) {
+                writer.insert(key, key * 3);
+            }
+            ::_exit(0);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        REQUIRE(WEXITSTATUS(status) == 0);
+
+        CHECK(keys(tree) == expected);
+        auto writer = tree.write();
+        CHECK(writer.insert(5000, 15000));
+        CHECK(writer.erase(0));
+        writer.commit();
+        CHECK(tree.size() == 1000);
+        CHECK(tree.get(5000) == 15000);
+        CHECK(not tree.contains(0));
+    }
+}
+
+} // anonymous namespace
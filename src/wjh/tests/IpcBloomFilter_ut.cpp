@@ -0,0 +1,192 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcBloomFilter.hpp"
+
+#include <sys/wait.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcBloomFilter;
+using wjh::IpcCountingBloomFilter;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcBloomFilter")
+{
+    // About 10 bits per key for 10000 keys.
+    using Filter = IpcBloomFilter<200>;
+
+    TEST_CASE("insert and contains")
+    {
+        auto filter = Shared<Filter>{};
+        CHECK(not filter->contains(std::uint64_t(42)));
+        CHECK(filter->insert(std::uint64_t(42)));
+        CHECK(not filter->insert(std::uint64_t(42)));
+        CHECK(filter->contains(std::uint64_t(42)));
+
+        CHECK(not filter->contains(std::string_view("message-1")));
+        CHECK(filter->insert(std::string_view("message-1")));
+        CHECK(filter->contains(std::string_view("message-1")));
+        CHECK(not filter->insert(std::string_view("message-1")));
+
+        filter->clear();
+        CHECK(not filter->contains(std::uint64_t(42)));
+        CHECK(not filter->contains(std::string_view("message-1")));
+    }
+
+    TEST_CASE("false positives")
+    {
+        auto filter = Shared<Filter>{};
+        for (std::uint64_t key = 0; key < 10000; ++key) {
+            filter->insert(key);
+        }
+        int missing = 0;
+        for (std::uint64_t key = 0; key < 10000; ++key) {
+            missing += not filter->contains(key);
+        }
+        CHECK(missing == 0);
+
+        int false_positives = 0;
+        for (std::uint64_t key = 1'000'000; key < 1'100'000; ++key) {
+            false_positives += filter->contains(key);
+        }
+        CHECK(false_positives < 2000);
+    }
+
+    TEST_CASE("batch query")
+    {
+        auto filter = Shared<Filter>{};
+        std::array<std::uint64_t, 64> keys;
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            keys[i] = i * 7919;
+            if (i % 3 == 0) {
+                filter->insert(keys[i]);
+            }
+        }
+        auto const mask = filter->contains(std::span(keys));
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            CAPTURE(i);
+            CHECK(bool(mask & (std::uint64_t(1) << i)) ==
+                  filter->contains(keys[i]));
+            if (i % 3 == 0) {
+                CHECK((mask & (std::uint64_t(1) << i)));
+            }
+        }
+    }
+
+    TEST_CASE("processes")
+    {
+        auto filter = Shared<Filter>{};
+        std::vector<pid_t> pids;
+        for (std::uint64_t p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                for (std::uint64_t key = p; key < 10000; key += 4) {
+                    filter->insert(key);
+                }
+                ::_exit(0);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            ::waitpid(pid, nullptr, 0);
+        }
+        int missing = 0;
+        for (std::uint64_t key = 0; key < 10000; ++key) {
+            missing += not filter->contains(key);
+        }
+        CHECK(missing == 0);
+    }
+
+    TEST_CASE("counting")
+    {
+        auto filter = Shared<IpcCountingBloomFilter<64>>{};
+        CHECK(not filter->erase(std::uint64_t(7)));
+
+        SUBCASE("erase") {
+            CHECK(filter->insert(std::uint64_t(7)));
+            CHECK(not filter->insert(std::uint64_t(7)));
+            CHECK(filter->erase(std::uint64_t(7)));
+            CHECK(filter->contains(std::uint64_t(7)));
+            CHECK(filter->erase(std::uint64_t(7)));
+            CHECK(not filter->contains(std::uint64_t(7)));
+            CHECK(not filter->erase(std::uint64_t(7)));
+
+            CHECK(filter->insert(std::string_view("abc")));
+            CHECK(filter->contains(std::string_view("abc")));
+            CHECK(filter->erase(std::string_view("abc")));
+            CHECK(not filter->contains(std::string_view("abc")));
+        }
+
+        SUBCASE("saturated counters stay put") {
+            for (int i = 0; i < 20; ++i) {
+                filter->insert(std::uint64_t(7));
+            }
+            for (int i = 0; i < 20; ++i) {
+                CHECK(filter->erase(std::uint64_t(7)));
+            }
+            CHECK(filter->contains(std::uint64_t(7)));
+        }
+
+        SUBCASE("other keys survive") {
+            for (std::uint64_t key = 0; key < 500; ++key) {
+                filter->insert(key);
+            }
+            for (std::uint64_t key = 0; key < 500; key += 2) {
+                CHECK(filter->erase(key));
+            }
+            int missing = 0;
+            for (std::uint64_t key = 1; key < 500; key += 2) {
+                missing += not filter->contains(key);
+            }
+            CHECK(missing == 0);
+        }
+    }
+
+    TEST_CASE("counting across processes")
+    {
+        auto filter = Shared<IpcCountingBloomFilter<64>>{};
+        std::vector<pid_t> pids;
+        for (int p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                bool ok = true;
+                for (int round = 0; round < 100; ++round) {
+                    for (std::uint64_t key = 0; key < 50; ++key) {
+                        filter->insert(key);
+                    }
+                    for (std::uint64_t key = 0; key < 50; ++key) {
+                        ok = filter->erase(key) && ok;
+                    }
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+
+        // Each process erased exactly what it inserted.
+        int remaining = 0;
+        for (std::uint64_t key = 0; key < 50; ++key) {
+            remaining += filter->contains(key);
+        }
+        CHECK(remaining == 0);
+    }
+}
+
+} // anonymous namespace
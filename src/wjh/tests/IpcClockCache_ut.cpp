@@ -0,0 +1,231 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcClockCache.hpp"
+
+#include <sys/wait.h>
+
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcClockCache;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcClockCache")
+{
+    using Cache = IpcClockCache<std::uint64_t, std::uint64_t, 8>;
+
+    TEST_CASE("insert, get, and erase")
+    {
+        auto cache = Shared<Cache>{};
+        CHECK(cache->empty());
+        CHECK(not cache->get(1));
+
+        CHECK(cache->insert(1, 100));
+        CHECK(not cache->insert(1, 200));
+        CHECK(cache->get(1) == 100);
+        CHECK(cache->size() == 1);
+
+        CHECK(cache->erase(1));
+        CHECK(not cache->erase(1));
+        CHECK(not cache->get(1));
+        CHECK(cache->empty());
+
+        CHECK(cache->insert(1, 300));
+        CHECK(cache->get(1) == 300);
+    }
+
+    TEST_CASE("struct keys")
+    {
+        struct Key
+        {
+            std::uint32_t id;
+            std::uint32_t version;
+        };
+        using Value = std::array<char, 16>;
+        auto cache = Shared<IpcClockCache<Key, Value, 100>>{};
+        for (std::uint32_t i = 0; i < 100; ++i) {
+            CHECK(cache->insert(Key{i, 1}, Value{char('a' + i % 26)}));
+        }
+        for (std::uint32_t i = 0; i < 100; ++i) {
+            CAPTURE(i);
+            CHECK(not cache->get(Key{i, 2}));
+            auto const value = cache->get(Key{i, 1});
+            REQUIRE(value);
+            CHECK((*value)[0] == char('a' + i % 26));
+        }
+    }
+
+    TEST_CASE("CLOCK eviction")
+    {
+        auto cache = Shared<Cache>{};
+        for (std::uint64_t key = 0; key < 8; ++key) {
+            CHECK(cache->insert(key, key * 10));
+        }
+        for (std::uint64_t key = 0; key < 4; ++key) {
+            CHECK(cache->get(key));
+        }
+
+        // The hand passes over the referenced entries, clearing their bits,
+        // and evicts the others.
+        for (std::uint64_t key = 8; key < 12; ++key) {
+            CHECK(cache->insert(key, key * 10));
+        }
+        CHECK(cache->size() == 8);
+        for (std::uint64_t key = 0; key < 12; ++key) {
+            CAPTURE(key);
+            CHECK(bool(cache->get(key)) == (key < 4 || key >= 8));
+        }
+    }
+
+    TEST_CASE("free entries are used before evicting")
+    {
+        auto cache = Shared<IpcClockCache<int, int, 4>>{};
+        for (int key = 0; key < 4; ++key) {
+            CHECK(cache->insert(key, key));
+        }
+        CHECK(cache->erase(2));
+        CHECK(cache->insert(10, 10));
+        CHECK(cache->size() == 4);
+        for (int key : {0, 1, 3, 10}) {
+            CAPTURE(key);
+            CHECK(cache->get(key) == key);
+        }
+    }
+
+    TEST_CASE("pins")
+    {
+        auto cache = Shared<Cache>{};
+        CHECK(not cache->pin(1));
+        CHECK(cache->insert(1, 100));
+
+        auto pin = cache->pin(1);
+        REQUIRE(pin);
+        CHECK(*pin == 100);
+        CHECK(pin.key() == 1);
+        CHECK(not cache->erase(1));
+
+        SUBCASE("not evicted") {
+            for (std::uint64_t key = 2; key < 100; ++key) {
+                CHECK(cache->insert(key, key));
+            }
+            CHECK(cache->get(1) == 100);
+            CHECK(*pin == 100);
+        }
+
+        SUBCASE("released") {
+            auto other = std::move(pin);
+            CHECK(not pin);
+            CHECK(not cache->erase(1));
+            other.reset();
+            CHECK(cache->erase(1));
+        }
+
+        SUBCASE("every entry pinned") {
+            std::vector<Cache::Pin> pins;
+            for (std::uint64_t key = 2; key < 9; ++key) {
+                CHECK(cache->insert(key, key));
+                pins.push_back(cache->pin(key));
+            }
+            CHECK(not cache->insert(9, 9));
+            pins.clear();
+            CHECK(cache->insert(9, 9));
+        }
+
+        SUBCASE("out of pin records") {
+            auto small = Shared<IpcClockCache<int, int, 4, 2>>{};
+            CHECK(small->insert(1, 1));
+            auto a = small->pin(1);
+            auto b = small->pin(1);
+            CHECK_THROWS_AS(small->pin(1), std::length_error);
+            b.reset();
+            CHECK(small->pin(1));
+        }
+    }
+
+    TEST_CASE("pins of dead processes")
+    {
+        auto cache = Shared<Cache>{};
+        for (std::uint64_t key = 0; key < 8; ++key) {
+            CHECK(cache->insert(key, key));
+        }
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            bool ok = true;
+            for (std::uint64_t key = 0; key < 3; ++key) {
+                // Leaked, as they would be by a crash.
+                auto * pin = new Cache::Pin(cache->pin(key));
+                ok = ok && *pin;
+            }
+            ::_exit(ok ? 0 : 1);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        REQUIRE(WEXITSTATUS(status) == 0);
+
+        SUBCASE("release_dead_pins") {
+            CHECK(cache->release_dead_pins() == 3);
+            CHECK(cache->release_dead_pins() == 0);
+        }
+
+        SUBCASE("eviction releases them") {
+            for (std::uint64_t key = 8; key < 16; ++key) {
+                CHECK(cache->insert(key, key));
+            }
+            for (std::uint64_t key = 0; key < 3; ++key) {
+                CHECK(not cache->get(key));
+            }
+        }
+    }
+
+    TEST_CASE("processes")
+    {
+        // More keys than entries, so lookups race with evictions.
+        auto cache = Shared<IpcClockCache<std::uint64_t, std::uint64_t, 64>>{};
+        std::vector<pid_t> pids;
+        for (std::uint64_t p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                bool ok = true;
+                for (std::uint64_t n = 0; n < 20000; ++n) {
+                    auto const key = (n * 7 + p * 13) % 100;
+                    if (auto const value = cache->get(key)) {
+                        ok = ok && *value == key * 3;
+                    } else {
+                        cache->insert(key, key * 3);
+                    }
+                    if (n % 16 == 0) {
+                        if (auto pin = cache->pin(key)) {
+                            ok = ok && *pin == key * 3;
+                        }
+                    }
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+        CHECK(cache->size() == 64);
+        for (std::uint64_t key = 0; key < 100; ++key) {
+            if (auto const value = cache->get(key)) {
+                CHECK(*value == key * 3);
+            }
+        }
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,155 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcCounterGroup.hpp"
+
+#include <sys/wait.h>
+
+#include <chrono>
+#include <csignal>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcCounterGroup;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcCounterGroup")
+{
+    enum { requests, bytes, errors, counters };
+
+    using Group = IpcCounterGroup<counters, 8>;
+
+    // Each request has 100 bytes, and every fourth is an error.
+    void serve(Group::Writer & writer, std::int64_t n)
+    {
+        writer.add({{requests, 1}, {bytes, 100}, {errors, n % 4 == 0}});
+    }
+
+    bool consistent(Group const & group)
+    {
+        auto const snapshot = group.snapshot();
+        return snapshot[bytes] == 100 * snapshot[requests] &&
+            snapshot[errors] <= snapshot[requests];
+    }
+
+    TEST_CASE("add and snapshot")
+    {
+        auto group = Shared<Group>{};
+        CHECK(group->snapshot() == std::array<std::int64_t, 3>{});
+
+        auto writer = group->writer();
+        writer.add(requests);
+        writer.add(bytes, 10);
+        writer.add({{bytes, 5}, {errors, 2}});
+        CHECK(group->snapshot() == std::array<std::int64_t, 3>{1, 15, 2});
+        CHECK(group->load(bytes) == 15);
+
+        writer.update([](auto & values) {
+            values[requests] = 7;
+            values[errors] -= 1;
+        });
+        CHECK(group->snapshot() == std::array<std::int64_t, 3>{7, 15, 1});
+
+        SUBCASE("writers add up") {
+            auto other = group->writer();
+            other.add({{requests, 3}, {bytes, 5}});
+            CHECK(group->snapshot() == std::array<std::int64_t, 3>{10, 20, 1});
+        }
+
+        SUBCASE("shares outlive writers") {
+            auto moved = std::move(writer);
+            moved.add(requests);
+            {
+                auto const gone = std::move(moved);
+            }
+            CHECK(group->load(requests) == 8);
+            auto next = group->writer();
+            next.add(requests);
+            CHECK(group->load(requests) == 9);
+        }
+    }
+
+    TEST_CASE("too many writers")
+    {
+        auto group = Shared<Group>{};
+        std::vector<Group::Writer> writers;
+        for (int i = 0; i < 8; ++i) {
+            writers.push_back(group->writer());
+        }
+        CHECK_THROWS_AS(group->writer(), std::length_error);
+        writers.pop_back();
+        CHECK_NOTHROW(group->writer());
+    }
+
+    TEST_CASE("processes")
+    {
+        auto group = Shared<Group>{};
+        std::vector<pid_t> pids;
+        for (int p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto writer = group->writer();
+                bool ok = true;
+                for (std::int64_t n = 0; n < 100000; ++n) {
+                    serve(writer, n);
+                    if (n % 64 == 0) {
+                        ok = ok && consistent(*group);
+                    }
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        bool ok = true;
+        for (int n = 0; n < 1000; ++n) {
+            ok = ok && consistent(*group);
+        }
+        CHECK(ok);
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+        CHECK(group->load(requests) == 400000);
+        CHECK(consistent(*group));
+    }
+
+    TEST_CASE("writers that die mid-update")
+    {
+        auto group = Shared<Group>{};
+        for (int round = 0; round < 20; ++round) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto writer = group->writer();
+                for (std::int64_t n = 0;; ++n) {
+                    serve(writer, n);
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ::kill(pid, SIGKILL);
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(consistent(*group));
+        }
+
+        // Every slot is free again, and keeps its share.
+        auto const before = group->snapshot();
+        std::vector<Group::Writer> writers;
+        for (int i = 0; i < 8; ++i) {
+            writers.push_back(group->writer());
+        }
+        CHECK(group->snapshot() == before);
+    }
+}
+
+} // anonymous namespace
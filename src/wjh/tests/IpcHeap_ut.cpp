@@ -0,0 +1,197 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcHeap.hpp"
+
+#include "wjh/Segment.hpp"
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcHeap;
+using wjh::Segment;
+
+TEST_SUITE("IpcHeap")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_heap.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    bool aligned(void const * p, std::size_t alignment)
+    {
+        return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+    }
+
+    std::span<std::byte> region(Segment & segment)
+    {
+        return std::span(segment.data(), segment.size());
+    }
+
+    TEST_CASE("allocate and free")
+    {
+        auto dir = TempDir{};
+        auto segment = Segment(dir.path / "heap", 1 << 20);
+        auto heap = IpcHeap(region(segment));
+        CHECK(heap.capacity() == segment.size());
+
+        auto a = heap.allocate(1);
+        auto b = heap.allocate(100);
+        auto c = heap.allocate(64, 64);
+        CHECK(aligned(a, 16));
+        CHECK(aligned(b, 16));
+        CHECK(aligned(c, 64));
+        CHECK(a != b);
+        CHECK(heap.at(heap.offset_of(b)) == b);
+        CHECK(IpcHeap::block_size(100) == 128u);
+        CHECK(IpcHeap::block_size(1, 256) == 256u);
+
+        SUBCASE("freed blocks are reused") {
+            heap.deallocate(b, 100);
+            CHECK(heap.allocate(128) == b);
+            heap.deallocate(a, 1);
+            CHECK(heap.allocate(16) == a);
+        }
+
+        SUBCASE("alignment padding is not wasted") {
+            auto const used = heap.used();
+            auto page = heap.allocate(4096, 4096);
+            CHECK(aligned(page, 4096));
+            CHECK(heap.used() > used);
+            auto const after = heap.used();
+            std::vector<void *> small;
+            for (int i = 0; i < 8; ++i) {
+                small.push_back(heap.allocate(16));
+            }
+            CHECK(heap.used() == after);
+        }
+
+        SUBCASE("memory runs out") {
+            CHECK_THROWS_AS(heap.allocate(2 << 20), std::bad_alloc);
+            CHECK_THROWS_AS(heap.allocate(16, 8192), std::bad_alloc);
+            auto big = heap.allocate(512 << 10);
+            CHECK_THROWS_AS(heap.allocate(512 << 10), std::bad_alloc);
+            heap.deallocate(big, 512 << 10);
+            CHECK(heap.allocate(512 << 10) == big);
+        }
+
+        SUBCASE("another handle") {
+            auto other = IpcHeap(region(segment));
+            CHECK(other == heap);
+            other.deallocate(c, 64, 64);
+            CHECK(heap.allocate(64) == c);
+        }
+    }
+
+    TEST_CASE("bad regions")
+    {
+        auto dir = TempDir{};
+        auto segment = Segment(dir.path / "heap", 1 << 16);
+        CHECK_THROWS_AS(
+            IpcHeap(region(segment).first(64)),
+            std::invalid_argument);
+        auto heap = IpcHeap(region(segment));
+        CHECK(heap.capacity() == segment.size());
+        CHECK_THROWS_AS(
+            IpcHeap(region(segment).first(1 << 12)),
+            std::invalid_argument);
+    }
+
+    TEST_CASE("threads and processes")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "heap";
+        constexpr int nprocs = 3;
+        constexpr int nthreads = 2;
+        constexpr int count = 2000;
+        auto segment = Segment(path, 16 << 20);
+        auto heap = IpcHeap(region(segment));
+
+        // Everyone allocates blocks, stamps them, and frees half, so the
+        // free lists are busy, and then checks that nobody else wrote to
+        // the blocks it kept.
+        std::vector<pid_t> pids;
+        for (int p = 0; p < nprocs; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto child = Segment(path);
+                auto mine = IpcHeap(region(child));
+                auto ok = std::atomic<bool>(true);
+                std::vector<std::thread> threads;
+                for (int t = 0; t < nthreads; ++t) {
+                    threads.emplace_back([&, t] {
+                        auto const stamp = p * nthreads + t + 1;
+                        std::vector<unsigned char *> kept;
+                        for (int i = 0; i < count; ++i) {
+                            auto const size = std::size_t(16) << (i % 4);
+                            auto block = static_cast<unsigned char *>(
+                                mine.allocate(size));
+                            std::memset(block, stamp, size);
+                            if (i % 2) {
+                                mine.deallocate(block, size);
+                            } else {
+                                kept.push_back(block);
+                            }
+                        }
+                        for (std::size_t i = 0; i < kept.size(); ++i) {
+                            auto const size = std::size_t(16) << (i * 2 % 4);
+                            if (std::any_of(
+                                    kept[i],
+                                    kept[i] + size,
+                                    [&](unsigned char c) {
+                                        return c != stamp;
+                                    }))
+                            {
+                                ok = false;
+                            }
+                        }
+                    });
+                }
+                for (auto & t : threads) {
+                    t.join();
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WIFEXITED(status));
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+        CHECK(heap.used() < heap.capacity());
+    }
+}
+
+} // anonymous namespace
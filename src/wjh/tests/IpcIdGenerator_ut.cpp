@@ -0,0 +1,233 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcIdGenerator.hpp"
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcIdGenerator;
+using Mode = IpcIdGenerator::Mode;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcIdGenerator")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_ids.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    bool unique(std::vector<std::uint64_t> const & sorted)
+    {
+        return std::adjacent_find(sorted.begin(), sorted.end()) ==
+            sorted.end();
+    }
+
+    TEST_CASE("blocks")
+    {
+        auto dir = TempDir{};
+        auto generator = IpcIdGenerator(dir.path / "ids", Mode::blocks, 16);
+        CHECK(generator.mode() == Mode::blocks);
+        CHECK(generator.block_size() == 16);
+
+        auto a = generator.issuer();
+        auto b = generator.issuer();
+        CHECK(a.next() == 1);
+        CHECK(a.next() == 2);
+        CHECK(b.next() == 17);
+        for (std::uint64_t id = 3; id <= 16; ++id) {
+            CHECK(a.next() == id);
+        }
+        CHECK(a.next() == 33);
+        CHECK(b.next() == 18);
+        CHECK(generator.high_water() >= 48);
+
+        SUBCASE("moved issuers keep their block") {
+            auto moved = std::move(b);
+            CHECK(moved.next() == 19);
+        }
+
+        SUBCASE("options must match the file") {
+            CHECK_THROWS_AS(
+                IpcIdGenerator(dir.path / "ids", Mode::blocks, 32),
+                std::invalid_argument);
+            CHECK_THROWS_AS(
+                IpcIdGenerator(dir.path / "ids", Mode::snowflake),
+                std::invalid_argument);
+            CHECK_THROWS_AS(
+                IpcIdGenerator(dir.path / "other", Mode::blocks, 0),
+                std::invalid_argument);
+        }
+    }
+
+    TEST_CASE("reopening skips past the high-water mark")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "ids";
+        std::uint64_t last = 0;
+        std::uint64_t high_water = 0;
+        for (int run = 0; run < 3; ++run) {
+            auto generator = IpcIdGenerator(path, Mode::blocks, 8);
+            CHECK(generator.high_water() >= high_water);
+            auto issuer = generator.issuer();
+            auto const first = issuer.next();
+            CHECK(first > last);
+            CHECK(first >= high_water);
+            last = first;
+            for (int n = 0; n < 1000; ++n) {
+                auto const id = issuer.next();
+                CHECK(id > last);
+                last = id;
+            }
+            CHECK(generator.high_water() > last);
+            high_water = generator.high_water();
+        }
+    }
+
+    TEST_CASE("processes")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "ids";
+        constexpr std::size_t per_child = 100000;
+        auto ids = Shared<std::array<std::uint64_t, 4 * per_child>>{};
+        std::vector<pid_t> pids;
+        for (std::size_t p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto generator = IpcIdGenerator(path, Mode::blocks, 64);
+                auto issuer = generator.issuer();
+                for (std::size_t n = 0; n < per_child; ++n) {
+                    (*ids)[p * per_child + n] = issuer.next();
+                }
+                ::_exit(0);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+        auto sorted = std::vector<std::uint64_t>(ids->begin(), ids->end());
+        std::sort(sorted.begin(), sorted.end());
+        CHECK(sorted.front() > 0);
+        CHECK(unique(sorted));
+        CHECK(IpcIdGenerator(path, Mode::blocks, 64).high_water() >
+              sorted.back());
+    }
+
+    TEST_CASE("snowflake")
+    {
+        auto dir = TempDir{};
+        auto generator = IpcIdGenerator(dir.path / "ids", Mode::snowflake);
+        auto a = generator.issuer();
+        auto b = generator.issuer();
+
+        auto const before = std::chrono::system_clock::now();
+        auto const first = a.next();
+        auto const parts = IpcIdGenerator::decode(first);
+        CHECK(first > 0);
+        CHECK(first >> 63 == 0);
+        CHECK(parts.sequence == 0);
+        CHECK(parts.time() >= before - std::chrono::milliseconds(1));
+        CHECK(parts.time() <= before + std::chrono::seconds(1));
+        CHECK(IpcIdGenerator::decode(b.next()).slot != parts.slot);
+
+        SUBCASE("more than a millisecond's worth") {
+            std::vector<std::uint64_t> issued{first};
+            bool increasing = true;
+            for (int n = 0; n < 100000; ++n) {
+                issued.push_back(a.next());
+                increasing =
+                    increasing && issued.back() > issued[issued.size() - 2];
+            }
+            CHECK(increasing);
+            for (int n = 0; n < 100000; ++n) {
+                issued.push_back(b.next());
+            }
+            std::sort(issued.begin(), issued.end());
+            CHECK(unique(issued));
+        }
+
+        SUBCASE("a reclaimed slot carries on") {
+            auto const slot = parts.slot;
+            std::uint64_t last = first;
+            for (int n = 0; n < 10000; ++n) {
+                last = a.next();
+            }
+            {
+                auto const gone = std::move(a);
+            }
+            auto c = generator.issuer();
+            auto const next = c.next();
+            CHECK(IpcIdGenerator::decode(next).slot == slot);
+            CHECK(next > last);
+        }
+    }
+
+    TEST_CASE("snowflake issuers that die")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "ids";
+        for (int round = 0; round < 4; ++round) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto generator = IpcIdGenerator(path, Mode::snowflake);
+                std::vector<IpcIdGenerator::Issuer> issuers;
+                for (int i = 0; i < 512; ++i) {
+                    issuers.push_back(generator.issuer());
+                }
+                for (;;) {
+                    for (auto & issuer : issuers) {
+                        issuer.next();
+                    }
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            ::kill(pid, SIGKILL);
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+        }
+
+        // Every slot is free again.
+        auto generator = IpcIdGenerator(path, Mode::snowflake);
+        std::vector<IpcIdGenerator::Issuer> issuers;
+        for (int i = 0; i < 1024; ++i) {
+            issuers.push_back(generator.issuer());
+        }
+        CHECK_THROWS_AS(generator.issuer(), std::length_error);
+    }
+}
+
+} // anonymous namespace
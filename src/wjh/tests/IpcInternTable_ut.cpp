@@ -0,0 +1,214 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcInternTable.hpp"
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcInternTable;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcInternTable")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_intern.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    std::string symbol(std::size_t n)
+    {
+        // Short symbols, and some longer than two words.
+        auto result = "SYM" + std::to_string(n);
+        if (n % 5 == 0) {
+            result += ".EXCHANGE.LONG.SUFFIX";
+        }
+        return result;
+    }
+
+    TEST_CASE("intern and lookup")
+    {
+        auto dir = TempDir{};
+        auto table = IpcInternTable(dir.path / "symbols", 100, 4096);
+        CHECK(table.capacity() == 128);
+        CHECK(table.size() == 0);
+        CHECK_FALSE(table.find("IBM"));
+
+        auto const ibm = table.intern("IBM");
+        auto const msft = table.intern("MSFT");
+        CHECK(ibm != msft);
+        CHECK(table.intern("IBM") == ibm);
+        CHECK(table.find("IBM") == ibm);
+        CHECK(table.lookup(ibm) == "IBM");
+        CHECK(table.lookup(msft) == "MSFT");
+        CHECK(table.size() == 2);
+
+        SUBCASE("strings that differ in any byte") {
+            std::vector<std::string> const strings{
+                "",
+                "A",
+                "AAAAAAAA",
+                "AAAAAAAB",
+                "AAAAAAAAA",
+                "AAAAAAAAAAAAAAAA",
+                "AAAAAAAAAAAAAAAB",
+                "AAAAAAAAAAAAAAAAA",
+                "AAAAAAAAAAAAAAAAB",
+                std::string("A\0B", 3),
+                std::string("A\0C", 3)};
+            std::set<IpcInternTable::Id> ids;
+            for (auto const & s : strings) {
+                ids.insert(table.intern(s));
+            }
+            CHECK(ids.size() == strings.size());
+            for (auto const & s : strings) {
+                auto const id = table.find(s);
+                REQUIRE(id);
+                CHECK(table.lookup(*id) == s);
+            }
+            CHECK_FALSE(table.find("AAAAAAA"));
+            CHECK_FALSE(table.find("AAAAAAAAAAAAAAAAC"));
+        }
+
+        SUBCASE("unknown ids") {
+            CHECK_THROWS_AS(table.lookup(128), std::out_of_range);
+            for (IpcInternTable::Id id = 0; id < 128; ++id) {
+                if (id != ibm && id != msft) {
+                    CHECK_THROWS_AS(table.lookup(id), std::out_of_range);
+                }
+            }
+        }
+    }
+
+    TEST_CASE("ids survive reopening")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "symbols";
+        std::vector<IpcInternTable::Id> ids;
+        {
+            auto table = IpcInternTable(path, 1024, 1 << 16);
+            for (std::size_t n = 0; n < 500; ++n) {
+                ids.push_back(table.intern(symbol(n)));
+            }
+            table.sync();
+        }
+
+        auto table = IpcInternTable(path, 1000, 1 << 16);
+        CHECK(table.size() == 500);
+        for (std::size_t n = 0; n < 500; ++n) {
+            CHECK(table.find(symbol(n)) == ids[n]);
+            CHECK(table.lookup(ids[n]) == symbol(n));
+        }
+
+        CHECK_THROWS_AS(
+            IpcInternTable(path, 2048, 1 << 16),
+            std::invalid_argument);
+        CHECK_THROWS_AS(
+            IpcInternTable(path, 1024, 1 << 15),
+            std::invalid_argument);
+        CHECK_THROWS_AS(
+            IpcInternTable(dir.path / "other", 0, 1024),
+            std::invalid_argument);
+    }
+
+    TEST_CASE("full")
+    {
+        auto dir = TempDir{};
+
+        SUBCASE("index") {
+            auto table = IpcInternTable(dir.path / "index", 4, 4096);
+            for (std::size_t n = 0; n < 4; ++n) {
+                table.intern(symbol(n));
+            }
+            CHECK_THROWS_AS(table.intern(symbol(4)), std::length_error);
+            CHECK(table.intern(symbol(0)) == *table.find(symbol(0)));
+        }
+
+        SUBCASE("arena") {
+            // The first word is reserved; each string here takes two.
+            auto table = IpcInternTable(dir.path / "arena", 64, 8 * 7);
+            for (std::size_t n = 1; n <= 3; ++n) {
+                table.intern(symbol(n));
+            }
+            CHECK_THROWS_AS(table.intern(symbol(4)), std::length_error);
+            CHECK(table.size() == 3);
+        }
+    }
+
+    TEST_CASE("processes")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "symbols";
+        constexpr std::size_t symbols = 2000;
+        constexpr std::size_t processes = 4;
+        using Ids = std::array<IpcInternTable::Id, processes * symbols>;
+        auto ids = Shared<Ids>{};
+
+        std::vector<pid_t> pids;
+        for (std::size_t p = 0; p < processes; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto table = IpcInternTable(path, 4096, 1 << 16);
+                // Every process interns every symbol, in its own order.
+                for (std::size_t i = 0; i < symbols; ++i) {
+                    auto const j = p % 2 == 0 ? i : symbols - 1 - i;
+                    auto const n = (j + p * 97) % symbols;
+                    (*ids)[p * symbols + n] = table.intern(symbol(n));
+                }
+                ::_exit(0);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+
+        auto table = IpcInternTable(path, 4096, 1 << 16);
+        CHECK(table.size() == symbols);
+        bool agree = true;
+        std::set<IpcInternTable::Id> distinct;
+        for (std::size_t n = 0; n < symbols; ++n) {
+            for (std::size_t p = 1; p < processes; ++p) {
+                agree = agree && (*ids)[p * symbols + n] == (*ids)[n];
+            }
+            agree = agree && table.lookup((*ids)[n]) == symbol(n);
+            distinct.insert((*ids)[n]);
+        }
+        CHECK(agree);
+        CHECK(distinct.size() == symbols);
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,152 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcMemoryResource.hpp"
+
+#include "wjh/Segment.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcHeap;
+using wjh::IpcMemoryResource;
+using wjh::Segment;
+
+TEST_SUITE("IpcMemoryResource")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_pmr.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    bool inside(Segment const & segment, void const * p)
+    {
+        auto const b = static_cast<std::byte const *>(p);
+        return b >= segment.data() && b < segment.data() + segment.size();
+    }
+
+    TEST_CASE("containers")
+    {
+        auto dir = TempDir{};
+        auto segment = Segment(dir.path / "heap", 4 << 20);
+        auto heap = IpcHeap(std::span(segment.data(), segment.size()));
+        auto thread_cache = false;
+        SUBCASE("without a thread cache") { }
+        SUBCASE("with a thread cache") {
+            thread_cache = true;
+        }
+        auto resource = IpcMemoryResource(heap, thread_cache);
+        CHECK(&resource.heap() == &heap);
+
+        std::pmr::vector<int> v(&resource);
+        for (int i = 0; i < 10000; ++i) {
+            v.push_back(i);
+        }
+        CHECK(inside(segment, v.data()));
+        CHECK(v[9999] == 9999);
+
+        std::pmr::unordered_map<int, std::pmr::string> m(&resource);
+        for (int i = 0; i < 1000; ++i) {
+            m.emplace(i, std::string(40, char('a' + i % 26)));
+        }
+        CHECK(std::string_view(m.at(27)) == std::string(40, 'b'));
+        CHECK(inside(segment, m.at(27).data()));
+        m.clear();
+        v = std::pmr::vector<int>(&resource);
+
+        auto other = IpcMemoryResource(heap);
+        CHECK(resource.is_equal(other));
+        CHECK(not resource.is_equal(*std::pmr::new_delete_resource()));
+    }
+
+    TEST_CASE("aligned for atomics")
+    {
+        auto dir = TempDir{};
+        auto segment = Segment(dir.path / "heap", 1 << 20);
+        auto heap = IpcHeap(std::span(segment.data(), segment.size()));
+        auto resource = IpcMemoryResource(heap);
+        for (std::size_t size : {1u, 3u, 8u, 24u}) {
+            auto p = resource.allocate(size, 1);
+            CHECK(reinterpret_cast<std::uintptr_t>(p) % 16 == 0);
+            resource.deallocate(p, size, 1);
+        }
+        auto p = resource.allocate(100, 128);
+        CHECK(reinterpret_cast<std::uintptr_t>(p) % 128 == 0);
+        resource.deallocate(p, 100, 128);
+    }
+
+    TEST_CASE("thread cache")
+    {
+        auto dir = TempDir{};
+        auto segment = Segment(dir.path / "heap", 1 << 20);
+        auto heap = IpcHeap(std::span(segment.data(), segment.size()));
+        void * p = nullptr;
+        {
+            auto resource = IpcMemoryResource(heap, true);
+            p = resource.allocate(64);
+            resource.deallocate(p, 64);
+            CHECK(resource.cached() == 1u);
+
+            // The cache is per thread.
+            std::thread([&] {
+                auto q = resource.allocate(64);
+                CHECK(q != p);
+                resource.deallocate(q, 64);
+            }).join();
+            CHECK(resource.cached() == 2u);
+
+            CHECK(resource.allocate(64) == p);
+            CHECK(resource.cached() == 1u);
+            resource.deallocate(p, 64);
+
+            // Large blocks are never cached.
+            auto big = resource.allocate(4096);
+            resource.deallocate(big, 4096);
+            CHECK(resource.cached() == 2u);
+        }
+
+        // The cached blocks went back to the heap.
+        auto const used = heap.used();
+        heap.allocate(64);
+        heap.allocate(64);
+        CHECK(heap.used() == used);
+
+        // Entries for resources that are gone make way for new ones.
+        bool fresh = true;
+        for (int n = 0; n < 1000; ++n) {
+            auto resource = IpcMemoryResource(heap, true);
+            resource.deallocate(resource.allocate(64), 64);
+            fresh = fresh && resource.cached() == 1u;
+        }
+        CHECK(fresh);
+    }
+}
+
+} // anonymous namespace
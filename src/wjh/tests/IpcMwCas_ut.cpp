@@ -0,0 +1,275 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcMwCas.hpp"
+
+#include <sys/wait.h>
+
+#include <chrono>
+#include <csignal>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::Atomic;
+using wjh::IpcMwCas;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcMwCas")
+{
+    // Accounts, whose total never changes, and a count of the transfers
+    // between them.
+    struct Bank
+    {
+        static constexpr std::uint64_t accounts = 8;
+
+        IpcMwCas<> cas;
+        Atomic<std::uint64_t> balances[accounts];
+        Atomic<std::uint64_t> transfers;
+
+        // Move one unit from account @p from to account @p to.
+        bool transfer(std::uint64_t from, std::uint64_t to)
+        {
+            auto const a = cas.load(balances[from]);
+            auto const b = cas.load(balances[to]);
+            auto const n = cas.load(transfers);
+            return a > 0 &&
+                cas.compare_exchange({
+                    {balances[from], a, a - 1},
+                    {balances[to], b, b + 1},
+                    {transfers, n, n + 1}});
+        }
+
+        // The total as of one moment: every transfer counts, so none
+        // happened while it was added up if the count is the same after.
+        std::uint64_t total()
+        {
+            for (;;) {
+                auto const n = cas.load(transfers);
+                std::uint64_t result = 0;
+                for (auto & balance : balances) {
+                    result += cas.load(balance);
+                }
+                if (cas.load(transfers) == n) {
+                    return result;
+                }
+            }
+        }
+    };
+
+    TEST_CASE("compare_exchange")
+    {
+        auto bank = Shared<Bank>{};
+        auto & cas = bank->cas;
+        auto & a = bank->balances[0];
+        auto & b = bank->balances[1];
+        CHECK(cas.load(a) == 0);
+
+        CHECK(cas.compare_exchange({{a, 0, 10}, {b, 0, 20}}));
+        CHECK(cas.load(a) == 10);
+        CHECK(cas.load(b) == 20);
+        CHECK(a.load() == 10);
+
+        SUBCASE("fails if any word differs") {
+            CHECK(not cas.compare_exchange({{a, 10, 11}, {b, 21, 22}}));
+            CHECK(cas.load(a) == 10);
+            CHECK(cas.load(b) == 20);
+        }
+
+        SUBCASE("one word") {
+            CHECK(cas.compare_exchange({{b, 20, 21}}));
+            CHECK(cas.load(b) == 21);
+        }
+
+        SUBCASE("in any order") {
+            CHECK(cas.compare_exchange({{b, 20, 0}, {a, 10, 1}}));
+            CHECK(cas.load(a) == 1);
+            CHECK(cas.load(b) == 0);
+        }
+
+        SUBCASE("bad updates") {
+            auto & c = bank->balances[2];
+            auto & d = bank->balances[3];
+            auto & e = bank->balances[4];
+            CHECK_THROWS_AS(
+                cas.compare_exchange(
+                    {{a, 10, 0}, {b, 20, 0}, {c, 0, 0}, {d, 0, 0}, {e, 0, 0}}),
+                std::length_error);
+            CHECK_THROWS_AS(
+                cas.compare_exchange({{a, 10, IpcMwCas<>::max_value + 1}}),
+                std::invalid_argument);
+            CHECK_THROWS_AS(
+                cas.compare_exchange({{a, 10, 0}, {a, 10, 1}}),
+                std::invalid_argument);
+            CHECK(cas.load(a) == 10);
+        }
+    }
+
+    TEST_CASE("processes")
+    {
+        auto bank = Shared<Bank>{};
+        for (auto & balance : bank->balances) {
+            balance.store(100u);
+        }
+        std::vector<pid_t> pids;
+        for (std::uint64_t p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                bool ok = true;
+                std::uint64_t done = 0;
+                for (std::uint64_t n = 0; n < 20000; ++n) {
+                    auto const from = (n * 5 + p) % Bank::accounts;
+                    auto const to = (n * 3 + p + 1) % Bank::accounts;
+                    if (from != to) {
+                        done += bank->transfer(from, to);
+                    }
+                    if (n % 64 == 0) {
+                        ok = ok && bank->total() == 800;
+                    }
+                }
+                ::_exit(ok && done > 0 ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+        CHECK(bank->total() == 800);
+        CHECK(bank->cas.recover() == 0);
+    }
+
+    TEST_CASE("processes stopped mid-update")
+    {
+        auto bank = Shared<Bank>{};
+        for (auto & balance : bank->balances) {
+            balance.store(100u);
+        }
+        auto const transfer = [&](std::uint64_t n) {
+            auto const from = n % Bank::accounts;
+            bank->transfer(from, (from + 1 + n % 7) % Bank::accounts);
+        };
+        for (int round = 0; round < 20; ++round) {
+            pid_t stopped = ::fork();
+            if (stopped == 0) {
+                for (std::uint64_t n = 0;; ++n) {
+                    transfer(n);
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ::kill(stopped, SIGSTOP);
+
+            // Another process gets through every account, finishing any
+            // update that the stopped one had started.
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                for (std::uint64_t n = 0; n < 1000; ++n) {
+                    transfer(n);
+                }
+                ::_exit(bank->total() == 800 ? 0 : 1);
+            }
+            int status = 0;
+            auto const deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (::waitpid(pid, &status, WNOHANG) == 0) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    ::kill(pid, SIGKILL);
+                    ::waitpid(pid, &status, 0);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            CHECK(WIFEXITED(status));
+            CHECK(WEXITSTATUS(status) == 0);
+
+            // The stopped process carries on without undoing any of it.
+            ::kill(stopped, SIGCONT);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ::kill(stopped, SIGKILL);
+            ::waitpid(stopped, nullptr, 0);
+            CHECK(bank->total() == 800);
+        }
+        bank->cas.recover();
+        for (auto & balance : bank->balances) {
+            CHECK(balance.load() <= 800);
+        }
+    }
+
+    TEST_CASE("every descriptor in use")
+    {
+        namespace detail = wjh::mwcas_detail;
+        struct Table
+        {
+            detail::Header headers[2];
+            detail::Entry entries[2][1];
+            Atomic<std::uint64_t> word;
+        };
+        auto table = Shared<Table>{};
+        auto const pool = detail::Pool{
+            reinterpret_cast<std::byte *>(table.get()),
+            table->headers,
+            2,
+            &table->entries[0][0],
+            1};
+        detail::Update const update[] = {{table->word, 0, 1}};
+
+        table->headers[0].lock.lock();
+        table->headers[1].lock.lock();
+        CHECK_THROWS_AS(
+            detail::compare_exchange(pool, update),
+            std::length_error);
+        CHECK(detail::load(pool, table->word) == 0);
+
+        table->headers[1].lock.unlock();
+        CHECK(detail::compare_exchange(pool, update));
+        CHECK(detail::load(pool, table->word) == 1);
+        table->headers[0].lock.unlock();
+    }
+
+    TEST_CASE("processes that die mid-update")
+    {
+        auto bank = Shared<Bank>{};
+        for (auto & balance : bank->balances) {
+            balance.store(100u);
+        }
+        for (int round = 0; round < 20; ++round) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                for (std::uint64_t n = 0;; ++n) {
+                    auto const from = n % Bank::accounts;
+                    bank->transfer(from, (from + 1 + n % 7) % Bank::accounts);
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ::kill(pid, SIGKILL);
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+
+            // Every other round, leave the update for the next one to find.
+            if (round % 2 == 1) {
+                CHECK(bank->cas.recover() <= 1);
+                for (auto & balance : bank->balances) {
+                    CHECK(balance.load() <= 800);
+                }
+            }
+            CHECK(bank->total() == 800);
+        }
+
+        auto const transfers = bank->cas.load(bank->transfers);
+        CHECK(bank->transfer(0, 1));
+        CHECK(bank->cas.load(bank->transfers) == transfers + 1);
+        CHECK(bank->total() == 800);
+    }
+}
+
+} // anonymous namespace
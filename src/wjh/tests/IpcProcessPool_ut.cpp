@@ -0,0 +1,220 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcProcessPool.hpp"
+
+#include <sys/wait.h>
+
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::Atomic;
+using wjh::IpcProcessPool;
+using wjh::IpcTaskQueue;
+using wjh::TaskId;
+using wjh::TaskState;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcProcessPool")
+{
+    using Queue = IpcTaskQueue<int, long, 8>;
+
+    long
+    square(int x)
+    {
+        if (x < 0) {
+            throw std::invalid_argument("negative");
+        }
+        return long(x) * x;
+    }
+
+    TEST_CASE("submit, run, and collect")
+    {
+        auto queue = Shared<Queue>{};
+        CHECK(not queue->run_one(square));
+
+        auto const id = queue->submit(7);
+        REQUIRE(id);
+        CHECK(queue->state(*id) == TaskState::pending);
+        CHECK(not queue->wait(*id, std::chrono::milliseconds(1)));
+        CHECK(not queue->collect(*id));
+
+        CHECK(queue->run_one(square));
+        CHECK(queue->state(*id) == TaskState::done);
+        CHECK(queue->wait(*id));
+        CHECK(queue->collect(*id) == 49);
+        CHECK(queue->state(*id) == TaskState::free);
+        CHECK(not queue->collect(*id));
+    }
+
+    TEST_CASE("a reused slot does not match an old id")
+    {
+        auto queue = Shared<IpcTaskQueue<int, long, 1>>{};
+        auto const id = queue->submit(7);
+        REQUIRE(id);
+        CHECK(not queue->submit(8));
+        CHECK(queue->run_one(square));
+        CHECK(queue->collect(*id) == 49);
+
+        auto const again = queue->submit(3);
+        REQUIRE(again);
+        CHECK(again->index() == id->index());
+        CHECK(*again != *id);
+        CHECK(queue->state(*id) == TaskState::free);
+        CHECK(not queue->collect(*id));
+        CHECK(queue->state(*again) == TaskState::pending);
+    }
+
+    TEST_CASE("a task that throws fails")
+    {
+        auto queue = Shared<Queue>{};
+        auto const id = queue->submit(-1);
+        REQUIRE(id);
+        CHECK(queue->run_one(square));
+        CHECK(queue->state(*id) == TaskState::failed);
+        CHECK(not queue->collect(*id));
+        CHECK(queue->state(*id) == TaskState::free);
+    }
+
+    TEST_CASE("batches")
+    {
+        auto queue = Shared<Queue>{};
+        std::vector<int> tasks{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+        std::vector<TaskId> ids(tasks.size());
+        CHECK(queue->submit(tasks, ids.data()) == 8u);
+        CHECK(not queue->submit(11));
+        CHECK(not queue->wait_all(
+            std::span(ids.data(), 8),
+            std::chrono::milliseconds(1)));
+
+        while (queue->run_one(square)) {
+        }
+        CHECK(queue->wait_all(std::span(ids.data(), 8)));
+        for (std::size_t i = 0; i < 8; ++i) {
+            CHECK(queue->collect(ids[i]) == long(tasks[i]) * tasks[i]);
+        }
+    }
+
+    TEST_CASE("pool")
+    {
+        constexpr int count = 2000;
+        auto queue = Shared<IpcTaskQueue<int, long, 256>>{};
+        IpcProcessPool pool(*queue, 4, square);
+        CHECK(pool.workers() == 4u);
+
+        // Keep the queue full, collecting results as they come in.
+        std::vector<TaskId> ids;
+        long sum = 0;
+        int next = 0;
+        while (next < count || not ids.empty()) {
+            std::vector<int> batch;
+            while (next < count && ids.size() + batch.size() < 256) {
+                batch.push_back(next++);
+            }
+            std::vector<TaskId> batch_ids(batch.size());
+            auto const n = queue->submit(batch, batch_ids.data());
+            REQUIRE(n == batch.size());
+            ids.insert(ids.end(), batch_ids.begin(), batch_ids.end());
+
+            pool.wait(ids.front());
+            while (not ids.empty() &&
+                   queue->state(ids.front()) == TaskState::done)
+            {
+                sum += queue->collect(ids.front()).value();
+                ids.erase(ids.begin());
+            }
+        }
+        CHECK(sum == long(count - 1) * count * (2 * count - 1) / 6);
+        pool.stop();
+        CHECK(pool.workers() == 0u);
+    }
+
+    TEST_CASE("the task of a dead worker is resubmitted")
+    {
+        struct Data
+        {
+            IpcTaskQueue<int, long, 16> queue;
+            Atomic<std::uint32_t> crashes;
+        };
+        auto data = Shared<Data>{};
+        Data * const d = data.get();
+
+        // The first two workers to run task 5 die doing so.
+        IpcProcessPool pool(d->queue, 2, [d](int x) {
+            if (x == 5 && d->crashes.fetch_add(1u) < 2) {
+                ::_exit(1);
+            }
+            return long(x) * x;
+        });
+
+        std::vector<int> tasks{1, 2, 3, 4, 5, 6, 7, 8};
+        std::vector<TaskId> ids(tasks.size());
+        REQUIRE(d->queue.submit(tasks, ids.data()) == tasks.size());
+        pool.wait_all(ids);
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            CHECK(d->queue.collect(ids[i]) == long(tasks[i]) * tasks[i]);
+        }
+        CHECK(d->crashes.load() == 3u);
+        CHECK(pool.workers() == 2u);
+    }
+
+    TEST_CASE("a task that keeps killing workers fails")
+    {
+        auto queue = Shared<Queue>{};
+        IpcProcessPool pool(
+            *queue,
+            2,
+            [](int x) {
+                if (x == 0) {
+                    ::_exit(1);
+                }
+                return long(x);
+            },
+            2);
+
+        auto const bad = queue->submit(0);
+        auto const good = queue->submit(1);
+        REQUIRE(bad);
+        REQUIRE(good);
+        pool.wait(*bad);
+        pool.wait(*good);
+        CHECK(queue->state(*bad) == TaskState::failed);
+        CHECK(not queue->collect(*bad));
+        CHECK(queue->collect(*good) == 1);
+    }
+
+    TEST_CASE("recover without a pool")
+    {
+        auto queue = Shared<Queue>{};
+        auto const id = queue->submit(4);
+        REQUIRE(id);
+
+        // An attached worker dies in the middle of the task.
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            queue->run_one([](int) -> long { ::_exit(0); });
+            ::_exit(1);
+        }
+        ::waitpid(pid, nullptr, 0);
+        CHECK(queue->state(*id) == TaskState::running);
+        CHECK(not queue->run_one(square));
+
+        CHECK(queue->recover() == 1u);
+        CHECK(queue->state(*id) == TaskState::pending);
+        CHECK(queue->recover() == 0u);
+        CHECK(queue->run_one(square));
+        CHECK(queue->collect(*id) == 16);
+    }
+}
+
+} // anonymous namespace
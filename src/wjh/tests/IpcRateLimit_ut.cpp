@@ -0,0 +1,187 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcRateLimit.hpp"
+
+#include <sys/wait.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::Atomic;
+using wjh::IpcSlidingWindowCounter;
+using wjh::IpcTokenBucket;
+using wjh::testing::Shared;
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+TEST_SUITE("IpcRateLimit")
+{
+    // Run @p fn in @p n child processes, and wait for them.
+    template <typename FnT>
+    void
+    in_children(int n, FnT fn)
+    {
+        std::vector<pid_t> pids;
+        for (int i = 0; i < n; ++i) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                fn();
+                ::_exit(0);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WIFEXITED(status));
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+    }
+
+    auto const t0 = Clock::time_point(seconds(100000));
+
+    TEST_CASE("token bucket")
+    {
+        auto bucket = Shared<IpcTokenBucket>{};
+        CHECK(not bucket->try_acquire(1, t0));
+        CHECK_THROWS_AS(
+            bucket->configure(1, IpcTokenBucket::max_burst + 1),
+            std::invalid_argument);
+
+        bucket->configure(10, 5);
+        CHECK(bucket->rate() == 10u);
+        CHECK(bucket->burst() == 5u);
+
+        SUBCASE("starts full") {
+            CHECK(bucket->available(t0) == 5u);
+            CHECK(bucket->try_acquire(3, t0));
+            CHECK(not bucket->try_acquire(3, t0));
+            CHECK(bucket->try_acquire(2, t0));
+            CHECK(not bucket->try_acquire(1, t0));
+            CHECK(bucket->available(t0) == 0u);
+        }
+
+        SUBCASE("refills at the rate, up to the burst") {
+            CHECK(bucket->try_acquire(5, t0));
+            CHECK(not bucket->try_acquire(1, t0 + milliseconds(99)));
+            CHECK(bucket->try_acquire(1, t0 + milliseconds(100)));
+            CHECK(bucket->available(t0 + milliseconds(350)) == 2u);
+            CHECK(bucket->available(t0 + seconds(1)) == 5u);
+            CHECK(bucket->available(t0 + seconds(100)) == 5u);
+        }
+
+        SUBCASE("an earlier clock reading adds nothing") {
+            CHECK(bucket->try_acquire(5, t0 + seconds(1)));
+            CHECK(not bucket->try_acquire(1, t0 + milliseconds(500)));
+        }
+
+        SUBCASE("batches") {
+            bucket->configure(10, 100);
+            CHECK(bucket->acquire_up_to(30, t0) == 30u);
+            CHECK(bucket->acquire_up_to(100, t0) == 70u);
+            CHECK(bucket->acquire_up_to(5, t0) == 0u);
+        }
+    }
+
+    TEST_CASE("token bucket keeps fractions of a token")
+    {
+        auto bucket = Shared<IpcTokenBucket>{};
+        bucket->configure(3, 1);
+        int granted = 0;
+        for (int ms = 0; ms < 10000; ++ms) {
+            granted += bucket->try_acquire(1, t0 + milliseconds(ms));
+        }
+        // The initial token, and three a second after that.
+        CHECK(granted >= 30);
+        CHECK(granted <= 31);
+    }
+
+    TEST_CASE("token bucket across processes")
+    {
+        struct Data
+        {
+            IpcTokenBucket bucket;
+            Atomic<std::uint32_t> granted;
+        };
+        auto data = Shared<Data>{};
+        data->bucket.configure(0, 1000);
+        in_children(4, [&] {
+            while (data->bucket.try_acquire()) {
+                data->granted.fetch_add(1u);
+            }
+        });
+        CHECK(data->granted.load() == 1000u);
+    }
+
+    TEST_CASE("sliding window")
+    {
+        auto counter = Shared<IpcSlidingWindowCounter<4>>{};
+        CHECK(not counter->try_acquire(1, t0));
+        counter->configure(10);
+        CHECK(counter->limit() == 10u);
+
+        SUBCASE("limit") {
+            CHECK(counter->try_acquire(6, t0));
+            CHECK(not counter->try_acquire(5, t0));
+            CHECK(counter->try_acquire(4, t0 + milliseconds(999)));
+            CHECK(counter->count(t0) == 10u);
+            CHECK(not counter->try_acquire(1, t0 + seconds(2)));
+        }
+
+        SUBCASE("the window slides") {
+            CHECK(counter->try_acquire(10, t0));
+            CHECK(counter->count(t0 + seconds(4)) == 10u);
+            CHECK(counter->count(t0 + milliseconds(4500)) == 5u);
+            CHECK(counter->try_acquire(5, t0 + milliseconds(4500)));
+            CHECK(not counter->try_acquire(1, t0 + milliseconds(4500)));
+            CHECK(counter->count(t0 + seconds(5)) == 5u);
+            CHECK(counter->count(t0 + seconds(9)) == 0u);
+        }
+
+        SUBCASE("batches") {
+            CHECK(counter->acquire_up_to(7, t0) == 7u);
+            CHECK(counter->acquire_up_to(7, t0) == 3u);
+            CHECK(counter->acquire_up_to(1, t0) == 0u);
+        }
+
+        SUBCASE("add ignores the limit") {
+            counter->add(20, t0);
+            CHECK(counter->count(t0) == 20u);
+            CHECK(not counter->try_acquire(1, t0));
+        }
+    }
+
+    TEST_CASE("sliding window across processes")
+    {
+        struct Data
+        {
+            IpcSlidingWindowCounter<4> counter;
+            Atomic<std::uint32_t> granted;
+        };
+        auto data = Shared<Data>{};
+        data->counter.configure(1000);
+        in_children(4, [&] {
+            while (data->counter.count(t0) < 1000u) {
+                if (data->counter.try_acquire(1, t0)) {
+                    data->granted.fetch_add(1u);
+                }
+            }
+        });
+        CHECK(data->granted.load() == 1000u);
+        CHECK(data->counter.count(t0) == 1000u);
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,240 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcRwLock.hpp"
+
+#include <sys/wait.h>
+
+#include <chrono>
+#include <cstring>
+#include <latch>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+
+TEST_SUITE("IpcRwLock")
+{
+    using wjh::IpcRwLock;
+
+    struct SharedData
+    {
+        IpcRwLock<> lock;
+        wjh::Atomic<int> readers;
+        wjh::Atomic<int> writers;
+        int counter;
+    };
+
+    using Shared = wjh::testing::Shared<SharedData>;
+
+    TEST_CASE("Can zero initialize")
+    {
+        alignas(IpcRwLock<>) unsigned char storage[sizeof(IpcRwLock<>)];
+        std::memset(storage, 0xff, sizeof(storage));
+        auto lock = ::new (storage) IpcRwLock<>{};
+
+        static unsigned char const zeros[sizeof(IpcRwLock<>)] = {};
+        CHECK(std::memcmp(zeros, lock, sizeof(zeros)) == 0);
+        CHECK(not lock->reader_biased());
+    }
+
+    TEST_CASE("Exclusive and shared ownership")
+    {
+        auto lock = IpcRwLock<>{};
+
+        REQUIRE(lock.try_lock());
+        CHECK(not lock.try_lock());
+        CHECK(not lock.try_lock_shared());
+        lock.unlock();
+
+        lock.lock_shared();
+        CHECK(lock.reader_biased());
+        REQUIRE(lock.try_lock_shared());
+        CHECK(not lock.try_lock());
+        lock.unlock_shared();
+        CHECK(not lock.try_lock());
+        lock.unlock_shared();
+
+        // The failed try_lock revoked the bias, but the lock is free.
+        CHECK(not lock.reader_biased());
+        REQUIRE(lock.try_lock());
+        lock.unlock();
+    }
+
+    TEST_CASE("Works with standard lock adapters")
+    {
+        auto lock = IpcRwLock<>{};
+        {
+            auto r1 = std::shared_lock(lock);
+            auto r2 = std::shared_lock(lock);
+            CHECK(not lock.try_lock());
+        }
+        auto w = std::unique_lock(lock);
+        CHECK(w.owns_lock());
+    }
+
+    TEST_CASE("Readers beyond the table fall back to the underlying lock")
+    {
+        auto lock = IpcRwLock<4>{};
+        for (int i = 0; i < 5; ++i) {
+            lock.lock_shared();
+        }
+        CHECK(not lock.try_lock());
+        for (int i = 0; i < 5; ++i) {
+            lock.unlock_shared();
+        }
+        REQUIRE(lock.try_lock());
+        lock.unlock();
+    }
+
+    TEST_CASE("Too many nested read locks")
+    {
+        auto lock = IpcRwLock<>{};
+        int n = 0;
+        CHECK_THROWS_AS(
+            [&] {
+                for (;; ++n) {
+                    lock.lock_shared();
+                }
+            }(),
+            std::length_error);
+        CHECK(n > 0);
+        for (; n > 0; --n) {
+            lock.unlock_shared();
+        }
+        REQUIRE(lock.try_lock());
+        lock.unlock();
+    }
+
+    TEST_CASE("Unlocking a read lock the thread does not hold")
+    {
+        auto lock = IpcRwLock<>{};
+        std::thread reader([&] { lock.lock_shared(); });
+        reader.join();
+
+        // The reader's slot stays held.
+        lock.unlock_shared();
+        CHECK(not lock.try_lock());
+    }
+
+    TEST_CASE("Writer waits for readers")
+    {
+        auto shared = Shared{};
+        shared->lock.lock_shared();
+
+        auto started = std::latch{1};
+        std::thread writer([&] {
+            started.count_down();
+            auto guard = std::lock_guard(shared->lock);
+            shared->counter = 2;
+        });
+        started.wait();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(shared->counter == 0);
+        shared->counter = 1;
+        shared->lock.unlock_shared();
+        writer.join();
+        CHECK(shared->counter == 2);
+    }
+
+    TEST_CASE("Concurrent readers and writers with threads")
+    {
+        auto shared = Shared{};
+        int const num_threads = 8;
+        int const iterations = 5000;
+        auto latch = std::latch{num_threads};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&, i] {
+                latch.arrive_and_wait();
+                for (int k = 0; k < iterations; ++k) {
+                    if (i == 0 || k % 16 == 0) {
+                        auto guard = std::lock_guard(shared->lock);
+                        CHECK(shared->writers.fetch_add(1) == 0);
+                        CHECK(shared->readers.load() == 0);
+                        ++shared->counter;
+                        shared->writers.fetch_sub(1);
+                    } else {
+                        auto guard = std::shared_lock(shared->lock);
+                        shared->readers.fetch_add(1);
+                        CHECK(shared->writers.load() == 0);
+                        shared->readers.fetch_sub(1);
+                    }
+                }
+            });
+        }
+        for (auto & t : threads) {
+            t.join();
+        }
+        CHECK(shared->counter == iterations + (num_threads - 1) * 313);
+    }
+
+    TEST_CASE("Concurrent readers and writers with processes")
+    {
+        auto shared = Shared{};
+        int const num_processes = 6;
+        int const iterations = 3000;
+        for (int i = 0; i < num_processes; ++i) {
+            if (::fork() == 0) {
+                int failures = 0;
+                for (int k = 0; k < iterations; ++k) {
+                    if (k % 8 == 0) {
+                        auto guard = std::lock_guard(shared->lock);
+                        failures += shared->writers.fetch_add(1) != 0;
+                        failures += shared->readers.load() != 0;
+                        ++shared->counter;
+                        shared->writers.fetch_sub(1);
+                    } else {
+                        auto guard = std::shared_lock(shared->lock);
+                        shared->readers.fetch_add(1);
+                        failures += shared->writers.load() != 0;
+                        shared->readers.fetch_sub(1);
+                    }
+                }
+                ::_exit(failures == 0 ? 0 : 1);
+            }
+        }
+        for (int i = 0; i < num_processes; ++i) {
+            int status = -1;
+            ::wait(&status);
+            CHECK(WIFEXITED(status));
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+        CHECK(shared->counter == num_processes * iterations / 8);
+    }
+
+    TEST_CASE("Slots held by dead readers are cleared")
+    {
+        auto shared = Shared{};
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            shared->lock.lock_shared();
+            shared->lock.lock_shared();
+            ::_exit(0);
+        }
+        int status = -1;
+        ::waitpid(pid, &status, 0);
+        REQUIRE(WIFEXITED(status));
+
+        shared->lock.lock();
+        shared->lock.unlock();
+        shared->lock.lock_shared();
+        shared->lock.unlock_shared();
+        REQUIRE(shared->lock.try_lock());
+        shared->lock.unlock();
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,318 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcSkipList.hpp"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <functional>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcHeap;
+using wjh::IpcSkipList;
+
+TEST_SUITE("IpcSkipList")
+{
+    // Anonymous shared memory, that survives fork, with the anchor of a
+    // list on the first page, and a heap on the rest.
+    struct Region
+    {
+        static constexpr std::size_t size = 8 << 20;
+
+        Region()
+        : p(static_cast<std::byte *>(::mmap(
+              nullptr,
+              size,
+              PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_ANONYMOUS,
+              -1,
+              0)))
+        {
+            REQUIRE(static_cast<void *>(p) != MAP_FAILED);
+        }
+
+        ~Region() { ::munmap(p, size); }
+
+        void operator = (Region &&) = delete;
+
+        wjh::Atomic<std::uint64_t> & anchor() const
+        {
+            return *reinterpret_cast<wjh::Atomic<std::uint64_t> *>(p);
+        }
+
+        IpcHeap heap() const
+        {
+            return IpcHeap(std::span(p + 4096, size - 4096));
+        }
+
+        std::byte * p;
+    };
+
+    using List = IpcSkipList<std::uint64_t, std::uint64_t>;
+
+    std::vector<std::uint64_t> keys(List const & list)
+    {
+        std::vector<std::uint64_t> result;
+        list.scan(0, ~std::uint64_t(0), [&](auto key, auto) {
+            result.push_back(key);
+        });
+        return result;
+    }
+
+    TEST_CASE("insert, get, and erase")
+    {
+        auto region = Region{};
+        auto heap = region.heap();
+        auto list = List(heap, region.anchor());
+        CHECK(list.empty());
+        CHECK(not list.get(1));
+
+        CHECK(list.insert(1, 100));
+        CHECK(not list.insert(1, 200));
+        CHECK(list.get(1) == 100);
+        CHECK(list.contains(1));
+        CHECK(list.size() == 1);
+
+        CHECK(list.erase(1));
+        CHECK(not list.erase(1));
+        CHECK(not list.contains(1));
+        CHECK(list.empty());
+
+        CHECK(list.insert(1, 300));
+        CHECK(list.get(1) == 300);
+    }
+
+    TEST_CASE("ordered")
+    {
+        auto region = Region{};
+        auto heap = region.heap();
+        auto list = List(heap, region.anchor());
+        for (std::uint64_t i = 0; i < 1000; ++i) {
+            CHECK(list.insert((i * 7919) % 1000, i));
+        }
+        CHECK(list.size() == 1000);
+        for (std::uint64_t key = 0; key < 1000; key += 3) {
+            CHECK(list.erase(key));
+        }
+
+        std::vector<std::uint64_t> expected;
+        for (std::uint64_t key = 0; key < 1000; ++key) {
+            if (key % 3 != 0) {
+                expected.push_back(key);
+            }
+        }
+        CHECK(keys(list) == expected);
+
+        SUBCASE("range") {
+            std::vector<std::uint64_t> seen;
+            auto const n = list.scan(100, 110, [&](auto key, auto) {
+                seen.push_back(key);
+            });
+            CHECK(n == seen.size());
+            auto const range =
+                std::vector<std::uint64_t>{100, 101, 103, 104, 106, 107, 109};
+            CHECK(seen == range);
+            CHECK(list.scan(2000, 3000, [](auto, auto) { }) == 0);
+        }
+
+        SUBCASE("another handle") {
+            auto other = List(heap, region.anchor());
+            CHECK(keys(other) == expected);
+            CHECK(other.get(1) == list.get(1));
+        }
+    }
+
+    TEST_CASE("comparator")
+    {
+        auto region = Region{};
+        auto heap = region.heap();
+        auto list = IpcSkipList<int, int, std::greater<int>>(
+            heap,
+            region.anchor());
+        for (int i = 0; i < 10; ++i) {
+            list.insert(i, i);
+        }
+        std::vector<int> seen;
+        list.scan(7, 2, [&](int key, int) { seen.push_back(key); });
+        CHECK(seen == std::vector<int>{7, 6, 5, 4, 3});
+    }
+
+    TEST_CASE("erased nodes are reused")
+    {
+        auto region = Region{};
+        auto heap = region.heap();
+        auto list = List(heap, region.anchor());
+        for (std::uint64_t key = 0; key < 1000; ++key) {
+            list.insert(key, key);
+            list.erase(key);
+        }
+        auto const used = heap.used();
+        for (std::uint64_t key = 0; key < 10000; ++key) {
+            list.insert(key, key);
+            list.erase(key);
+        }
+        CHECK(heap.used() == used);
+
+        SUBCASE("not while a reader holds them") {
+            list.insert(1, 1);
+            list.scan(0, 10, [&](auto, auto) {
+                auto other = List(heap, region.anchor());
+                for (std::uint64_t key = 100; key < 1100; ++key) {
+                    other.insert(key, key);
+                    other.erase(key);
+                }
+                // The node for 1 is still readable.
+                CHECK(list.get(1) == 1);
+            });
+            CHECK(heap.used() > used);
+        }
+    }
+
+    TEST_CASE("dead readers do not stop reclamation")
+    {
+        auto region = Region{};
+        auto heap = region.heap();
+        auto list = List(heap, region.anchor());
+        list.insert(1, 1);
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            auto child = List(heap, region.anchor());
+            child.scan(0, 10, [](auto, auto) { ::_exit(0); });
+            ::_exit(1);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        REQUIRE(WEXITSTATUS(status) == 0);
+
+        for (std::uint64_t key = 100; key < 1100; ++key) {
+            list.insert(key, key);
+            list.erase(key);
+        }
+        auto const used = heap.used();
+        for (std::uint64_t key = 100; key < 10100; ++key) {
+            list.insert(key, key);
+            list.erase(key);
+        }
+        CHECK(heap.used() == used);
+    }
+
+    TEST_CASE("the same key inserted and erased by several processes")
+    {
+        auto region = Region{};
+        {
+            auto heap = region.heap();
+            auto list = List(heap, region.anchor());
+        }
+        std::vector<pid_t> pids;
+        for (std::uint64_t p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto heap = region.heap();
+                auto list = List(heap, region.anchor());
+                bool ok = true;
+                for (int round = 0; round < 20000; ++round) {
+                    // Every process races on key 0, and reuses the nodes
+                    // freed for it for a key of its own.
+                    list.insert(0, 0);
+                    list.erase(0);
+                    auto const mine = p + 1;
+                    ok = list.insert(mine, mine * 3) && ok;
+
+                    // A node freed while still linked breaks the order, or
+                    // hides a key.
+                    std::uint64_t count = 0;
+                    std::uint64_t last = 0;
+                    list.scan(0, 5, [&](auto key, auto value) {
+                        ok = ok && value == key * 3 &&
+                            (count == 0 || key > last);
+                        last = key;
+                        ++count;
+                    });
+                    ok = ok && count <= 5 && list.get(mine) == mine * 3;
+                    ok = list.erase(mine) && ok;
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WIFEXITED(status));
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+
+        auto heap = region.heap();
+        auto list = List(heap, region.anchor());
+        CHECK(keys(list).empty());
+        CHECK(list.empty());
+    }
+
+    TEST_CASE("processes")
+    {
+        auto region = Region{};
+        {
+            auto heap = region.heap();
+            auto list = List(heap, region.anchor());
+        }
+        std::vector<pid_t> pids;
+        for (std::uint64_t p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto heap = region.heap();
+                auto list = List(heap, region.anchor());
+                bool ok = true;
+                for (std::uint64_t round = 0; round < 4; ++round) {
+                    // Keys interleave with those of the other processes, so
+                    // they share neighbors.
+                    for (std::uint64_t key = p; key < 2000; key += 4) {
+                        ok = list.insert(key, key * 3) && ok;
+                    }
+                    for (std::uint64_t key = p; key < 2000; key += 8) {
+                        ok = list.erase(key) && ok;
+                    }
+                    std::uint64_t last = 0;
+                    list.scan(0, 2000, [&](auto key, auto value) {
+                        ok = ok && value == key * 3 &&
+                            (last == 0 || key > last);
+                        last = key;
+                    });
+                    if (round < 3) {
+                        for (std::uint64_t key = p + 4; key < 2000; key += 8) {
+                            ok = list.erase(key) && ok;
+                        }
+                    }
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+
+        auto heap = region.heap();
+        auto list = List(heap, region.anchor());
+        std::vector<std::uint64_t> expected;
+        for (std::uint64_t key = 0; key < 2000; ++key) {
+            if (key % 8 >= 4) {
+                expected.push_back(key);
+            }
+        }
+        CHECK(keys(list) == expected);
+        CHECK(list.size() == expected.size());
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,302 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcSlotMap.hpp"
+
+#include <sys/wait.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcSlotMap;
+using wjh::ProcessId;
+using wjh::SlotHandle;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcSlotMap")
+{
+    struct Item
+    {
+        int a;
+        int b;
+    };
+
+    TEST_CASE("insert, find, and erase")
+    {
+        auto map = Shared<IpcSlotMap<Item, 4>>{};
+        CHECK(map->empty());
+
+        auto const h = map->insert(Item{1, 2});
+        REQUIRE(h);
+        CHECK(map->size() == 1u);
+        CHECK(map->contains(h));
+        CHECK(map->get(h)->b == 2);
+        CHECK(map->load(h)->a == 1);
+        CHECK(map->owner(h) == ProcessId::current());
+        CHECK(not map->contains(SlotHandle{}));
+        CHECK(not map->contains(SlotHandle::make(100, 1)));
+
+        map->get(h)->a = 10;
+        CHECK(map->load(h)->a == 10);
+
+        CHECK(map->erase(h));
+        CHECK(not map->erase(h));
+        CHECK(map->empty());
+        CHECK(map->get(h) == nullptr);
+        CHECK(not map->load(h));
+        CHECK(map->owner(h) == ProcessId::null());
+
+        // The slot is reused, but the stale handle does not match it.
+        auto const again = map->insert(Item{3, 4});
+        CHECK(again.index() == h.index());
+        CHECK(again != h);
+        CHECK(not map->contains(h));
+        CHECK(map->get(again)->a == 3);
+    }
+
+    TEST_CASE("full")
+    {
+        auto map = Shared<IpcSlotMap<Item, 4>>{};
+        std::vector<SlotHandle> handles;
+        for (int i = 0; i < 4; ++i) {
+            handles.push_back(map->insert(Item{i, i}));
+            CHECK(handles.back());
+        }
+        CHECK(not map->insert(Item{}));
+        CHECK(map->erase(handles[2]));
+        CHECK(map->insert(Item{}).index() == handles[2].index());
+        CHECK(not map->insert(Item{}));
+    }
+
+    TEST_CASE("for_each")
+    {
+        auto map = Shared<IpcSlotMap<Item, 16>>{};
+        std::vector<SlotHandle> handles;
+        for (int i = 0; i < 8; ++i) {
+            handles.push_back(map->insert(Item{i, 0}));
+        }
+        map->erase(handles[1]);
+        map->erase(handles[5]);
+
+        int count = 0;
+        int sum = 0;
+        map->for_each([&](SlotHandle h, Item & item) {
+            CHECK(map->contains(h));
+            ++count;
+            sum += item.a;
+            item.b = 1;
+        });
+        CHECK(count == 6);
+        CHECK(sum == 0 + 2 + 3 + 4 + 6 + 7);
+        CHECK(map->get(handles[7])->b == 1);
+    }
+
+    TEST_CASE("orphans of dead processes")
+    {
+        auto map = Shared<IpcSlotMap<Item, 64>>{};
+        auto const mine = map->insert(Item{1, 1});
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            for (int i = 0; i < 10; ++i) {
+                map->insert(Item{i, i});
+            }
+            ::_exit(0);
+        }
+        ::waitpid(pid, nullptr, 0);
+        CHECK(map->size() == 11u);
+        CHECK(map->reclaim_orphans() == 10u);
+        CHECK(map->size() == 1u);
+        CHECK(map->contains(mine));
+        CHECK(map->reclaim_orphans() == 0u);
+    }
+
+    TEST_CASE("slots of processes that die inserting")
+    {
+        namespace detail = wjh::slotmap_detail;
+        constexpr std::uint32_t capacity = 4;
+        struct Table
+        {
+            detail::Control control;
+            detail::Slot slots[capacity];
+        };
+        auto table = Shared<Table>{};
+        auto & [control, slots] = *table;
+
+        // One slot comes off the free list, and one is never used before.
+        auto const used = detail::acquire(control, slots, capacity);
+        REQUIRE(used);
+        slots[*used].generation.store(1u);
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            detail::release(control, slots, SlotHandle::make(*used, 1u));
+            auto const a = detail::acquire(control, slots, capacity);
+            auto const b = detail::acquire(control, slots, capacity);
+            ::_exit(a == used && b == 1u ? 0 : 1);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        REQUIRE(WEXITSTATUS(status) == 0);
+
+        CHECK(detail::reclaim(control, slots) == 0u);
+        std::set<std::uint32_t> taken;
+        while (auto const index = detail::acquire(control, slots, capacity)) {
+            taken.insert(*index);
+        }
+        CHECK(taken == std::set<std::uint32_t>{0, 1, 2, 3});
+    }
+
+    TEST_CASE("inserts past a stopped process")
+    {
+        namespace detail = wjh::slotmap_detail;
+        constexpr std::uint32_t capacity = 4;
+        struct Table
+        {
+            detail::Control control;
+            detail::Slot slots[capacity];
+        };
+        auto table = Shared<Table>{};
+        auto & [control, slots] = *table;
+        auto const used = detail::acquire(control, slots, capacity);
+        REQUIRE(used);
+        slots[*used].generation.store(1u);
+        REQUIRE(detail::release(control, slots, SlotHandle::make(*used, 1u)));
+
+        // A live process left on the first free slot holds up nobody.
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ::pause();
+            ::_exit(0);
+        }
+        slots[*used].owner.store(ProcessId(pid));
+        CHECK(detail::acquire(control, slots, capacity) == used);
+        CHECK(slots[*used].owner.load() == ProcessId::current());
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, nullptr, 0);
+    }
+
+    TEST_CASE("reclaim alongside inserts")
+    {
+        namespace detail = wjh::slotmap_detail;
+        constexpr std::uint32_t capacity = 1u << 14;
+        struct Table
+        {
+            detail::Control control;
+            detail::Slot slots[capacity];
+            wjh::Atomic<bool> done;
+        };
+        auto table = Shared<Table>{};
+        auto & [control, slots, done] = *table;
+
+        // Every slot has been used, so an insert that finds the free list
+        // empty is turned away.
+        for (std::uint32_t i = 0; i < capacity; ++i) {
+            detail::acquire(control, slots, capacity);
+            slots[i].generation.store(1u);
+        }
+        for (std::uint32_t i = 0; i < capacity; ++i) {
+            detail::release(control, slots, SlotHandle::make(i, 1u));
+        }
+        REQUIRE(control.high_water.load() == capacity);
+
+        // Strand a slot at a time, and reclaim it, over and over.
+        pid_t reclaimer = ::fork();
+        if (reclaimer == 0) {
+            while (not done.load()) {
+                pid_t pid = ::fork();
+                if (pid == 0) {
+                    detail::acquire(control, slots, capacity);
+                    ::_exit(0);
+                }
+                ::waitpid(pid, nullptr, 0);
+                detail::reclaim(control, slots);
+            }
+            ::_exit(0);
+        }
+
+        // Stop it wherever it happens to be, and insert meanwhile.
+        bool ok = true;
+        for (int i = 0; i < 200; ++i) {
+            ::usleep(100u + 37u * unsigned(i % 13));
+            ::kill(reclaimer, SIGSTOP);
+            ::waitpid(reclaimer, nullptr, WUNTRACED);
+            auto const index = detail::acquire(control, slots, capacity);
+            ok = ok && index;
+            if (index) {
+                auto const generation = slots[*index].generation.load() + 1;
+                slots[*index].generation.store(generation);
+                detail::release(
+                    control,
+                    slots,
+                    SlotHandle::make(*index, generation));
+            }
+            ::kill(reclaimer, SIGCONT);
+        }
+        CHECK(ok);
+        done.store(true);
+        int status = 0;
+        ::waitpid(reclaimer, &status, 0);
+        CHECK(WIFEXITED(status));
+
+        detail::reclaim(control, slots);
+        std::uint32_t taken = 0;
+        while (detail::acquire(control, slots, capacity)) {
+            ++taken;
+        }
+        CHECK(taken == capacity);
+    }
+
+    TEST_CASE("concurrent processes")
+    {
+        constexpr int nprocs = 4;
+        constexpr int count = 5000;
+        auto map = Shared<IpcSlotMap<Item, 64>>{};
+
+        std::vector<pid_t> pids;
+        for (int p = 0; p < nprocs; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                bool ok = true;
+                std::vector<SlotHandle> held;
+                for (int i = 0; i < count; ++i) {
+                    if (held.size() < 8) {
+                        auto const h = map->insert(Item{p, i});
+                        ok = ok && h;
+                        held.push_back(h);
+                    } else {
+                        auto const h = held[std::size_t(i) % held.size()];
+                        auto const item = map->load(h);
+                        ok = ok && item && item->a == p;
+                        ok = ok && map->erase(h);
+                        held.erase(held.begin() + i % 8);
+                    }
+                }
+                for (auto h : held) {
+                    ok = ok && map->erase(h);
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WIFEXITED(status));
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+        CHECK(map->empty());
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,187 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcStm.hpp"
+
+#include <sys/wait.h>
+
+#include <chrono>
+#include <csignal>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::Atomic;
+using wjh::IpcStm;
+using wjh::IpcTx;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcStm")
+{
+    // Accounts, whose total never changes, and a count of the transfers
+    // between them.
+    struct Bank
+    {
+        static constexpr std::uint64_t accounts = 16;
+
+        IpcStm<64, 8, 16> stm;
+        Atomic<std::uint64_t> balances[accounts];
+        Atomic<std::uint64_t> transfers;
+
+        void transfer(std::uint64_t from, std::uint64_t to)
+        {
+            ipc_atomically(stm, [&](IpcTx & tx) {
+                auto const a = tx.load(balances[from]);
+                if (a > 0) {
+                    tx.store(balances[from], a - 1);
+                    tx.store(balances[to], tx.load(balances[to]) + 1);
+                    tx.store(transfers, tx.load(transfers) + 1);
+                }
+            });
+        }
+
+        std::uint64_t total()
+        {
+            return ipc_atomically(stm, [&](IpcTx & tx) {
+                std::uint64_t result = 0;
+                for (auto & balance : balances) {
+                    result += tx.load(balance);
+                }
+                return result;
+            });
+        }
+    };
+
+    TEST_CASE("transactions")
+    {
+        auto bank = Shared<Bank>{};
+        auto & stm = bank->stm;
+        auto & a = bank->balances[0];
+        auto & b = bank->balances[1];
+
+        ipc_atomically(stm, [&](IpcTx & tx) {
+            tx.store(a, 10);
+            CHECK(tx.load(a) == 10);
+            tx.store(b, tx.load(a) + 10);
+        });
+        CHECK(a.load() == 10);
+        CHECK(b.load() == 20);
+        CHECK(stm.version() == 1);
+
+        SUBCASE("reads write nothing") {
+            auto const sum = ipc_atomically(stm, [&](IpcTx & tx) {
+                return tx.load(a) + tx.load(b);
+            });
+            CHECK(sum == 30);
+            CHECK(stm.version() == 1);
+        }
+
+        SUBCASE("exceptions discard writes") {
+            CHECK_THROWS_AS(
+                ipc_atomically(
+                    stm,
+                    [&](IpcTx & tx) {
+                        tx.store(a, 0);
+                        throw std::runtime_error("no");
+                    }),
+                std::runtime_error);
+            CHECK(a.load() == 10);
+            CHECK(stm.version() == 1);
+        }
+
+        SUBCASE("too many writes") {
+            CHECK_THROWS_AS(
+                ipc_atomically(
+                    stm,
+                    [&](IpcTx & tx) {
+                        for (auto & balance : bank->balances) {
+                            tx.store(balance, 1);
+                        }
+                        tx.store(bank->transfers, 1);
+                    }),
+                std::length_error);
+            CHECK(a.load() == 10);
+        }
+    }
+
+    TEST_CASE("processes")
+    {
+        auto bank = Shared<Bank>{};
+        for (auto & balance : bank->balances) {
+            balance.store(100u);
+        }
+        std::vector<pid_t> pids;
+        for (std::uint64_t p = 0; p < 4; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                bool ok = true;
+                for (std::uint64_t n = 0; n < 20000; ++n) {
+                    auto const from = (n * 5 + p) % Bank::accounts;
+                    bank->transfer(from, (from + 1 + n % 7) % Bank::accounts);
+                    if (n % 16 == 0) {
+                        // A consistent snapshot, even while others commit.
+                        ok = ok && bank->total() == 1600;
+                    }
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WEXITSTATUS(status) == 0);
+        }
+        CHECK(bank->total() == 1600);
+        CHECK(bank->stm.recover() == 0);
+        CHECK(bank->stm.version() >= bank->transfers.load());
+    }
+
+    TEST_CASE("processes that die while committing")
+    {
+        auto bank = Shared<Bank>{};
+        for (auto & balance : bank->balances) {
+            balance.store(100u);
+        }
+        for (int round = 0; round < 20; ++round) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                for (std::uint64_t n = 0;; ++n) {
+                    auto const from = n % Bank::accounts;
+                    bank->transfer(from, (from + 1 + n % 7) % Bank::accounts);
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ::kill(pid, SIGKILL);
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+
+            // Every other round, leave the commit for a transaction to find.
+            if (round % 2 == 1) {
+                CHECK(bank->stm.recover() <= 1);
+                std::uint64_t total = 0;
+                for (auto & balance : bank->balances) {
+                    total += balance.load();
+                }
+                CHECK(total == 1600);
+            }
+            CHECK(bank->total() == 1600);
+        }
+
+        auto const transfers = bank->transfers.load();
+        bank->transfer(0, 1);
+        CHECK(bank->transfers.load() == transfers + 1);
+        CHECK(bank->total() == 1600);
+    }
+}
+
+} // anonymous namespace
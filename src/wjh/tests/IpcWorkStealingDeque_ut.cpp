@@ -0,0 +1,170 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/IpcWorkStealingDeque.hpp"
+
+#include <sys/wait.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::Atomic;
+using wjh::IpcWorkStealingDeque;
+using wjh::ProcessId;
+using wjh::testing::Shared;
+
+TEST_SUITE("IpcWorkStealingDeque")
+{
+    using Deque = IpcWorkStealingDeque<std::uint32_t, 8, 4>;
+
+    TEST_CASE("owner and thieves")
+    {
+        auto deque = Shared<Deque>{};
+        CHECK(deque->owner() == ProcessId::null());
+        CHECK(deque->claim());
+        CHECK(deque->owner() == ProcessId::current());
+        CHECK(deque->claim());
+        CHECK(not deque->pop());
+        CHECK(not deque->steal());
+
+        for (std::uint32_t i = 1; i <= 5; ++i) {
+            CHECK(deque->push(i));
+        }
+        CHECK(deque->size() == 5u);
+
+        // The owner takes the newest, thieves the oldest.
+        CHECK(deque->pop() == 5u);
+        CHECK(deque->steal() == 1u);
+        CHECK(deque->pop() == 4u);
+        CHECK(deque->steal() == 2u);
+        CHECK(deque->pop() == 3u);
+        CHECK(not deque->pop());
+        CHECK(not deque->steal());
+        CHECK(deque->empty());
+
+        deque->release();
+        CHECK(deque->owner() == ProcessId::null());
+    }
+
+    TEST_CASE("spill")
+    {
+        auto deque = Shared<Deque>{};
+        REQUIRE(deque->claim());
+        for (std::uint32_t i = 0; i < 12; ++i) {
+            CHECK(deque->push(i));
+        }
+        CHECK(not deque->push(12));
+        CHECK(deque->size() == 12u);
+
+        // The ring drains first, then the spilled tasks.
+        std::vector<std::uint32_t> taken;
+        while (auto task = deque->steal()) {
+            taken.push_back(*task);
+        }
+        CHECK(
+            taken ==
+            std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5, 6, 7, 11, 10, 9, 8});
+    }
+
+    TEST_CASE("a dead owner's deque is taken over")
+    {
+        auto deque = Shared<Deque>{};
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            if (deque->claim()) {
+                deque->push(1);
+                deque->push(2);
+            }
+            ::_exit(0);
+        }
+        ::waitpid(pid, nullptr, 0);
+
+        CHECK(deque->owner() != ProcessId::null());
+        CHECK(deque->owner() != ProcessId::current());
+        REQUIRE(deque->claim());
+        CHECK(deque->pop() == 2u);
+        CHECK(deque->pop() == 1u);
+    }
+
+    TEST_CASE("a live owner's deque is not")
+    {
+        auto deque = Shared<Deque>{};
+        REQUIRE(deque->claim());
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ::_exit(deque->claim() ? 1 : 0);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        CHECK(WEXITSTATUS(status) == 0);
+    }
+
+    TEST_CASE("every task is taken once")
+    {
+        constexpr std::uint32_t count = 100000;
+        constexpr int nthieves = 3;
+        struct Data
+        {
+            IpcWorkStealingDeque<std::uint32_t, 64> deque;
+            Atomic<std::uint32_t> done;
+            Atomic<std::uint8_t> taken[count];
+        };
+        auto data = Shared<Data>{};
+
+        std::vector<pid_t> pids;
+        for (int p = 0; p < nthieves; ++p) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                while (data->done.load() < count) {
+                    if (auto task = data->deque.steal()) {
+                        data->taken[*task].fetch_add(1u);
+                        data->done.fetch_add(1u);
+                    }
+                }
+                ::_exit(0);
+            }
+            pids.push_back(pid);
+        }
+
+        REQUIRE(data->deque.claim());
+        for (std::uint32_t i = 0; i < count; ++i) {
+            while (not data->deque.push(i)) {
+                if (auto task = data->deque.pop()) {
+                    data->taken[*task].fetch_add(1u);
+                    data->done.fetch_add(1u);
+                }
+            }
+            if (i % 3 == 0) {
+                if (auto task = data->deque.pop()) {
+                    data->taken[*task].fetch_add(1u);
+                    data->done.fetch_add(1u);
+                }
+            }
+        }
+        while (auto task = data->deque.pop()) {
+            data->taken[*task].fetch_add(1u);
+            data->done.fetch_add(1u);
+        }
+        for (auto pid : pids) {
+            ::waitpid(pid, nullptr, 0);
+        }
+
+        CHECK(data->done.load() == count);
+        std::uint32_t wrong = 0;
+        for (auto const & taken : data->taken) {
+            wrong += taken.load() != 1u;
+        }
+        CHECK(wrong == 0u);
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,170 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/Numa.hpp"
+
+#include "wjh/Segment.hpp"
+
+#include <sys/wait.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcNodeReplicated;
+using wjh::NumaPolicy;
+using wjh::Segment;
+
+TEST_SUITE("Numa")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_numa.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    struct Pair
+    {
+        std::uint64_t a;
+        std::uint64_t b;
+    };
+
+    using Replicated = IpcNodeReplicated<Pair, 4>;
+
+    TEST_CASE("topology")
+    {
+        CHECK(wjh::numa_nodes() >= 1u);
+        CHECK(wjh::current_numa_node() < wjh::numa_nodes());
+        CHECK(Replicated::replicas() >= 1u);
+        CHECK(Replicated::replicas() <= 4u);
+    }
+
+    TEST_CASE("policy")
+    {
+        auto dir = TempDir{};
+        auto segment = Segment(dir.path / "seg", 16 * Segment::page_size());
+        auto const region = std::span(segment.data(), segment.size());
+
+        // Without NUMA support, these return false, but never throw.
+        auto const supported =
+            wjh::set_numa_policy(region, NumaPolicy::interleave);
+        CHECK(
+            wjh::set_numa_policy(region.subspan(10, 100), NumaPolicy::local) ==
+            supported);
+        CHECK(
+            wjh::set_numa_policy(region, NumaPolicy::preferred, 0, true) ==
+            supported);
+        CHECK(wjh::set_numa_policy(region, NumaPolicy::bind) == supported);
+        CHECK_THROWS_AS(
+            wjh::set_numa_policy(
+                region,
+                NumaPolicy::preferred,
+                static_cast<unsigned>(wjh::numa_nodes())),
+            std::system_error);
+    }
+
+    TEST_CASE("replicated value")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "seg";
+        auto segment = Segment(path, Replicated::required_size());
+        auto & value = *reinterpret_cast<Replicated *>(segment.data());
+        CHECK(value.load().a == 0u);
+        value.place();
+
+        SUBCASE("store and update") {
+            value.store(Pair{1, 1});
+            CHECK(value.load().a == 1u);
+            auto const next = value.update([](Pair const & p) {
+                return Pair{p.a + 1, p.b + 1};
+            });
+            CHECK(next.b == 2u);
+            CHECK(value.load().b == 2u);
+        }
+
+        SUBCASE("concurrent writers and readers") {
+            constexpr int nprocs = 3;
+            constexpr std::uint64_t count = 2000;
+            std::vector<pid_t> pids;
+            for (int p = 0; p < nprocs; ++p) {
+                pid_t pid = ::fork();
+                if (pid == 0) {
+                    auto child = Segment(path);
+                    auto & shared =
+                        *reinterpret_cast<Replicated *>(child.data());
+                    for (std::uint64_t i = 0; i < count; ++i) {
+                        shared.update([](Pair const & v) {
+                            return Pair{v.a + 1, v.b + 1};
+                        });
+                        auto const seen = shared.load();
+                        if (seen.a != seen.b) {
+                            ::_exit(1);
+                        }
+                    }
+                    ::_exit(0);
+                }
+                pids.push_back(pid);
+            }
+            for (auto pid : pids) {
+                int status = 0;
+                ::waitpid(pid, &status, 0);
+                CHECK(WIFEXITED(status));
+                CHECK(WEXITSTATUS(status) == 0);
+            }
+            auto const total = value.load();
+            CHECK(total.a == nprocs * count);
+            CHECK(total.b == nprocs * count);
+        }
+
+        SUBCASE("a dead writer is repaired") {
+            value.store(Pair{5, 5});
+
+            // Leave the first replica marked as changing, with the lock held
+            // by a process that is gone.
+            using Replica = wjh::numa_detail::Replica<Pair>;
+            auto & replica = *reinterpret_cast<Replica *>(
+                segment.data() + Segment::page_size());
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                auto child = Segment(path);
+                auto & shared = *reinterpret_cast<Replicated *>(child.data());
+                shared.update([](Pair const & v) {
+                    ::_exit(0);
+                    return v;
+                });
+            }
+            ::waitpid(pid, nullptr, 0);
+            replica.seq.fetch_add(1u);
+
+            auto const seen = value.load();
+            CHECK(seen.a == 5u);
+            CHECK(seen.b == 5u);
+            CHECK(replica.seq.load() % 2 == 0u);
+            value.store(Pair{6, 6});
+            CHECK(value.load().a == 6u);
+        }
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,299 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/PerCpu.hpp"
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <array>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <unistd.h>
+
+#include "testing/Shared.hpp"
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::IpcPerCpuCounter;
+using wjh::IpcPerCpuFreelist;
+using wjh::IpcPerCpuRing;
+using wjh::testing::Shared;
+
+TEST_SUITE("PerCpu")
+{
+    template <typename FnT>
+    void in_processes(int nprocs, FnT fn)
+    {
+        std::vector<pid_t> pids;
+        for (int i = 0; i < nprocs; ++i) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                fn(i);
+                ::_exit(0);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            CHECK(WIFEXITED(status));
+        }
+    }
+
+    template <typename FnT>
+    void in_threads(int nthreads, FnT fn)
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < nthreads; ++i) {
+            threads.emplace_back(fn, i);
+        }
+        for (auto & t : threads) {
+            t.join();
+        }
+    }
+
+    // Pins the calling thread to one CPU, while in scope.
+    struct Pin
+    {
+        explicit Pin(std::size_t cpu)
+        {
+            ::sched_getaffinity(0, sizeof(saved), &saved);
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            REQUIRE(::sched_setaffinity(0, sizeof(set), &set) == 0);
+        }
+
+        ~Pin() { ::sched_setaffinity(0, sizeof(saved), &saved); }
+
+        void operator = (Pin &&) = delete;
+
+    private:
+        cpu_set_t saved;
+    };
+
+    std::vector<std::size_t> allowed_cpus()
+    {
+        cpu_set_t set;
+        ::sched_getaffinity(0, sizeof(set), &set);
+        std::vector<std::size_t> result;
+        for (std::size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                result.push_back(cpu);
+            }
+        }
+        return result;
+    }
+
+    // Pop every index from every CPU's list.
+    template <typename FreelistT>
+    std::multiset<std::uint32_t> pop_all(FreelistT & freelist)
+    {
+        std::multiset<std::uint32_t> result;
+        for (auto cpu : allowed_cpus()) {
+            auto pin = Pin(cpu);
+            while (auto index = freelist.pop()) {
+                result.insert(*index);
+            }
+        }
+        return result;
+    }
+
+    TEST_CASE("current_cpu")
+    {
+        auto const n = std::max(1u, std::thread::hardware_concurrency());
+        CHECK(wjh::current_cpu() < n);
+#if defined(__linux__) && defined(__x86_64__)
+        CHECK(wjh::rseq_supported());
+#endif
+    }
+
+    template <std::size_t MaxCpus>
+    void check_counter()
+    {
+        auto counter = Shared<IpcPerCpuCounter<MaxCpus>>{};
+        CHECK(counter->value() == 0);
+
+        SUBCASE("add") {
+            counter->add();
+            counter->add(41);
+            counter->add(-2);
+            CHECK(counter->value() == 40);
+        }
+
+        SUBCASE("threads") {
+            in_threads(4, [&](int) {
+                for (int i = 0; i < 100000; ++i) {
+                    counter->add();
+                }
+            });
+            CHECK(counter->value() == 400000);
+        }
+
+        SUBCASE("processes") {
+            in_processes(4, [&](int) {
+                for (int i = 0; i < 100000; ++i) {
+                    counter->add(2);
+                }
+            });
+            CHECK(counter->value() == 800000);
+        }
+    }
+
+    TEST_CASE("IpcPerCpuCounter")
+    {
+        check_counter<256>();
+    }
+
+    TEST_CASE("IpcPerCpuCounter with only the shared slot")
+    {
+        check_counter<0>();
+    }
+
+    template <std::size_t MaxCpus>
+    void check_freelist()
+    {
+        constexpr std::uint32_t capacity = 64;
+        using Freelist = IpcPerCpuFreelist<MaxCpus, capacity>;
+        auto freelist = Shared<Freelist>{};
+        CHECK(freelist->pop() == std::nullopt);
+        for (std::uint32_t i = 0; i < capacity; ++i) {
+            freelist->push(i);
+        }
+
+        SUBCASE("pop returns each index once") {
+            auto const seen = pop_all(*freelist);
+            CHECK(seen.size() == capacity);
+            CHECK(std::set<std::uint32_t>(seen.begin(), seen.end()).size() ==
+                capacity);
+            CHECK(*seen.rbegin() < capacity);
+        }
+
+        SUBCASE("processes") {
+            struct Owners
+            {
+                std::array<wjh::Atomic<std::uint32_t>, capacity> owner;
+                wjh::Atomic<std::uint32_t> errors;
+            };
+            auto owners = Shared<Owners>{};
+            in_processes(4, [&](int id) {
+                auto const me = static_cast<std::uint32_t>(id + 1);
+                for (int i = 0; i < 20000; ++i) {
+                    if (auto index = freelist->pop()) {
+                        auto & owner = owners->owner[*index];
+                        if (owner.exchange(me) != 0u) {
+                            owners->errors.fetch_add(1u);
+                        }
+                        owner.store(0u);
+                        freelist->push(*index);
+                    }
+                }
+            });
+            CHECK(owners->errors.load() == 0u);
+
+            // Every index is still free, exactly once.
+            auto const seen = pop_all(*freelist);
+            CHECK(seen.size() == capacity);
+            CHECK(std::set<std::uint32_t>(seen.begin(), seen.end()).size() ==
+                capacity);
+        }
+    }
+
+    TEST_CASE("IpcPerCpuFreelist")
+    {
+        check_freelist<256>();
+    }
+
+    TEST_CASE("IpcPerCpuFreelist with only the shared list")
+    {
+        check_freelist<0>();
+    }
+
+    template <std::size_t MaxCpus>
+    void check_ring()
+    {
+        constexpr std::uint32_t capacity = 16;
+        using Ring = IpcPerCpuRing<MaxCpus, capacity>;
+        auto ring = Shared<Ring>{};
+        std::array<std::uint64_t, 32> out;
+
+        auto drain = [&](auto fn) {
+            for (std::size_t r = 0; r < Ring::rings; ++r) {
+                while (auto n = ring->consume(r, out)) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        fn(out[i]);
+                    }
+                }
+            }
+        };
+
+        SUBCASE("fills up, and drains in order") {
+            // Every push goes to the same ring.
+            auto pin = Pin(allowed_cpus().front());
+            std::vector<std::uint64_t> values;
+            std::uint64_t pushed = 0;
+            while (ring->try_push(pushed + 1)) {
+                ++pushed;
+                REQUIRE(pushed <= capacity);
+            }
+            CHECK(pushed == capacity);
+            drain([&](std::uint64_t v) { values.push_back(v); });
+            CHECK(values.size() == pushed);
+            CHECK(std::is_sorted(values.begin(), values.end()));
+            CHECK(ring->try_push(99));
+        }
+
+        SUBCASE("processes") {
+            struct Sum
+            {
+                wjh::Atomic<std::uint64_t> sum;
+                wjh::Atomic<std::uint64_t> count;
+                wjh::Atomic<std::uint32_t> done;
+            };
+            auto sum = Shared<Sum>{};
+            constexpr int nprocs = 3;
+            constexpr std::uint64_t per_proc = 20000;
+            std::thread consumer([&] {
+                auto consume = [&](std::uint64_t v) {
+                    sum->sum.fetch_add(v);
+                    sum->count.fetch_add(1u);
+                };
+                while (sum->done.load() == 0u) {
+                    drain(consume);
+                    std::this_thread::yield();
+                }
+                drain(consume);
+            });
+            in_processes(nprocs, [&](int) {
+                for (std::uint64_t i = 1; i <= per_proc; ++i) {
+                    while (not ring->try_push(i)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            sum->done.store(1u);
+            consumer.join();
+            CHECK(sum->count.load() == nprocs * per_proc);
+            CHECK(sum->sum.load() == nprocs * per_proc * (per_proc + 1) / 2);
+        }
+    }
+
+    TEST_CASE("IpcPerCpuRing")
+    {
+        check_ring<256>();
+    }
+
+    TEST_CASE("IpcPerCpuRing with only the shared ring")
+    {
+        check_ring<0>();
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,113 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/Prefault.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::GrowableSegment;
+using wjh::PrefaultMode;
+using wjh::Segment;
+
+TEST_SUITE("Prefault")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_fault.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    std::size_t resident(std::byte * data, std::size_t size)
+    {
+        auto const page = Segment::page_size();
+        std::vector<unsigned char> pages((size + page - 1) / page);
+        REQUIRE(::mincore(data, size, pages.data()) == 0);
+        std::size_t result = 0;
+        for (auto p : pages) {
+            result += p & 1u;
+        }
+        return result;
+    }
+
+    TEST_CASE("segment")
+    {
+        auto dir = TempDir{};
+        auto const page = Segment::page_size();
+        auto segment = Segment(dir.path / "seg", 64 * page);
+        std::memcpy(segment.data() + 5 * page, "hello", 5);
+
+        SUBCASE("write") {
+            auto const report = wjh::prefault(segment, 4);
+            CHECK(report.pages == 64u);
+            CHECK(report.threads == 4u);
+            CHECK(not report.locked);
+            CHECK(report.elapsed.count() > 0);
+            CHECK(resident(segment.data(), segment.size()) == 64u);
+        }
+
+        SUBCASE("read") {
+            auto const report = wjh::prefault(segment, 1, PrefaultMode::read);
+            CHECK(report.pages == 64u);
+            CHECK(report.threads == 1u);
+            CHECK(resident(segment.data(), segment.size()) == 64u);
+        }
+
+        SUBCASE("locked") {
+            auto const report =
+                wjh::prefault(segment, 0, PrefaultMode::write, true);
+            CHECK(report.locked);
+            CHECK(report.threads >= 1u);
+            ::munlock(segment.data(), segment.size());
+        }
+
+        SUBCASE("more threads than pages") {
+            auto const report =
+                wjh::prefault(std::span(segment.data() + 10, 2 * page), 16);
+            CHECK(report.pages == 3u);
+            CHECK(report.threads == 3u);
+        }
+
+        SUBCASE("nothing") {
+            auto const report = wjh::prefault(std::span<std::byte>());
+            CHECK(report.pages == 0u);
+        }
+
+        CHECK(std::memcmp(segment.data() + 5 * page, "hello", 5) == 0);
+    }
+
+    TEST_CASE("growable segment")
+    {
+        auto dir = TempDir{};
+        auto const page = Segment::page_size();
+        auto segment = GrowableSegment(dir.path / "seg", 8 * page, 64 * page);
+        auto const report = wjh::prefault(segment, 2);
+        CHECK(report.pages == 8u);
+        CHECK(resident(segment.data(), segment.size()) == 8u);
+    }
+}
+
+} // anonymous namespace
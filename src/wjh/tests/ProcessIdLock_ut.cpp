@@ -177,6 +177,24 @@ TEST_SUITE("ProcessIdLock")
         lock.unlock();
     }
 
+    TEST_CASE("owner and force_unlock")
+    {
+        auto lock = ProcessIdLock{};
+        auto const me = wjh::ProcessId::current();
+        CHECK(lock.owner() == wjh::ProcessId::null());
+        CHECK(not lock.force_unlock(wjh::ProcessId::null()));
+
+        REQUIRE(lock.try_lock());
+        CHECK(lock.owner() == me);
+        CHECK(not lock.force_unlock(wjh::ProcessId(
+            me.pid(),
+            ::timeval{me.start_time().tv_sec + 1, 0})));
+        CHECK(lock.owner() == me);
+        CHECK(lock.force_unlock(me));
+        CHECK(lock.owner() == wjh::ProcessId::null());
+        CHECK(not lock.force_unlock(me));
+    }
+
     TEST_CASE("ProcessIdLock in file")
     {
         auto guard = create_shared_lock_file();
@@ -196,6 +196,23 @@ TEST_SUITE("ProcessId")
             CHECK(other == child_id);
         }
     }
+
+    TEST_CASE("alive")
+    {
+        CHECK(ProcessId::current().alive());
+        CHECK(not ProcessId::null().alive());
+        if (auto pid = ::fork(); pid == 0) {
+            _Exit(0);
+        } else {
+            REQUIRE(pid != -1);
+            auto child_id = ProcessId::maybe(pid);
+            int status = -1;
+            REQUIRE(::waitpid(pid, &status, 0) == pid);
+            if (child_id) {
+                CHECK(not child_id->alive());
+            }
+        }
+    }
 }
 
 } // anonymous namespace
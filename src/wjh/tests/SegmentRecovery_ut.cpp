@@ -0,0 +1,186 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/SegmentRecovery.hpp"
+
+#include <sys/wait.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::Atomic;
+using wjh::IpcRecoveryTable;
+using wjh::ProcessId;
+using wjh::ProcessIdLock;
+using wjh::RecoveryAction;
+using wjh::RecoveryKind;
+using wjh::Segment;
+using wjh::WaitableProcessIdLock;
+
+TEST_SUITE("SegmentRecovery")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_recover.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    struct Layout
+    {
+        IpcRecoveryTable<8> table;
+        IpcRecoveryTable<1> small;
+        ProcessIdLock locks[2];
+        WaitableProcessIdLock waitable;
+        Atomic<ProcessId> owner;
+    };
+
+    Layout & layout(Segment & segment)
+    {
+        return *reinterpret_cast<Layout *>(segment.data());
+    }
+
+    // Lock everything in a child, and let it die holding it all.
+    ProcessId die_holding(std::filesystem::path const & path, Layout & words)
+    {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            auto segment = Segment(path);
+            auto & held = layout(segment);
+            held.locks[0].lock();
+            held.locks[1].lock();
+            held.waitable.lock();
+            held.owner.store(ProcessId::current());
+            ::_exit(0);
+        }
+        ::waitpid(pid, nullptr, 0);
+        return words.owner.load();
+    }
+
+    TEST_CASE("dead owners")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "seg";
+        auto segment = Segment(path, Segment::page_size());
+        auto & words = layout(segment);
+        CHECK(words.table.add(segment, words.locks[0], 1));
+        CHECK(words.table.add(segment, words.locks[1], 2));
+        CHECK(words.table.add(segment, words.waitable, 3));
+        CHECK(words.table.add(segment, words.owner, 4));
+        CHECK(words.table.entries().size() == 4u);
+
+        SUBCASE("are released, and probed once") {
+            auto const child = die_holding(path, words);
+            auto const report = wjh::recover_segment(segment, words.table);
+            CHECK(report.scanned == 4u);
+            CHECK(report.owners_checked == 1u);
+            CHECK(report.dead_owners == 1u);
+            REQUIRE(report.recovered.size() == 4u);
+            for (auto const & word : report.recovered) {
+                CHECK(word.owner == child);
+                CHECK(word.released);
+            }
+            CHECK(report.recovered[2].kind == RecoveryKind::waitable_lock);
+            CHECK(report.recovered[3].tag == 4u);
+
+            CHECK(words.locks[0].try_lock());
+            CHECK(words.locks[1].try_lock());
+            CHECK(words.waitable.try_lock());
+            CHECK(words.owner.load() == ProcessId::null());
+
+            // Nothing is left to recover.
+            auto const again = wjh::recover_segment(segment, words.table);
+            CHECK(again.dead_owners == 0u);
+            CHECK(again.recovered.empty());
+        }
+
+        SUBCASE("are only reported") {
+            auto const offset = reinterpret_cast<std::byte *>(&words.owner) -
+                segment.data();
+            auto & other = words.small;
+            CHECK(other.add(segment, words.owner, 9, RecoveryAction::report));
+            auto const child = die_holding(path, words);
+            auto const report = wjh::recover_segment(segment, other);
+            REQUIRE(report.recovered.size() == 1u);
+            CHECK(report.recovered[0].offset == std::uint64_t(offset));
+            CHECK(report.recovered[0].tag == 9u);
+            CHECK(not report.recovered[0].released);
+            CHECK(words.owner.load() == child);
+        }
+
+        SUBCASE("in the last word of the segment") {
+            // Smaller than a waitable lock, so it only fits by its own size.
+            static_assert(
+                sizeof(Atomic<ProcessId>) < sizeof(WaitableProcessIdLock));
+            auto & last = *reinterpret_cast<Atomic<ProcessId> *>(
+                segment.data() + segment.size() - sizeof(Atomic<ProcessId>));
+            auto & other = words.small;
+            CHECK(other.add(segment, last, 5));
+            last.store(die_holding(path, words));
+            auto const report = wjh::recover_segment(segment, other);
+            CHECK(report.scanned == 1u);
+            REQUIRE(report.recovered.size() == 1u);
+            CHECK(report.recovered[0].released);
+            CHECK(last.load() == ProcessId::null());
+        }
+
+        SUBCASE("not live ones") {
+            words.locks[0].lock();
+            auto const report = wjh::recover_segment(segment, words.table);
+            CHECK(report.owners_checked == 1u);
+            CHECK(report.dead_owners == 0u);
+            CHECK(report.recovered.empty());
+            CHECK(words.locks[0].owner() == ProcessId::current());
+            words.locks[0].unlock();
+        }
+    }
+
+    TEST_CASE("registration")
+    {
+        auto dir = TempDir{};
+        auto segment = Segment(dir.path / "seg", Segment::page_size());
+        auto & words = layout(segment);
+
+        SUBCASE("is idempotent") {
+            CHECK(words.table.add(segment, words.locks[0]));
+            CHECK(words.table.add(segment, words.locks[0]));
+            CHECK(words.table.entries().size() == 1u);
+        }
+
+        SUBCASE("stops when full") {
+            auto & small = words.small;
+            CHECK(small.add(segment, words.locks[0]));
+            CHECK(not small.add(segment, words.locks[1]));
+            CHECK(small.entries().size() == 1u);
+        }
+
+        SUBCASE("requires words in the segment") {
+            auto outside = ProcessIdLock{};
+            CHECK_THROWS_AS(
+                words.table.add(segment, outside),
+                std::out_of_range);
+        }
+    }
+}
+
+} // anonymous namespace
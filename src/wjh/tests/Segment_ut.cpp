@@ -0,0 +1,104 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#include "wjh/Segment.hpp"
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+#include "testing/doctest.hpp"
+
+namespace {
+using wjh::Segment;
+
+TEST_SUITE("Segment")
+{
+    struct TempDir
+    {
+        TempDir()
+        {
+            auto pattern =
+                (std::filesystem::temp_directory_path() / "wjh_segment.XXXXXX")
+                    .string();
+            REQUIRE(::mkdtemp(pattern.data()) != nullptr);
+            path = pattern;
+        }
+
+        ~TempDir() { std::filesystem::remove_all(path); }
+
+        void operator = (TempDir &&) = delete;
+
+        std::filesystem::path path;
+    };
+
+    TEST_CASE("create and reopen")
+    {
+        auto dir = TempDir{};
+        auto const path = dir.path / "seg";
+
+        {
+            auto segment = Segment(path, 10000);
+            CHECK(segment.size() == 10000u);
+            CHECK(segment.path() == path);
+            CHECK(std::all_of(
+                segment.data(),
+                segment.data() + segment.size(),
+                [](std::byte b) { return b == std::byte{0}; }));
+            std::memcpy(segment.data() + 5000, "hello", 5);
+            segment.sync(5000, 5);
+            segment.sync();
+        }
+
+        SUBCASE("existing") {
+            auto segment = Segment(path);
+            CHECK(segment.size() == 10000u);
+            CHECK(std::memcmp(segment.data() + 5000, "hello", 5) == 0);
+        }
+
+        SUBCASE("extended") {
+            auto segment = Segment(path, 20000);
+            CHECK(segment.size() == 20000u);
+            CHECK(std::memcmp(segment.data() + 5000, "hello", 5) == 0);
+            CHECK(segment.data()[15000] == std::byte{0});
+        }
+
+        SUBCASE("never shrunk") {
+            auto segment = Segment(path, 100);
+            CHECK(segment.size() == 10000u);
+        }
+    }
+
+    TEST_CASE("shared between processes")
+    {
+        auto dir = TempDir{};
+        auto segment = Segment(dir.path / "seg", Segment::page_size());
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            auto child = Segment(dir.path / "seg");
+            child.data()[7] = std::byte{42};
+            ::_exit(0);
+        }
+        ::waitpid(pid, nullptr, 0);
+        CHECK(segment.data()[7] == std::byte{42});
+    }
+
+    TEST_CASE("errors")
+    {
+        auto dir = TempDir{};
+        CHECK_THROWS_AS(Segment(dir.path / "missing"), std::system_error);
+        CHECK_THROWS_AS(Segment(dir.path / "empty", 0), std::system_error);
+    }
+}
+
+} // anonymous namespace
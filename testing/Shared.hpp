@@ -0,0 +1,60 @@
+// ======================================================================
+// Copyright 2025 Jody Hagins
+// Distributed under the MIT Software License
+// See accompanying file LICENSE or copy at
+// https://opensource.org/licenses/MIT
+// ======================================================================
+#ifndef WJH_585c280b6a314e05a137e3fa5b0d7e91
+#define WJH_585c280b6a314e05a137e3fa5b0d7e91
+
+#include "doctest.hpp"
+
+#include <sys/mman.h>
+
+#include <new>
+
+namespace wjh::testing {
+
+/**
+ * A value-initialized T in anonymous shared memory, zero-filled, that
+ * survives fork, so that tests can share it with the processes they fork.
+ *
+ * The T is never destroyed; as with anything else placed in shared memory,
+ * the last process to unmap it just lets it go.
+ */
+template <typename T>
+class Shared
+{
+public:
+    Shared()
+    : data_(::new (map()) T{})
+    { }
+
+    ~Shared() { ::munmap(data_, sizeof(T)); }
+
+    void operator = (Shared &&) = delete;
+
+    T * get() const noexcept { return data_; }
+    T * operator -> () const noexcept { return data_; }
+    T & operator * () const noexcept { return *data_; }
+
+private:
+    static void * map()
+    {
+        void * addr = ::mmap(
+            nullptr,
+            sizeof(T),
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS,
+            -1,
+            0);
+        REQUIRE(addr != MAP_FAILED);
+        return addr;
+    }
+
+    T * data_;
+};
+
+} // namespace wjh::testing
+
+#endif // WJH_585c280b6a314e05a137e3fa5b0d7e91